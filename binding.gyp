@@ -5,8 +5,13 @@
       'target_name': 'mysql_bindings',
       'sources': [
         'src/mysql_bindings.cc',
+        'src/mysql_bindings_arrow.cc',
         'src/mysql_bindings_connection.cc',
+        'src/mysql_bindings_dictionary.cc',
+        'src/mysql_bindings_json.cc',
+        'src/mysql_bindings_lazy_row.cc',
         'src/mysql_bindings_result.cc',
+        'src/mysql_bindings_shard_router.cc',
         'src/mysql_bindings_statement.cc',
       ],
       "include_dirs" : [
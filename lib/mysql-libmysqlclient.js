@@ -69,6 +69,16 @@ for (var key in bindings) {
   }
 }
 
+/** section: Exports
+ * MysqlLibmysqlclient.classifyQuerySync(query) -> Integer
+ * - query (String): Query
+ *
+ * Classifies query for read/write splitting, returns one of
+ * QUERY_TYPE_READ, QUERY_TYPE_WRITE, QUERY_TYPE_BEGIN or QUERY_TYPE_END.
+ * Does not require connection.
+ **/
+exports.classifyQuerySync = bindings.classifyQuerySync;
+
 /**
  * MysqlLibmysqlclient
  *
@@ -207,16 +217,15 @@ exports.createConnection = function createConnection() {
  * class MysqlConnectionQueued < MysqlConnection
  *
  * MySQL connection with queries queue
+ *
+ * Queue lives in native MysqlConnection, see MysqlConnection#enqueue(),
+ * so queries can have priority and deadline options
  **/
 var MysqlConnectionQueued = function MysqlConnectionQueued() {
   // Hacky inheritance
   var connection = new bindings.MysqlConnection();
   connection.__proto__ = MysqlConnectionQueued.prototype;
 
-  // Queries queue
-  connection._queueBlocked = false;
-  connection._queue = [];
-
   return connection;
 };
 
@@ -224,56 +233,15 @@ var MysqlConnectionQueued = function MysqlConnectionQueued() {
 MysqlConnectionQueued.prototype = new bindings.MysqlConnection();
 
 /*!
- * MysqlConnectionQueued#_processQueue()
+ * MysqlConnectionQueued#_enqueue(method, args)
  *
- * Process MysqlConnectionQueued internal queue for connect and queries
+ * Adds method call to connection queue
  **/
-MysqlConnectionQueued.prototype._processQueue = function () {
-  if (this._queueBlocked) {
-    return;
-  }
-
-  if (this._queue.length == 0) {
-    return;
-  }
-
-  var data = this._queue.shift();
-  var method = data[0];
-  var methodArguments = data[1];
-  var callback = data[2];
-  data = null;
-
-  var self = this;
-  var realCallback = function () {
-    var args = Array.prototype.slice.call(arguments);
-
-    process.nextTick(function () {
-      self._queueBlocked = false;
-      self._processQueue();
-    });
-
-    if (typeof callback == "function") {
-      callback.apply(null, args);
-    }
-  };
-
-  methodArguments.push(realCallback);
-
-  self._queueBlocked = true;
+MysqlConnectionQueued.prototype._enqueue = function (method, args) {
+  args = Array.prototype.slice.call(args);
+  args.unshift(method);
 
-  switch (method) {
-    case 'connect':
-      bindings.MysqlConnection.prototype.connect.apply(this, methodArguments);
-      break;
-    case 'query':
-      bindings.MysqlConnection.prototype.query.apply(this, methodArguments);
-      break;
-    case 'querySend':
-      bindings.MysqlConnection.prototype.querySend.apply(this, methodArguments);
-      break;
-    default:
-      throw new Error("mysql-libmysqlclient internal error: wrong method in queue");
-  }
+  bindings.MysqlConnection.prototype.enqueue.apply(this, args);
 };
 
 /**
@@ -286,6 +254,8 @@ MysqlConnectionQueued.prototype._processQueue = function () {
  * MysqlConnectionQueued#connect(hostname, user, password, database, port, socket, flags[, callback])
  *
  * Connects to the MySQL server
+ *
+ * Queries queued before connect is completed are sent after it
  **/
 MysqlConnectionQueued.prototype.connect = function connect() {
   var args = Array.prototype.slice.call(arguments);
@@ -295,38 +265,48 @@ MysqlConnectionQueued.prototype.connect = function connect() {
   var callback = args.pop();
   if (typeof callback != 'function') {
     args.push(callback);
-    callback = null;
+    callback = function () {};
   }
 
-  this._queue.push(['connect', args, callback]);
+  args.push(callback);
 
-  this._processQueue();
+  bindings.MysqlConnection.prototype.connect.apply(this, args);
 };
 
 /**
- * MysqlConnectionQueued#query(query[, callback])
+ * MysqlConnectionQueued#query(query[, options][, callback])
  *
  * Performs a query on the database
  *
  * Uses mysql_real_query()
+ *
+ * Options are `priority`, `deadlineMs` and `timeoutMs`,
+ * see MysqlConnection#enqueue()
  **/
-MysqlConnectionQueued.prototype.query = function query(query, callback) {
-  this._queue.push(['query', [query], callback]);
-
-  this._processQueue();
+MysqlConnectionQueued.prototype.query = function query() {
+  this._enqueue('query', arguments);
 };
 
 /**
- * MysqlConnectionQueued#querySend(query[, callback])
+ * MysqlConnectionQueued#querySend(query[, options][, callback])
  *
  * Performs a query on the database
  *
  * Uses mysql_send_query()
  **/
-MysqlConnectionQueued.prototype.querySend = function querySend(query, callback) {
-  this._queue.push(['querySend', [query], callback]);
+MysqlConnectionQueued.prototype.querySend = function querySend() {
+  this._enqueue('querySend', arguments);
+};
 
-  this._processQueue();
+/**
+ * MysqlConnectionQueued#multiQuery(query[, options][, callback])
+ *
+ * Performs a multi query on the database
+ *
+ * Callback gets all result sets and OK packets as one array
+ **/
+MysqlConnectionQueued.prototype.multiQuery = function multiQuery() {
+  this._enqueue('multiQuery', arguments);
 };
 
 /*!
@@ -559,3 +539,719 @@ exports.createConnectionHighlevel = function createConnectionHighlevel() {
  * Export MysqlConnectionQueued
  */
 exports.MysqlConnectionHighlevel = MysqlConnectionHighlevel;
+
+/** section: Classes
+ * class MysqlRouter
+ *
+ * Read/write splitting router over primary and replicas connections
+ *
+ * Reads are sent to the replica with lowest queries time EWMA
+ * (MysqlConnection#queryTimeEwma), writes and transactions
+ * go to the primary. Reads are also pinned
+ * to the primary for `readAfterWriteMs` after the last write,
+ * so they see the data they have just written.
+ **/
+var MysqlRouter = function MysqlRouter(primary, replicas, options) {
+  if (!primary) {
+    throw new Error("mysql-libmysqlclient error: MysqlRouter requires primary connection");
+  }
+
+  options = options || {};
+
+  this._primary = primary;
+  this._replicas = replicas || [];
+  this._readAfterWriteMs = (typeof options.readAfterWriteMs == 'number') ? options.readAfterWriteMs : 1000;
+
+  this._inTransaction = false;
+  // BEGIN queries sent, but not completed yet
+  this._beginsPending = 0;
+  this._lastWriteAt = 0;
+};
+
+/**
+ * MysqlRouter#classifyQuerySync(query) -> Integer
+ *
+ * Classifies query, returns one of QUERY_TYPE_* constants
+ **/
+MysqlRouter.prototype.classifyQuerySync = function classifyQuerySync(query) {
+  return exports.classifyQuerySync(query);
+};
+
+/*!
+ * MysqlRouter#_pickReplica() -> Integer
+ *
+ * Gets index of connected replica with lowest queries time EWMA, or -1
+ **/
+MysqlRouter.prototype._pickReplica = function () {
+  var best = -1, bestTime = Infinity, time, i;
+
+  for (i = 0; i < this._replicas.length; i += 1) {
+    if (typeof this._replicas[i].connectedSync == 'function' && !this._replicas[i].connectedSync()) {
+      continue;
+    }
+
+    // Replicas without timings yet have 0 and will be tried first
+    time = this._replicas[i].queryTimeEwma;
+    if (time < bestTime) {
+      best = i;
+      bestTime = time;
+    }
+  }
+
+  return best;
+};
+
+/**
+ * MysqlRouter#getConnectionSync(query) -> MysqlConnection
+ *
+ * Gets connection the query will be routed to
+ **/
+MysqlRouter.prototype.getConnectionSync = function getConnectionSync(query) {
+  var index = this._route(this.classifyQuerySync(query));
+
+  return index < 0 ? this._primary : this._replicas[index];
+};
+
+/*!
+ * MysqlRouter#_route(queryType) -> Integer
+ *
+ * Gets replica index for query type, or -1 for the primary
+ **/
+MysqlRouter.prototype._route = function (queryType) {
+  if (queryType != exports.QUERY_TYPE_READ) {
+    return -1;
+  }
+
+  if (this._inTransaction || this._beginsPending > 0 ||
+      (Date.now() - this._lastWriteAt < this._readAfterWriteMs)) {
+    return -1;
+  }
+
+  return this._pickReplica();
+};
+
+/**
+ * MysqlRouter#query(query[, options][, callback])
+ *
+ * Performs a query on the primary or one of replicas
+ **/
+MysqlRouter.prototype.query = function query(query, options, callback) {
+  var
+    self = this,
+    queryType = this.classifyQuerySync(query),
+    index,
+    args;
+
+  if (typeof options == 'function') {
+    callback = options;
+    options = null;
+  }
+
+  switch (queryType) {
+    case exports.QUERY_TYPE_BEGIN:
+      // Reads are pinned to the primary until BEGIN result is known
+      this._beginsPending += 1;
+      break;
+    case exports.QUERY_TYPE_END:
+    case exports.QUERY_TYPE_WRITE:
+      this._lastWriteAt = Date.now();
+      break;
+  }
+
+  index = this._route(queryType);
+  args = options ? [query, options] : [query];
+
+  if (index >= 0) {
+    if (typeof callback == "function") {
+      args.push(callback);
+    }
+
+    this._replicas[index].query.apply(this._replicas[index], args);
+    return;
+  }
+
+  args.push(function (err) {
+    switch (queryType) {
+      case exports.QUERY_TYPE_BEGIN:
+        self._beginsPending -= 1;
+        // Failed BEGIN does not open transaction
+        if (!err) {
+          self._inTransaction = true;
+        }
+        break;
+      case exports.QUERY_TYPE_END:
+        if (!err) {
+          self._inTransaction = false;
+        }
+        // Read-after-write window starts when write is completed
+        self._lastWriteAt = Date.now();
+        break;
+      case exports.QUERY_TYPE_WRITE:
+        self._lastWriteAt = Date.now();
+        break;
+    }
+
+    if (typeof callback == "function") {
+      callback.apply(null, arguments);
+    }
+  });
+
+  this._primary.query.apply(this._primary, args);
+};
+
+/*!
+ * Export MysqlRouter
+ */
+exports.MysqlRouter = MysqlRouter;
+
+/** section: Exports
+ * MysqlLibmysqlclient.createRouter(primary, replicas[, options]) -> MysqlRouter
+ * - primary (MysqlConnection): Connection for writes and transactions
+ * - replicas (Array): Connections for reads
+ * - options (Object): `readAfterWriteMs`, defaults to 1000
+ *
+ * Creates read/write splitting router
+ **/
+exports.createRouter = function createRouter(primary, replicas, options) {
+  return new MysqlRouter(primary, replicas, options);
+};
+
+/** section: Classes
+ * class MysqlShardRouter
+ *
+ * Sharding router over groups of connections
+ *
+ * Keys are mapped to shards with native consistent hashing ring,
+ * queries for a key are sent to one of its shard connections.
+ * Scatter-gather queries run on all shards in parallel
+ * and are merged in threadpool.
+ **/
+var MysqlShardRouter = function MysqlShardRouter(shards, options) {
+  options = options || {};
+
+  // Hacky inheritance
+  var router = new bindings.MysqlShardRouter(options.virtualNodes);
+  router.__proto__ = MysqlShardRouter.prototype;
+
+  router._shards = {};
+
+  Object.keys(shards || {}).forEach(function (name) {
+    router.addShardSync(name, shards[name]);
+  });
+
+  return router;
+};
+
+// Hacky inheritance
+MysqlShardRouter.prototype = new bindings.MysqlShardRouter();
+
+/**
+ * MysqlShardRouter#addShardSync(name, connections) -> Integer
+ * - name (String): Shard name
+ * - connections (Array|MysqlConnection): Shard connections
+ *
+ * Adds shard, returns shards count
+ **/
+MysqlShardRouter.prototype.addShardSync = function addShardSync(name, connections) {
+  if (!Array.isArray(connections)) {
+    connections = connections ? [connections] : [];
+  }
+
+  if (connections.length === 0) {
+    throw new Error("mysql-libmysqlclient error: MysqlShardRouter shard requires connections");
+  }
+
+  var count = bindings.MysqlShardRouter.prototype.addShardSync.call(this, name);
+
+  this._shards[name] = {connections: connections, next: 0};
+
+  return count;
+};
+
+/**
+ * MysqlShardRouter#removeShardSync(name) -> Boolean
+ *
+ * Removes shard, its connections are not closed
+ **/
+MysqlShardRouter.prototype.removeShardSync = function removeShardSync(name) {
+  delete this._shards[name];
+
+  return bindings.MysqlShardRouter.prototype.removeShardSync.call(this, name);
+};
+
+/*!
+ * MysqlShardRouter#_pickConnection(name) -> MysqlConnection
+ *
+ * Gets next connected connection of the shard, round-robin
+ **/
+MysqlShardRouter.prototype._pickConnection = function (name) {
+  var shard = this._shards[name], connection, i;
+
+  for (i = 0; i < shard.connections.length; i += 1) {
+    connection = shard.connections[shard.next];
+    shard.next = (shard.next + 1) % shard.connections.length;
+
+    if (typeof connection.connectedSync != 'function' || connection.connectedSync()) {
+      return connection;
+    }
+  }
+
+  // Let the connection report its error
+  return connection;
+};
+
+/**
+ * MysqlShardRouter#getConnectionSync(key) -> MysqlConnection
+ *
+ * Gets connection the key queries will be sent to
+ **/
+MysqlShardRouter.prototype.getConnectionSync = function getConnectionSync(key) {
+  return this._pickConnection(this.getShardSync(key));
+};
+
+/**
+ * MysqlShardRouter#query(key, query[, options][, callback])
+ *
+ * Performs a query on the key shard
+ **/
+MysqlShardRouter.prototype.query = function query(key, query, options, callback) {
+  var connection = this.getConnectionSync(key);
+
+  connection.query.apply(connection, Array.prototype.slice.call(arguments, 1));
+};
+
+/**
+ * MysqlShardRouter#execute(key, query, params, callback)
+ *
+ * Prepares and executes a statement on the key shard,
+ * callback gets (error, rows) for queries with result set
+ * and (error, {affectedRows, insertId}) for others
+ **/
+MysqlShardRouter.prototype.execute = function execute(key, query, params, callback) {
+  var
+    connection = this.getConnectionSync(key),
+    stmt = connection.initStatementSync(),
+    error;
+
+  if (!stmt) {
+    return callback(new Error("Statement init error #" + connection.errnoSync() + ": " + connection.errorSync()));
+  }
+
+  if (!stmt.prepareSync(query)) {
+    error = new Error("Statement error #" + stmt.errnoSync() + ": " + stmt.errorSync());
+    stmt.closeSync();
+    return callback(error);
+  }
+
+  stmt.run(params || [], function (err, result) {
+    stmt.closeSync();
+    callback(err, result);
+  });
+};
+
+/**
+ * MysqlShardRouter#scatter(query[, options], callback)
+ *
+ * Runs query on one connection of every shard in parallel,
+ * callback gets (error, rows, fields) with merged rows.
+ * See native MysqlShardRouter#scatter() for options
+ **/
+MysqlShardRouter.prototype.scatter = function scatter(query, options, callback) {
+  var self = this, connections = Object.keys(this._shards).map(function (name) {
+    return self._pickConnection(name);
+  });
+
+  bindings.MysqlShardRouter.prototype.scatter.apply(this, [connections].concat(Array.prototype.slice.call(arguments)));
+};
+
+/*!
+ * Export MysqlShardRouter
+ */
+exports.MysqlShardRouter = MysqlShardRouter;
+
+/** section: Exports
+ * MysqlLibmysqlclient.createShardRouter(shards[, options]) -> MysqlShardRouter
+ * - shards (Object): Shard name to connections array map
+ * - options (Object): `virtualNodes`, points on the hash ring per shard, defaults to 160
+ *
+ * Creates sharding router
+ **/
+exports.createShardRouter = function createShardRouter(shards, options) {
+  return new MysqlShardRouter(shards, options);
+};
+
+/** section: Classes
+ * class MysqlInsertBuffer
+ *
+ * Write coalescing buffer over connection
+ *
+ * Rows inserted with bufferedInsert() by independent callers are collected
+ * for `windowMs` milliseconds or up to `maxRows` rows and written with one
+ * multi-row INSERT, or with LOAD DATA LOCAL INFILE from buffer if `loadData`
+ * option is set (connection needs MYSQL_OPT_LOCAL_INFILE for that
+ * and must be MysqlConnectionQueued, so warnings are read before next query).
+ *
+ * Each caller gets its own insertId, assuming consecutive auto increment
+ * values for one statement (innodb_autoinc_lock_mode 0 or 1,
+ * step is `autoIncrementIncrement` option). Auto increment column of table
+ * is looked up once, rows of tables without it or rows setting it explicitly
+ * get no insertId. If statement fails, all rows of the batch get the error.
+ * LOAD DATA turns bad rows to warnings, so a batch with warnings
+ * or skipped rows fails too, error has `warnings` array.
+ *
+ * Dates are written in UTC as 'YYYY-MM-DD HH:MM:SS[.ffffff]', the way DATETIME
+ * values are read, Buffers are written as hex.
+ **/
+var MysqlInsertBuffer = function MysqlInsertBuffer(connection, options) {
+  if (!connection) {
+    throw new Error("mysql-libmysqlclient error: MysqlInsertBuffer requires connection");
+  }
+
+  options = options || {};
+
+  // Warnings are read with sync calls in LOAD DATA callback,
+  // only queue guarantees no other query runs on connection meanwhile
+  if (options.loadData && !(connection instanceof MysqlConnectionQueued)) {
+    throw new Error("mysql-libmysqlclient error: MysqlInsertBuffer with loadData requires MysqlConnectionQueued");
+  }
+
+  this._connection = connection;
+  this._windowMs = (typeof options.windowMs == 'number') ? options.windowMs : 10;
+  this._maxRows = options.maxRows || 1000;
+  this._loadData = !!options.loadData;
+  this._autoIncrementIncrement = options.autoIncrementIncrement || 1;
+
+  // Pending batches by table and columns list
+  this._batches = {};
+
+  // Auto increment column names by table, null if table has none,
+  // and batches waiting for lookup
+  this._autoIncrementColumns = {};
+  this._autoIncrementLookups = {};
+};
+
+/*!
+ * MysqlInsertBuffer#_quoteIdentifier(name) -> String
+ *
+ * Quotes table or column name
+ **/
+MysqlInsertBuffer.prototype._quoteIdentifier = function (name) {
+  return "`" + String(name).replace(/`/g, "``") + "`";
+};
+
+/*!
+ * MysqlInsertBuffer#_textValue(value) -> String|null
+ *
+ * Gets value text, null for NULL values. Buffers are not handled here
+ **/
+MysqlInsertBuffer.prototype._textValue = function (value) {
+  if (value === null || value === undefined) {
+    return null;
+  }
+
+  if (typeof value == 'number') {
+    return isFinite(value) ? String(value) : null;
+  }
+
+  if (typeof value == 'boolean') {
+    return value ? "1" : "0";
+  }
+
+  if (value instanceof Date) {
+    if (isNaN(value.getTime())) {
+      return null;
+    }
+
+    var pad = function (number, length) {
+      return ("000" + number).slice(-length);
+    };
+
+    return pad(value.getUTCFullYear(), 4) + "-" + pad(value.getUTCMonth() + 1, 2) + "-" +
+           pad(value.getUTCDate(), 2) + " " + pad(value.getUTCHours(), 2) + ":" +
+           pad(value.getUTCMinutes(), 2) + ":" + pad(value.getUTCSeconds(), 2) +
+           (value.getUTCMilliseconds() ? "." + pad(value.getUTCMilliseconds(), 3) + "000" : "");
+  }
+
+  return String(value);
+};
+
+/*!
+ * MysqlInsertBuffer#_sqlValue(value) -> String
+ *
+ * Gets value as SQL literal for INSERT
+ **/
+MysqlInsertBuffer.prototype._sqlValue = function (value) {
+  if (Buffer.isBuffer(value)) {
+    return "X'" + value.toString('hex') + "'";
+  }
+
+  var text = this._textValue(value);
+  if (text === null) {
+    return "NULL";
+  }
+
+  return (typeof value == 'number' || typeof value == 'boolean') ? text :
+         "'" + this._connection.escapeSync(text) + "'";
+};
+
+/*!
+ * MysqlInsertBuffer#_tsvValue(value, hex) -> String
+ *
+ * Gets value as LOAD DATA field with default escaping,
+ * hex columns are loaded with UNHEX(), see MysqlInsertBuffer#_flush()
+ **/
+MysqlInsertBuffer.prototype._tsvValue = function (value, hex) {
+  // Buffers are only in hex columns
+  if (Buffer.isBuffer(value)) {
+    return value.toString('hex');
+  }
+
+  var text = this._textValue(value);
+  if (text === null) {
+    return "\\N";
+  }
+
+  if (hex) {
+    return new Buffer(text).toString('hex');
+  }
+
+  return text.replace(/[\\\t\n\r\0]/g, function (c) {
+    switch (c) {
+      case "\t": return "\\t";
+      case "\n": return "\\n";
+      case "\r": return "\\r";
+      case "\0": return "\\0";
+    }
+    return "\\\\";
+  });
+};
+
+/*!
+ * MysqlInsertBuffer#_autoIncrementColumn(table, callback)
+ *
+ * Gets auto increment column name of table, null if there is none
+ **/
+MysqlInsertBuffer.prototype._autoIncrementColumn = function (table, callback) {
+  var self = this, query;
+
+  if (this._autoIncrementColumns.hasOwnProperty(table)) {
+    callback(null, this._autoIncrementColumns[table]);
+    return;
+  }
+
+  if (this._autoIncrementLookups.hasOwnProperty(table)) {
+    this._autoIncrementLookups[table].push(callback);
+    return;
+  }
+  this._autoIncrementLookups[table] = [callback];
+
+  query = "SHOW COLUMNS FROM " + this._quoteIdentifier(table) + " WHERE Extra LIKE '%auto_increment%';";
+
+  this._connection.query(query, function (err, res) {
+    var callbacks = self._autoIncrementLookups[table], column = null, rows;
+
+    delete self._autoIncrementLookups[table];
+
+    if (!err) {
+      rows = res.fetchAllSync();
+      res.freeSync();
+
+      column = rows.length ? rows[0].Field : null;
+      self._autoIncrementColumns[table] = column;
+    }
+
+    callbacks.forEach(function (callback) {
+      callback(err || null, column);
+    });
+  });
+};
+
+/**
+ * MysqlInsertBuffer#bufferedInsert(table, row[, callback])
+ * - table (String): Table name
+ * - row (Object): Row values by column names
+ * - callback (Function): Callback function, gets (error, info)
+ *
+ * Adds row to the batch of the table, info contains row `insertId`
+ * if table has auto increment column and row doesn't set it
+ **/
+MysqlInsertBuffer.prototype.bufferedInsert = function bufferedInsert(table, row, callback) {
+  var self = this, columns, key, batch;
+
+  if (typeof table != 'string' || !row || typeof row != 'object') {
+    throw new Error("mysql-libmysqlclient error: bufferedInsert() requires table name and row object");
+  }
+
+  columns = Object.keys(row);
+  if (columns.length === 0) {
+    throw new Error("mysql-libmysqlclient error: bufferedInsert() requires at least one column");
+  }
+
+  // Rows with other columns set go to separate statement
+  key = JSON.stringify([table, columns]);
+  batch = this._batches[key];
+
+  if (!batch) {
+    batch = this._batches[key] = {
+      table: table,
+      columns: columns,
+      rows: [],
+      callbacks: [],
+      timer: setTimeout(function () {
+        self._flush(key);
+      }, this._windowMs)
+    };
+  }
+
+  batch.rows.push(columns.map(function (column) {
+    return row[column];
+  }));
+  batch.callbacks.push(callback);
+
+  if (batch.rows.length >= this._maxRows) {
+    this._flush(key);
+  }
+};
+
+/**
+ * MysqlInsertBuffer#flush()
+ *
+ * Writes all pending batches without waiting for window end
+ **/
+MysqlInsertBuffer.prototype.flush = function flush() {
+  Object.keys(this._batches).forEach(this._flush, this);
+};
+
+/*!
+ * MysqlInsertBuffer#_flush(key)
+ *
+ * Writes batch after auto increment column of its table is known
+ **/
+MysqlInsertBuffer.prototype._flush = function (key) {
+  var self = this, batch = this._batches[key];
+
+  if (!batch) {
+    return;
+  }
+
+  clearTimeout(batch.timer);
+  delete this._batches[key];
+
+  this._autoIncrementColumn(batch.table, function (err, column) {
+    if (err) {
+      batch.callbacks.forEach(function (callback) {
+        if (typeof callback == "function") {
+          callback(err);
+        }
+      });
+      return;
+    }
+
+    // Column names are case insensitive
+    batch.mapInsertIds = (column !== null) && !batch.columns.some(function (batchColumn) {
+      return batchColumn.toLowerCase() === column.toLowerCase();
+    });
+
+    self._write(batch);
+  });
+};
+
+/*!
+ * MysqlInsertBuffer#_write(batch)
+ *
+ * Writes batch and maps result back to rows callbacks
+ **/
+MysqlInsertBuffer.prototype._write = function (batch) {
+  var self = this, columnsSql, query, args, hexColumns;
+
+  columnsSql = batch.columns.map(this._quoteIdentifier, this).join(", ");
+
+  if (this._loadData) {
+    // Binary data can't be passed in text file, columns with Buffers are hex encoded
+    hexColumns = batch.columns.map(function (column, j) {
+      return batch.rows.some(function (values) {
+        return Buffer.isBuffer(values[j]);
+      });
+    });
+
+    query = "LOAD DATA LOCAL INFILE 'buffered_insert' INTO TABLE " +
+            this._quoteIdentifier(batch.table) + " (" +
+            batch.columns.map(function (column, j) {
+              return hexColumns[j] ? "@hex" + j : self._quoteIdentifier(column);
+            }).join(", ") + ")";
+    if (hexColumns.indexOf(true) !== -1) {
+      query += " SET " + batch.columns.map(function (column, j) {
+        return hexColumns[j] ? self._quoteIdentifier(column) + " = UNHEX(@hex" + j + ")" : null;
+      }).filter(function (assignment) {
+        return assignment !== null;
+      }).join(", ");
+    }
+    query += ";";
+
+    args = [query, new Buffer(batch.rows.map(function (values) {
+      return values.map(function (value, j) {
+        return self._tsvValue(value, hexColumns[j]);
+      }).join("\t") + "\n";
+    }).join(""))];
+  } else {
+    query = "INSERT INTO " + this._quoteIdentifier(batch.table) + " (" + columnsSql + ") VALUES " +
+            batch.rows.map(function (values) {
+              return "(" + values.map(self._sqlValue, self).join(", ") + ")";
+            }).join(", ") + ";";
+    args = [query];
+  }
+
+  args.push(function (err, info) {
+    var warnings;
+
+    // Rows LOAD DATA skipped or changed are reported as warnings only
+    if (!err && self._loadData) {
+      warnings = self._connection.warningCountSync() ? self._connection.getWarningsSync() : [];
+      if (warnings.length > 0 || info.affectedRows !== batch.rows.length) {
+        err = new Error("mysql-libmysqlclient error: LOAD DATA wrote " + info.affectedRows + " of " +
+                        batch.rows.length + " rows with " + warnings.length + " warnings" +
+                        (warnings.length ? ", first: " + warnings[0].reason : ""));
+        err.warnings = warnings;
+      }
+    }
+
+    batch.callbacks.forEach(function (callback, i) {
+      if (typeof callback != "function") {
+        return;
+      }
+
+      if (err) {
+        callback(err);
+        return;
+      }
+
+      if (!batch.mapInsertIds) {
+        callback(null, {affectedRows: 1});
+        return;
+      }
+
+      callback(null, {
+        affectedRows: 1,
+        insertId: info.insertId + i * self._autoIncrementIncrement
+      });
+    });
+  });
+
+  this._connection.query.apply(this._connection, args);
+};
+
+/*!
+ * Export MysqlInsertBuffer
+ */
+exports.MysqlInsertBuffer = MysqlInsertBuffer;
+
+/** section: Exports
+ * MysqlLibmysqlclient.createInsertBuffer(connection[, options]) -> MysqlInsertBuffer
+ * - connection (MysqlConnection): Connection for inserts
+ * - options (Object): `windowMs` (10), `maxRows` (1000), `loadData` (false), `autoIncrementIncrement` (1)
+ *
+ * Creates write coalescing buffer
+ **/
+exports.createInsertBuffer = function createInsertBuffer(connection, options) {
+  return new MysqlInsertBuffer(connection, options);
+};
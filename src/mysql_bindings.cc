@@ -17,6 +17,86 @@
 #include "./mysql_bindings_connection.h"
 #include "./mysql_bindings_result.h"
 #include "./mysql_bindings_statement.h"
+#include "./mysql_bindings_shard_router.h"
+#include "./mysql_bindings_lazy_row.h"
+
+/*!
+ * Days since 1970-01-01 for proleptic Gregorian calendar date
+ */
+int64_t MysqlBindingsDaysFromCivil(int64_t year, int64_t month, int64_t day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t year_of_era = year - era * 400;
+    int64_t day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+
+    return era * 146097 + day_of_era - 719468;
+}
+
+/*!
+ * Integer mantissa digits of DECIMAL text for given scale, "-12.5" with scale 2 is "-1250".
+ * Returns whether mantissa is exactly representable as JS number
+ */
+bool MysqlBindingsDecimalMantissa(const char *value, unsigned long length, unsigned int scale,
+                                  std::string *mantissa) {
+    unsigned long i = 0;
+    unsigned int fraction_digits = 0;
+    bool negative = false, fraction = false;
+
+    mantissa->clear();
+
+    if (i < length && (value[i] == '-' || value[i] == '+')) {
+        negative = value[i] == '-';
+        i++;
+    }
+
+    for (; i < length; i++) {
+        if (value[i] == '.') {
+            fraction = true;
+            continue;
+        }
+        if (value[i] < '0' || value[i] > '9') {
+            break;
+        }
+        if (fraction) {
+            // Digits over the scale are truncated
+            if (fraction_digits == scale) {
+                continue;
+            }
+            fraction_digits++;
+        }
+        // Leading zeros
+        if (value[i] == '0' && mantissa->empty()) {
+            continue;
+        }
+        mantissa->push_back(value[i]);
+    }
+
+    if (mantissa->empty()) {
+        mantissa->assign("0");
+        return true;
+    }
+
+    mantissa->append(scale - fraction_digits, '0');
+    if (negative) {
+        mantissa->insert(mantissa->begin(), '-');
+    }
+
+    size_t digits = mantissa->size() - negative;
+    return digits < 16 || (digits == 16 && mantissa->compare(negative, 16, "9007199254740991") <= 0);
+}
+
+/*!
+ * Module function classifyQuerySync(query),
+ * classifies query for read/write splitting without connection
+ */
+static NAN_METHOD(ClassifyQuerySync) {
+    NanScope();
+
+    REQ_STR_ARG(0, query);
+
+    NanReturnValue(Integer::New(MysqlConnection::ClassifyQuery(*query, query.length())));
+}
 
 /*!
  * Init V8 structures
@@ -26,15 +106,25 @@
  * * MysqlConnection
  * * MysqlResult
  * * MysqlStatement
+ * * MysqlShardRouter
  */
 void InitMysqlLibmysqlclient(Handle<Object> target) {
     NanScope();
 
+    // mysql_library_init() is not thread-safe, call it
+    // before connect and KILL QUERY threads call mysql_init()
+    mysql_library_init(0, NULL, NULL);
+
     //// Populate classes constructors
     MysqlConnection::Init(target);
     MysqlResult::Init(target);
     MysqlStatement::Init(target);
-    
+    MysqlShardRouter::Init(target);
+    MysqlLazyRow::Init(target);
+
+    //// Populate functions
+    NODE_SET_METHOD(target, "classifyQuerySync", ClassifyQuerySync);
+
     //// Populate constants
     // Constants for connect flags
     NODE_DEFINE_CONSTANT(target, CLIENT_COMPRESS);
@@ -91,6 +181,17 @@ void InitMysqlLibmysqlclient(Handle<Object> target) {
     NODE_DEFINE_CONSTANT(target, STMT_ATTR_UPDATE_MAX_LENGTH);
     NODE_DEFINE_CONSTANT(target, STMT_ATTR_CURSOR_TYPE);
     NODE_DEFINE_CONSTANT(target, STMT_ATTR_PREFETCH_ROWS);
+
+    // Query types for classifyQuerySync
+    NODE_DEFINE_CONSTANT(target, QUERY_TYPE_READ);
+    NODE_DEFINE_CONSTANT(target, QUERY_TYPE_WRITE);
+    NODE_DEFINE_CONSTANT(target, QUERY_TYPE_BEGIN);
+    NODE_DEFINE_CONSTANT(target, QUERY_TYPE_END);
+
+    // Queue priorities for enqueue
+    NODE_DEFINE_CONSTANT(target, QUEUE_PRIORITY_HIGH);
+    NODE_DEFINE_CONSTANT(target, QUEUE_PRIORITY_NORMAL);
+    NODE_DEFINE_CONSTANT(target, QUEUE_PRIORITY_LOW);
 }
 
 NODE_MODULE(mysql_bindings, InitMysqlLibmysqlclient)
@@ -9,8 +9,13 @@
 #define SRC_MYSQL_BINDINGS_H_
 
 #include <v8.h>
+#include <node.h>
 #include <node_buffer.h>
 
+#include <stdint.h>
+
+#include <string>
+
 #include "nan.h"
 
 using namespace v8; // NOLINT
@@ -99,6 +104,29 @@ if (args.Length() > (I) \
     VAR = Null(); \
 }
 
+int64_t MysqlBindingsDaysFromCivil(int64_t year, int64_t month, int64_t day);
+
+/*!
+ * DECIMAL/NEWDECIMAL values decoding, see 'decimal' fetch option
+ */
+enum MysqlBindingsDecimalMode {
+    MYSQL_BINDINGS_DECIMAL_STRING = 0,
+    MYSQL_BINDINGS_DECIMAL_NUMBER,
+    MYSQL_BINDINGS_DECIMAL_SCALED
+};
+
+bool MysqlBindingsDecimalMantissa(const char *value, unsigned long length, unsigned int scale,
+                                  std::string *mantissa);
+
+/*!
+ * libuv timer callback signature, status argument is gone since libuv 1.0
+ */
+#if UV_VERSION_MAJOR >= 1
+#define MYSQL_BINDINGS_TIMER_CB(name) void name(uv_timer_t *handle)
+#else
+#define MYSQL_BINDINGS_TIMER_CB(name) void name(uv_timer_t *handle, int status)
+#endif
+
 #ifdef DEBUG
     #define DEBUG_PRINTF(...) printf("\nDEBUG_PRINTF: "); printf(__VA_ARGS__); printf("\n")
     #define DEBUG_ARGS() for (int i = 0; i < args.Length(); i++) { \
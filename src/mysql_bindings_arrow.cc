@@ -0,0 +1,683 @@
+/*!
+ * Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+ * See contributors list in README
+ *
+ * See license text in LICENSE file
+ */
+
+/*!
+ * Include headers
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "./mysql_bindings_arrow.h"
+
+/*!
+ * Arrow format constants, see Schema.fbs and Message.fbs
+ */
+#define ARROW_METADATA_V5 4
+
+#define ARROW_HEADER_SCHEMA 1
+#define ARROW_HEADER_RECORD_BATCH 3
+
+#define ARROW_TYPE_NULL 1
+#define ARROW_TYPE_INT 2
+#define ARROW_TYPE_FLOATING_POINT 3
+#define ARROW_TYPE_BINARY 4
+#define ARROW_TYPE_UTF8 5
+#define ARROW_TYPE_DECIMAL 7
+#define ARROW_TYPE_DATE 8
+#define ARROW_TYPE_TIMESTAMP 10
+#define ARROW_TYPE_DURATION 18
+
+#define ARROW_PRECISION_SINGLE 1
+#define ARROW_PRECISION_DOUBLE 2
+#define ARROW_DATE_UNIT_DAY 0
+#define ARROW_TIME_UNIT_MICROSECOND 2
+
+#define ARROW_DECIMAL128_MAX_PRECISION 38
+
+#define ARROW_CONTINUATION 0xFFFFFFFF
+
+MysqlArrowFlatBuilder::MysqlArrowFlatBuilder() {
+    // Root table offset
+    data.assign(4, '\0');
+}
+
+size_t MysqlArrowFlatBuilder::Align(size_t alignment) {
+    while (data.size() % alignment) {
+        data.push_back('\0');
+    }
+
+    return data.size();
+}
+
+void MysqlArrowFlatBuilder::Put(size_t position, uint64_t value, size_t size) {
+    // Little-endian only, like Arrow IPC written by this class
+    memcpy(&data[position], &value, size);
+}
+
+/*!
+ * Vtable is written just before its table, table start is aligned to 8 bytes,
+ * so every field is aligned to its size
+ */
+size_t MysqlArrowFlatBuilder::Table(const field *fields, size_t count, size_t *slots) {
+    size_t i, ids = 0;
+
+    for (i = 0; i < count; i++) {
+        if (fields[i].id + 1u > ids) {
+            ids = fields[i].id + 1u;
+        }
+    }
+
+    size_t vtable_size = 4 + 2 * ids;
+    size_t vtable = Align(2);
+    data.append(vtable_size, '\0');
+
+    size_t table = Align(8);
+    size_t table_size = 4;
+    for (i = 0; i < count; i++) {
+        table_size = (table_size + fields[i].size - 1) / fields[i].size * fields[i].size;
+        slots[i] = table + table_size;
+        table_size += fields[i].size;
+    }
+    data.append(table_size, '\0');
+
+    Put(table, table - vtable, 4);
+    for (i = 0; i < count; i++) {
+        Put(slots[i], fields[i].value, fields[i].size);
+    }
+
+    Put(vtable, vtable_size, 2);
+    Put(vtable + 2, table_size, 2);
+    for (i = 0; i < count; i++) {
+        Put(vtable + 4 + 2 * fields[i].id, slots[i] - table, 2);
+    }
+
+    return table;
+}
+
+size_t MysqlArrowFlatBuilder::String(const std::string &value) {
+    size_t position = Align(4);
+
+    // Zero terminated
+    data.append(4, '\0');
+    data.append(value);
+    data.push_back('\0');
+
+    Put(position, value.size(), 4);
+
+    return position;
+}
+
+size_t MysqlArrowFlatBuilder::StructVector(const std::vector<int64_t> &values, size_t struct_fields) {
+    // Length goes just before 8-byte aligned elements
+    Align(4);
+    if ((data.size() + 4) % 8) {
+        data.append(4, '\0');
+    }
+    size_t position = data.size();
+
+    data.append(4 + 8 * values.size(), '\0');
+
+    Put(position, values.size() / struct_fields, 4);
+    for (size_t i = 0; i < values.size(); i++) {
+        Put(position + 4 + 8 * i, static_cast<uint64_t>(values[i]), 8);
+    }
+
+    return position;
+}
+
+size_t MysqlArrowFlatBuilder::OffsetVector(size_t count, std::vector<size_t> *slots) {
+    size_t position = Align(4);
+
+    data.append(4 + 4 * count, '\0');
+
+    Put(position, count, 4);
+    slots->resize(count);
+    for (size_t i = 0; i < count; i++) {
+        (*slots)[i] = position + 4 + 4 * i;
+    }
+
+    return position;
+}
+
+void MysqlArrowFlatBuilder::PatchOffset(size_t slot, size_t target) {
+    Put(slot, target - slot, 4);
+}
+
+void MysqlArrowFlatBuilder::Finish(size_t root) {
+    PatchOffset(0, root);
+
+    // Message body must start at 8-byte boundary
+    Align(8);
+}
+
+/*!
+ * DECIMAL precision from display length, which includes sign and decimal point
+ */
+static int32_t DecimalPrecision(const MYSQL_FIELD &field) {
+    return static_cast<int32_t>(field.length) - (field.decimals > 0) - !(field.flags & UNSIGNED_FLAG);
+}
+
+MysqlArrowWriter::MysqlArrowWriter(MYSQL_FIELD *fields, uint32_t num_fields, MysqlBindingsDecimalMode decimal):
+    row_count(0),
+    var_bytes(0) {
+    columns.resize(num_fields);
+
+    for (uint32_t i = 0; i < num_fields; i++) {
+        columns[i].name = fields[i].name ? fields[i].name : "";
+        columns[i].kind = ColumnKind(fields[i], decimal);
+        columns[i].null_count = 0;
+        columns[i].precision = DecimalPrecision(fields[i]);
+        columns[i].scale = fields[i].decimals;
+
+        if (columns[i].kind == ARROW_UTF8 || columns[i].kind == ARROW_BINARY) {
+            columns[i].offsets.push_back(0);
+        }
+    }
+}
+
+/*!
+ * Arrow type for MySQL column type, the same values as MysqlResult::GetFieldValue() gives,
+ * but BIGINT is a 64-bit integer and TIME is a duration
+ */
+MysqlArrowWriter::column_kind MysqlArrowWriter::ColumnKind(const MYSQL_FIELD &field,
+                                                           MysqlBindingsDecimalMode decimal) {
+    switch (field.type) {
+        case MYSQL_TYPE_DECIMAL:
+        case MYSQL_TYPE_NEWDECIMAL:
+            if (decimal == MYSQL_BINDINGS_DECIMAL_NUMBER) {
+                return ARROW_FLOAT64;
+            }
+            // Wider decimals stay strings
+            if (decimal == MYSQL_BINDINGS_DECIMAL_SCALED &&
+                DecimalPrecision(field) <= ARROW_DECIMAL128_MAX_PRECISION) {
+                return ARROW_DECIMAL128;
+            }
+            return ARROW_UTF8;
+        case MYSQL_TYPE_NULL:
+            return ARROW_NULL;
+        case MYSQL_TYPE_TINY:
+        case MYSQL_TYPE_SHORT:
+        case MYSQL_TYPE_INT24:
+        case MYSQL_TYPE_YEAR:
+            return ARROW_INT32;
+        case MYSQL_TYPE_LONG:
+            return (field.flags & UNSIGNED_FLAG) ? ARROW_INT64 : ARROW_INT32;
+        case MYSQL_TYPE_LONGLONG:
+            return (field.flags & UNSIGNED_FLAG) ? ARROW_UINT64 : ARROW_INT64;
+        case MYSQL_TYPE_FLOAT:
+            return ARROW_FLOAT32;
+        case MYSQL_TYPE_DOUBLE:
+            return ARROW_FLOAT64;
+        case MYSQL_TYPE_DATE:
+        case MYSQL_TYPE_NEWDATE:
+            return ARROW_DATE32;
+        case MYSQL_TYPE_TIMESTAMP:
+        case MYSQL_TYPE_DATETIME:
+            return ARROW_TIMESTAMP;
+        case MYSQL_TYPE_TIME:
+            return ARROW_DURATION;
+        case MYSQL_TYPE_BIT:
+            return ARROW_BINARY;
+        case MYSQL_TYPE_TINY_BLOB:
+        case MYSQL_TYPE_MEDIUM_BLOB:
+        case MYSQL_TYPE_LONG_BLOB:
+        case MYSQL_TYPE_BLOB:
+        case MYSQL_TYPE_STRING:
+        case MYSQL_TYPE_VAR_STRING:
+            return (field.flags & BINARY_FLAG) ? ARROW_BINARY : ARROW_UTF8;
+        default:
+            // SET is comma separated string
+            return ARROW_UTF8;
+    }
+}
+
+size_t MysqlArrowWriter::FixedWidth(column_kind kind) {
+    switch (kind) {
+        case ARROW_INT32:
+        case ARROW_FLOAT32:
+        case ARROW_DATE32:
+            return 4;
+        case ARROW_INT64:
+        case ARROW_UINT64:
+        case ARROW_FLOAT64:
+        case ARROW_TIMESTAMP:
+        case ARROW_DURATION:
+            return 8;
+        case ARROW_DECIMAL128:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+uint8_t MysqlArrowWriter::TypeId(column_kind kind) {
+    switch (kind) {
+        case ARROW_NULL:
+            return ARROW_TYPE_NULL;
+        case ARROW_INT32:
+        case ARROW_INT64:
+        case ARROW_UINT64:
+            return ARROW_TYPE_INT;
+        case ARROW_FLOAT32:
+        case ARROW_FLOAT64:
+            return ARROW_TYPE_FLOATING_POINT;
+        case ARROW_DATE32:
+            return ARROW_TYPE_DATE;
+        case ARROW_TIMESTAMP:
+            return ARROW_TYPE_TIMESTAMP;
+        case ARROW_DURATION:
+            return ARROW_TYPE_DURATION;
+        case ARROW_DECIMAL128:
+            return ARROW_TYPE_DECIMAL;
+        case ARROW_BINARY:
+            return ARROW_TYPE_BINARY;
+        default:
+            return ARROW_TYPE_UTF8;
+    }
+}
+
+/*!
+ * Writes type table of Field.type union
+ */
+size_t MysqlArrowWriter::TypeTable(MysqlArrowFlatBuilder *fb, const column &col) {
+    MysqlArrowFlatBuilder::field fields[3];
+    size_t slots[3];
+    size_t table;
+    column_kind kind = col.kind;
+
+    switch (kind) {
+        case ARROW_INT32:
+        case ARROW_INT64:
+        case ARROW_UINT64:
+            // Int {bitWidth, is_signed}
+            fields[0].id = 0;
+            fields[0].size = 4;
+            fields[0].value = kind == ARROW_INT32 ? 32 : 64;
+            fields[1].id = 1;
+            fields[1].size = 1;
+            fields[1].value = kind != ARROW_UINT64;
+            return fb->Table(fields, 2, slots);
+        case ARROW_FLOAT32:
+        case ARROW_FLOAT64:
+            // FloatingPoint {precision}
+            fields[0].id = 0;
+            fields[0].size = 2;
+            fields[0].value = kind == ARROW_FLOAT32 ? ARROW_PRECISION_SINGLE : ARROW_PRECISION_DOUBLE;
+            return fb->Table(fields, 1, slots);
+        case ARROW_DATE32:
+            // Date {unit}
+            fields[0].id = 0;
+            fields[0].size = 2;
+            fields[0].value = ARROW_DATE_UNIT_DAY;
+            return fb->Table(fields, 1, slots);
+        case ARROW_TIMESTAMP:
+            // Timestamp {unit, timezone}, values are UTC like in GetFieldValue()
+            fields[0].id = 0;
+            fields[0].size = 2;
+            fields[0].value = ARROW_TIME_UNIT_MICROSECOND;
+            fields[1].id = 1;
+            fields[1].size = 4;
+            fields[1].value = 0;
+            table = fb->Table(fields, 2, slots);
+            fb->PatchOffset(slots[1], fb->String("UTC"));
+            return table;
+        case ARROW_DURATION:
+            // Duration {unit}
+            fields[0].id = 0;
+            fields[0].size = 2;
+            fields[0].value = ARROW_TIME_UNIT_MICROSECOND;
+            return fb->Table(fields, 1, slots);
+        case ARROW_DECIMAL128:
+            // Decimal {precision, scale, bitWidth}
+            fields[0].id = 0;
+            fields[0].size = 4;
+            fields[0].value = static_cast<uint32_t>(col.precision);
+            fields[1].id = 1;
+            fields[1].size = 4;
+            fields[1].value = static_cast<uint32_t>(col.scale);
+            fields[2].id = 2;
+            fields[2].size = 4;
+            fields[2].value = 128;
+            return fb->Table(fields, 3, slots);
+        default:
+            // Null, Utf8 and Binary have no parameters
+            return fb->Table(NULL, 0, slots);
+    }
+}
+
+/*!
+ * Microseconds of "HH:MM:SS.ffffff" fractional part
+ */
+static int64_t ParseMicroseconds(const char *value) {
+    const char *dot = strchr(value, '.');
+    int64_t microseconds = 0;
+    int digits = 0;
+
+    if (dot) {
+        for (dot++; digits < 6 && *dot >= '0' && *dot <= '9'; dot++, digits++) {
+            microseconds = microseconds * 10 + (*dot - '0');
+        }
+    }
+    for (; digits < 6; digits++) {
+        microseconds *= 10;
+    }
+
+    return microseconds;
+}
+
+/*!
+ * Integer mantissa of column scale as little-endian 128-bit two's complement,
+ * precision is checked by ColumnKind()
+ */
+void MysqlArrowWriter::AppendDecimal128(column *col, const char *value, unsigned long length) {
+    std::string mantissa;
+    uint64_t low = 0, high = 0;
+    bool negative;
+    size_t i;
+
+    MysqlBindingsDecimalMantissa(value, length, col->scale, &mantissa);
+    negative = mantissa[0] == '-';
+
+    for (i = negative; i < mantissa.size(); i++) {
+        // (high, low) = (high, low) * 10 + digit, in 32-bit parts to keep carries
+        uint64_t low_part = (low & 0xFFFFFFFF) * 10 + (mantissa[i] - '0');
+        uint64_t high_part = (low >> 32) * 10 + (low_part >> 32);
+
+        low = (high_part << 32) | (low_part & 0xFFFFFFFF);
+        high = high * 10 + (high_part >> 32);
+    }
+
+    if (negative) {
+        low = ~low + 1;
+        high = ~high + (low == 0);
+    }
+
+    AppendFixed<uint64_t>(col, low);
+    AppendFixed<uint64_t>(col, high);
+}
+
+void MysqlArrowWriter::AppendNull(column *col) {
+    col->null_count++;
+
+    if (col->kind == ARROW_UTF8 || col->kind == ARROW_BINARY) {
+        col->offsets.push_back(col->offsets.back());
+    } else {
+        col->values.resize(col->values.size() + FixedWidth(col->kind), '\0');
+    }
+}
+
+bool MysqlArrowWriter::AppendValue(column *col, const char *value, unsigned long length) {
+    int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+    int64_t microseconds;
+
+    switch (col->kind) {
+        case ARROW_NULL:
+            return false;
+        case ARROW_INT32:
+            AppendFixed<int32_t>(col, static_cast<int32_t>(strtol(value, NULL, 10)));
+            return true;
+        case ARROW_INT64:
+            AppendFixed<int64_t>(col, static_cast<int64_t>(strtoll(value, NULL, 10)));
+            return true;
+        case ARROW_UINT64:
+            AppendFixed<uint64_t>(col, static_cast<uint64_t>(strtoull(value, NULL, 10)));
+            return true;
+        case ARROW_FLOAT32:
+            AppendFixed<float>(col, strtof(value, NULL));
+            return true;
+        case ARROW_FLOAT64:
+            AppendFixed<double>(col, strtod(value, NULL));
+            return true;
+        case ARROW_DATE32:
+            // Zero dates are NULL
+            if (sscanf(value, "%d-%d-%d", &year, &month, &day) != 3 || month < 1 || day < 1) {
+                return false;
+            }
+            AppendFixed<int32_t>(col, static_cast<int32_t>(MysqlBindingsDaysFromCivil(year, month, day)));
+            return true;
+        case ARROW_TIMESTAMP:
+            if (sscanf(value, "%d-%d-%d %d:%d:%d", &year, &month, &day, &hour, &minute, &second) < 3 ||
+                month < 1 || day < 1) {
+                return false;
+            }
+            microseconds = ((MysqlBindingsDaysFromCivil(year, month, day) * 86400 +
+                             static_cast<int64_t>(hour) * 3600 + minute * 60 + second) * 1000000 +
+                            ParseMicroseconds(value));
+            AppendFixed<int64_t>(col, microseconds);
+            return true;
+        case ARROW_DURATION:
+            // TIME is "[-]HHH:MM:SS[.ffffff]", sign belongs to the whole value
+            if (sscanf(value + (value[0] == '-'), "%d:%d:%d", &hour, &minute, &second) != 3) {
+                return false;
+            }
+            microseconds = (static_cast<int64_t>(hour) * 3600 + minute * 60 + second) * 1000000 +
+                           ParseMicroseconds(value);
+            AppendFixed<int64_t>(col, value[0] == '-' ? -microseconds : microseconds);
+            return true;
+        case ARROW_DECIMAL128:
+            AppendDecimal128(col, value, length);
+            return true;
+        default:
+            col->values.insert(col->values.end(), value, value + length);
+            col->offsets.push_back(static_cast<int32_t>(col->values.size()));
+            var_bytes += length;
+            return true;
+    }
+}
+
+void MysqlArrowWriter::AppendRow(char **values, unsigned long *lengths) {
+    uint8_t bit = static_cast<uint8_t>(1 << (row_count % 8));
+
+    for (size_t i = 0; i < columns.size(); i++) {
+        column *col = &columns[i];
+
+        if (row_count % 8 == 0) {
+            col->validity.push_back(0);
+        }
+
+        if (values[i] && AppendValue(col, values[i], lengths[i])) {
+            col->validity.back() |= bit;
+        } else {
+            AppendNull(col);
+        }
+    }
+
+    row_count++;
+}
+
+bool MysqlArrowWriter::BatchFull() const {
+    return row_count >= MYSQLARROW_BATCH_ROWS || var_bytes >= MYSQLARROW_BATCH_BYTES;
+}
+
+/*!
+ * Writes Message table, header union value is written by caller
+ */
+size_t MysqlArrowWriter::MessageTable(MysqlArrowFlatBuilder *fb, uint8_t header_type, int64_t body_length,
+                                      size_t *header_slot) {
+    MysqlArrowFlatBuilder::field fields[4] = {
+        {0, 2, ARROW_METADATA_V5},
+        {1, 1, header_type},
+        {2, 4, 0},
+        {3, 8, static_cast<uint64_t>(body_length)}
+    };
+    size_t slots[4];
+
+    size_t table = fb->Table(fields, 4, slots);
+    *header_slot = slots[2];
+
+    return table;
+}
+
+/*!
+ * Encapsulated message: continuation marker, metadata size,
+ * metadata flatbuffer and body buffers padded to 8 bytes
+ */
+char *MysqlArrowWriter::Message(const MysqlArrowFlatBuilder &fb, const std::vector<body_buffer> &body,
+                                size_t *length) {
+    size_t i, body_length = 0;
+
+    for (i = 0; i < body.size(); i++) {
+        body_length += (body[i].length + 7) / 8 * 8;
+    }
+
+    *length = 8 + fb.data.size() + body_length;
+    char *data = static_cast<char *>(malloc(*length));
+    if (!data) {
+        return NULL;
+    }
+
+    uint32_t prefix[2] = {ARROW_CONTINUATION, static_cast<uint32_t>(fb.data.size())};
+    memcpy(data, prefix, 8);
+    memcpy(data + 8, fb.data.data(), fb.data.size());
+
+    char *position = data + 8 + fb.data.size();
+    for (i = 0; i < body.size(); i++) {
+        size_t padded = (body[i].length + 7) / 8 * 8;
+
+        if (body[i].length) {
+            memcpy(position, body[i].data, body[i].length);
+        }
+        memset(position + body[i].length, 0, padded - body[i].length);
+        position += padded;
+    }
+
+    return data;
+}
+
+char *MysqlArrowWriter::SchemaMessage(size_t *length) {
+    MysqlArrowFlatBuilder fb;
+    size_t header_slot;
+
+    size_t message = MessageTable(&fb, ARROW_HEADER_SCHEMA, 0, &header_slot);
+
+    // Schema {endianness: Little, fields}
+    MysqlArrowFlatBuilder::field schema_fields[2] = {
+        {0, 2, 0},
+        {1, 4, 0}
+    };
+    size_t schema_slots[2];
+    fb.PatchOffset(header_slot, fb.Table(schema_fields, 2, schema_slots));
+
+    std::vector<size_t> field_slots, no_children;
+    fb.PatchOffset(schema_slots[1], fb.OffsetVector(columns.size(), &field_slots));
+
+    for (size_t i = 0; i < columns.size(); i++) {
+        // Field {name, nullable, type_type, type, children}
+        MysqlArrowFlatBuilder::field fields[5] = {
+            {0, 4, 0},
+            {1, 1, 1},
+            {2, 1, TypeId(columns[i].kind)},
+            {3, 4, 0},
+            {5, 4, 0}
+        };
+        size_t slots[5];
+        fb.PatchOffset(field_slots[i], fb.Table(fields, 5, slots));
+
+        fb.PatchOffset(slots[0], fb.String(columns[i].name));
+        fb.PatchOffset(slots[3], TypeTable(&fb, columns[i]));
+        // Some readers require children vector even for primitive types
+        fb.PatchOffset(slots[4], fb.OffsetVector(0, &no_children));
+    }
+
+    fb.Finish(message);
+
+    return Message(fb, std::vector<body_buffer>(), length);
+}
+
+char *MysqlArrowWriter::BatchMessage(size_t *length) {
+    if (row_count == 0) {
+        *length = 0;
+        return NULL;
+    }
+
+    std::vector<body_buffer> body;
+    std::vector<int64_t> nodes, buffers;
+    int64_t body_length = 0;
+
+    for (size_t i = 0; i < columns.size(); i++) {
+        const column &col = columns[i];
+
+        // FieldNode {length, null_count}
+        nodes.push_back(row_count);
+        nodes.push_back(col.null_count);
+
+        if (col.kind == ARROW_NULL) {
+            continue;
+        }
+
+        // Validity bitmap may be omitted when there are no nulls
+        body_buffer validity = {&col.validity[0], col.null_count ? col.validity.size() : 0};
+        body.push_back(validity);
+
+        if (col.kind == ARROW_UTF8 || col.kind == ARROW_BINARY) {
+            body_buffer offsets = {&col.offsets[0], col.offsets.size() * sizeof(int32_t)};
+            body.push_back(offsets);
+        }
+
+        body_buffer values = {col.values.empty() ? NULL : &col.values[0], col.values.size()};
+        body.push_back(values);
+    }
+
+    // Buffer {offset, length} relative to body start
+    for (size_t i = 0; i < body.size(); i++) {
+        buffers.push_back(body_length);
+        buffers.push_back(static_cast<int64_t>(body[i].length));
+        body_length += (body[i].length + 7) / 8 * 8;
+    }
+
+    MysqlArrowFlatBuilder fb;
+    size_t header_slot;
+
+    size_t message = MessageTable(&fb, ARROW_HEADER_RECORD_BATCH, body_length, &header_slot);
+
+    // RecordBatch {length, nodes, buffers}
+    MysqlArrowFlatBuilder::field batch_fields[3] = {
+        {0, 8, static_cast<uint64_t>(row_count)},
+        {1, 4, 0},
+        {2, 4, 0}
+    };
+    size_t batch_slots[3];
+    fb.PatchOffset(header_slot, fb.Table(batch_fields, 3, batch_slots));
+
+    fb.PatchOffset(batch_slots[1], fb.StructVector(nodes, 2));
+    fb.PatchOffset(batch_slots[2], fb.StructVector(buffers, 2));
+
+    fb.Finish(message);
+
+    char *data = Message(fb, body, length);
+
+    // Next batch reuses column buffers memory
+    for (size_t i = 0; i < columns.size(); i++) {
+        columns[i].validity.clear();
+        columns[i].null_count = 0;
+        columns[i].values.clear();
+        if (!columns[i].offsets.empty()) {
+            columns[i].offsets.resize(1);
+        }
+    }
+    row_count = 0;
+    var_bytes = 0;
+
+    return data;
+}
+
+char *MysqlArrowWriter::EndOfStream(size_t *length) {
+    uint32_t marker[2] = {ARROW_CONTINUATION, 0};
+
+    *length = sizeof(marker);
+    char *data = static_cast<char *>(malloc(*length));
+    if (data) {
+        memcpy(data, marker, *length);
+    }
+
+    return data;
+}
+
+void MysqlArrowWriter::FreeBuffer(char *data, void *hint) {
+    free(data);
+}
@@ -0,0 +1,153 @@
+/*!
+ * Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+ * See contributors list in README
+ *
+ * See license text in LICENSE file
+ */
+
+#ifndef SRC_MYSQL_BINDINGS_ARROW_H_
+#define SRC_MYSQL_BINDINGS_ARROW_H_
+
+#include <mysql.h>
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "./mysql_bindings.h"
+
+// Rows per record batch
+#define MYSQLARROW_BATCH_ROWS 65536
+
+// Record batch is flushed earlier when some variable width column
+// grows over this size, offsets are 32-bit
+#define MYSQLARROW_BATCH_BYTES (256 * 1024 * 1024)
+
+/*!
+ * Minimal FlatBuffers encoder for Arrow IPC metadata.
+ *
+ * Objects are written front to back: referenced objects are always
+ * written after the referring offset, so offsets stay unsigned
+ */
+class MysqlArrowFlatBuilder {
+  public:
+    struct field {
+        uint16_t id;
+        uint8_t size;  // 1, 2, 4 or 8 bytes, offsets are 4 bytes
+        uint64_t value;
+    };
+
+    std::string data;
+
+    MysqlArrowFlatBuilder();
+
+    // Writes table with its vtable, slots get absolute positions of fields
+    size_t Table(const field *fields, size_t count, size_t *slots);
+
+    size_t String(const std::string &value);
+
+    // Vector of structs made of 8-byte fields
+    size_t StructVector(const std::vector<int64_t> &values, size_t struct_fields);
+
+    // Vector of offsets, slots get absolute positions of elements
+    size_t OffsetVector(size_t count, std::vector<size_t> *slots);
+
+    void PatchOffset(size_t slot, size_t target);
+
+    void Finish(size_t root);
+
+  private:
+    size_t Align(size_t alignment);
+    void Put(size_t position, uint64_t value, size_t size);
+};
+
+/*!
+ * Serializes result rows to Arrow IPC stream format.
+ *
+ * Does not touch V8, so rows can be converted in threadpool.
+ * Each message is a separate malloc'ed block, their concatenation
+ * is a valid stream: schema, record batches, end-of-stream marker
+ */
+class MysqlArrowWriter {
+  public:
+    MysqlArrowWriter(MYSQL_FIELD *fields, uint32_t num_fields, MysqlBindingsDecimalMode decimal);
+
+    // Values are NULL for NULL cells, text protocol only
+    void AppendRow(char **values, unsigned long *lengths);
+
+    // Record batch should be flushed before next row
+    bool BatchFull() const;
+
+    char *SchemaMessage(size_t *length);
+
+    // Takes buffered rows, returns NULL for empty batch
+    char *BatchMessage(size_t *length);
+
+    static char *EndOfStream(size_t *length);
+
+    static void FreeBuffer(char *data, void *hint);
+
+  private:
+    // Physical layout of Arrow type used for column
+    enum column_kind {
+        ARROW_NULL,
+        ARROW_INT32,
+        ARROW_INT64,
+        ARROW_UINT64,
+        ARROW_FLOAT32,
+        ARROW_FLOAT64,
+        ARROW_DATE32,
+        ARROW_TIMESTAMP,
+        ARROW_DURATION,
+        ARROW_DECIMAL128,
+        ARROW_UTF8,
+        ARROW_BINARY
+    };
+    struct column {
+        std::string name;
+        column_kind kind;
+        // Decimal128 type parameters
+        int32_t precision;
+        int32_t scale;
+
+        std::vector<uint8_t> validity;
+        int64_t null_count;
+        // Fixed width values or variable width data
+        std::vector<char> values;
+        std::vector<int32_t> offsets;
+    };
+    std::vector<column> columns;
+    int64_t row_count;
+    size_t var_bytes;
+
+    static column_kind ColumnKind(const MYSQL_FIELD &field, MysqlBindingsDecimalMode decimal);
+
+    void AppendNull(column *col);
+    // Returns false for values Arrow type can't hold, they are stored as NULL
+    bool AppendValue(column *col, const char *value, unsigned long length);
+    static void AppendDecimal128(column *col, const char *value, unsigned long length);
+
+    template<typename T> static void AppendFixed(column *col, T value) {
+        const char *bytes = reinterpret_cast<const char *>(&value);
+        col->values.insert(col->values.end(), bytes, bytes + sizeof(T));
+    }
+
+    static uint8_t TypeId(column_kind kind);
+    static size_t TypeTable(MysqlArrowFlatBuilder *fb, const column &col);
+    static size_t FixedWidth(column_kind kind);
+
+    // Message body part, padded to 8 bytes in stream
+    struct body_buffer {
+        const void *data;
+        size_t length;
+    };
+
+    static size_t MessageTable(MysqlArrowFlatBuilder *fb, uint8_t header_type, int64_t body_length,
+                               size_t *header_slot);
+
+    static char *Message(const MysqlArrowFlatBuilder &fb, const std::vector<body_buffer> &body,
+                         size_t *length);
+};
+
+#endif  // SRC_MYSQL_BINDINGS_ARROW_H_
@@ -32,18 +32,25 @@ void MysqlConnection::Init(Handle<Object> target) {
     // Instance properties
     instance_template->SetAccessor(V8STR("connectErrno"), ConnectErrnoGetter);
     instance_template->SetAccessor(V8STR("connectError"), ConnectErrorGetter);
+    instance_template->SetAccessor(V8STR("lastQueryTime"), LastQueryTimeGetter);
+    instance_template->SetAccessor(V8STR("queryTimeEwma"), QueryTimeEwmaGetter);
 
     // Prototype methods
     NODE_SET_PROTOTYPE_METHOD(tpl, "affectedRowsSync",     AffectedRowsSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "autoCommit",           AutoCommit);
     NODE_SET_PROTOTYPE_METHOD(tpl, "autoCommitSync",       AutoCommitSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "changeUser",           ChangeUser);
     NODE_SET_PROTOTYPE_METHOD(tpl, "changeUserSync",       ChangeUserSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "commit",               Commit);
     NODE_SET_PROTOTYPE_METHOD(tpl, "commitSync",           CommitSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "connect",              Connect);
     NODE_SET_PROTOTYPE_METHOD(tpl, "connectSync",          ConnectSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "connectedSync",        ConnectedSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "close",                Close);
     NODE_SET_PROTOTYPE_METHOD(tpl, "closeSync",            CloseSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "debugSync",            DebugSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "dumpDebugInfoSync",    DumpDebugInfoSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "enqueue",              Enqueue);
     NODE_SET_PROTOTYPE_METHOD(tpl, "errnoSync",            ErrnoSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "errorSync",            ErrorSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "escapeSync",           EscapeSync);
@@ -53,26 +60,40 @@ void MysqlConnection::Init(Handle<Object> target) {
     NODE_SET_PROTOTYPE_METHOD(tpl, "getClientInfoSync",    GetClientInfoSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "getInfoSync",          GetInfoSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "getInfoStringSync",    GetInfoStringSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "getWarnings",          GetWarnings);
     NODE_SET_PROTOTYPE_METHOD(tpl, "getWarningsSync",      GetWarningsSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "initSync",             InitSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "initStatementSync",    InitStatementSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "lastInsertIdSync",     LastInsertIdSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "loadByKey",            LoadByKey);
     NODE_SET_PROTOTYPE_METHOD(tpl, "multiMoreResultsSync", MultiMoreResultsSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "multiNextResultSync",  MultiNextResultSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "multiQuery",           MultiQuery);
     NODE_SET_PROTOTYPE_METHOD(tpl, "multiRealQuerySync",   MultiRealQuerySync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "ping",                 Ping);
     NODE_SET_PROTOTYPE_METHOD(tpl, "pingSync",             PingSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "query",                Query);
     NODE_SET_PROTOTYPE_METHOD(tpl, "querySend",            QuerySend);
     NODE_SET_PROTOTYPE_METHOD(tpl, "querySync",            QuerySync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "queueStatsSync",       QueueStatsSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "realConnectSync",      RealConnectSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "realQuerySync",        RealQuerySync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "resetSession",         ResetSession);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "rollback",             Rollback);
     NODE_SET_PROTOTYPE_METHOD(tpl, "rollbackSync",         RollbackSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "selectDb",             SelectDb);
     NODE_SET_PROTOTYPE_METHOD(tpl, "selectDbSync",         SelectDbSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "setCharset",           SetCharset);
     NODE_SET_PROTOTYPE_METHOD(tpl, "setCharsetSync",       SetCharsetSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "setKeepAliveSync",     SetKeepAliveSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "setOptionSync",        SetOptionSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "setQueryCoalescingSync", SetQueryCoalescingSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "setSslSync",           SetSslSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "sqlStateSync",         SqlStateSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "sslSessionReusedSync", SslSessionReusedSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "stat",                 Stat);
     NODE_SET_PROTOTYPE_METHOD(tpl, "statSync",             StatSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "storeResult",          StoreResult);
     NODE_SET_PROTOTYPE_METHOD(tpl, "storeResultSync",      StoreResultSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "threadIdSync",         ThreadIdSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "threadSafeSync",       ThreadSafeSync);
@@ -101,6 +122,12 @@ bool MysqlConnection::Connect(const char* hostname,
         return false;
     }
 
+    this->ForgetRecordedSetup();
+
+    std::string ssl_session_key = SslSessionKey(hostname, user, port, socket,
+                                                this->recorded_ssl, this->recorded_options);
+    ApplyCachedSslSession(this->_conn, ssl_session_key);
+
     bool unsuccessful = !mysql_real_connect(this->_conn,
                             hostname,
                             user,
@@ -120,6 +147,311 @@ bool MysqlConnection::Connect(const char* hostname,
         return false;
     }
 
+    CacheSslSession(this->_conn, ssl_session_key);
+    this->SaveConnectParams(hostname, user, password, dbname, port, socket, flags);
+
+    this->connected = true;
+    return true;
+}
+
+/*!
+ * Parallel connect to hosts list
+ *
+ * Every host is expanded to all of its addresses, then connects are started
+ * one by one with MYSQLCONN_CONNECT_STAGGER_MS delay, or right after all
+ * started attempts are failed. The first successful handshake wins,
+ * connections of other attempts are closed by their threads.
+ */
+bool MysqlConnection::ParseConnectCandidate(const std::string &entry,
+                                            uint32_t default_port,
+                                            connect_candidate *candidate) {
+    std::string host = entry;
+    std::string port_string;
+
+    if (!entry.empty() && entry[0] == '[') {
+        // [IPv6]:port
+        size_t end = entry.find(']');
+        if (end == std::string::npos) {
+            return false;
+        }
+        host = entry.substr(1, end - 1);
+        if (end + 1 < entry.size()) {
+            if (entry[end + 1] != ':') {
+                return false;
+            }
+            port_string = entry.substr(end + 2);
+        }
+    } else {
+        size_t colon = entry.find(':');
+        // More than one colon means bare IPv6 address
+        if (colon != std::string::npos && entry.find(':', colon + 1) == std::string::npos) {
+            host = entry.substr(0, colon);
+            port_string = entry.substr(colon + 1);
+        }
+    }
+
+    if (host.empty()) {
+        return false;
+    }
+
+    candidate->host = host;
+    candidate->port = default_port;
+
+    if (!port_string.empty()) {
+        char *end = NULL;
+        unsigned long port = strtoul(port_string.c_str(), &end, 10);  // NOLINT
+        if (*end != '\0' || port == 0 || port > 65535) {
+            return false;
+        }
+        candidate->port = static_cast<uint32_t>(port);
+    }
+
+    return true;
+}
+
+void MysqlConnection::ResolveConnectCandidates(const std::vector<connect_candidate> &hosts,
+                                               std::vector<connect_candidate> *candidates) {
+    for (size_t i = 0; i < hosts.size(); i++) {
+        // "localhost" means unix socket for libmysqlclient
+        if (hosts[i].host == "localhost") {
+            candidates->push_back(hosts[i]);
+            continue;
+        }
+
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+
+        struct addrinfo *addresses = NULL;
+        if (getaddrinfo(hosts[i].host.c_str(), NULL, &hints, &addresses) != 0) {
+            // Let libmysqlclient report resolve error
+            candidates->push_back(hosts[i]);
+            continue;
+        }
+
+        for (struct addrinfo *address = addresses; address; address = address->ai_next) {
+            char numeric_host[NI_MAXHOST];
+            if (getnameinfo(address->ai_addr, address->ai_addrlen,
+                            numeric_host, sizeof(numeric_host),
+                            NULL, 0, NI_NUMERICHOST) != 0) {
+                continue;
+            }
+
+            connect_candidate candidate;
+            candidate.host = numeric_host;
+            candidate.port = hosts[i].port;
+
+            bool duplicate = false;
+            for (size_t j = 0; j < candidates->size(); j++) {
+                if ((*candidates)[j].host == candidate.host &&
+                    (*candidates)[j].port == candidate.port) {
+                    duplicate = true;
+                    break;
+                }
+            }
+            if (!duplicate) {
+                candidates->push_back(candidate);
+            }
+        }
+
+        freeaddrinfo(addresses);
+    }
+}
+
+void MysqlConnection::ReleaseConnectRace(connect_race *race) {
+    pthread_mutex_lock(&race->lock);
+    bool last = --race->refs == 0;
+    pthread_mutex_unlock(&race->lock);
+
+    if (last) {
+        pthread_cond_destroy(&race->cond);
+        pthread_mutex_destroy(&race->lock);
+        delete race;
+    }
+}
+
+/*!
+ * Runs single connect attempt, in its own thread
+ * to not occupy threadpool threads with slow or blackholed hosts
+ */
+void *MysqlConnection::ConnectAttemptThread(void *data) {
+    connect_attempt *attempt = static_cast<connect_attempt *>(data);
+    connect_race *race = attempt->race;
+    const connect_params &params = attempt->params;
+
+    mysql_thread_init();
+
+    const char *hostname = attempt->candidate.host.c_str();
+    const char *socket = params.socket.empty() ? NULL : params.socket.c_str();
+
+    bool ok = false;
+    unsigned int my_errno = 0;
+    std::string my_error = "Not enough memory to connect";
+
+    MYSQL *my_conn = mysql_init(NULL);
+    if (my_conn) {
+        // Attempts use fresh handles without TLS setup
+        ssl_setup no_ssl;
+        no_ssl.set = false;
+        std::string ssl_session_key = SslSessionKey(hostname, params.user.c_str(),
+                                                    attempt->candidate.port, socket,
+                                                    no_ssl, std::vector<recorded_option>());
+        ApplyCachedSslSession(my_conn, ssl_session_key);
+
+        // Default connect timeout is OS one, minutes for blackholed hosts
+        unsigned int connect_timeout = MYSQLCONN_CONNECT_ATTEMPT_TIMEOUT;
+        mysql_options(my_conn, MYSQL_OPT_CONNECT_TIMEOUT, &connect_timeout);
+
+        if (mysql_real_connect(my_conn,
+                               hostname,
+                               params.user.c_str(),
+                               params.password.c_str(),
+                               params.dbname.empty() ? NULL : params.dbname.c_str(),
+                               attempt->candidate.port,
+                               socket,
+                               params.flags)) {
+            CacheSslSession(my_conn, ssl_session_key);
+            ok = true;
+        } else {
+            my_errno = mysql_errno(my_conn);
+            my_error = mysql_error(my_conn);
+        }
+    }
+
+    pthread_mutex_lock(&race->lock);
+    if (ok && !race->winner) {
+        race->winner = my_conn;
+        race->winner_index = attempt->index;
+        my_conn = NULL;
+    } else if (!ok) {
+        race->failed++;
+        race->my_errno = my_errno;
+        race->my_error = my_error;
+    }
+    pthread_cond_signal(&race->cond);
+    pthread_mutex_unlock(&race->lock);
+
+    // Failed or lost attempt
+    if (my_conn) {
+        mysql_close(my_conn);
+    }
+
+    mysql_thread_end();
+
+    ReleaseConnectRace(race);
+    delete attempt;
+
+    return NULL;
+}
+
+bool MysqlConnection::ConnectFirst(const std::vector<connect_candidate> &hosts,
+                                   const char* user,
+                                   const char* password,
+                                   const char* dbname,
+                                   const char* socket,
+                                   uint64_t flags) {
+    if (this->_conn) {
+        return false;
+    }
+
+    std::vector<connect_candidate> candidates;
+    ResolveConnectCandidates(hosts, &candidates);
+
+    connect_race *race = new connect_race;
+    pthread_mutex_init(&race->lock, NULL);
+    pthread_cond_init(&race->cond, NULL);
+    race->refs = 1;
+    race->started = 0;
+    race->failed = 0;
+    race->winner = NULL;
+    race->winner_index = 0;
+    race->my_errno = 0;
+    race->my_error = "No hosts to connect to";
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    size_t next = 0;
+
+    pthread_mutex_lock(&race->lock);
+    while (!race->winner && (next < candidates.size() || race->failed < race->started)) {
+        if (next == candidates.size()) {
+            // Wait for running attempts
+            pthread_cond_wait(&race->cond, &race->lock);
+            continue;
+        }
+
+        connect_attempt *attempt = new connect_attempt;
+        attempt->race = race;
+        attempt->index = next;
+        attempt->candidate = candidates[next];
+        attempt->params.user = user ? user : "";
+        attempt->params.password = password ? password : "";
+        attempt->params.dbname = dbname ? dbname : "";
+        attempt->params.socket = socket ? socket : "";
+        attempt->params.port = candidates[next].port;
+        attempt->params.flags = flags;
+
+        race->refs++;
+        race->started++;
+        next++;
+
+        pthread_t thread;
+        if (pthread_create(&thread, &attr, ConnectAttemptThread, attempt) != 0) {
+            race->refs--;
+            race->failed++;
+            race->my_errno = 0;
+            race->my_error = "Can't create thread for connect attempt";
+            delete attempt;
+        }
+
+        if (next == candidates.size()) {
+            continue;
+        }
+
+        // Start next attempt after stagger delay or right after all started attempts are failed
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += MYSQLCONN_CONNECT_STAGGER_MS / 1000;
+        deadline.tv_nsec += (MYSQLCONN_CONNECT_STAGGER_MS % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        while (!race->winner && race->failed < race->started) {
+            if (pthread_cond_timedwait(&race->cond, &race->lock, &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+    }
+
+    MYSQL *winner = race->winner;
+    size_t winner_index = race->winner_index;
+    unsigned int my_errno = race->my_errno;
+    std::string my_error = race->my_error;
+    pthread_mutex_unlock(&race->lock);
+
+    pthread_attr_destroy(&attr);
+
+    // Slow attempts may still run, the last of them frees race
+    ReleaseConnectRace(race);
+
+    if (!winner) {
+        this->connect_errno = my_errno;
+        this->connect_error_buffer = my_error;
+        this->connect_error = this->connect_error_buffer.c_str();
+        this->connected = false;
+        return false;
+    }
+
+    this->_conn = winner;
+    this->ForgetRecordedSetup();
+    this->SaveConnectParams(candidates[winner_index].host.c_str(), user, password, dbname,
+                            candidates[winner_index].port, socket, flags);
+
     this->connected = true;
     return true;
 }
@@ -139,6 +471,10 @@ bool MysqlConnection::RealConnect(const char* hostname,
         return false;
     }
 
+    std::string ssl_session_key = SslSessionKey(hostname, user, port, socket,
+                                                this->recorded_ssl, this->recorded_options);
+    ApplyCachedSslSession(this->_conn, ssl_session_key);
+
     bool unsuccessful = !mysql_real_connect(this->_conn,
                                             hostname,
                                             user,
@@ -176,754 +512,3267 @@ bool MysqlConnection::RealConnect(const char* hostname,
     }
 #endif
 
+    CacheSslSession(this->_conn, ssl_session_key);
+    this->SaveConnectParams(hostname, user, password, dbname, port, socket, flags);
+
     this->connected = true;
     return true;
 }
 
-void MysqlConnection::Close() {
-    pthread_mutex_lock(&this->query_lock);
-    if (this->_conn) {
-        mysql_close(this->_conn);
-        this->_conn = NULL;
-        this->connected = false;
-        // this->multi_query = false;
-        this->opt_reconnect = false;
-        this->connect_errno = 0;
-        this->connect_error = NULL;
+/*!
+ * TLS session resumption
+ *
+ * After successful TLS handshake session data is saved per user@host:port
+ * and client setup: setSslSync() files and ciphers and setOptionSync() options.
+ * The next connection to the same server with the same setup offers it
+ * to skip full handshake.
+ * If server does not accept the session, libmysqlclient silently falls back
+ * to the full handshake.
+ */
+std::map<std::string, std::string> MysqlConnection::ssl_sessions;
+pthread_mutex_t MysqlConnection::ssl_sessions_lock = PTHREAD_MUTEX_INITIALIZER;
+
+std::string MysqlConnection::SslSessionKey(const char* hostname,
+                                           const char* user,
+                                           uint32_t port,
+                                           const char* socket,
+                                           const ssl_setup &ssl,
+                                           const std::vector<recorded_option> &options) {
+    char number_string[16];
+    snprintf(number_string, sizeof(number_string), "%u", port);
+
+    std::string key(user ? user : "");
+    key += "@";
+    key += hostname ? hostname : "localhost";
+    key += ":";
+    key += socket ? socket : number_string;
+
+    // Parts are separated by zero bytes, file names can't contain them
+    if (ssl.set) {
+        for (int i = 0; i < 5; i++) {
+            key += '\0';
+            if (ssl.have[i]) {
+                key += "+" + ssl.values[i];
+            } else {
+                key += "-";
+            }
+        }
     }
-    pthread_mutex_unlock(&this->query_lock);
-}
 
-MysqlConnection::MysqlConnection(): ObjectWrap() {
-    this->_conn = NULL;
-    this->connected = false;
-    this->multi_query = false;
-    this->opt_reconnect = false;
-    this->connect_errno = 0;
-    this->connect_error = NULL;
-    pthread_mutex_init(&this->query_lock, NULL);
+    // Recorded options are unique, but their order depends on calls order
+    std::vector<std::string> option_keys;
+    for (size_t i = 0; i < options.size(); i++) {
+        std::string option_key;
+
+        snprintf(number_string, sizeof(number_string), "%d", static_cast<int>(options[i].option));
+        option_key = number_string;
+        switch (options[i].kind) {
+            case RECORDED_OPTION_INT:
+                snprintf(number_string, sizeof(number_string), "%d", options[i].int_value);
+                option_key += "=";
+                option_key += number_string;
+                break;
+            case RECORDED_OPTION_STRING:
+                option_key += "=" + options[i].string_value;
+                break;
+            case RECORDED_OPTION_NULL:
+                break;
+        }
+
+        option_keys.push_back(option_key);
+    }
+    std::sort(option_keys.begin(), option_keys.end());
+    for (size_t i = 0; i < option_keys.size(); i++) {
+        key += '\0';
+        key += option_keys[i];
+    }
+
+    return key;
 }
 
-MysqlConnection::~MysqlConnection() {
-    this->Close();
-    pthread_mutex_destroy(&this->query_lock);
+void MysqlConnection::ApplyCachedSslSession(MYSQL *my_conn, const std::string &key) {
+#ifdef MYSQLCONN_HAVE_SSL_SESSION_DATA
+    pthread_mutex_lock(&ssl_sessions_lock);
+    std::map<std::string, std::string>::iterator it = ssl_sessions.find(key);
+    if (it != ssl_sessions.end()) {
+        // mysql_options() copies session data
+        mysql_options(my_conn, MYSQL_OPT_SSL_SESSION_DATA, it->second.c_str());
+    }
+    pthread_mutex_unlock(&ssl_sessions_lock);
+#endif
 }
 
-/**
- * new MysqlConnection()
- *
- * Creates new MysqlConnection object
- **/
-NAN_METHOD(MysqlConnection::New) {
-    NanScope();
+void MysqlConnection::CacheSslSession(MYSQL *my_conn, const std::string &key) {
+#ifdef MYSQLCONN_HAVE_SSL_SESSION_DATA
+    if (!mysql_get_ssl_cipher(my_conn)) {
+        // Not a TLS connection
+        return;
+    }
 
-    MysqlConnection *conn = new MysqlConnection();
-    conn->Wrap(args.Holder());
+    unsigned int session_data_length = 0;
+    void *session_data = mysql_get_ssl_session_data(my_conn, 0, &session_data_length);
+    if (!session_data) {
+        return;
+    }
 
-    NanReturnValue(args.Holder());
+    pthread_mutex_lock(&ssl_sessions_lock);
+    ssl_sessions[key].assign(static_cast<const char *>(session_data), session_data_length);
+    pthread_mutex_unlock(&ssl_sessions_lock);
+
+    mysql_free_ssl_session_data(my_conn, session_data);
+#endif
 }
 
-/** read-only
- * MysqlConnection#connectErrno -> Integer
- *
- * Gets last connect error number
- **/
-NAN_GETTER(MysqlConnection::ConnectErrnoGetter) {
-    NanScope();
+void MysqlConnection::SaveConnectParams(const char* hostname,
+                                        const char* user,
+                                        const char* password,
+                                        const char* dbname,
+                                        uint32_t port,
+                                        const char* socket,
+                                        uint64_t flags) {
+    this->last_connect.hostname = hostname ? hostname : "";
+    this->last_connect.user = user ? user : "";
+    this->last_connect.password = password ? password : "";
+    this->last_connect.dbname = dbname ? dbname : "";
+    this->last_connect.socket = socket ? socket : "";
+    this->last_connect.port = port;
+    this->last_connect.flags = flags;
+}
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+/*!
+ * Opens side connection for KILL QUERY with saved connect parameters,
+ * options and TLS setup of the main connection
+ */
+MYSQL *MysqlConnection::ConnectKillConnection(const kill_query_request *kill_req) {
+    const connect_params &params = kill_req->params;
 
-    NanReturnValue(Integer::NewFromUnsigned(conn->connect_errno));
-}
+    MYSQL *kill_conn = mysql_init(NULL);
+    if (!kill_conn) {
+        return NULL;
+    }
 
-/** read-only
- * MysqlConnection#connectError -> String
- *
- * Gets last connect error string
- **/
-NAN_GETTER(MysqlConnection::ConnectErrorGetter) {
-    NanScope();
+    ApplyRecordedSetup(kill_conn, kill_req->options, kill_req->ssl);
+
+    // Recorded connect timeout may be longer
+    unsigned int connect_timeout = MYSQLCONN_KILL_CONNECT_TIMEOUT;
+    mysql_options(kill_conn, MYSQL_OPT_CONNECT_TIMEOUT, &connect_timeout);
+
+    std::string ssl_session_key = SslSessionKey(params.hostname.empty() ? NULL : params.hostname.c_str(),
+                                                params.user.c_str(), params.port,
+                                                params.socket.empty() ? NULL : params.socket.c_str(),
+                                                kill_req->ssl, kill_req->options);
+    ApplyCachedSslSession(kill_conn, ssl_session_key);
+
+    if (!mysql_real_connect(kill_conn,
+                            params.hostname.empty() ? NULL : params.hostname.c_str(),
+                            params.user.c_str(),
+                            params.password.c_str(),
+                            NULL,
+                            params.port,
+                            params.socket.empty() ? NULL : params.socket.c_str(),
+                            params.flags & ~CLIENT_MULTI_STATEMENTS)) {
+        mysql_close(kill_conn);
+        return NULL;
+    }
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    CacheSslSession(kill_conn, ssl_session_key);
 
-    NanReturnValue(V8STR(conn->connect_error ? conn->connect_error : ""));
+    return kill_conn;
 }
 
-/**
- * MysqlConnection#affectedRowsSync() -> Integer
- *
- * Gets number of affected rows in previous operation
- **/
-NAN_METHOD(MysqlConnection::AffectedRowsSync) {
-    NanScope();
+/*!
+ * Sends KILL QUERY for running query, runs in its own thread
+ * to not wait for a free threadpool thread when all of them are busy
+ */
+void *MysqlConnection::KillQueryThread(void *data) {
+    kill_query_request *kill_req = static_cast<kill_query_request *>(data);
+    MysqlConnection *conn = kill_req->conn;
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    mysql_thread_init();
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    char kill_query[64];
+    snprintf(kill_query, sizeof(kill_query), "KILL QUERY %lu", kill_req->thread_id);
 
-    my_ulonglong affected_rows = mysql_affected_rows(conn->_conn);
+    pthread_mutex_lock(&conn->kill_conn_lock);
 
-    if (affected_rows == ((my_ulonglong)-1)) {
-        NanReturnValue(Integer::New(-1));
-    }
+    // Side connection may be closed by server due to wait_timeout,
+    // so try to reopen it once
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (!conn->kill_conn) {
+            conn->kill_conn = ConnectKillConnection(kill_req);
+            if (!conn->kill_conn) {
+                break;
+            }
+        }
 
-    NanReturnValue(Integer::New(affected_rows));
-}
+        // Next query on this connection waits in EIO_Query while KILL QUERY
+        // is sent, so it can't start and be killed instead.
+        // Only one KILL QUERY thread gets here at a time, see kill_conn_lock
+        pthread_mutex_lock(&conn->kill_lock);
+        bool running = (conn->running_query_id == kill_req->query_id);
+        conn->kill_sending = running;
+        if (running) {
+            conn->killed_query_id = kill_req->query_id;
+        }
+        pthread_mutex_unlock(&conn->kill_lock);
 
-/**
- * MysqlConnection#autoCommitSync(mode) -> Boolean
- * - mode (Boolean): Mode flag
- *
- * Sets autocommit mode
- **/
-NAN_METHOD(MysqlConnection::AutoCommitSync) {
-    NanScope();
+        int r = 0;
+        if (running) {
+            r = mysql_real_query(conn->kill_conn, kill_query, strlen(kill_query));
+        }
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+        pthread_mutex_lock(&conn->kill_lock);
+        conn->kill_sending = false;
+        pthread_cond_broadcast(&conn->kill_cond);
+        pthread_mutex_unlock(&conn->kill_lock);
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+        if (r == 0) {
+            break;
+        }
 
-    REQ_BOOL_ARG(0, autocomit)
+        mysql_close(conn->kill_conn);
+        conn->kill_conn = NULL;
+    }
 
-    if (mysql_autocommit(conn->_conn, autocomit)) {
-        NanReturnValue(False());
+    MYSQL *closed_kill_conn = NULL;
+
+    pthread_mutex_lock(&conn->kill_lock);
+    if (conn->pending_kills == 1 && conn->close_kill_conn) {
+        closed_kill_conn = conn->kill_conn;
+        conn->kill_conn = NULL;
+        conn->close_kill_conn = false;
     }
+    conn->pending_kills--;
+    pthread_cond_broadcast(&conn->kill_cond);
+    pthread_mutex_unlock(&conn->kill_lock);
 
-    NanReturnValue(True());
-}
+    // Connection may be destroyed right after this, don't touch it anymore
+    pthread_mutex_unlock(&conn->kill_conn_lock);
 
-/**
- * MysqlConnection#changeUserSync(user[, password[, database]]) -> Boolean
- * - user (String): Username
- * - password (String): Password
- * - database (String): Database to use
- *
- * Changes the user and causes the database to become the default
- **/
-NAN_METHOD(MysqlConnection::ChangeUserSync) {
-    NanScope();
+    if (closed_kill_conn) {
+        mysql_close(closed_kill_conn);
+    }
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    delete kill_req;
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    mysql_thread_end();
 
-    REQ_STR_ARG(0, user)
+    return NULL;
+}
 
-    // TODO(Sannis): Check logic
-    if ( (args.Length() < 2) || (!args[0]->IsString()) ||
-         (!args[1]->IsString()) ) {
-        return NanThrowTypeError("Must give at least user and password as arguments");
+/*!
+ * Starts KILL QUERY thread for running query,
+ * caller has already counted it in pending_kills
+ */
+void MysqlConnection::KillRunningQuery(uint64_t query_id) {
+    kill_query_request *kill_req = new kill_query_request;
+    kill_req->conn = this;
+    kill_req->params = this->last_connect;
+    kill_req->options = this->recorded_options;
+    kill_req->ssl = this->recorded_ssl;
+    kill_req->query_id = query_id;
+    kill_req->thread_id = mysql_thread_id(this->_conn);
+
+    pthread_t kill_thread;
+    if (pthread_create(&kill_thread, NULL, KillQueryThread, kill_req) != 0) {
+        delete kill_req;
+
+        pthread_mutex_lock(&this->kill_lock);
+        this->pending_kills--;
+        pthread_cond_broadcast(&this->kill_cond);
+        pthread_mutex_unlock(&this->kill_lock);
+        return;
     }
-    String::Utf8Value password(args[1]->ToString());
+    pthread_detach(kill_thread);
+}
 
-    if ( (args.Length() == 3) && (!args[2]->IsString()) ) {
-        return NanThrowTypeError("Must give string value as third argument, dbname");
-    }
-    String::Utf8Value dbname(args[2]->ToString());
+/*!
+ * Helpers for MysqlConnection::ClassifyQuery
+ */
+static inline bool IsQueryWordChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+        || (c >= '0' && c <= '9') || c == '_' || c == '$';
+}
 
-    bool r = mysql_change_user(conn->_conn,
-                               *user,
-                               args[1]->IsString() ? *password : NULL,
-                               args[2]->IsString() ? *dbname : NULL);
+static inline bool QueryWordIs(const char *word, size_t word_len, const char *keyword) {
+    return (strlen(keyword) == word_len) && (strncasecmp(word, keyword, word_len) == 0);
+}
 
-    if (r) {
-        NanReturnValue(False());
+/*!
+ * Moves pos to the next word outside of literals and comments,
+ * returns its length or 0 at the end of the query
+ */
+static size_t NextQueryWord(const char *query, size_t query_len, size_t *pos) {
+    size_t i = *pos;
+
+    while (i < query_len) {
+        char c = query[i];
+
+        if (c == '\'' || c == '"' || c == '`') {
+            // Skip quoted literal or identifier
+            for (i++; i < query_len && query[i] != c; i++) {
+                if (query[i] == '\\' && c != '`') {
+                    i++;
+                }
+            }
+            i++;
+        } else if (c == '/' && i + 1 < query_len && query[i + 1] == '*') {
+            // Skip block comment
+            for (i += 2; i + 1 < query_len && !(query[i] == '*' && query[i + 1] == '/'); i++) {}
+            i += 2;
+        } else if (c == '#' || (c == '-' && i + 2 < query_len && query[i + 1] == '-'
+                                && (query[i + 2] == ' ' || query[i + 2] == '\t'))) {
+            // Skip line comment
+            for (; i < query_len && query[i] != '\n'; i++) {}
+        } else if (IsQueryWordChar(c)) {
+            size_t start = i;
+            for (; i < query_len && IsQueryWordChar(query[i]); i++) {}
+            *pos = start;
+            return i - start;
+        } else {
+            i++;
+        }
     }
 
-    NanReturnValue(True());
+    *pos = query_len;
+    return 0;
 }
 
-/**
- * MysqlConnection#commitSync() -> Boolean
+/*!
+ * Classifies query as read, write or transaction boundary
  *
- * Commits the current transaction
+ * Only scans words, so it is cheap enough to run before each query.
+ * Reads with side effects or locks are classified as writes.
+ */
+MysqlQueryType MysqlConnection::ClassifyQuery(const char *query, size_t query_len) {
+    size_t pos = 0, len;
+
+    len = NextQueryWord(query, query_len, &pos);
+    if (len == 0) {
+        return QUERY_TYPE_WRITE;
+    }
+
+    const char *word = query + pos;
+    pos += len;
+
+    if (QueryWordIs(word, len, "BEGIN")) {
+        return QUERY_TYPE_BEGIN;
+    }
+
+    if (QueryWordIs(word, len, "START")) {
+        len = NextQueryWord(query, query_len, &pos);
+        if (QueryWordIs(query + pos, len, "TRANSACTION")) {
+            return QUERY_TYPE_BEGIN;
+        }
+        return QUERY_TYPE_WRITE;
+    }
+
+    if (QueryWordIs(word, len, "COMMIT")) {
+        return QUERY_TYPE_END;
+    }
+
+    if (QueryWordIs(word, len, "ROLLBACK")) {
+        // ROLLBACK [WORK] TO SAVEPOINT keeps transaction open
+        len = NextQueryWord(query, query_len, &pos);
+        if (QueryWordIs(query + pos, len, "WORK")) {
+            pos += len;
+            len = NextQueryWord(query, query_len, &pos);
+        }
+        if (QueryWordIs(query + pos, len, "TO")) {
+            return QUERY_TYPE_WRITE;
+        }
+        return QUERY_TYPE_END;
+    }
+
+    bool is_with = QueryWordIs(word, len, "WITH");
+
+    if (!is_with
+     && !QueryWordIs(word, len, "SELECT")
+     && !QueryWordIs(word, len, "SHOW")
+     && !QueryWordIs(word, len, "DESC")
+     && !QueryWordIs(word, len, "DESCRIBE")
+     && !QueryWordIs(word, len, "EXPLAIN")) {
+        return QUERY_TYPE_WRITE;
+    }
+
+    // Look for locking reads, SELECT ... INTO
+    // and functions that depend on session state
+    const char *prev_word = word;
+    size_t prev_len = len;
+
+    while ((len = NextQueryWord(query, query_len, &pos)) > 0) {
+        word = query + pos;
+        pos += len;
+
+        if (QueryWordIs(word, len, "INTO")
+         || QueryWordIs(word, len, "LAST_INSERT_ID")
+         || QueryWordIs(word, len, "FOUND_ROWS")
+         || QueryWordIs(word, len, "ROW_COUNT")
+         || QueryWordIs(word, len, "GET_LOCK")
+         || QueryWordIs(word, len, "RELEASE_LOCK")
+         || QueryWordIs(word, len, "RELEASE_ALL_LOCKS")) {
+            return QUERY_TYPE_WRITE;
+        }
+
+        // SELECT ... FOR UPDATE, SELECT ... FOR SHARE
+        if (QueryWordIs(prev_word, prev_len, "FOR")
+         && (QueryWordIs(word, len, "UPDATE") || QueryWordIs(word, len, "SHARE"))) {
+            return QUERY_TYPE_WRITE;
+        }
+
+        // SELECT ... LOCK IN SHARE MODE
+        if (QueryWordIs(prev_word, prev_len, "LOCK") && QueryWordIs(word, len, "IN")) {
+            return QUERY_TYPE_WRITE;
+        }
+
+        // WITH ... UPDATE/DELETE
+        if (is_with
+         && (QueryWordIs(word, len, "UPDATE")
+          || QueryWordIs(word, len, "DELETE")
+          || QueryWordIs(word, len, "INSERT")
+          || QueryWordIs(word, len, "REPLACE"))) {
+            return QUERY_TYPE_WRITE;
+        }
+
+        prev_word = word;
+        prev_len = len;
+    }
+
+    return QUERY_TYPE_READ;
+}
+
+/*!
+ * Updates last query time and its EWMA, should be called from main thread
+ */
+void MysqlConnection::UpdateQueryTime(uint64_t query_time) {
+    this->last_query_time = query_time;
+
+    if (this->query_time_ewma == 0) {
+        this->query_time_ewma = static_cast<double>(query_time);
+    } else {
+        this->query_time_ewma += MYSQLCONN_QUERY_TIME_EWMA_ALPHA
+                               * (static_cast<double>(query_time) - this->query_time_ewma);
+    }
+}
+
+void MysqlConnection::RegisterStatement(MysqlStatement *stmt) {
+    stmt->SetConnection(this);
+    this->statements.insert(stmt);
+}
+
+void MysqlConnection::UnregisterStatement(MysqlStatement *stmt) {
+    this->statements.erase(stmt);
+}
+
+/*!
+ * Runs query and stores its result, must be called from threadpool.
+ * Connection closed with closeSync() is reported as error with zero errno
+ */
+bool MysqlConnection::QueryStoreResult(const std::string &query,
+                                       MYSQL_RES **my_result,
+                                       unsigned int *my_errno,
+                                       std::string *my_error) {
+    MysqlConnection *conn = this;
+
+    *my_result = NULL;
+
+    pthread_mutex_lock(&conn->query_lock);
+
+    if (!conn->_conn || !conn->connected) {
+        *my_errno = 0;
+        *my_error = "Connection is closed by closeSync() during query";
+
+        pthread_mutex_unlock(&conn->query_lock);
+        return false;
+    }
+
+    MYSQLCONN_DISABLE_MQ;
+
+    bool ok = true;
+    if (mysql_real_query(conn->_conn, query.c_str(), query.length()) != 0) {
+        ok = false;
+    } else {
+        *my_result = mysql_store_result(conn->_conn);
+        if (!*my_result && mysql_field_count(conn->_conn) != 0) {
+            ok = false;
+        }
+    }
+
+    if (!ok) {
+        *my_errno = mysql_errno(conn->_conn);
+        *my_error = mysql_error(conn->_conn);
+    }
+
+    pthread_mutex_unlock(&conn->query_lock);
+
+    return ok;
+}
+
+void MysqlConnection::InvalidateStatements() {
+    for (std::set<MysqlStatement *>::iterator it = this->statements.begin();
+         it != this->statements.end(); ++it) {
+        (*it)->Invalidate();
+    }
+}
+
+/*!
+ * Saves connection option for replay, the last value of option wins
+ */
+void MysqlConnection::RecordOption(const recorded_option &option) {
+    for (size_t i = 0; i < this->recorded_options.size(); i++) {
+        if (this->recorded_options[i].option == option.option) {
+            this->recorded_options[i] = option;
+            return;
+        }
+    }
+
+    this->recorded_options.push_back(option);
+}
+
+void MysqlConnection::ForgetRecordedSetup() {
+    this->recorded_options.clear();
+    this->recorded_ssl.set = false;
+    this->session_charset.clear();
+}
+
+/*!
+ * Sets recorded options and TLS setup on new MYSQL handle
+ */
+void MysqlConnection::ApplyRecordedSetup(MYSQL *my_conn,
+                                         const std::vector<recorded_option> &options,
+                                         const ssl_setup &ssl) {
+    for (size_t i = 0; i < options.size(); i++) {
+        const recorded_option &option = options[i];
+
+        switch (option.kind) {
+            case RECORDED_OPTION_INT:
+                mysql_options(my_conn, option.option,
+                              static_cast<const char *>(static_cast<const void *>(&option.int_value)));
+                break;
+            case RECORDED_OPTION_STRING:
+                mysql_options(my_conn, option.option, option.string_value.c_str());
+                break;
+            case RECORDED_OPTION_NULL:
+                mysql_options(my_conn, option.option, NULL);
+                break;
+        }
+    }
+
+    if (ssl.set) {
+        mysql_ssl_set(my_conn,
+                      ssl.have[0] ? ssl.values[0].c_str() : NULL,
+                      ssl.have[1] ? ssl.values[1].c_str() : NULL,
+                      ssl.have[2] ? ssl.values[2].c_str() : NULL,
+                      ssl.have[3] ? ssl.values[3].c_str() : NULL,
+                      ssl.have[4] ? ssl.values[4].c_str() : NULL);
+    }
+}
+
+/*!
+ * Opens new connection with recorded options and session setup,
+ * runs in threadpool
+ */
+MYSQL *MysqlConnection::ReplayConnect(keepalive_request *keepalive_req) {
+    MYSQL *my_conn = mysql_init(NULL);
+    if (!my_conn) {
+        return NULL;
+    }
+
+    ApplyRecordedSetup(my_conn, keepalive_req->options, keepalive_req->ssl);
+
+    const connect_params &params = keepalive_req->params;
+    const char *hostname = params.hostname.empty() ? NULL : params.hostname.c_str();
+    const char *socket = params.socket.empty() ? NULL : params.socket.c_str();
+
+    std::string ssl_session_key = SslSessionKey(hostname, params.user.c_str(), params.port, socket,
+                                                keepalive_req->ssl, keepalive_req->options);
+    ApplyCachedSslSession(my_conn, ssl_session_key);
+
+    if (!mysql_real_connect(my_conn,
+                            hostname,
+                            params.user.c_str(),
+                            params.password.c_str(),
+                            params.dbname.empty() ? NULL : params.dbname.c_str(),
+                            params.port,
+                            socket,
+                            params.flags)) {
+        mysql_close(my_conn);
+        return NULL;
+    }
+
+    CacheSslSession(my_conn, ssl_session_key);
+
+    if (!keepalive_req->charset.empty() &&
+        mysql_set_character_set(my_conn, keepalive_req->charset.c_str())) {
+        mysql_close(my_conn);
+        return NULL;
+    }
+
+    return my_conn;
+}
+
+/*!
+ * EIO wrapper functions for keepalive ping
+ */
+void MysqlConnection::EIO_After_KeepAlive(uv_work_t *req) {
+    NanScope();
+
+    struct keepalive_request *keepalive_req = (struct keepalive_request *)(req->data);
+    MysqlConnection *conn = keepalive_req->conn;
+
+    if (keepalive_req->new_conn) {
+        if (conn->CanReplaceHandle()) {
+            conn->ReplaceHandle(keepalive_req);
+        } else {
+            // Connection was used or closed while reconnecting, next request gets the error
+            for (size_t i = 0; i < keepalive_req->statements.size(); i++) {
+                if (keepalive_req->statements[i].new_stmt) {
+                    mysql_stmt_close(keepalive_req->statements[i].new_stmt);
+                }
+            }
+            mysql_close(keepalive_req->new_conn);
+            keepalive_req->failed = true;
+        }
+    }
+
+    if (!keepalive_req->skipped && !keepalive_req->failed) {
+        conn->last_activity = uv_hrtime();
+    }
+
+    conn->keepalive_running = false;
+    conn->Unref();
+
+    delete keepalive_req;
+
+    delete req;
+}
+
+void MysqlConnection::EIO_KeepAlive(uv_work_t *req) {
+    struct keepalive_request *keepalive_req = (struct keepalive_request *)(req->data);
+
+    MysqlConnection *conn = keepalive_req->conn;
+
+    // Connection is not idle if query_lock is taken
+    if (pthread_mutex_trylock(&conn->query_lock) != 0) {
+        keepalive_req->skipped = true;
+        return;
+    }
+
+    if (!conn->_conn || !conn->connected) {
+        keepalive_req->skipped = true;
+
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
+    }
+
+    int ping_result = mysql_ping(conn->_conn);
+
+    pthread_mutex_unlock(&conn->query_lock);
+
+    if (ping_result == 0) {
+        return;
+    }
+
+    // New connection is private to this request until main thread installs it
+    MYSQL *new_conn = ReplayConnect(keepalive_req);
+    if (!new_conn) {
+        // Connection stays dead, next request gets the error
+        keepalive_req->failed = true;
+        return;
+    }
+
+    for (size_t i = 0; i < keepalive_req->statements.size(); i++) {
+        keepalive_statement &statement = keepalive_req->statements[i];
+
+        statement.new_stmt = mysql_stmt_init(new_conn);
+        if (statement.new_stmt &&
+            mysql_stmt_prepare(statement.new_stmt, statement.query.c_str(), statement.query.size())) {
+            mysql_stmt_close(statement.new_stmt);
+            statement.new_stmt = NULL;
+        }
+    }
+
+    keepalive_req->new_conn = new_conn;
+}
+
+/*!
+ * Checks that dead connection handle is not used by anything
+ * since keepalive ping, runs in main thread
+ */
+bool MysqlConnection::CanReplaceHandle() {
+    if (this->closing || this->connecting || this->queue_busy ||
+        this->pending_query_sends > 0 || !this->_conn || !this->connected) {
+        return false;
+    }
+
+    // Unbuffered results and their unread rows belong to the old handle
+    if (this->attached_results > 0 || this->_conn->status != MYSQL_STATUS_READY) {
+        return false;
+    }
+
+    for (std::set<MysqlStatement *>::iterator it = this->statements.begin();
+         it != this->statements.end(); ++it) {
+        if ((*it)->Busy()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*!
+ * Installs connection opened by keepalive instead of dead one
+ * and re-prepares statements, runs in main thread
+ */
+void MysqlConnection::ReplaceHandle(keepalive_request *keepalive_req) {
+    pthread_mutex_lock(&this->query_lock);
+    mysql_close(this->_conn);
+    this->_conn = keepalive_req->new_conn;
+    this->multi_query = false;
+    pthread_mutex_unlock(&this->query_lock);
+
+    std::set<MysqlStatement *> reprepared;
+
+    for (size_t i = 0; i < keepalive_req->statements.size(); i++) {
+        keepalive_statement &statement = keepalive_req->statements[i];
+
+        // Statement may be garbage collected, closed or prepared
+        // with another query while reconnecting
+        if (this->statements.count(statement.stmt) &&
+            statement.stmt->PreparedQuery() == statement.query) {
+            statement.stmt->Reprepare(statement.new_stmt);
+            reprepared.insert(statement.stmt);
+        } else if (statement.new_stmt) {
+            mysql_stmt_close(statement.new_stmt);
+        }
+    }
+
+    // Other statements were created on the old handle and are lost with it
+    for (std::set<MysqlStatement *>::iterator it = this->statements.begin();
+         it != this->statements.end(); ++it) {
+        if (!reprepared.count(*it)) {
+            (*it)->Reprepare(NULL);
+        }
+    }
+}
+
+/*!
+ * Keepalive timer callback, runs in main thread
+ */
+MYSQL_BINDINGS_TIMER_CB(MysqlConnection::EV_KeepAlive) {
+    MysqlConnection *conn = (MysqlConnection *)(handle->data);
+
+    if (conn->keepalive_running || conn->closing || conn->connecting || conn->queue_busy ||
+        !conn->_conn || !conn->connected) {
+        return;
+    }
+
+    // querySend() and unbuffered results read connection without holding
+    // query_lock, ping would be sent in the middle of their results
+    if (conn->pending_query_sends > 0 || conn->attached_results > 0) {
+        return;
+    }
+
+    // Statements requests don't take query_lock, don't ping under them
+    for (std::set<MysqlStatement *>::iterator it = conn->statements.begin();
+         it != conn->statements.end(); ++it) {
+        if ((*it)->Busy()) {
+            return;
+        }
+    }
+
+    if (uv_hrtime() - conn->last_activity < static_cast<uint64_t>(conn->keepalive_interval) * 1000000) {
+        return;
+    }
+
+    keepalive_request *keepalive_req = new keepalive_request;
+    keepalive_req->conn = conn;
+    keepalive_req->skipped = false;
+    keepalive_req->failed = false;
+    keepalive_req->new_conn = NULL;
+    keepalive_req->params = conn->last_connect;
+    keepalive_req->options = conn->recorded_options;
+    keepalive_req->ssl = conn->recorded_ssl;
+    keepalive_req->charset = conn->session_charset;
+
+    for (std::set<MysqlStatement *>::iterator it = conn->statements.begin();
+         it != conn->statements.end(); ++it) {
+        keepalive_statement statement;
+        statement.stmt = *it;
+        statement.query = (*it)->PreparedQuery();
+        statement.new_stmt = NULL;
+
+        if (!statement.query.empty()) {
+            keepalive_req->statements.push_back(statement);
+        }
+    }
+
+    conn->keepalive_running = true;
+    conn->Ref();
+
+    uv_work_t *_req = new uv_work_t;
+    _req->data = keepalive_req;
+    uv_queue_work(uv_default_loop(), _req, EIO_KeepAlive, (uv_after_work_cb)EIO_After_KeepAlive);
+}
+
+void MysqlConnection::EV_KeepAlive_OnTimerClose(uv_handle_t *handle) {
+    delete (uv_timer_t *)handle;
+}
+
+void MysqlConnection::StopKeepAlive() {
+    if (!this->keepalive_timer) {
+        return;
+    }
+
+    uv_timer_stop(this->keepalive_timer);
+    uv_close((uv_handle_t *)this->keepalive_timer, EV_KeepAlive_OnTimerClose);
+    this->keepalive_timer = NULL;
+    this->keepalive_interval = 0;
+}
+
+/*!
+ * Creates request for async variant of connection *Sync method
+ */
+MysqlConnection::op_request *MysqlConnection::NewOpRequest(MysqlConnection *conn,
+                                                           connection_op op,
+                                                           Handle<Value> callback) {
+    op_request *op_req = new op_request;
+
+    op_req->conn = conn;
+    op_req->op = op;
+    op_req->nan_callback = callback->IsFunction() ? new NanCallback(callback.As<Function>()) : NULL;
+
+    op_req->flag = false;
+    op_req->have_password = false;
+    op_req->have_dbname = false;
+    op_req->my_result = NULL;
+    op_req->field_count = 0;
+    op_req->my_errno = 0;
+
+    return op_req;
+}
+
+/*!
+ * Adds connection operation request to connection queue,
+ * so it runs after queries queued before it
+ */
+void MysqlConnection::QueueOp(op_request *op_req) {
+    queue_entry entry;
+    entry.method = QUEUE_METHOD_OP;
+    entry.request = op_req;
+    entry.timeout_ms = 0;
+    entry.enqueued_at = uv_hrtime();
+    entry.deadline = 0;
+
+    // Queued request holds connection until it is sent or shed
+    this->Ref();
+
+    QueuePush(&this->queue[QUEUE_PRIORITY_NORMAL], entry);
+    this->queue_enqueued++;
+
+    this->ProcessQueue();
+}
+
+/*!
+ * Queues connection operation request to threadpool
+ */
+void MysqlConnection::StartOp(op_request *op_req) {
+    this->Ref();
+
+    uv_work_t *_req = new uv_work_t;
+    _req->data = op_req;
+    uv_queue_work(uv_default_loop(), _req, EIO_Op, (uv_after_work_cb)EIO_After_Op);
+}
+
+/*!
+ * Gets JS method name of connection operation, for error messages
+ */
+const char *MysqlConnection::OpName(connection_op op) {
+    switch (op) {
+        case CONN_OP_AUTO_COMMIT:
+            return "autoCommit";
+        case CONN_OP_CHANGE_USER:
+            return "changeUser";
+        case CONN_OP_COMMIT:
+            return "commit";
+        case CONN_OP_GET_WARNINGS:
+            return "getWarnings";
+        case CONN_OP_PING:
+            return "ping";
+        case CONN_OP_RESET_SESSION:
+            return "resetSession";
+        case CONN_OP_ROLLBACK:
+            return "rollback";
+        case CONN_OP_SELECT_DB:
+            return "selectDb";
+        case CONN_OP_SET_CHARSET:
+            return "setCharset";
+        case CONN_OP_STAT:
+            return "stat";
+        case CONN_OP_STORE_RESULT:
+            return "storeResult";
+    }
+
+    return "";
+}
+
+/*!
+ * EIO wrapper functions for async variants of connection *Sync methods
+ */
+void MysqlConnection::EIO_After_Op(uv_work_t *req) {
+    NanScope();
+
+    struct op_request *op_req = (struct op_request *)(req->data);
+    MysqlConnection *conn = op_req->conn;
+
+    int argc = 1;
+    Local<Value> argv[2];
+
+    // Server has dropped session state, libmysqlclient has detached
+    // statements even if the call failed halfway
+    if (!op_req->connection_closed &&
+        (op_req->op == CONN_OP_RESET_SESSION || op_req->op == CONN_OP_CHANGE_USER)) {
+        if (op_req->op == CONN_OP_RESET_SESSION) {
+            conn->multi_query = false;
+        }
+        conn->InvalidateStatements();
+    }
+
+    if (op_req->connection_closed) {
+        argv[0] = V8EXC("Connection is closed by closeSync() during query");
+    } else if (!op_req->ok) {
+        const char *op_name = OpName(op_req->op);
+        unsigned int error_string_length = strlen(op_name) + op_req->my_error.size() + 30;
+        char* error_string = new char[error_string_length];
+        snprintf(error_string, error_string_length, "%s() error #%d: %s",
+                 op_name, op_req->my_errno, op_req->my_error.c_str());
+
+        argv[0] = V8EXC(error_string);
+        delete[] error_string;
+    } else {
+        argv[0] = NanNewLocal(Null());
+
+        switch (op_req->op) {
+            case CONN_OP_CHANGE_USER:
+                conn->last_connect.user = op_req->user;
+                conn->last_connect.password = op_req->password;
+                conn->last_connect.dbname = op_req->dbname;
+                break;
+            case CONN_OP_SELECT_DB:
+                conn->last_connect.dbname = op_req->dbname;
+                break;
+            case CONN_OP_SET_CHARSET:
+                conn->session_charset = op_req->charset;
+                break;
+            case CONN_OP_GET_WARNINGS:
+                {
+                    Local<Array> js_result = Array::New(op_req->warnings.size());
+                    for (size_t i = 0; i < op_req->warnings.size(); i++) {
+                        Local<Object> js_warning = Object::New();
+                        js_warning->Set(V8STR("errno"), Integer::NewFromUnsigned(op_req->warnings[i].my_errno));
+                        js_warning->Set(V8STR("reason"), V8STR(op_req->warnings[i].reason.c_str()));
+                        js_result->Set(Integer::NewFromUnsigned(i), js_warning);
+                    }
+                    argc = 2;
+                    argv[1] = js_result;
+                }
+                break;
+            case CONN_OP_STAT:
+                argc = 2;
+                argv[1] = V8STR(op_req->stat.c_str());
+                break;
+            case CONN_OP_STORE_RESULT:
+                argc = 2;
+                if (!op_req->field_count) {
+                    // No result set - not a SELECT, SHOW, DESCRIBE or EXPLAIN
+                    argv[1] = NanNewLocal(True());
+                } else if (!conn->_conn) {
+                    // Connection is closed by close() before callback, result can't be used
+                    mysql_free_result(op_req->my_result);
+                    argc = 1;
+                    argv[0] = V8EXC("Connection is closed by close() during query");
+                } else if (op_req->nan_callback) {
+                    argv[1] = MysqlResult::NewInstance(conn->_conn, op_req->my_result, op_req->field_count);
+                } else {
+                    mysql_free_result(op_req->my_result);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    conn->last_activity = uv_hrtime();
+
+    if (op_req->nan_callback) {
+        op_req->nan_callback->Call(argc, argv);
+        delete op_req->nan_callback;
+    }
+
+    conn->queue_busy = false;
+    conn->ProcessQueue();
+
+    conn->Unref();
+
+    delete op_req;
+
+    delete req;
+}
+
+void MysqlConnection::EIO_Op(uv_work_t *req) {
+    struct op_request *op_req = (struct op_request *)(req->data);
+
+    MysqlConnection *conn = op_req->conn;
+
+    pthread_mutex_lock(&conn->query_lock);
+
+    if (!conn->_conn || !conn->connected) {
+        op_req->ok = false;
+        op_req->connection_closed = true;
+
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
+    }
+    op_req->connection_closed = false;
+
+    MYSQL *my_conn = conn->_conn;
+    bool failed = false;
+
+    switch (op_req->op) {
+        case CONN_OP_AUTO_COMMIT:
+            failed = mysql_autocommit(my_conn, op_req->flag);
+            break;
+        case CONN_OP_CHANGE_USER:
+            failed = mysql_change_user(my_conn,
+                                       op_req->user.c_str(),
+                                       op_req->have_password ? op_req->password.c_str() : NULL,
+                                       op_req->have_dbname ? op_req->dbname.c_str() : NULL);
+            break;
+        case CONN_OP_COMMIT:
+            failed = mysql_commit(my_conn);
+            break;
+        case CONN_OP_GET_WARNINGS:
+            if (mysql_warning_count(my_conn)) {
+                MYSQL_RES *result = NULL;
+                if (mysql_real_query(my_conn, "SHOW WARNINGS", 13) == 0) {
+                    result = mysql_store_result(my_conn);
+                }
+                if (!result) {
+                    failed = true;
+                    break;
+                }
+
+                MYSQL_ROW row;
+                while ((row = mysql_fetch_row(result))) {
+                    op_warning warning;
+                    warning.my_errno = row[1] ? strtoul(row[1], NULL, 10) : 0;
+                    warning.reason = row[2] ? row[2] : "";
+                    op_req->warnings.push_back(warning);
+                }
+
+                mysql_free_result(result);
+            }
+            break;
+        case CONN_OP_PING:
+            failed = (mysql_ping(my_conn) != 0);
+            break;
+        case CONN_OP_RESET_SESSION:
+#ifdef MYSQLCONN_HAVE_RESET_CONNECTION
+            failed = (mysql_reset_connection(my_conn) != 0);
+#else
+            failed = mysql_change_user(my_conn,
+                                       op_req->user.c_str(),
+                                       op_req->password.c_str(),
+                                       op_req->have_dbname ? op_req->dbname.c_str() : NULL);
+#endif
+            // Multi statements option may outlive the reset
+            if (!failed && op_req->flag) {
+                failed = (mysql_set_server_option(my_conn, MYSQL_OPTION_MULTI_STATEMENTS_OFF) != 0);
+            }
+            break;
+        case CONN_OP_ROLLBACK:
+            failed = mysql_rollback(my_conn);
+            break;
+        case CONN_OP_SELECT_DB:
+            failed = (mysql_select_db(my_conn, op_req->dbname.c_str()) != 0);
+            break;
+        case CONN_OP_SET_CHARSET:
+            failed = (mysql_set_character_set(my_conn, op_req->charset.c_str()) != 0);
+            break;
+        case CONN_OP_STAT:
+            {
+                const char *stat = mysql_stat(my_conn);
+                if (stat) {
+                    op_req->stat = stat;
+                } else {
+                    failed = true;
+                }
+            }
+            break;
+        case CONN_OP_STORE_RESULT:
+            op_req->field_count = mysql_field_count(my_conn);
+            if (op_req->field_count) {
+                op_req->my_result = mysql_store_result(my_conn);
+                failed = !op_req->my_result;
+            }
+            break;
+    }
+
+    op_req->ok = !failed;
+    if (failed) {
+        op_req->my_errno = mysql_errno(my_conn);
+        op_req->my_error = mysql_error(my_conn);
+    }
+
+    pthread_mutex_unlock(&conn->query_lock);
+}
+
+void MysqlConnection::QueuePush(queue_ring *ring, const queue_entry &entry) {
+    size_t capacity = ring->entries.size();
+
+    if (ring->count == capacity) {
+        // Grow ring, moving entries to the beginning
+        std::vector<queue_entry> entries;
+        entries.reserve(capacity ? capacity * 2 : MYSQLCONN_QUEUE_INITIAL_CAPACITY);
+        for (size_t i = 0; i < ring->count; i++) {
+            entries.push_back(ring->entries[(ring->head + i) % capacity]);
+        }
+        entries.resize(entries.capacity());
+
+        ring->entries.swap(entries);
+        ring->head = 0;
+        capacity = ring->entries.size();
+    }
+
+    ring->entries[(ring->head + ring->count) % capacity] = entry;
+    ring->count++;
+}
+
+MysqlConnection::queue_entry MysqlConnection::QueuePop(queue_ring *ring) {
+    queue_entry entry = ring->entries[ring->head];
+
+    ring->head = (ring->head + 1) % ring->entries.size();
+    ring->count--;
+
+    return entry;
+}
+
+size_t MysqlConnection::QueueDepth() {
+    size_t depth = 0;
+
+    for (int i = 0; i < QUEUE_PRIORITIES_COUNT; i++) {
+        depth += this->queue[i].count;
+    }
+
+    return depth;
+}
+
+/*!
+ * Sends next queued request, if connection is not busy,
+ * expired requests are shed without sending
+ */
+void MysqlConnection::ProcessQueue() {
+    if (this->queue_processing) {
+        return;
+    }
+    this->queue_processing = true;
+
+    while (!this->queue_busy && !this->connecting) {
+        int priority;
+        for (priority = 0; priority < QUEUE_PRIORITIES_COUNT; priority++) {
+            if (this->queue[priority].count > 0) {
+                break;
+            }
+        }
+        if (priority == QUEUE_PRIORITIES_COUNT) {
+            break;
+        }
+
+        queue_entry entry = QueuePop(&this->queue[priority]);
+
+        uint64_t now = uv_hrtime();
+        uint64_t wait_time = now - entry.enqueued_at;
+
+        this->queue_last_wait_time = wait_time;
+        if (wait_time > this->queue_max_wait_time) {
+            this->queue_max_wait_time = wait_time;
+        }
+        if (this->queue_wait_time_ewma == 0) {
+            this->queue_wait_time_ewma = static_cast<double>(wait_time);
+        } else {
+            this->queue_wait_time_ewma += MYSQLCONN_QUEUE_WAIT_EWMA_ALPHA
+                                        * (static_cast<double>(wait_time) - this->queue_wait_time_ewma);
+        }
+
+        if (entry.deadline && now > entry.deadline) {
+            this->queue_shed++;
+            this->ShedQueued(entry, "Query deadline exceeded in queue");
+            continue;
+        }
+
+        if (this->closing) {
+            this->ShedQueued(entry, "Connection is closing");
+            continue;
+        }
+
+        if (!this->_conn || !this->connected) {
+            this->ShedQueued(entry, "Not connected");
+            continue;
+        }
+
+        this->queue_dispatched++;
+        this->queue_busy = true;
+
+        switch (entry.method) {
+            case QUEUE_METHOD_QUERY:
+                this->StartQuery(static_cast<query_request *>(entry.request), entry.timeout_ms);
+                break;
+            case QUEUE_METHOD_QUERY_SEND:
+                this->StartQuerySend(static_cast<query_request *>(entry.request));
+                break;
+            case QUEUE_METHOD_MULTI_QUERY:
+                this->StartMultiQuery(static_cast<multi_query_request *>(entry.request));
+                break;
+            case QUEUE_METHOD_WORK:
+                this->StartWork(static_cast<work_request *>(entry.request));
+                break;
+            case QUEUE_METHOD_OP:
+                this->StartOp(static_cast<op_request *>(entry.request));
+                break;
+        }
+
+        // Running request holds its own reference
+        this->Unref();
+    }
+
+    this->queue_processing = false;
+}
+
+/*!
+ * Queues threadpool work of other classes, it runs when connection
+ * is not busy with queued queries
+ */
+void MysqlConnection::QueueWork(void *data, queued_work_cb work, queued_work_after_cb after) {
+    work_request *work_req = new work_request;
+    work_req->conn = this;
+    work_req->data = data;
+    work_req->work = work;
+    work_req->after = after;
+
+    queue_entry entry;
+    entry.method = QUEUE_METHOD_WORK;
+    entry.request = work_req;
+    entry.timeout_ms = 0;
+    entry.enqueued_at = uv_hrtime();
+    entry.deadline = 0;
+
+    // Queued request holds connection until it is sent or shed
+    this->Ref();
+
+    QueuePush(&this->queue[QUEUE_PRIORITY_NORMAL], entry);
+    this->queue_enqueued++;
+
+    this->ProcessQueue();
+}
+
+void MysqlConnection::StartWork(work_request *work_req) {
+    this->Ref();
+
+    uv_work_t *_req = new uv_work_t;
+    _req->data = work_req;
+    uv_queue_work(uv_default_loop(), _req, EIO_QueuedWork, (uv_after_work_cb)EIO_After_QueuedWork);
+}
+
+/*!
+ * EIO wrapper functions for MysqlConnection::QueueWork
+ */
+void MysqlConnection::EIO_After_QueuedWork(uv_work_t *req) {
+    NanScope();
+
+    work_request *work_req = static_cast<work_request *>(req->data);
+    MysqlConnection *conn = work_req->conn;
+
+    work_req->after(work_req->data, NULL);
+
+    conn->queue_busy = false;
+    conn->ProcessQueue();
+
+    conn->Unref();
+
+    delete work_req;
+    delete req;
+}
+
+void MysqlConnection::EIO_QueuedWork(uv_work_t *req) {
+    work_request *work_req = static_cast<work_request *>(req->data);
+
+    work_req->work(work_req->data);
+}
+
+/*!
+ * Completes queued request with error without sending it
+ */
+void MysqlConnection::ShedQueued(const queue_entry &entry, const char *error) {
+    NanScope();
+
+    if (entry.method == QUEUE_METHOD_WORK) {
+        work_request *work_req = static_cast<work_request *>(entry.request);
+
+        work_req->after(work_req->data, error);
+        delete work_req;
+
+        this->Unref();
+        return;
+    }
+
+    const int argc = 1;
+    Local<Value> argv[argc];
+    argv[0] = V8EXC(error);
+
+    NanCallback *nan_callback;
+
+    if (entry.method == QUEUE_METHOD_MULTI_QUERY) {
+        multi_query_request *mquery_req = static_cast<multi_query_request *>(entry.request);
+
+        nan_callback = mquery_req->nan_callback;
+
+        delete[] mquery_req->query;
+        delete mquery_req;
+    } else if (entry.method == QUEUE_METHOD_OP) {
+        op_request *op_req = static_cast<op_request *>(entry.request);
+
+        nan_callback = op_req->nan_callback;
+
+        delete op_req;
+    } else {
+        query_request *query_req = static_cast<query_request *>(entry.request);
+
+        nan_callback = query_req->nan_callback;
+
+        this->ForgetInflightRead(query_req);
+        for (size_t i = 0; i < query_req->followers.size(); i++) {
+            query_req->followers[i]->Call(argc, argv);
+            delete query_req->followers[i];
+        }
+
+        if (query_req->infile_data) {
+            free(query_req->infile_data->buffer);
+            free(query_req->infile_data);
+        }
+        delete[] query_req->query;
+        delete query_req;
+    }
+
+    if (nan_callback) {
+        nan_callback->Call(argc, argv);
+        delete nan_callback;
+    }
+
+    this->Unref();
+}
+
+/*!
+ * Attaches callback to in-flight query with the same SQL, if coalescing
+ * is enabled and query is a read. Any other query stops coalescing
+ * with already running reads, so next reads see its changes.
+ */
+bool MysqlConnection::JoinInflightRead(const char *query,
+                                       size_t query_len,
+                                       Handle<Value> callback,
+                                       bool *is_read) {
+    *is_read = false;
+
+    if (!this->coalesce_reads) {
+        return false;
+    }
+
+    if (ClassifyQuery(query, query_len) != QUERY_TYPE_READ) {
+        this->inflight_reads.clear();
+        return false;
+    }
+    *is_read = true;
+
+    std::map<std::string, query_request *>::iterator it =
+        this->inflight_reads.find(std::string(query, query_len));
+    if (it == this->inflight_reads.end()) {
+        return false;
+    }
+
+    if (callback->IsFunction()) {
+        it->second->followers.push_back(new NanCallback(callback.As<Function>()));
+    }
+    this->coalesced_count++;
+
+    return true;
+}
+
+void MysqlConnection::RegisterInflightRead(query_request *query_req) {
+    this->inflight_reads[std::string(query_req->query, query_req->query_len)] = query_req;
+    query_req->inflight_registered = true;
+}
+
+void MysqlConnection::ForgetInflightRead(query_request *query_req) {
+    if (!query_req->inflight_registered) {
+        return;
+    }
+    query_req->inflight_registered = false;
+
+    std::map<std::string, query_request *>::iterator it =
+        this->inflight_reads.find(std::string(query_req->query, query_req->query_len));
+    if (it != this->inflight_reads.end() && it->second == query_req) {
+        this->inflight_reads.erase(it);
+    }
+}
+
+void MysqlConnection::StopCoalescing(const char *query, size_t query_len) {
+    if (!query || ClassifyQuery(query, query_len) != QUERY_TYPE_READ) {
+        this->inflight_reads.clear();
+    }
+}
+
+void MysqlConnection::LockQuery() {
+    pthread_mutex_lock(&this->query_lock);
+}
+
+void MysqlConnection::UnlockQuery() {
+    pthread_mutex_unlock(&this->query_lock);
+}
+
+void MysqlConnection::MarkActive() {
+    this->last_activity = uv_hrtime();
+}
+
+void MysqlConnection::AttachResult() {
+    this->attached_results++;
+}
+
+void MysqlConnection::DetachResult() {
+    this->attached_results--;
+}
+
+void MysqlConnection::Disconnect() {
+    pthread_mutex_lock(&this->query_lock);
+    if (this->_conn) {
+        mysql_close(this->_conn);
+        this->_conn = NULL;
+        this->connected = false;
+        // this->multi_query = false;
+        this->opt_reconnect = false;
+        this->connect_errno = 0;
+        this->connect_error = NULL;
+    }
+    pthread_mutex_unlock(&this->query_lock);
+
+    // Running KILL QUERY threads still use side connection,
+    // don't wait for them here, the last of them closes it
+    pthread_mutex_lock(&this->kill_lock);
+    bool kills_running = this->pending_kills > 0;
+    this->close_kill_conn = kills_running;
+    pthread_mutex_unlock(&this->kill_lock);
+
+    if (!kills_running) {
+        pthread_mutex_lock(&this->kill_conn_lock);
+        if (this->kill_conn) {
+            mysql_close(this->kill_conn);
+            this->kill_conn = NULL;
+        }
+        pthread_mutex_unlock(&this->kill_conn_lock);
+    }
+}
+
+MysqlConnection::MysqlConnection(): ObjectWrap() {
+    this->_conn = NULL;
+    this->connected = false;
+    this->multi_query = false;
+    this->opt_reconnect = false;
+    this->connect_errno = 0;
+    this->connect_error = NULL;
+    this->last_query_time = 0;
+    this->query_time_ewma = 0;
+    this->last_connect.port = 0;
+    this->last_connect.flags = 0;
+    this->kill_conn = NULL;
+    this->pending_kills = 0;
+    this->kill_sending = false;
+    this->close_kill_conn = false;
+    this->running_query_id = 0;
+    this->killed_query_id = 0;
+    this->last_query_id = 0;
+    for (int i = 0; i < QUEUE_PRIORITIES_COUNT; i++) {
+        this->queue[i].head = 0;
+        this->queue[i].count = 0;
+    }
+    this->queue_busy = false;
+    this->queue_processing = false;
+    this->connecting = false;
+    this->closing = false;
+    this->recorded_ssl.set = false;
+    this->keepalive_timer = NULL;
+    this->keepalive_interval = 0;
+    this->keepalive_running = false;
+    this->last_activity = 0;
+    this->attached_results = 0;
+    this->pending_query_sends = 0;
+    this->queue_enqueued = 0;
+    this->queue_dispatched = 0;
+    this->queue_shed = 0;
+    this->queue_last_wait_time = 0;
+    this->queue_max_wait_time = 0;
+    this->queue_wait_time_ewma = 0;
+    this->coalesce_reads = false;
+    this->coalesced_count = 0;
+    pthread_mutex_init(&this->query_lock, NULL);
+    pthread_mutex_init(&this->kill_conn_lock, NULL);
+    pthread_mutex_init(&this->kill_lock, NULL);
+    pthread_cond_init(&this->kill_cond, NULL);
+}
+
+MysqlConnection::~MysqlConnection() {
+    for (std::set<MysqlStatement *>::iterator it = this->statements.begin();
+         it != this->statements.end(); ++it) {
+        (*it)->SetConnection(NULL);
+    }
+    this->StopKeepAlive();
+    this->Disconnect();
+
+    // KILL QUERY threads use connection locks until they are finished
+    pthread_mutex_lock(&this->kill_lock);
+    while (this->pending_kills > 0) {
+        pthread_cond_wait(&this->kill_cond, &this->kill_lock);
+    }
+    pthread_mutex_unlock(&this->kill_lock);
+    pthread_mutex_lock(&this->kill_conn_lock);
+    pthread_mutex_unlock(&this->kill_conn_lock);
+
+    pthread_mutex_destroy(&this->query_lock);
+    pthread_mutex_destroy(&this->kill_conn_lock);
+    pthread_mutex_destroy(&this->kill_lock);
+    pthread_cond_destroy(&this->kill_cond);
+}
+
+/**
+ * new MysqlConnection()
+ *
+ * Creates new MysqlConnection object
+ **/
+NAN_METHOD(MysqlConnection::New) {
+    NanScope();
+
+    MysqlConnection *conn = new MysqlConnection();
+    conn->Wrap(args.Holder());
+
+    NanReturnValue(args.Holder());
+}
+
+/** read-only
+ * MysqlConnection#connectErrno -> Integer
+ *
+ * Gets last connect error number
+ **/
+NAN_GETTER(MysqlConnection::ConnectErrnoGetter) {
+    NanScope();
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    NanReturnValue(Integer::NewFromUnsigned(conn->connect_errno));
+}
+
+/** read-only
+ * MysqlConnection#connectError -> String
+ *
+ * Gets last connect error string
+ **/
+NAN_GETTER(MysqlConnection::ConnectErrorGetter) {
+    NanScope();
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    NanReturnValue(V8STR(conn->connect_error ? conn->connect_error : ""));
+}
+
+/** read-only
+ * MysqlConnection#lastQueryTime -> Number
+ *
+ * Gets duration of last asynchronous query in milliseconds
+ **/
+NAN_GETTER(MysqlConnection::LastQueryTimeGetter) {
+    NanScope();
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    NanReturnValue(Number::New(conn->last_query_time / 1e6));
+}
+
+/** read-only
+ * MysqlConnection#queryTimeEwma -> Number
+ *
+ * Gets exponentially weighted moving average of asynchronous queries
+ * duration in milliseconds, 0 if there were no queries yet
+ **/
+NAN_GETTER(MysqlConnection::QueryTimeEwmaGetter) {
+    NanScope();
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    NanReturnValue(Number::New(conn->query_time_ewma / 1e6));
+}
+
+/**
+ * MysqlConnection#affectedRowsSync() -> Integer
+ *
+ * Gets number of affected rows in previous operation
+ **/
+NAN_METHOD(MysqlConnection::AffectedRowsSync) {
+    NanScope();
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    my_ulonglong affected_rows = mysql_affected_rows(conn->_conn);
+
+    if (affected_rows == ((my_ulonglong)-1)) {
+        NanReturnValue(Integer::New(-1));
+    }
+
+    NanReturnValue(Integer::New(affected_rows));
+}
+
+/**
+ * MysqlConnection#autoCommit(mode[, callback])
+ * - mode (Boolean): Mode flag
+ * - callback (Function): Callback function, gets (error)
+ *
+ * Sets autocommit mode, asynchronous version of autoCommitSync()
+ **/
+NAN_METHOD(MysqlConnection::AutoCommit) {
+    NanScope();
+
+    REQ_BOOL_ARG(0, autocommit)
+    OPTIONAL_FUN_ARG(1, callback);
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    op_request *op_req = NewOpRequest(conn, CONN_OP_AUTO_COMMIT, callback);
+    op_req->flag = autocommit;
+
+    conn->QueueOp(op_req);
+
+    NanReturnUndefined();
+}
+
+/**
+ * MysqlConnection#autoCommitSync(mode) -> Boolean
+ * - mode (Boolean): Mode flag
+ *
+ * Sets autocommit mode
+ **/
+NAN_METHOD(MysqlConnection::AutoCommitSync) {
+    NanScope();
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    REQ_BOOL_ARG(0, autocomit)
+
+    if (mysql_autocommit(conn->_conn, autocomit)) {
+        NanReturnValue(False());
+    }
+
+    NanReturnValue(True());
+}
+
+/**
+ * MysqlConnection#changeUser(user[, password[, database]][, callback])
+ * - user (String): Username
+ * - password (String): Password
+ * - database (String): Database to use
+ * - callback (Function): Callback function, gets (error)
+ *
+ * Changes the user and causes the database to become the default,
+ * asynchronous version of changeUserSync()
+ **/
+NAN_METHOD(MysqlConnection::ChangeUser) {
+    NanScope();
+
+    REQ_STR_ARG(0, user)
+    OPTIONAL_FUN_ARG(args.Length() - 1, callback);
+
+    int string_args = callback->IsFunction() ? args.Length() - 1 : args.Length();
+    for (int i = 1; i < string_args; i++) {
+        if (!args[i]->IsString()) {
+            return NanThrowTypeError("Password and database must be strings");
+        }
+    }
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    op_request *op_req = NewOpRequest(conn, CONN_OP_CHANGE_USER, callback);
+    op_req->user = *user;
+    if (string_args > 1) {
+        op_req->have_password = true;
+        op_req->password = *String::Utf8Value(args[1]->ToString());
+    }
+    if (string_args > 2) {
+        op_req->have_dbname = true;
+        op_req->dbname = *String::Utf8Value(args[2]->ToString());
+    }
+
+    conn->QueueOp(op_req);
+
+    NanReturnUndefined();
+}
+
+/**
+ * MysqlConnection#changeUserSync(user[, password[, database]]) -> Boolean
+ * - user (String): Username
+ * - password (String): Password
+ * - database (String): Database to use
+ *
+ * Changes the user and causes the database to become the default
+ **/
+NAN_METHOD(MysqlConnection::ChangeUserSync) {
+    NanScope();
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    REQ_STR_ARG(0, user)
+
+    // TODO(Sannis): Check logic
+    if ( (args.Length() < 2) || (!args[0]->IsString()) ||
+         (!args[1]->IsString()) ) {
+        return NanThrowTypeError("Must give at least user and password as arguments");
+    }
+    String::Utf8Value password(args[1]->ToString());
+
+    if ( (args.Length() == 3) && (!args[2]->IsString()) ) {
+        return NanThrowTypeError("Must give string value as third argument, dbname");
+    }
+    String::Utf8Value dbname(args[2]->ToString());
+
+    bool r = mysql_change_user(conn->_conn,
+                               *user,
+                               args[1]->IsString() ? *password : NULL,
+                               args[2]->IsString() ? *dbname : NULL);
+
+    conn->InvalidateStatements();
+
+    if (r) {
+        NanReturnValue(False());
+    }
+
+    conn->last_connect.user = *user;
+    conn->last_connect.password = args[1]->IsString() ? *password : "";
+    conn->last_connect.dbname = args[2]->IsString() ? *dbname : "";
+
+    NanReturnValue(True());
+}
+
+/**
+ * MysqlConnection#commit([callback])
+ * - callback (Function): Callback function, gets (error)
+ *
+ * Commits the current transaction, asynchronous version of commitSync()
+ **/
+NAN_METHOD(MysqlConnection::Commit) {
+    NanScope();
+
+    OPTIONAL_FUN_ARG(0, callback);
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    op_request *op_req = NewOpRequest(conn, CONN_OP_COMMIT, callback);
+
+    conn->QueueOp(op_req);
+
+    NanReturnUndefined();
+}
+
+/**
+ * MysqlConnection#commitSync() -> Boolean
+ *
+ * Commits the current transaction
+ **/
+NAN_METHOD(MysqlConnection::CommitSync) {
+    NanScope();
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    if (mysql_commit(conn->_conn)) {
+        NanReturnValue(False());
+    }
+
+    NanReturnValue(True());
+}
+
+/*!
+ * EIO wrapper functions for MysqlConnection::Connect
+ */
+void MysqlConnection::EIO_After_Connect(uv_work_t *req) {
+    NanScope();
+
+    struct connect_request *conn_req = (struct connect_request *)(req->data);
+
+    const int argc = 1;
+    Local<Value> argv[argc];
+
+    if (!conn_req->ok) {
+        unsigned int error_string_length = strlen(conn_req->conn->connect_error) + 25;
+        char* error_string = new char[error_string_length];
+        snprintf(
+            error_string, error_string_length,
+            "Connection error #%d: %s",
+            conn_req->conn->connect_errno, conn_req->conn->connect_error);
+
+        argv[0] = V8EXC(error_string);
+        delete[] error_string;
+    } else {
+        argv[0] = NanNewLocal(Null());
+    }
+
+    conn_req->conn->connecting = false;
+
+    conn_req->nan_callback->Call(argc, argv);
+    delete conn_req->nan_callback;
+
+    // Send queries queued while connecting
+    conn_req->conn->ProcessQueue();
+
+    conn_req->conn->Unref();
+
+    delete conn_req;
+
+    delete req;
+}
+
+void MysqlConnection::EIO_Connect(uv_work_t *req) {
+    struct connect_request *conn_req = (struct connect_request *)(req->data);
+
+    if (!conn_req->hosts.empty()) {
+        conn_req->ok = conn_req->conn->ConnectFirst(
+            conn_req->hosts,
+            conn_req->user ? **(conn_req->user) : NULL,
+            conn_req->password ? **(conn_req->password) : NULL,
+            conn_req->dbname ? **(conn_req->dbname) : NULL,
+            conn_req->socket ? **(conn_req->socket) : NULL,
+            conn_req->flags);
+    } else {
+        conn_req->ok = conn_req->conn->Connect(
+            conn_req->hostname ? **(conn_req->hostname) : NULL,
+            conn_req->user ? **(conn_req->user) : NULL,
+            conn_req->password ? **(conn_req->password) : NULL,
+            conn_req->dbname ? **(conn_req->dbname) : NULL,
+            conn_req->port,
+            conn_req->socket ? **(conn_req->socket) : NULL,
+            conn_req->flags
+        ) ? true : false;
+    }
+
+    delete conn_req->hostname;
+    delete conn_req->user;
+    delete conn_req->password;
+    delete conn_req->dbname;
+    delete conn_req->socket;
+}
+
+/**
+ * MysqlConnection#connect([hostname[, user[, password[, database[, port[, socket]]]]]], callback)
+ * - hostname (String|Array): Hostname or hosts list
+ * - user (String): Username
+ * - password (String): Password
+ * - database (String): Database to use
+ * - port (Integer): Connection port
+ * - socket (String): Connection socket
+ * - callback (Function): Callback function, gets (error)
+ *
+ * Connects to the MySQL server
+ *
+ * Hosts list entries are "host", "host:port" or "[IPv6]:port",
+ * port argument is used when entry has no port.
+ * Single hostname is connected the same way as one-element hosts list.
+ * Every host is expanded to all of its addresses and connects
+ * to them are started in parallel with a small stagger,
+ * the first successful handshake wins. Each attempt times out
+ * after MYSQLCONN_CONNECT_ATTEMPT_TIMEOUT seconds.
+ **/
+NAN_METHOD(MysqlConnection::Connect) {
+    NanScope();
+
+    REQ_FUN_ARG(args.Length() - 1, callback);
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTNOT_BE_CLOSING;
+
+    if (conn->_conn) {
+        const int argc = 1;
+        Local<Value> argv[argc];
+
+        argv[0] = V8EXC("Already initialized. "
+                        "Use conn.realConnectSync() after conn.initSync()");
+
+        TryCatch try_catch;
+
+        callback->Call(Context::GetCurrent()->Global(), argc, argv);
+
+        if (try_catch.HasCaught()) {
+            node::FatalException(try_catch);
+        }
+
+        NanReturnUndefined();
+    }
+
+    std::vector<connect_candidate> hosts;
+    if (args[0]->IsArray()) {
+        Local<Array> hosts_list = Local<Array>::Cast(args[0]);
+        uint32_t default_port = args[4]->IsUint32() ? args[4]->Uint32Value() : 0;
+
+        for (uint32_t i = 0; i < hosts_list->Length(); i++) {
+            String::Utf8Value host(hosts_list->Get(i)->ToString());
+
+            connect_candidate candidate;
+            if (!ParseConnectCandidate(*host, default_port, &candidate)) {
+                return NanThrowError("Invalid host in hosts list");
+            }
+            hosts.push_back(candidate);
+        }
+
+        if (hosts.empty()) {
+            return NanThrowError("Hosts list is empty");
+        }
+    } else if (args[0]->IsString()) {
+        // Single host name may resolve to several addresses,
+        // it is not parsed as hosts list entry
+        String::Utf8Value host(args[0]);
+
+        connect_candidate candidate;
+        candidate.host = std::string(*host, host.length());
+        candidate.port = args[4]->IsUint32() ? args[4]->Uint32Value() : 0;
+        hosts.push_back(candidate);
+    }
+
+    connect_request *conn_req = new connect_request;
+
+    conn_req->nan_callback = new NanCallback(callback.As<Function>());
+
+    conn_req->conn = conn;
+    conn->Ref();
+    conn->connecting = true;
+
+    String::Utf8Value *hostname = new String::Utf8Value(args[0]->ToString());
+    String::Utf8Value *user     = new String::Utf8Value(args[1]->ToString());
+    String::Utf8Value *password = new String::Utf8Value(args[2]->ToString());
+    String::Utf8Value *dbname   = new String::Utf8Value(args[3]->ToString());
+    uint32_t port               =                       args[4]->Uint32Value();
+    String::Utf8Value *socket   = new String::Utf8Value(args[5]->ToString());
+    uint64_t flags              =                       args[6]->Uint32Value();
+
+    conn_req->hostname = args[0]->IsString() ? hostname : NULL;
+    conn_req->user     = args[1]->IsString() ? user     : NULL;
+    conn_req->password = args[2]->IsString() ? password : NULL;
+    conn_req->dbname   = args[3]->IsString() ? dbname   : NULL;
+    conn_req->port     = args[4]->IsUint32() ? port     : 0;
+    conn_req->socket   = args[5]->IsString() ? socket   : NULL;
+    conn_req->flags    = args[6]->IsUint32() ? flags    : 0;
+
+    conn_req->hosts.swap(hosts);
+
+    uv_work_t *_req = new uv_work_t; \
+    _req->data = conn_req; \
+    uv_queue_work(uv_default_loop(), _req, EIO_Connect, (uv_after_work_cb)EIO_After_Connect);
+
+    NanReturnUndefined();
+}
+
+/**
+ * MysqlConnection#connectSync([hostname[, user[, password[, database[, port[, socket]]]]]]) -> Boolean
+ * - hostname (String): Hostname
+ * - user (String): Username
+ * - password (String): Password
+ * - database (String): Database to use
+ * - port (Integer): Connection port
+ * - socket (String): Connection socket
+ *
+ * Connects to the MySQL server
+ **/
+NAN_METHOD(MysqlConnection::ConnectSync) {
+    NanScope();
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTNOT_BE_CLOSING;
+
+    if (conn->_conn) {
+        return NanThrowError("Already initialized. Use conn.realConnectSync() after conn.initSync()");
+    }
+
+    String::Utf8Value hostname(args[0]->ToString());
+    String::Utf8Value user(args[1]->ToString());
+    String::Utf8Value password(args[2]->ToString());
+    String::Utf8Value dbname(args[3]->ToString());
+    uint32_t port = args[4]->Uint32Value();
+    String::Utf8Value socket(args[5]->ToString());
+    uint64_t flags = args[6]->Uint32Value();
+
+    bool r = conn->Connect(
+        args[0]->IsString() ? *hostname : NULL,
+        args[1]->IsString() ? *user     : NULL,
+        args[2]->IsString() ? *password : NULL,
+        args[3]->IsString() ? *dbname   : NULL,
+        args[4]->IsUint32() ? port      : 0,
+        args[5]->IsString() ? *socket   : NULL,
+        args[6]->IsUint32() ? flags     : 0
+    );
+
+    if (!r) {
+        NanReturnValue(False());
+    }
+
+    NanReturnValue(True());
+}
+
+/**
+ * MysqlConnection#connectedSync() -> Boolean
+ *
+ * Returns current connected status
+ **/
+NAN_METHOD(MysqlConnection::ConnectedSync) {
+    NanScope();
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    NanReturnValue(conn->connected ? True() : False());
+}
+
+/*!
+ * EIO wrapper functions for MysqlConnection::Close
+ */
+void MysqlConnection::EIO_After_Close(uv_work_t *req) {
+    NanScope();
+
+    struct close_request *close_req = (struct close_request *)(req->data);
+
+    close_req->conn->closing = false;
+
+    if (close_req->nan_callback) {
+        const int argc = 1;
+        Local<Value> argv[argc];
+        argv[0] = NanNewLocal(Null());
+
+        close_req->nan_callback->Call(argc, argv);
+        delete close_req->nan_callback;
+    }
+
+    close_req->conn->Unref();
+
+    delete close_req;
+
+    delete req;
+}
+
+void MysqlConnection::EIO_Close(uv_work_t *req) {
+    struct close_request *close_req = (struct close_request *)(req->data);
+
+    // Waits for in-flight query and KILL QUERY threads in threadpool
+    close_req->conn->Disconnect();
+}
+
+/**
+ * MysqlConnection#close([options, ]callback)
+ * - options (Object): Close options, `killQuery` - stop running query with KILL QUERY
+ * - callback (Function): Callback function, gets (error)
+ *
+ * Closes database connection without blocking event loop.
+ * New work is rejected with "Connection is closing" error, queued
+ * but not started queries are shed with the same error, in-flight
+ * query is completed (or killed if `killQuery` is set) and then
+ * connection is closed in threadpool.
+ **/
+NAN_METHOD(MysqlConnection::Close) {
+    NanScope();
+
+    int callback_index = 0;
+    bool kill_query = false;
+    if (args.Length() > 0 && args[0]->IsObject() && !args[0]->IsFunction()) {
+        Local<Object> options = args[0]->ToObject();
+        kill_query = options->Get(V8STR("killQuery"))->BooleanValue();
+        callback_index = 1;
+    }
+
+    OPTIONAL_FUN_ARG(callback_index, callback);
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    conn->closing = true;
+    conn->StopKeepAlive();
+
+    for (int priority = 0; priority < QUEUE_PRIORITIES_COUNT; priority++) {
+        while (conn->queue[priority].count > 0) {
+            conn->ShedQueued(QueuePop(&conn->queue[priority]), "Connection is closing");
+        }
+    }
+
+    if (kill_query) {
+        pthread_mutex_lock(&conn->kill_lock);
+        uint64_t query_id = conn->running_query_id;
+        if (query_id) {
+            conn->pending_kills++;
+        }
+        pthread_mutex_unlock(&conn->kill_lock);
+
+        if (query_id) {
+            conn->KillRunningQuery(query_id);
+        }
+    }
+
+    close_request *close_req = new close_request;
+    close_req->conn = conn;
+    close_req->nan_callback = callback->IsFunction() ? new NanCallback(callback.As<Function>()) : NULL;
+
+    conn->Ref();
+
+    uv_work_t *_req = new uv_work_t;
+    _req->data = close_req;
+    uv_queue_work(uv_default_loop(), _req, EIO_Close, (uv_after_work_cb)EIO_After_Close);
+
+    NanReturnUndefined();
+}
+
+/**
+ * MysqlConnection#closeSync()
+ *
+ * Closes database connection
+ **/
+NAN_METHOD(MysqlConnection::CloseSync) {
+    NanScope();
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    conn->StopKeepAlive();
+    conn->Disconnect();
+
+    NanReturnUndefined();
+}
+
+/**
+ * MysqlConnection#debugSync(message)
+ * - message (String): Debug message
+ *
+ * Performs debug logging
+ **/
+NAN_METHOD(MysqlConnection::DebugSync) {
+    NanScope();
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    REQ_STR_ARG(0, debug)
+
+    mysql_debug(*debug);
+
+    NanReturnUndefined();
+}
+
+/**
+ * MysqlConnection#dumpDebugInfoSync() -> Boolean
+ *
+ * Dump debugging information into the log
+ **/
+NAN_METHOD(MysqlConnection::DumpDebugInfoSync) {
+    NanScope();
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    NanReturnValue(mysql_dump_debug_info(conn->_conn) ? False() : True());
+}
+
+/**
+ * MysqlConnection#enqueue(method, query[, localInfileBuffer][, options], callback)
+ * - method (String): 'query', 'querySend' or 'multiQuery'
+ * - query (String): Query
+ * - localInfileBuffer (Buffer): Data for LOAD DATA LOCAL INFILE, only for 'query'
+ * - options (Object): `priority` - one of QUEUE_PRIORITY_* constants,
+ *   `deadlineMs` - max time to wait in queue, `timeoutMs` - query timeout, only for 'query'
+ * - callback (Function): Callback function, gets (error, result)
+ *
+ * Adds query to connection queue, queued queries are sent one by one
+ * in priority order. Queries waited in queue longer than `deadlineMs`
+ * are not sent, callback gets error instead.
+ **/
+NAN_METHOD(MysqlConnection::Enqueue) {
+    NanScope();
+
+    REQ_STR_ARG(0, method_name);
+    REQ_STR_ARG(1, query);
+
+    queue_method method;
+    if (strcmp(*method_name, "query") == 0) {
+        method = QUEUE_METHOD_QUERY;
+    } else if (strcmp(*method_name, "querySend") == 0) {
+        method = QUEUE_METHOD_QUERY_SEND;
+    } else if (strcmp(*method_name, "multiQuery") == 0) {
+        method = QUEUE_METHOD_MULTI_QUERY;
+    } else {
+        return NanThrowTypeError("Method must be one of 'query', 'querySend' or 'multiQuery'");
+    }
+
+    int optional_arg_number = 2;
+
+    Handle<Value> local_infile_buffer = Null();
+    if (method == QUEUE_METHOD_QUERY) {
+        OPTIONAL_BUFFER_ARG(2, optional_local_infile_buffer);
+        if (!optional_local_infile_buffer->IsNull()) {
+            local_infile_buffer = optional_local_infile_buffer;
+            optional_arg_number++;
+        }
+    }
+
+    query_options qo = {0, 0, QUEUE_PRIORITY_NORMAL};
+    if (args.Length() > optional_arg_number
+     && args[optional_arg_number]->IsObject()
+     && !args[optional_arg_number]->IsFunction()) {
+        const char *options_error = MysqlConnection::GetQueryOptions(args[optional_arg_number]->ToObject(), &qo);
+        if (options_error) {
+            return NanThrowTypeError(options_error);
+        }
+        optional_arg_number++;
+    }
+    OPTIONAL_FUN_ARG(optional_arg_number, optional_callback);
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTNOT_BE_CLOSING;
+    if (!conn->connecting) {
+        MYSQLCONN_MUSTBE_CONNECTED;
+    }
+
+    queue_entry entry;
+    entry.method = method;
+    entry.timeout_ms = qo.timeout_ms;
+    entry.enqueued_at = uv_hrtime();
+    entry.deadline = qo.deadline_ms ? entry.enqueued_at + qo.deadline_ms * (uint64_t)1000000 : 0;
+
+    if (method == QUEUE_METHOD_MULTI_QUERY) {
+        multi_query_request *mquery_req = NewMultiQueryRequest(conn, *query, query.length(), optional_callback);
+        mquery_req->queued = true;
+        entry.request = mquery_req;
+    } else {
+        bool is_read = false;
+        if (qo.timeout_ms == 0 && local_infile_buffer->IsNull()
+         && conn->JoinInflightRead(*query, query.length(), optional_callback, &is_read)) {
+            NanReturnUndefined();
+        }
+
+        query_request *query_req = NewQueryRequest(conn, *query, query.length(),
+                                                   local_infile_buffer, optional_callback);
+        query_req->queued = true;
+        if (is_read) {
+            conn->RegisterInflightRead(query_req);
+        }
+        entry.request = query_req;
+    }
+
+    // Queued request holds connection until it is sent or shed
+    conn->Ref();
+
+    QueuePush(&conn->queue[qo.priority], entry);
+    conn->queue_enqueued++;
+
+    conn->ProcessQueue();
+
+    NanReturnUndefined();
+}
+
+/**
+ * MysqlConnection#errnoSync() -> Integer
+ *
+ * Returns the last error code
+ **/
+NAN_METHOD(MysqlConnection::ErrnoSync) {
+    NanScope();
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    NanReturnValue(Integer::NewFromUnsigned(mysql_errno(conn->_conn)));
+}
+
+/**
+ * MysqlConnection#errorSync() -> String
+ *
+ * Returns the last error message
+ **/
+NAN_METHOD(MysqlConnection::ErrorSync) {
+    NanScope();
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    const char *error = mysql_error(conn->_conn);
+
+    NanReturnValue(V8STR(error));
+}
+
+/**
+ * MysqlConnection#escapeSync(string) -> String
+ * - string (String): String to escape
+ *
+ * Escapes special characters in a string for use in an SQL statement,
+ * taking into account the current charset of the connection
+ **/
+NAN_METHOD(MysqlConnection::EscapeSync) {
+    NanScope();
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    REQ_STR_ARG(0, str)
+
+    unsigned long len = static_cast<unsigned long>(str.length());
+    char *result = new char[2*len + 1];
+    if (!result) {
+        V8::LowMemoryNotification();
+        return NanThrowError("Not enough memory");
+    }
+
+    len = mysql_real_escape_string(conn->_conn, result, *str, len);
+    Local<Value> js_result = V8STR2(result, len);
+
+    delete[] result;
+
+    NanReturnValue(js_result);
+}
+
+/**
+ * MysqlConnection#fieldCountSync() -> Integer
+ *
+ * Returns the number of columns for the most recent query
  **/
-NAN_METHOD(MysqlConnection::CommitSync) {
+NAN_METHOD(MysqlConnection::FieldCountSync) {
     NanScope();
 
     MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
 
     MYSQLCONN_MUSTBE_CONNECTED;
 
-    if (mysql_commit(conn->_conn)) {
-        NanReturnValue(False());
-    }
-
-    NanReturnValue(True());
+    NanReturnValue(
+                Integer::NewFromUnsigned(
+                    mysql_field_count(conn->_conn)));
 }
 
-/*!
- * EIO wrapper functions for MysqlConnection::Connect
- */
-void MysqlConnection::EIO_After_Connect(uv_work_t *req) {
+/**
+ * MysqlConnection#getCharsetSync() -> Object
+ *
+ * Returns a character set object
+ **/
+NAN_METHOD(MysqlConnection::GetCharsetSync) {
     NanScope();
 
-    struct connect_request *conn_req = (struct connect_request *)(req->data);
-
-    const int argc = 1;
-    Local<Value> argv[argc];
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
 
-    if (!conn_req->ok) {
-        unsigned int error_string_length = strlen(conn_req->conn->connect_error) + 25;
-        char* error_string = new char[error_string_length];
-        snprintf(
-            error_string, error_string_length,
-            "Connection error #%d: %s",
-            conn_req->conn->connect_errno, conn_req->conn->connect_error);
+    MYSQLCONN_MUSTBE_CONNECTED;
 
-        argv[0] = V8EXC(error_string);
-        delete[] error_string;
-    } else {
-        argv[0] = NanNewLocal(Null());
-    }
+    MY_CHARSET_INFO cs;
 
-    conn_req->nan_callback->Call(argc, argv);
-    delete conn_req->nan_callback;
+    mysql_get_character_set_info(conn->_conn, &cs);
 
-    conn_req->conn->Unref();
+    Local<Object> js_result = Object::New();
 
-    delete conn_req;
+    js_result->Set(V8STR("charset"), V8STR(cs.csname ? cs.csname : ""));
+    js_result->Set(V8STR("collation"), V8STR(cs.name ? cs.name : ""));
+    js_result->Set(V8STR("dir"), V8STR(cs.dir ? cs.dir : ""));
+    js_result->Set(V8STR("min_length"), Integer::NewFromUnsigned(cs.mbminlen));
+    js_result->Set(V8STR("max_length"), Integer::NewFromUnsigned(cs.mbmaxlen));
+    js_result->Set(V8STR("number"), Integer::NewFromUnsigned(cs.number));
+    js_result->Set(V8STR("state"), Integer::NewFromUnsigned(cs.state));
+    js_result->Set(V8STR("comment"), V8STR(cs.comment ? cs.comment : ""));
 
-    delete req;
+    NanReturnValue(js_result);
 }
 
-void MysqlConnection::EIO_Connect(uv_work_t *req) {
-    struct connect_request *conn_req = (struct connect_request *)(req->data);
+/**
+ * MysqlConnection#getCharsetNameSync() -> String
+ *
+ * Returns a character set name
+ **/
+NAN_METHOD(MysqlConnection::GetCharsetNameSync) {
+    NanScope();
 
-    conn_req->ok = conn_req->conn->Connect(
-        conn_req->hostname ? **(conn_req->hostname) : NULL,
-        conn_req->user ? **(conn_req->user) : NULL,
-        conn_req->password ? **(conn_req->password) : NULL,
-        conn_req->dbname ? **(conn_req->dbname) : NULL,
-        conn_req->port,
-        conn_req->socket ? **(conn_req->socket) : NULL,
-        conn_req->flags
-    ) ? true : false;
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
 
-    delete conn_req->hostname;
-    delete conn_req->user;
-    delete conn_req->password;
-    delete conn_req->socket;
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    NanReturnValue(V8STR(mysql_character_set_name(conn->_conn)));
 }
 
 /**
- * MysqlConnection#connect([hostname[, user[, password[, database[, port[, socket]]]]]], callback)
- * - hostname (String): Hostname
- * - user (String): Username
- * - password (String): Password
- * - database (String): Database to use
- * - port (Integer): Connection port
- * - socket (String): Connection socket
- * - callback (Function): Callback function, gets (error)
+ * MysqlConnection#getClientInfoSync() -> Object
  *
- * Connects to the MySQL server
+ * Returns the MySQL client version and information
  **/
-NAN_METHOD(MysqlConnection::Connect) {
+NAN_METHOD(MysqlConnection::GetClientInfoSync) {
     NanScope();
 
-    REQ_FUN_ARG(args.Length() - 1, callback);
+    Local<Object> js_result = Object::New();
+
+    js_result->Set(V8STR("client_info"),
+                   V8STR(mysql_get_client_info()));
+    js_result->Set(V8STR("client_version"),
+                   Integer::NewFromUnsigned(mysql_get_client_version()));
+
+    NanReturnValue(js_result);
+}
+
+/**
+ * MysqlConnection#getInfoSync() -> Object
+ *
+ * Returns the MySQL client, server, host and protocol version and information
+ **/
+NAN_METHOD(MysqlConnection::GetInfoSync) {
+    NanScope();
 
     MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
 
-    if (conn->_conn) {
-        const int argc = 1;
-        Local<Value> argv[argc];
+    MYSQLCONN_MUSTBE_CONNECTED;
 
-        argv[0] = V8EXC("Already initialized. "
-                        "Use conn.realConnectSync() after conn.initSync()");
+    Local<Object> js_result = Object::New();
 
-        TryCatch try_catch;
+    js_result->Set(V8STR("client_info"),
+                   V8STR(mysql_get_client_info()));
+    js_result->Set(V8STR("client_version"),
+                   Integer::NewFromUnsigned(mysql_get_client_version()));
+    js_result->Set(V8STR("server_info"),
+                   V8STR(mysql_get_server_info(conn->_conn)));
+    js_result->Set(V8STR("server_version"),
+                   Integer::NewFromUnsigned(
+                       mysql_get_server_version(conn->_conn)));
+    js_result->Set(V8STR("host_info"),
+                   V8STR(mysql_get_host_info(conn->_conn)));
+    js_result->Set(V8STR("proto_info"),
+                   Integer::NewFromUnsigned(mysql_get_proto_info(conn->_conn)));
 
-        callback->Call(Context::GetCurrent()->Global(), argc, argv);
+    NanReturnValue(js_result);
+}
 
-        if (try_catch.HasCaught()) {
-            node::FatalException(try_catch);
-        }
+/**
+ * MysqlConnection#getInfoStringSync() -> String
+ *
+ * Retrieves information about the most recently executed query
+ **/
+NAN_METHOD(MysqlConnection::GetInfoStringSync) {
+    NanScope();
 
-        NanReturnUndefined();
-    }
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
 
-    connect_request *conn_req = new connect_request;
+    MYSQLCONN_MUSTBE_CONNECTED;
 
-    conn_req->nan_callback = new NanCallback(callback.As<Function>());
+    const char *info = mysql_info(conn->_conn);
 
-    conn_req->conn = conn;
-    conn->Ref();
+    NanReturnValue(V8STR(info ? info : ""));
+}
 
-    String::Utf8Value *hostname = new String::Utf8Value(args[0]->ToString());
-    String::Utf8Value *user     = new String::Utf8Value(args[1]->ToString());
-    String::Utf8Value *password = new String::Utf8Value(args[2]->ToString());
-    String::Utf8Value *dbname   = new String::Utf8Value(args[3]->ToString());
-    uint32_t port               =                       args[4]->Uint32Value();
-    String::Utf8Value *socket   = new String::Utf8Value(args[5]->ToString());
-    uint64_t flags              =                       args[6]->Uint32Value();
+/**
+ * MysqlConnection#getWarnings(callback)
+ * - callback (Function): Callback function, gets (error, warnings)
+ *
+ * Gets result of SHOW WARNINGS, asynchronous version of getWarningsSync()
+ **/
+NAN_METHOD(MysqlConnection::GetWarnings) {
+    NanScope();
 
-    conn_req->hostname = args[0]->IsString() ? hostname : NULL;
-    conn_req->user     = args[1]->IsString() ? user     : NULL;
-    conn_req->password = args[2]->IsString() ? password : NULL;
-    conn_req->dbname   = args[3]->IsString() ? dbname   : NULL;
-    conn_req->port     = args[4]->IsUint32() ? port     : 0;
-    conn_req->socket   = args[5]->IsString() ? socket   : NULL;
-    conn_req->flags    = args[6]->IsUint32() ? flags    : 0;
+    OPTIONAL_FUN_ARG(0, callback);
 
-    uv_work_t *_req = new uv_work_t; \
-    _req->data = conn_req; \
-    uv_queue_work(uv_default_loop(), _req, EIO_Connect, (uv_after_work_cb)EIO_After_Connect);
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    op_request *op_req = NewOpRequest(conn, CONN_OP_GET_WARNINGS, callback);
+
+    conn->QueueOp(op_req);
 
     NanReturnUndefined();
 }
 
 /**
- * MysqlConnection#connectSync([hostname[, user[, password[, database[, port[, socket]]]]]]) -> Boolean
- * - hostname (String): Hostname
- * - user (String): Username
- * - password (String): Password
- * - database (String): Database to use
- * - port (Integer): Connection port
- * - socket (String): Connection socket
+ * MysqlConnection#getWarningsSync() -> Array
  *
- * Connects to the MySQL server
+ * Gets result of SHOW WARNINGS
  **/
-NAN_METHOD(MysqlConnection::ConnectSync) {
+NAN_METHOD(MysqlConnection::GetWarningsSync) {
     NanScope();
 
     MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
-    if (conn->_conn) {
-        return NanThrowError("Already initialized. Use conn.realConnectSync() after conn.initSync()");
-    }
 
-    String::Utf8Value hostname(args[0]->ToString());
-    String::Utf8Value user(args[1]->ToString());
-    String::Utf8Value password(args[2]->ToString());
-    String::Utf8Value dbname(args[3]->ToString());
-    uint32_t port = args[4]->Uint32Value();
-    String::Utf8Value socket(args[5]->ToString());
-    uint64_t flags = args[6]->Uint32Value();
+    MYSQLCONN_MUSTBE_CONNECTED;
 
-    bool r = conn->Connect(
-        args[0]->IsString() ? *hostname : NULL,
-        args[1]->IsString() ? *user     : NULL,
-        args[2]->IsString() ? *password : NULL,
-        args[3]->IsString() ? *dbname   : NULL,
-        args[4]->IsUint32() ? port      : 0,
-        args[5]->IsString() ? *socket   : NULL,
-        args[6]->IsUint32() ? flags     : 0
-    );
+    MYSQL_RES *result;
+    MYSQL_ROW row;
+    int i = 0;
 
-    if (!r) {
-        NanReturnValue(False());
+    Local<Object> js_warning;
+    Local<Array> js_result = Array::New();
+
+    if (mysql_warning_count(conn->_conn)) {
+        if (mysql_real_query(conn->_conn, "SHOW WARNINGS", 13) == 0) {
+            result = mysql_store_result(conn->_conn);
+
+            while ((row = mysql_fetch_row(result))) {
+                js_warning = Object::New();
+                js_warning->Set(V8STR("errno"), V8STR(row[1])->ToInteger());
+
+                js_warning->Set(V8STR("reason"), V8STR(row[2]));
+
+                js_result->Set(Integer::New(i), js_warning);
+
+                i++;
+            }
+
+            mysql_free_result(result);
+        }
     }
 
-    NanReturnValue(True());
+    NanReturnValue(js_result);
 }
 
 /**
- * MysqlConnection#connectedSync() -> Boolean
+ * MysqlConnection#initSync() -> Boolean
  *
- * Returns current connected status
+ * Initializes MysqlConnection
  **/
-NAN_METHOD(MysqlConnection::ConnectedSync) {
+NAN_METHOD(MysqlConnection::InitSync) {
     NanScope();
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTNOT_BE_CLOSING;
+
+    if (conn->_conn) {
+        return NanThrowError("Already initialized");
+    }
+
+    conn->_conn = mysql_init(NULL);
+
+    if (!conn->_conn) {
+        NanReturnValue(False());
+    }
 
-    NanReturnValue(conn->connected ? True() : False());
+    conn->ForgetRecordedSetup();
+
+    NanReturnValue(True());
 }
 
 /**
- * MysqlConnection#closeSync()
+ * MysqlConnection#initStatementSync() -> MysqlStatement|Boolean
  *
- * Closes database connection
+ * Initializes a statement and returns it
  **/
-NAN_METHOD(MysqlConnection::CloseSync) {
+NAN_METHOD(MysqlConnection::InitStatementSync) {
     NanScope();
 
     MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
 
     MYSQLCONN_MUSTBE_CONNECTED;
 
-    conn->Close();
+    MYSQL_STMT *my_statement = mysql_stmt_init(conn->_conn);
 
-    NanReturnUndefined();
+    if (!my_statement) {
+        NanReturnValue(False());
+    }
+
+    Local<Object> local_js_result = MysqlStatement::NewInstance(my_statement);
+    conn->RegisterStatement(OBJUNWRAP<MysqlStatement>(local_js_result));
+    Persistent<Object> persistent_js_result;
+    NanAssignPersistent(Object, persistent_js_result, local_js_result);
+
+    NanReturnValue(persistent_js_result);
 }
 
 /**
- * MysqlConnection#debugSync(message)
- * - message (String): Debug message
+ * MysqlConnection#lastInsertIdSync() -> Integer
  *
- * Performs debug logging
+ * Returns the auto generated id used in the last query
  **/
-NAN_METHOD(MysqlConnection::DebugSync) {
+NAN_METHOD(MysqlConnection::LastInsertIdSync) {
     NanScope();
 
     MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
 
     MYSQLCONN_MUSTBE_CONNECTED;
 
-    REQ_STR_ARG(0, debug)
+    MYSQL_RES *result;
+    my_ulonglong insert_id = 0;
 
-    mysql_debug(*debug);
+    if ( (result = mysql_store_result(conn->_conn)) == 0 &&
+         mysql_field_count(conn->_conn) == 0 &&
+         mysql_insert_id(conn->_conn) != 0) {
+        insert_id = mysql_insert_id(conn->_conn);
+    }
 
-    NanReturnUndefined();
+    NanReturnValue(Integer::New(insert_id));
 }
 
-/**
- * MysqlConnection#dumpDebugInfoSync() -> Boolean
- *
- * Dump debugging information into the log
- **/
-NAN_METHOD(MysqlConnection::DumpDebugInfoSync) {
-    NanScope();
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+/*!
+ * Quotes table or column name for use in generated query
+ */
+static std::string QuoteIdentifier(const std::string &name) {
+    std::string quoted = "`";
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    for (size_t i = 0; i < name.size(); i++) {
+        if (name[i] == '`') {
+            quoted += '`';
+        }
+        quoted += name[i];
+    }
 
-    NanReturnValue(mysql_dump_debug_info(conn->_conn) ? False() : True());
+    return quoted + "`";
 }
 
-/**
- * MysqlConnection#errnoSync() -> Integer
- *
- * Returns the last error code
- **/
-NAN_METHOD(MysqlConnection::ErrnoSync) {
-    NanScope();
+/*!
+ * Brings text of numeric key to canonical form,
+ * so 1, '1.00' and '+01.0' are the same key
+ */
+static std::string NormalizeNumericKey(const std::string &key) {
+    size_t begin = 0, end = key.size();
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    while (begin < end && isspace(static_cast<unsigned char>(key[begin]))) {
+        begin++;
+    }
+    while (end > begin && isspace(static_cast<unsigned char>(key[end - 1]))) {
+        end--;
+    }
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    bool negative = false;
+    if (begin < end && (key[begin] == '-' || key[begin] == '+')) {
+        negative = (key[begin] == '-');
+        begin++;
+    }
 
-    NanReturnValue(Integer::NewFromUnsigned(mysql_errno(conn->_conn)));
-}
+    size_t point = key.find('.', begin);
+    if (point == std::string::npos || point > end) {
+        point = end;
+    }
 
-/**
- * MysqlConnection#errorSync() -> String
- *
- * Returns the last error message
- **/
-NAN_METHOD(MysqlConnection::ErrorSync) {
-    NanScope();
+    for (size_t i = begin; i < end; i++) {
+        if (i != point && !isdigit(static_cast<unsigned char>(key[i]))) {
+            // Exponent or not a number, compared as is
+            return key.substr(begin, end - begin);
+        }
+    }
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    size_t int_begin = begin;
+    while (int_begin < point && key[int_begin] == '0') {
+        int_begin++;
+    }
+    size_t frac_end = end;
+    while (frac_end > point + 1 && key[frac_end - 1] == '0') {
+        frac_end--;
+    }
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    std::string normalized = (int_begin < point) ? key.substr(int_begin, point - int_begin) : "0";
+    if (frac_end > point + 1) {
+        normalized += key.substr(point, frac_end - point);
+    }
 
-    const char *error = mysql_error(conn->_conn);
+    if (negative && normalized != "0") {
+        normalized = "-" + normalized;
+    }
 
-    NanReturnValue(V8STR(error));
+    return normalized;
 }
 
-/**
- * MysqlConnection#escapeSync(string) -> String
- * - string (String): String to escape
- *
- * Escapes special characters in a string for use in an SQL statement,
- * taking into account the current charset of the connection
- **/
-NAN_METHOD(MysqlConnection::EscapeSync) {
+/*!
+ * Completes loadByKey() batch in main thread, error is set
+ * when batch query is shed from connection queue
+ */
+void MysqlConnection::LoadByKeysDone(void *data, const char *error) {
     NanScope();
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    struct load_batch_request *batch = static_cast<load_batch_request *>(data);
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    int argc = 1;
+    Local<Value> argv[2];
+    std::vector<Local<Value> > js_rows_by_key;
+    size_t i, j;
 
-    REQ_STR_ARG(0, str)
+    if (error) {
+        argv[0] = V8EXC(error);
+    } else if (batch->connection_closed) {
+        argv[0] = V8EXC("Connection is closed by closeSync() during query");
+    } else if (!batch->ok) {
+        unsigned int error_string_length = strlen(batch->my_error) + 20;
+        char* error_string = new char[error_string_length];
+        snprintf(error_string, error_string_length, "Query error #%d: %s", batch->my_errno, batch->my_error);
 
-    unsigned long len = static_cast<unsigned long>(str.length());
-    char *result = new char[2*len + 1];
-    if (!result) {
-        V8::LowMemoryNotification();
-        return NanThrowError("Not enough memory");
+        argv[0] = V8EXC(error_string);
+        delete[] error_string;
+    } else {
+        argc = 2;
+        argv[0] = NanNewLocal(Null());
+
+        MYSQL_FIELD *fields = mysql_fetch_fields(batch->my_result);
+        uint32_t field_count = mysql_num_fields(batch->my_result);
+
+        // Rows are converted once per key, callbacks of the same key share them
+        for (i = 0; i < batch->keys.size(); i++) {
+            std::vector<load_row> &rows = batch->rows_by_key[i];
+            Local<Array> js_rows = Array::New(rows.size());
+
+            for (j = 0; j < rows.size(); j++) {
+                Local<Object> js_row = Object::New();
+
+                for (uint32_t k = 0; k < field_count; k++) {
+                    js_row->Set(V8STR(fields[k].name),
+                                MysqlResult::GetFieldValue(fields[k], rows[j].row[k], rows[j].lengths[k]));
+                }
+
+                js_rows->Set(Integer::NewFromUnsigned(j), js_row);
+            }
+
+            js_rows_by_key.push_back(js_rows);
+        }
     }
 
-    len = mysql_real_escape_string(conn->_conn, result, *str, len);
-    Local<Value> js_result = V8STR2(result, len);
+    for (i = 0; i < batch->waiters.size(); i++) {
+        NanCallback *nan_callback = batch->waiters[i].nan_callback;
+        size_t key_index = batch->waiters[i].key_index;
 
-    delete[] result;
+        if (argc == 2 && batch->unmatched_rows > 0 && batch->rows_by_key[key_index].empty()) {
+            // Some of unmatched rows may belong to this key
+            Local<Value> unmatched_argv[1];
+            unmatched_argv[0] = V8EXC("Rows can't be matched to key by key column value");
+            nan_callback->Call(1, unmatched_argv);
+        } else {
+            if (argc == 2) {
+                argv[1] = js_rows_by_key[key_index];
+            }
 
-    NanReturnValue(js_result);
+            nan_callback->Call(argc, argv);
+        }
+        delete nan_callback;
+    }
+
+    if (batch->my_result) {
+        mysql_free_result(batch->my_result);
+    }
+
+    batch->conn->Unref();
+
+    delete batch;
 }
 
-/**
- * MysqlConnection#fieldCountSync() -> Integer
- *
- * Returns the number of columns for the most recent query
- **/
-NAN_METHOD(MysqlConnection::FieldCountSync) {
-    NanScope();
+void MysqlConnection::LoadByKeysWork(void *data) {
+    struct load_batch_request *batch = static_cast<load_batch_request *>(data);
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    MysqlConnection *conn = batch->conn;
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    batch->my_result = NULL;
 
-    NanReturnValue(
-                Integer::NewFromUnsigned(
-                    mysql_field_count(conn->_conn)));
-}
+    pthread_mutex_lock(&conn->query_lock);
 
-/**
- * MysqlConnection#getCharsetSync() -> Object
- *
- * Returns a character set object
- **/
-NAN_METHOD(MysqlConnection::GetCharsetSync) {
-    NanScope();
+    if (!conn->_conn || !conn->connected) {
+        batch->ok = false;
+        batch->connection_closed = true;
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
+    }
+    batch->connection_closed = false;
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQLCONN_DISABLE_MQ;
 
-    MY_CHARSET_INFO cs;
+    int r = mysql_real_query(conn->_conn, batch->query.c_str(), batch->query.size());
+    if (r == 0) {
+        batch->my_result = mysql_store_result(conn->_conn);
+    }
 
-    mysql_get_character_set_info(conn->_conn, &cs);
+    if (r != 0 || !batch->my_result) {
+        batch->ok = false;
+        batch->my_errno = mysql_errno(conn->_conn);
+        batch->my_error = mysql_error(conn->_conn);
 
-    Local<Object> js_result = Object::New();
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
+    }
 
-    js_result->Set(V8STR("charset"), V8STR(cs.csname ? cs.csname : ""));
-    js_result->Set(V8STR("collation"), V8STR(cs.name ? cs.name : ""));
-    js_result->Set(V8STR("dir"), V8STR(cs.dir ? cs.dir : ""));
-    js_result->Set(V8STR("min_length"), Integer::NewFromUnsigned(cs.mbminlen));
-    js_result->Set(V8STR("max_length"), Integer::NewFromUnsigned(cs.mbmaxlen));
-    js_result->Set(V8STR("number"), Integer::NewFromUnsigned(cs.number));
-    js_result->Set(V8STR("state"), Integer::NewFromUnsigned(cs.state));
-    js_result->Set(V8STR("comment"), V8STR(cs.comment ? cs.comment : ""));
+    pthread_mutex_unlock(&conn->query_lock);
 
-    NanReturnValue(js_result);
-}
+    MYSQL_FIELD *fields = mysql_fetch_fields(batch->my_result);
+    uint32_t field_count = mysql_num_fields(batch->my_result);
+    uint32_t key_field = field_count;
 
-/**
- * MysqlConnection#getCharsetNameSync() -> String
- *
- * Returns a character set name
- **/
-NAN_METHOD(MysqlConnection::GetCharsetNameSync) {
-    NanScope();
+    for (uint32_t i = 0; i < field_count; i++) {
+        if (strcasecmp(fields[i].name, batch->key_column.c_str()) == 0) {
+            key_field = i;
+            break;
+        }
+    }
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    if (key_field == field_count) {
+        batch->ok = false;
+        batch->my_errno = 0;
+        batch->my_error = "Key column is not found in result";
+        return;
+    }
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    // Server compares keys by column type, numeric keys are matched
+    // by value, so 1 finds '1.00' of DECIMAL column
+    bool numeric_key = IS_NUM(fields[key_field].type);
+    std::map<std::string, size_t> normalized_indexes;
+    if (numeric_key) {
+        for (size_t i = 0; i < batch->keys.size(); i++) {
+            normalized_indexes[NormalizeNumericKey(batch->keys[i])] = i;
+        }
+    }
+    const std::map<std::string, size_t> &indexes = numeric_key ? normalized_indexes : batch->key_indexes;
 
-    NanReturnValue(V8STR(mysql_character_set_name(conn->_conn)));
+    // Group rows by key value, rows with text differing from all keys
+    // (e.g. matched by case insensitive collation) are counted,
+    // keys without rows get error instead of empty result
+    batch->unmatched_rows = 0;
+
+    MYSQL_ROW row;
+    while ((row = mysql_fetch_row(batch->my_result))) {
+        if (!row[key_field]) {
+            continue;
+        }
+
+        unsigned long *lengths = mysql_fetch_lengths(batch->my_result);
+        std::string key_value(row[key_field], lengths[key_field]);
+        std::map<std::string, size_t>::const_iterator it =
+            indexes.find(numeric_key ? NormalizeNumericKey(key_value) : key_value);
+        if (it != indexes.end()) {
+            load_row grouped_row;
+            grouped_row.row = row;
+            grouped_row.lengths.assign(lengths, lengths + field_count);
+            batch->rows_by_key[it->second].push_back(grouped_row);
+        } else {
+            batch->unmatched_rows++;
+        }
+    }
+
+    batch->ok = true;
 }
 
-/**
- * MysqlConnection#getClientInfoSync() -> Object
- *
- * Returns the MySQL client version and information
- **/
-NAN_METHOD(MysqlConnection::GetClientInfoSync) {
+/*!
+ * Timer callback for loadByKey() batch window, runs in main thread
+ */
+MYSQL_BINDINGS_TIMER_CB(MysqlConnection::EV_LoadBatchTimeout) {
+    struct load_batch_request *batch = (struct load_batch_request *)(handle->data);
+
+    batch->conn->FlushLoadBatch(batch);
+}
+
+void MysqlConnection::EV_LoadBatchTimeout_OnTimerClose(uv_handle_t *handle) {
+    delete (uv_timer_t *)handle;
+}
+
+/*!
+ * Builds IN-list query for collected keys and queues it to connection queue
+ */
+void MysqlConnection::FlushLoadBatch(load_batch_request *batch) {
     NanScope();
 
-    Local<Object> js_result = Object::New();
+    uv_timer_stop(batch->timer);
+    uv_close((uv_handle_t *)batch->timer, EV_LoadBatchTimeout_OnTimerClose);
+    batch->timer = NULL;
 
-    js_result->Set(V8STR("client_info"),
-                   V8STR(mysql_get_client_info()));
-    js_result->Set(V8STR("client_version"),
-                   Integer::NewFromUnsigned(mysql_get_client_version()));
+    this->load_batches.erase(batch->batch_key);
 
-    NanReturnValue(js_result);
+    batch->rows_by_key.resize(batch->keys.size());
+
+    if (!this->_conn || !this->connected || this->closing) {
+        batch->ok = false;
+        batch->connection_closed = true;
+        batch->my_result = NULL;
+
+        LoadByKeysDone(batch, NULL);
+        return;
+    }
+
+    batch->query = "SELECT * FROM " + QuoteIdentifier(batch->table) +
+                   " WHERE " + QuoteIdentifier(batch->key_column) + " IN (";
+
+    for (size_t i = 0; i < batch->keys.size(); i++) {
+        const std::string &key = batch->keys[i];
+        char *escaped_key = new char[key.size() * 2 + 1];
+        unsigned long escaped_len = mysql_real_escape_string(this->_conn, escaped_key,
+                                                             key.data(), key.size());
+
+        if (i > 0) {
+            batch->query += ", ";
+        }
+        batch->query += '\'';
+        batch->query.append(escaped_key, escaped_len);
+        batch->query += '\'';
+
+        delete[] escaped_key;
+    }
+    batch->query += ")";
+
+    this->StopCoalescing(batch->query.data(), batch->query.size());
+
+    // Batch is sent after queries queued before it, so it sees their writes
+    this->QueueWork(batch, LoadByKeysWork, LoadByKeysDone);
 }
 
 /**
- * MysqlConnection#getInfoSync() -> Object
+ * MysqlConnection#loadByKey(table, keyColumn, key[, options], callback)
+ * - table (String): Table name
+ * - keyColumn (String): Key column name
+ * - key (String|Number): Key value
+ * - options (Object): Batch options, `windowMs` - time to collect keys, default 0
+ * - callback (Function): Callback function, gets (error, rows)
  *
- * Returns the MySQL client, server, host and protocol version and information
+ * Loads rows with given key value. Keys requested for the same table
+ * and column within one event loop tick (or `windowMs` milliseconds)
+ * are loaded by single `SELECT * ... WHERE keyColumn IN (...)` query
+ * and rows are grouped by key in threadpool. Batch query is sent
+ * after queries queued before it.
+ * Rows are matched to keys by text value of key column, numeric keys
+ * by their value. If server returns rows which can't be matched this way
+ * (e.g. 'ABC' for key 'abc' with case insensitive collation),
+ * keys without matched rows get error instead of empty rows.
  **/
-NAN_METHOD(MysqlConnection::GetInfoSync) {
+NAN_METHOD(MysqlConnection::LoadByKey) {
     NanScope();
 
+    REQ_STR_ARG(0, table);
+    REQ_STR_ARG(1, key_column);
+
+    if (args.Length() <= 2 || !(args[2]->IsString() || args[2]->IsNumber())) {
+        return NanThrowTypeError("Argument 2 must be a string or a number");
+    }
+    String::Utf8Value key(args[2]->ToString());
+
+    int callback_index = 3;
+    uint32_t window_ms = 0;
+    if (args.Length() > 3 && args[3]->IsObject() && !args[3]->IsFunction()) {
+        Local<Object> options = args[3]->ToObject();
+        if (options->Has(V8STR("windowMs"))) {
+            Local<Value> js_window_ms = options->Get(V8STR("windowMs"));
+            if (!js_window_ms->IsUint32()) {
+                return NanThrowTypeError("windowMs option must be a non-negative integer");
+            }
+            window_ms = js_window_ms->Uint32Value();
+        }
+        callback_index = 4;
+    }
+
+    if (args.Length() <= callback_index || !args[callback_index]->IsFunction()) {
+        return NanThrowTypeError("Last argument must be a callback function");
+    }
+
     MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
 
     MYSQLCONN_MUSTBE_CONNECTED;
 
-    Local<Object> js_result = Object::New();
+    std::string batch_key = std::string(*table, table.length()) + '\0' +
+                            std::string(*key_column, key_column.length());
+
+    load_batch_request *batch;
+    std::map<std::string, load_batch_request *>::iterator it = conn->load_batches.find(batch_key);
+    if (it != conn->load_batches.end()) {
+        batch = it->second;
+    } else {
+        batch = new load_batch_request;
+        batch->conn = conn;
+        batch->batch_key = batch_key;
+        batch->table = std::string(*table, table.length());
+        batch->key_column = std::string(*key_column, key_column.length());
+        batch->my_result = NULL;
+        batch->unmatched_rows = 0;
+
+        batch->timer = new uv_timer_t;
+        batch->timer->data = batch;
+        uv_timer_init(uv_default_loop(), batch->timer);
+        uv_timer_start(batch->timer, EV_LoadBatchTimeout, window_ms, 0);
+
+        conn->load_batches[batch_key] = batch;
+        conn->Ref();
+    }
+
+    std::string key_value(*key, key.length());
+    load_waiter waiter;
+    std::map<std::string, size_t>::iterator key_it = batch->key_indexes.find(key_value);
+    if (key_it != batch->key_indexes.end()) {
+        waiter.key_index = key_it->second;
+    } else {
+        waiter.key_index = batch->keys.size();
+        batch->key_indexes[key_value] = waiter.key_index;
+        batch->keys.push_back(key_value);
+    }
+    waiter.nan_callback = new NanCallback(args[callback_index].As<Function>());
+    batch->waiters.push_back(waiter);
 
-    js_result->Set(V8STR("client_info"),
-                   V8STR(mysql_get_client_info()));
-    js_result->Set(V8STR("client_version"),
-                   Integer::NewFromUnsigned(mysql_get_client_version()));
-    js_result->Set(V8STR("server_info"),
-                   V8STR(mysql_get_server_info(conn->_conn)));
-    js_result->Set(V8STR("server_version"),
-                   Integer::NewFromUnsigned(
-                       mysql_get_server_version(conn->_conn)));
-    js_result->Set(V8STR("host_info"),
-                   V8STR(mysql_get_host_info(conn->_conn)));
-    js_result->Set(V8STR("proto_info"),
-                   Integer::NewFromUnsigned(mysql_get_proto_info(conn->_conn)));
+    if (batch->keys.size() >= MYSQLCONN_LOAD_BATCH_MAX_KEYS) {
+        conn->FlushLoadBatch(batch);
+    }
 
-    NanReturnValue(js_result);
+    NanReturnUndefined();
 }
 
 /**
- * MysqlConnection#getInfoStringSync() -> String
+ * MysqlConnection#multiMoreResultsSync() -> Boolean
  *
- * Retrieves information about the most recently executed query
+ * Checks if there are any more query results from a multi query
  **/
-NAN_METHOD(MysqlConnection::GetInfoStringSync) {
+NAN_METHOD(MysqlConnection::MultiMoreResultsSync) {
     NanScope();
 
     MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
 
     MYSQLCONN_MUSTBE_CONNECTED;
 
-    const char *info = mysql_info(conn->_conn);
+    if (mysql_more_results(conn->_conn)) {
+        NanReturnValue(True());
+    }
 
-    NanReturnValue(V8STR(info ? info : ""));
+    NanReturnValue(False());
 }
 
 /**
- * MysqlConnection#getWarningsSync() -> Array
+ * MysqlConnection#multiNextResultSync() -> Boolean
  *
- * Gets result of SHOW WARNINGS
+ * Prepare next result from multi query
  **/
-NAN_METHOD(MysqlConnection::GetWarningsSync) {
+NAN_METHOD(MysqlConnection::MultiNextResultSync) {
     NanScope();
 
     MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
 
     MYSQLCONN_MUSTBE_CONNECTED;
 
-    MYSQL_RES *result;
-    MYSQL_ROW row;
-    int i = 0;
+    if (!mysql_more_results(conn->_conn)) {
+        return NanThrowError("There is no next result set. Please, call MultiMoreResultsSync() to check whether to call this function/method");
+    }
 
-    Local<Object> js_warning = Object::New();
-    Local<Array> js_result = Array::New();
+    if (!mysql_next_result(conn->_conn)) {
+        NanReturnValue(True());
+    }
 
-    if (mysql_warning_count(conn->_conn)) {
-        if (mysql_real_query(conn->_conn, "SHOW WARNINGS", 13) == 0) {
-            result = mysql_store_result(conn->_conn);
+    NanReturnValue(False());
+}
 
-            while ((row = mysql_fetch_row(result))) {
-                js_warning->Set(V8STR("errno"), V8STR(row[1])->ToInteger());
+/*!
+ * EIO wrapper functions for MysqlConnection::MultiQuery
+ */
+void MysqlConnection::EIO_After_MultiQuery(uv_work_t *req) {
+    NanScope();
 
-                js_warning->Set(V8STR("reason"), V8STR(row[2]));
+    struct multi_query_request *mquery_req = (struct multi_query_request *)(req->data);
 
-                js_result->Set(Integer::New(i), js_warning);
+    int argc = 1;
+    Local<Value> argv[2];
+    size_t i;
 
-                i++;
+    if (mquery_req->connection_closed) {
+        argv[0] = V8EXC("Connection is closed by closeSync() during query");
+    } else if (mquery_req->ok && !mquery_req->conn->_conn) {
+        // Connection is closed by close() before callback, results can't be used
+        for (i = 0; i < mquery_req->results.size(); i++) {
+            if (mquery_req->results[i].have_result_set) {
+                mysql_free_result(mquery_req->results[i].my_result);
             }
-
-            mysql_free_result(result);
         }
-    }
 
-    NanReturnValue(js_result);
-}
+        argv[0] = V8EXC("Connection is closed by close() during query");
+    } else if (!mquery_req->ok) {
+        unsigned int error_string_length = mquery_req->my_error.length() + 20;
+        char* error_string = new char[error_string_length];
+        snprintf(error_string, error_string_length, "Query error #%d: %s", mquery_req->my_errno,
+                 mquery_req->my_error.c_str());
 
-/**
- * MysqlConnection#initSync() -> Boolean
- *
- * Initializes MysqlConnection
- **/
-NAN_METHOD(MysqlConnection::InitSync) {
-    NanScope();
+        argv[0] = V8EXC(error_string);
+        delete[] error_string;
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+        // Results stored before failed statement are not passed to callback
+        for (i = 0; i < mquery_req->results.size(); i++) {
+            if (mquery_req->results[i].have_result_set) {
+                mysql_free_result(mquery_req->results[i].my_result);
+            }
+        }
+    } else {
+        Local<Array> js_results = Array::New(mquery_req->results.size());
 
-    if (conn->_conn) {
-        return NanThrowError("Already initialized");
+        for (i = 0; i < mquery_req->results.size(); i++) {
+            multi_query_result &result = mquery_req->results[i];
+
+            if (result.have_result_set) {
+                js_results->Set(Integer::NewFromUnsigned(i),
+                                MysqlResult::NewInstance(mquery_req->conn->_conn,
+                                                         result.my_result,
+                                                         result.field_count));
+            } else {
+                Local<Object> js_info = Object::New();
+                js_info->Set(V8STR("affectedRows"), Integer::New(result.affected_rows));
+                js_info->Set(V8STR("insertId"), Integer::New(result.insert_id));
+                js_results->Set(Integer::NewFromUnsigned(i), js_info);
+            }
+        }
+
+        argc = 2;
+        argv[0] = NanNewLocal(Null());
+        argv[1] = js_results;
     }
 
-    conn->_conn = mysql_init(NULL);
+    mquery_req->conn->last_activity = uv_hrtime();
 
-    if (!conn->_conn) {
-        NanReturnValue(False());
+    if (mquery_req->nan_callback) {
+        mquery_req->nan_callback->Call(argc, argv);
+        delete mquery_req->nan_callback;
     }
 
-    NanReturnValue(True());
+    if (mquery_req->queued) {
+        mquery_req->conn->queue_busy = false;
+        mquery_req->conn->ProcessQueue();
+    }
+
+    mquery_req->conn->Unref();
+
+    delete[] mquery_req->query;
+    delete mquery_req;
+
+    delete req;
 }
 
-/**
- * MysqlConnection#initStatementSync() -> MysqlStatement|Boolean
- *
- * Initializes a statement and returns it
- **/
-NAN_METHOD(MysqlConnection::InitStatementSync) {
-    NanScope();
+void MysqlConnection::EIO_MultiQuery(uv_work_t *req) {
+    struct multi_query_request *mquery_req = (struct multi_query_request *)(req->data);
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    MysqlConnection *conn = mquery_req->conn;
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    pthread_mutex_lock(&conn->query_lock);
 
-    MYSQL_STMT *my_statement = mysql_stmt_init(conn->_conn);
+    if (!conn->_conn || !conn->connected) {
+        mquery_req->ok = false;
+        mquery_req->connection_closed = true;
 
-    if (!my_statement) {
-        NanReturnValue(False());
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
     }
+    mquery_req->connection_closed = false;
 
-    Local<Object> local_js_result = MysqlStatement::NewInstance(my_statement);
-    Persistent<Object> persistent_js_result;
-    NanAssignPersistent(Object, persistent_js_result, local_js_result);
+    MYSQLCONN_ENABLE_MQ;
 
-    NanReturnValue(persistent_js_result);
-}
+    mquery_req->ok = true;
 
-/**
- * MysqlConnection#lastInsertIdSync() -> Integer
- *
- * Returns the auto generated id used in the last query
- **/
-NAN_METHOD(MysqlConnection::LastInsertIdSync) {
-    NanScope();
+    int r = mysql_real_query(conn->_conn, mquery_req->query, mquery_req->query_len);
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    // Store every result set and OK packet,
+    // mysql_next_result() returns -1 when there are no more results
+    while (r == 0) {
+        multi_query_result result;
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+        result.my_result = mysql_store_result(conn->_conn);
+        result.field_count = mysql_field_count(conn->_conn);
 
-    MYSQL_RES *result;
-    my_ulonglong insert_id = 0;
+        if (result.my_result) {
+            result.have_result_set = true;
+            result.affected_rows = 0;
+            result.insert_id = 0;
+        } else if (result.field_count == 0) {
+            result.have_result_set = false;
+            result.affected_rows = mysql_affected_rows(conn->_conn);
+            result.insert_id = mysql_insert_id(conn->_conn);
+        } else {
+            // Result store error
+            r = 1;
+            break;
+        }
 
-    if ( (result = mysql_store_result(conn->_conn)) == 0 &&
-         mysql_field_count(conn->_conn) == 0 &&
-         mysql_insert_id(conn->_conn) != 0) {
-        insert_id = mysql_insert_id(conn->_conn);
+        mquery_req->results.push_back(result);
+
+        r = mysql_next_result(conn->_conn);
     }
 
-    NanReturnValue(Integer::New(insert_id));
+    if (r > 0) {
+        mquery_req->ok = false;
+        mquery_req->my_errno = mysql_errno(conn->_conn);
+        mquery_req->my_error = mysql_error(conn->_conn);
+    }
+
+    MYSQLCONN_DISABLE_MQ;
+
+    pthread_mutex_unlock(&conn->query_lock);
 }
 
 /**
- * MysqlConnection#multiMoreResultsSync() -> Boolean
+ * MysqlConnection#multiQuery(query, callback)
+ * - query (String): Query, may contain several statements
+ * - callback (Function): Callback function, gets (error, results)
  *
- * Checks if there are any more query results from a multi query
+ * Performs a multi query on the database and stores all of its results
+ * in one thread pool call. Results array contains MysqlResult objects
+ * for result sets and {affectedRows, insertId} objects for OK packets.
  **/
-NAN_METHOD(MysqlConnection::MultiMoreResultsSync) {
+NAN_METHOD(MysqlConnection::MultiQuery) {
     NanScope();
 
+    REQ_STR_ARG(0, query);
+    REQ_FUN_ARG(1, callback);
+
     MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
 
     MYSQLCONN_MUSTBE_CONNECTED;
 
-    if (mysql_more_results(conn->_conn)) {
-        NanReturnValue(True());
-    }
+    multi_query_request *mquery_req = NewMultiQueryRequest(conn, *query, query.length(), callback);
 
-    NanReturnValue(False());
+    conn->StartMultiQuery(mquery_req);
+
+    NanReturnUndefined();
 }
 
-/**
- * MysqlConnection#multiNextResultSync() -> Boolean
- *
- * Prepare next result from multi query
- **/
-NAN_METHOD(MysqlConnection::MultiNextResultSync) {
-    NanScope();
+MysqlConnection::multi_query_request *MysqlConnection::NewMultiQueryRequest(MysqlConnection *conn,
+                                                                           const char *query,
+                                                                           size_t query_len,
+                                                                           Handle<Value> callback) {
+    multi_query_request *mquery_req = new multi_query_request;
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    // Multi statements are not classified
+    conn->StopCoalescing(NULL, 0);
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    mquery_req->query = new char[query_len + 1];
+    mquery_req->query_len = query_len;
+    memcpy(mquery_req->query, query, query_len);
+    mquery_req->query[query_len] = '\0';
 
-    if (!mysql_more_results(conn->_conn)) {
-        return NanThrowError("There is no next result set. Please, call MultiMoreResultsSync() to check whether to call this function/method");
+    if (callback->IsFunction()) {
+        mquery_req->nan_callback = new NanCallback(callback.As<Function>());
+    } else {
+        mquery_req->nan_callback = NULL;
     }
 
-    if (!mysql_next_result(conn->_conn)) {
-        NanReturnValue(True());
-    }
+    mquery_req->conn = conn;
+    mquery_req->queued = false;
 
-    NanReturnValue(False());
+    return mquery_req;
+}
+
+void MysqlConnection::StartMultiQuery(multi_query_request *mquery_req) {
+    this->Ref();
+
+    uv_work_t *_req = new uv_work_t;
+    _req->data = mquery_req;
+    uv_queue_work(uv_default_loop(), _req, EIO_MultiQuery, (uv_after_work_cb)EIO_After_MultiQuery);
 }
 
 /**
@@ -941,6 +3790,8 @@ NAN_METHOD(MysqlConnection::MultiRealQuerySync) {
 
     MYSQLCONN_MUSTBE_CONNECTED;
 
+    conn->StopCoalescing(NULL, 0);
+
     MYSQLCONN_ENABLE_MQ;
     unsigned int query_len = static_cast<unsigned int>(query.length());
     if (mysql_real_query(conn->_conn, *query, query_len) != 0) {
@@ -952,6 +3803,29 @@ NAN_METHOD(MysqlConnection::MultiRealQuerySync) {
     NanReturnValue(True());
 }
 
+/**
+ * MysqlConnection#ping([callback])
+ * - callback (Function): Callback function, gets (error)
+ *
+ * Pings a server connection, or tries to reconnect if the connection
+ * has gone down, asynchronous version of pingSync()
+ **/
+NAN_METHOD(MysqlConnection::Ping) {
+    NanScope();
+
+    OPTIONAL_FUN_ARG(0, callback);
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    op_request *op_req = NewOpRequest(conn, CONN_OP_PING, callback);
+
+    conn->QueueOp(op_req);
+
+    NanReturnUndefined();
+}
+
 /**
  * MysqlConnection#pingSync() -> Boolean
  *
@@ -985,14 +3859,50 @@ void MysqlConnection::EIO_After_Query(uv_work_t *req) {
     int argc = 1; // node.js convention, there is always at least one argument for callback
     Local<Value> argv[2];
     DEBUG_PRINTF("EIO_After_Query: in");
-    if (!query_req->conn->_conn || !query_req->conn->connected || query_req->connection_closed) {
+
+    if (query_req->timeout_timer) {
+        uv_timer_stop(query_req->timeout_timer);
+        uv_close((uv_handle_t *)query_req->timeout_timer, EV_QueryTimeout_OnTimerClose);
+        query_req->timeout_timer = NULL;
+    }
+
+    // Queries started from now on are not coalesced with this one
+    query_req->conn->ForgetInflightRead(query_req);
+
+    MysqlSharedResult *shared_result = NULL;
+
+    if (query_req->connection_closed ||
+        (!query_req->conn->closing && (!query_req->conn->_conn || !query_req->conn->connected))) {
         DEBUG_PRINTF("EIO_After_Query: !query_req->conn->_conn || !query_req->conn->connected || query_req->connection_closed");
         // Check connection
         // If closeSync() is called after query(),
         // than connection is destroyed here
         // https://github.com/Sannis/node-mysql-libmysqlclient/issues/157
+        // Query completed before async close() still gets its result,
+        // if connection is not closed yet
         argv[0] = V8EXC("Connection is closed by closeSync() during query");
+    } else if (query_req->interrupted && (!query_req->ok || query_req->have_result_set)) {
+        // Query was killed or has not been started before deadline,
+        // write completed before KILL QUERY reached it gets its result
+        if (query_req->query_time) {
+            query_req->conn->UpdateQueryTime(query_req->query_time);
+        }
+
+        if (query_req->ok) {
+            mysql_free_result(query_req->my_result);
+        }
+
+        argv[0] = V8EXC("Query timeout");
+    } else if (query_req->ok && query_req->have_result_set && !query_req->conn->_conn) {
+        // Connection is closed by close() before callback, result can't be used
+        query_req->conn->UpdateQueryTime(query_req->query_time);
+
+        mysql_free_result(query_req->my_result);
+
+        argv[0] = V8EXC("Connection is closed by close() during query");
     } else if (!query_req->ok) {
+        query_req->conn->UpdateQueryTime(query_req->query_time);
+
         unsigned int error_string_length = strlen(query_req->my_error) + 20;
         char* error_string = new char[error_string_length];
         snprintf(error_string, error_string_length, "Query error #%d: %s", query_req->my_errno, query_req->my_error);
@@ -1000,10 +3910,21 @@ void MysqlConnection::EIO_After_Query(uv_work_t *req) {
         argv[0] = V8EXC(error_string);
         delete[] error_string;
     } else {
+        query_req->conn->UpdateQueryTime(query_req->query_time);
+
         argc = 2;
         argv[0] = NanNewLocal(Null());
         if (query_req->have_result_set) {
-            Local<Object> local_js_result = MysqlResult::NewInstance(query_req->conn->_conn, query_req->my_result, query_req->field_count);
+            if (query_req->followers.size() > 0) {
+                shared_result = new MysqlSharedResult;
+                shared_result->res = query_req->my_result;
+                shared_result->refs = 1 + query_req->followers.size();
+                shared_result->cursor_owner = NULL;
+                shared_result->fetching = false;
+            }
+
+            Local<Object> local_js_result = MysqlResult::NewInstance(query_req->conn->_conn, query_req->my_result,
+                                                                     query_req->field_count, shared_result);
             argv[1] = local_js_result;
         } else {
             Local<Object> local_js_result = Object::New();
@@ -1015,6 +3936,8 @@ void MysqlConnection::EIO_After_Query(uv_work_t *req) {
         }
     }
 
+    query_req->conn->last_activity = uv_hrtime();
+
     if (query_req->nan_callback) {
         DEBUG_PRINTF("EIO_After_Query: query_req->nan_callback->Call()");
         query_req->nan_callback->Call(argc, argv);
@@ -1022,6 +3945,32 @@ void MysqlConnection::EIO_After_Query(uv_work_t *req) {
         delete query_req->nan_callback;
     }
 
+    // Coalesced followers get the same error or own MysqlResult
+    // over the same result set
+    for (size_t i = 0; i < query_req->followers.size(); i++) {
+        if (argc == 2) {
+            if (query_req->have_result_set) {
+                argv[1] = MysqlResult::NewInstance(query_req->conn->_conn, query_req->my_result,
+                                                   query_req->field_count, shared_result);
+            } else {
+                Local<Object> local_js_result = Object::New();
+                local_js_result->Set(V8STR("affectedRows"),
+                               Integer::New(query_req->affected_rows));
+                local_js_result->Set(V8STR("insertId"),
+                               Integer::New(query_req->insert_id));
+                argv[1] = local_js_result;
+            }
+        }
+
+        query_req->followers[i]->Call(argc, argv);
+        delete query_req->followers[i];
+    }
+
+    if (query_req->queued) {
+        query_req->conn->queue_busy = false;
+        query_req->conn->ProcessQueue();
+    }
+
     // See comment above
     DEBUG_PRINTF("EIO_After_Query: Unref?");
     if (!query_req->conn->_conn || !query_req->conn->connected) {
@@ -1059,8 +4008,31 @@ void MysqlConnection::EIO_Query(uv_work_t *req) {
     }
     query_req->connection_closed = false;
 
+    // Skip query if its deadline is passed while waiting for query_lock,
+    // otherwise mark it as running for KILL QUERY
+    pthread_mutex_lock(&conn->kill_lock);
+    // KILL QUERY for the previous query may still be on its way
+    while (conn->kill_sending) {
+        pthread_cond_wait(&conn->kill_cond, &conn->kill_lock);
+    }
+    if (query_req->timed_out) {
+        pthread_mutex_unlock(&conn->kill_lock);
+
+        query_req->ok = false;
+        query_req->interrupted = true;
+        query_req->query_time = 0;
+
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
+    }
+    conn->running_query_id = query_req->query_id;
+    pthread_mutex_unlock(&conn->kill_lock);
+
     MYSQLCONN_DISABLE_MQ;
 
+    // Measure query round trip without waiting for query_lock
+    uint64_t query_start = uv_hrtime();
+
     // we are protected with mutex, so set CURRENT request data
     // in connection (common object for ALL queries)
     SetCorrectLocalInfileHandlers(query_req->infile_data, conn->_conn);
@@ -1103,16 +4075,137 @@ void MysqlConnection::EIO_Query(uv_work_t *req) {
         }
     }
 
-    pthread_mutex_unlock(&conn->query_lock);
+    query_req->query_time = uv_hrtime() - query_start;
+
+    pthread_mutex_lock(&conn->kill_lock);
+    conn->running_query_id = 0;
+    query_req->interrupted = (conn->killed_query_id == query_req->query_id);
+    pthread_mutex_unlock(&conn->kill_lock);
+
+    pthread_mutex_unlock(&conn->query_lock);
+}
+
+/*!
+ * Timer callback for query timeout, runs in main thread
+ */
+MYSQL_BINDINGS_TIMER_CB(MysqlConnection::EV_QueryTimeout) {
+    struct query_request *query_req = (struct query_request *)(handle->data);
+    MysqlConnection *conn = query_req->conn;
+
+    pthread_mutex_lock(&conn->kill_lock);
+    query_req->timed_out = true;
+    bool running = (conn->running_query_id == query_req->query_id);
+    if (running) {
+        conn->pending_kills++;
+    }
+    pthread_mutex_unlock(&conn->kill_lock);
+
+    // Not started query will be skipped by EIO_Query
+    if (!running) {
+        return;
+    }
+
+    conn->KillRunningQuery(query_req->query_id);
+}
+
+void MysqlConnection::EV_QueryTimeout_OnTimerClose(uv_handle_t *handle) {
+    delete (uv_timer_t *)handle;
+}
+
+const char *MysqlConnection::GetQueryOptions(Local<Object> options, query_options *qo) {
+    if (options->Has(V8STR("timeoutMs"))) {
+        Local<Value> timeout_ms = options->Get(V8STR("timeoutMs"));
+        if (!timeout_ms->IsUint32()) {
+            return "timeoutMs option must be a non-negative integer";
+        }
+        qo->timeout_ms = timeout_ms->Uint32Value();
+    }
+    if (options->Has(V8STR("deadlineMs"))) {
+        Local<Value> deadline_ms = options->Get(V8STR("deadlineMs"));
+        if (!deadline_ms->IsUint32()) {
+            return "deadlineMs option must be a non-negative integer";
+        }
+        qo->deadline_ms = deadline_ms->Uint32Value();
+    }
+    if (options->Has(V8STR("priority"))) {
+        Local<Value> priority = options->Get(V8STR("priority"));
+        if (!priority->IsUint32() || priority->Uint32Value() >= QUEUE_PRIORITIES_COUNT) {
+            return "priority option must be one of QUEUE_PRIORITY_* constants";
+        }
+        qo->priority = priority->Uint32Value();
+    }
+
+    return NULL;
+}
+
+/*!
+ * Creates query request for MysqlConnection::Query and MysqlConnection::QuerySend
+ */
+MysqlConnection::query_request *MysqlConnection::NewQueryRequest(MysqlConnection *conn,
+                                                                 const char *query,
+                                                                 size_t query_len,
+                                                                 Handle<Value> local_infile_buffer,
+                                                                 Handle<Value> callback) {
+    query_request *query_req = new query_request;
+
+    query_req->query = new char[query_len + 1];
+    query_req->query_len = query_len;
+    query_req->infile_data = MysqlConnection::PrepareLocalInfileData(local_infile_buffer);
+    // Copy query from V8 value to buffer
+    memcpy(query_req->query, query, query_len);
+    query_req->query[query_len] = '\0';
+
+    if (callback->IsFunction()) {
+        DEBUG_PRINTF("NewQueryRequest: callback->IsFunction()");
+        query_req->nan_callback = new NanCallback(callback.As<Function>());
+    } else {
+        DEBUG_PRINTF("NewQueryRequest: !callback->IsFunction()");
+        query_req->nan_callback = NULL;
+    }
+
+    query_req->conn = conn;
+    query_req->query_id = 0;
+    query_req->timed_out = false;
+    query_req->interrupted = false;
+    query_req->timeout_timer = NULL;
+    query_req->queued = false;
+    query_req->inflight_registered = false;
+
+    return query_req;
+}
+
+/*!
+ * Queues query request to threadpool
+ */
+void MysqlConnection::StartQuery(query_request *query_req, uint32_t timeout_ms) {
+    this->Ref();
+
+    query_req->query_id = ++this->last_query_id;
+    if (timeout_ms > 0) {
+        query_req->timeout_timer = new uv_timer_t;
+        query_req->timeout_timer->data = query_req;
+        uv_timer_init(uv_default_loop(), query_req->timeout_timer);
+        uv_timer_start(query_req->timeout_timer, EV_QueryTimeout, timeout_ms, 0);
+    }
+
+    uv_work_t *_req = new uv_work_t;
+    _req->data = query_req;
+    uv_queue_work(uv_default_loop(), _req, EIO_Query, (uv_after_work_cb)EIO_After_Query);
 }
 
 /**
- * MysqlConnection#query(query, callback)
+ * MysqlConnection#query(query[, options], callback)
  * - query (String): Query
+ * - options (Object): Query options, `timeoutMs` - query deadline
  * - callback (Function): Callback function, gets (error, result)
  *
  * Performs a query on the database.
  * Uses mysql_real_query.
+ *
+ * If query is not completed in `timeoutMs` milliseconds, it is stopped
+ * with KILL QUERY sent using side connection and callback gets timeout error.
+ * Write completed before KILL QUERY reached it gets its result as usual,
+ * so it is never reported as timed out after being committed.
  **/
 NAN_METHOD(MysqlConnection::Query) {
     NanScope();
@@ -1123,15 +4216,26 @@ NAN_METHOD(MysqlConnection::Query) {
     REQ_STR_ARG(0, query);
     OPTIONAL_BUFFER_ARG(1, optional_local_infile_buffer);
 
-    int optional_callback_arg_number;
+    int optional_arg_number;
     if (optional_local_infile_buffer->IsNull()) {
         DEBUG_PRINTF("Query: local_infile_buffer->IsNull()");
-        optional_callback_arg_number = 1;
+        optional_arg_number = 1;
     } else {
         DEBUG_PRINTF("Query: !local_infile_buffer->IsNull()");
-        optional_callback_arg_number = 2;
+        optional_arg_number = 2;
     }
-    OPTIONAL_FUN_ARG(optional_callback_arg_number, optional_callback);
+
+    query_options qo = {0, 0, QUEUE_PRIORITY_NORMAL};
+    if (args.Length() > optional_arg_number
+     && args[optional_arg_number]->IsObject()
+     && !args[optional_arg_number]->IsFunction()) {
+        const char *options_error = MysqlConnection::GetQueryOptions(args[optional_arg_number]->ToObject(), &qo);
+        if (options_error) {
+            return NanThrowTypeError(options_error);
+        }
+        optional_arg_number++;
+    }
+    OPTIONAL_FUN_ARG(optional_arg_number, optional_callback);
 
     DEBUG_PRINTF("Query: continue");
 
@@ -1139,30 +4243,20 @@ NAN_METHOD(MysqlConnection::Query) {
 
     MYSQLCONN_MUSTBE_CONNECTED;
 
-    query_request *query_req = new query_request;
-    unsigned int query_len = static_cast<unsigned int>(query.length());
-
-    query_req->query = new char[query_len + 1];
-    query_req->query_len = query_len;
-    query_req->infile_data = MysqlConnection::PrepareLocalInfileData(optional_local_infile_buffer);
-    // Copy query from V8 value to buffer
-    memcpy(query_req->query, *query, query_len);
-    query_req->query[query_len] = '\0';
-
-    if (optional_callback->IsFunction()) {
-        DEBUG_PRINTF("Query: optional_callback->IsFunction()");
-        query_req->nan_callback = new NanCallback(optional_callback.As<Function>());
-    } else {
-        DEBUG_PRINTF("Query: !optional_callback->IsFunction()");
-        query_req->nan_callback = NULL;
+    // Queries with own deadline or LOAD DATA are never coalesced
+    bool is_read = false;
+    if (qo.timeout_ms == 0 && optional_local_infile_buffer->IsNull()
+     && conn->JoinInflightRead(*query, query.length(), optional_callback, &is_read)) {
+        NanReturnUndefined();
     }
 
-    query_req->conn = conn;
-    conn->Ref();
+    query_request *query_req = NewQueryRequest(conn, *query, query.length(),
+                                               optional_local_infile_buffer, optional_callback);
+    if (is_read) {
+        conn->RegisterInflightRead(query_req);
+    }
 
-    uv_work_t *_req = new uv_work_t;
-    _req->data = query_req;
-    uv_queue_work(uv_default_loop(), _req, EIO_Query, (uv_after_work_cb)EIO_After_Query);
+    conn->StartQuery(query_req, qo.timeout_ms);
 
     NanReturnUndefined();
 }
@@ -1173,23 +4267,39 @@ NAN_METHOD(MysqlConnection::Query) {
 void MysqlConnection::EV_After_QuerySend(uv_poll_t* handle, int status, int events) {
     NanScope();
 
-    // Fake uv_work_t struct for EIO_After_Query call
-    uv_work_t *fake_req = new uv_work_t;
-    fake_req->data = handle->data;
+    struct query_request *query_req = (struct query_request *)handle->data;
+
+    MysqlConnection *conn = query_req->conn;
 
-    // Stop IO watcher
+    // Stop IO watcher, result is already readable
     uv_poll_stop(handle);
+
+    // Lock is held while reading result, so async close() waits for it.
+    // Main thread doesn't wait for threadpool work holding the lock,
+    // result is read again after a short delay instead
+    if (pthread_mutex_trylock(&conn->query_lock) != 0) {
+        uv_timer_t *retry_timer = new uv_timer_t;
+        uv_timer_init(uv_default_loop(), retry_timer);
+        retry_timer->data = handle;
+        uv_timer_start(retry_timer, EV_QuerySend_OnRetryTimer, 1, 0);
+        return;
+    }
+
     uv_close((uv_handle_t *)handle, EV_After_QuerySend_OnWatchHandleClose);
 
-    struct query_request *query_req = (struct query_request *)handle->data;
+    conn->pending_query_sends--;
 
-    MysqlConnection *conn = query_req->conn;
+    // Fake uv_work_t struct for EIO_After_Query call
+    uv_work_t *fake_req = new uv_work_t;
+    fake_req->data = query_req;
 
     // Check connection
     // If closeSync() is called after query(),
     // than connection is destroyed here
     // https://github.com/Sannis/node-mysql-libmysqlclient/issues/157
     if (!conn->_conn || !conn->connected) {
+        pthread_mutex_unlock(&conn->query_lock);
+
         query_req->ok = false;
         query_req->connection_closed = true;
 
@@ -1238,6 +4348,10 @@ void MysqlConnection::EV_After_QuerySend(uv_poll_t* handle, int status, int even
         }
     }
 
+    pthread_mutex_unlock(&conn->query_lock);
+
+    query_req->query_time = uv_hrtime() - query_req->query_time;
+
     // The callback part, just call the existing code
     EIO_After_Query(fake_req);
 }
@@ -1246,6 +4360,19 @@ void MysqlConnection::EV_After_QuerySend_OnWatchHandleClose(uv_handle_t* handle)
     delete handle;
 }
 
+MYSQL_BINDINGS_TIMER_CB(MysqlConnection::EV_QuerySend_OnRetryTimer) {
+    uv_poll_t *watch_handle = (uv_poll_t *)handle->data;
+
+    uv_close((uv_handle_t *)handle, EV_QuerySend_OnRetryTimerClose);
+
+    // Connection may be closed meanwhile, so watcher is not restarted
+    EV_After_QuerySend(watch_handle, 0, UV_READABLE);
+}
+
+void MysqlConnection::EV_QuerySend_OnRetryTimerClose(uv_handle_t *handle) {
+    delete (uv_timer_t *)handle;
+}
+
 /**
  * MysqlConnection#querySend(query, callback)
  * - query (String): Query
@@ -1267,39 +4394,43 @@ NAN_METHOD(MysqlConnection::QuerySend) {
 
     MYSQLCONN_MUSTBE_CONNECTED;
 
-    query_request *query_req = new query_request;
+    bool is_read = false;
+    if (conn->JoinInflightRead(*query, query.length(), optional_callback, &is_read)) {
+        NanReturnUndefined();
+    }
 
-    unsigned int query_len = static_cast<unsigned int>(query.length());
-    query_req->query = new char[query_len + 1];
+    query_request *query_req = NewQueryRequest(conn, *query, query.length(), Null(), optional_callback);
+    if (is_read) {
+        conn->RegisterInflightRead(query_req);
+    }
 
-    // Copy query from V8 var to buffer
-    memcpy(query_req->query, *query, query_len);
-    query_req->query[query_len] = '\0';
+    conn->StartQuerySend(query_req);
 
-    if (optional_callback->IsFunction()) {
-        DEBUG_PRINTF("QuerySend: optional_callback->IsFunction()\n\n\n");
-        query_req->nan_callback = new NanCallback(optional_callback.As<Function>());
-    } else {
-        DEBUG_PRINTF("QuerySend: !optional_callback->IsFunction()\n\n\n");
-        query_req->nan_callback = NULL;
-    }
+    NanReturnUndefined();
+}
 
-    query_req->conn = conn;
-    conn->Ref();
+/*!
+ * Sends query and starts IO watcher for its result
+ */
+void MysqlConnection::StartQuerySend(query_request *query_req) {
+    this->Ref();
+
+    // Keepalive doesn't ping connection until result is read
+    this->pending_query_sends++;
+
+    // Holds query start time until result is read
+    query_req->query_time = uv_hrtime();
 
     // Send query
-    mysql_send_query(conn->_conn, query_req->query, query_len + 1);
+    mysql_send_query(this->_conn, query_req->query, query_req->query_len + 1);
 
     // Init IO watcher
     uv_poll_t* handle = new uv_poll_t;
     handle->data = query_req;
-    uv_poll_init(uv_default_loop(), handle, conn->_conn->net.fd);
+    uv_poll_init(uv_default_loop(), handle, this->_conn->net.fd);
     uv_poll_start(handle, UV_READABLE, EV_After_QuerySend);
-
-    NanReturnUndefined();
 }
 
-
 /**
  * MysqlConnection#querySync(query) -> MysqlResult
  * - query (String): Query
@@ -1318,6 +4449,8 @@ NAN_METHOD(MysqlConnection::QuerySync) {
 
     MYSQLCONN_DISABLE_MQ;
 
+    conn->StopCoalescing(*query, query.length());
+
     MYSQL_RES *my_result = NULL;
     unsigned int field_count;
 
@@ -1354,6 +4487,59 @@ NAN_METHOD(MysqlConnection::QuerySync) {
     NanReturnValue(local_js_result);
 }
 
+/**
+ * MysqlConnection#resetSession([callback])
+ * - callback (Function): Callback function, gets (error)
+ *
+ * Resets server session state for connection reuse: rolls back
+ * transaction, drops temporary tables, user variables and prepared
+ * statements, restores autocommit and charset. Uses mysql_reset_connection
+ * (or mysql_change_user with the last credentials for libmysqlclient < 5.7.3).
+ * Prepared statements of this connection become closed.
+ **/
+NAN_METHOD(MysqlConnection::ResetSession) {
+    NanScope();
+
+    OPTIONAL_FUN_ARG(0, callback);
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    op_request *op_req = NewOpRequest(conn, CONN_OP_RESET_SESSION, callback);
+    op_req->flag = conn->multi_query;
+    op_req->user = conn->last_connect.user;
+    op_req->password = conn->last_connect.password;
+    op_req->dbname = conn->last_connect.dbname;
+    op_req->have_dbname = !conn->last_connect.dbname.empty();
+
+    conn->QueueOp(op_req);
+
+    NanReturnUndefined();
+}
+
+/**
+ * MysqlConnection#rollback([callback])
+ * - callback (Function): Callback function, gets (error)
+ *
+ * Rolls back current transaction, asynchronous version of rollbackSync()
+ **/
+NAN_METHOD(MysqlConnection::Rollback) {
+    NanScope();
+
+    OPTIONAL_FUN_ARG(0, callback);
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    op_request *op_req = NewOpRequest(conn, CONN_OP_ROLLBACK, callback);
+
+    conn->QueueOp(op_req);
+
+    NanReturnUndefined();
+}
+
 /**
  * MysqlConnection#rollbackSync() -> Boolean
  *
@@ -1373,6 +4559,39 @@ NAN_METHOD(MysqlConnection::RollbackSync) {
     NanReturnValue(True());
 }
 
+/**
+ * MysqlConnection#queueStatsSync() -> Object
+ *
+ * Gets queries queue metrics: current depth (total and per priority),
+ * counters of enqueued, dispatched and shed queries
+ * and queue wait times in milliseconds
+ **/
+NAN_METHOD(MysqlConnection::QueueStatsSync) {
+    NanScope();
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    Local<Object> js_stats = Object::New();
+    Local<Array> js_depth_by_priority = Array::New(QUEUE_PRIORITIES_COUNT);
+
+    for (int i = 0; i < QUEUE_PRIORITIES_COUNT; i++) {
+        js_depth_by_priority->Set(Integer::New(i), Integer::NewFromUnsigned(conn->queue[i].count));
+    }
+
+    js_stats->Set(V8STR("depth"), Integer::NewFromUnsigned(conn->QueueDepth()));
+    js_stats->Set(V8STR("depthByPriority"), js_depth_by_priority);
+    js_stats->Set(V8STR("busy"), conn->queue_busy ? True() : False());
+    js_stats->Set(V8STR("enqueued"), Number::New(conn->queue_enqueued));
+    js_stats->Set(V8STR("dispatched"), Number::New(conn->queue_dispatched));
+    js_stats->Set(V8STR("shed"), Number::New(conn->queue_shed));
+    js_stats->Set(V8STR("coalesced"), Number::New(conn->coalesced_count));
+    js_stats->Set(V8STR("lastWaitTime"), Number::New(conn->queue_last_wait_time / 1e6));
+    js_stats->Set(V8STR("maxWaitTime"), Number::New(conn->queue_max_wait_time / 1e6));
+    js_stats->Set(V8STR("waitTimeEwma"), Number::New(conn->queue_wait_time_ewma / 1e6));
+
+    NanReturnValue(js_stats);
+}
+
 /**
  * MysqlConnection#realConnectSync([hostname[, user[, password[, database[, port[, socket]]]]]]) -> Boolean
  * - hostname (String): Hostname
@@ -1430,6 +4649,8 @@ NAN_METHOD(MysqlConnection::RealQuerySync) {
 
     MYSQLCONN_DISABLE_MQ;
 
+    conn->StopCoalescing(*query, query.length());
+
     unsigned int query_len = static_cast<unsigned int>(query.length());
 
     pthread_mutex_lock(&conn->query_lock);
@@ -1443,6 +4664,32 @@ NAN_METHOD(MysqlConnection::RealQuerySync) {
     NanReturnValue(True());
 }
 
+/**
+ * MysqlConnection#selectDb(database[, callback])
+ * - database (String): Database to use
+ * - callback (Function): Callback function, gets (error)
+ *
+ * Selects the default database for database queries,
+ * asynchronous version of selectDbSync()
+ **/
+NAN_METHOD(MysqlConnection::SelectDb) {
+    NanScope();
+
+    REQ_STR_ARG(0, dbname)
+    OPTIONAL_FUN_ARG(1, callback);
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    op_request *op_req = NewOpRequest(conn, CONN_OP_SELECT_DB, callback);
+    op_req->dbname = *dbname;
+
+    conn->QueueOp(op_req);
+
+    NanReturnUndefined();
+}
+
 /**
  * MysqlConnection#selectDbSync(database) -> Boolean
  * - database (String): Database to use
@@ -1462,9 +4709,37 @@ NAN_METHOD(MysqlConnection::SelectDbSync) {
         NanReturnValue(False());
     }
 
+    conn->last_connect.dbname = *dbname;
+
     NanReturnValue(True());
 }
 
+/**
+ * MysqlConnection#setCharset(charset[, callback])
+ * - charset (String): Charset
+ * - callback (Function): Callback function, gets (error)
+ *
+ * Sets the default client character set,
+ * asynchronous version of setCharsetSync()
+ **/
+NAN_METHOD(MysqlConnection::SetCharset) {
+    NanScope();
+
+    REQ_STR_ARG(0, charset)
+    OPTIONAL_FUN_ARG(1, callback);
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    op_request *op_req = NewOpRequest(conn, CONN_OP_SET_CHARSET, callback);
+    op_req->charset = *charset;
+
+    conn->QueueOp(op_req);
+
+    NanReturnUndefined();
+}
+
 /**
  * MysqlConnection#setCharsetSync() -> Boolean
  * - charset (String): Charset
@@ -1484,9 +4759,76 @@ NAN_METHOD(MysqlConnection::SetCharsetSync) {
         NanReturnValue(False());
     }
 
+    conn->session_charset = *charset;
+
     NanReturnValue(True());
 }
 
+/**
+ * MysqlConnection#setQueryCoalescingSync(enabled)
+ * - enabled (Boolean): Enable coalescing
+ *
+ * Enables single-flight coalescing of identical read queries:
+ * query() or querySend() with the same SQL as already running read query
+ * is not sent, its callback gets the result of running one instead.
+ * Each callback gets own MysqlResult object over the shared result set,
+ * while one of them is fetched in threadpool the others throw.
+ * Any non-read query stops coalescing with earlier reads.
+ **/
+NAN_METHOD(MysqlConnection::SetQueryCoalescingSync) {
+    NanScope();
+
+    REQ_BOOL_ARG(0, enabled);
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    conn->coalesce_reads = enabled;
+    if (!enabled) {
+        conn->inflight_reads.clear();
+    }
+
+    NanReturnUndefined();
+}
+
+/**
+ * MysqlConnection#setKeepAliveSync(intervalMs)
+ * - intervalMs (Integer): Idle time before ping, 0 disables keepalive
+ *
+ * Enables background health check of idle connection. Connection idle
+ * for `intervalMs` is pinged in threadpool, dead one is reconnected with
+ * the last connect parameters, options from setOptionSync() and setSslSync(),
+ * database from selectDb[Sync](), charset from setCharset[Sync]()
+ * and its prepared statements are prepared again. Connection is not replaced
+ * while its unbuffered results are alive or statements are running.
+ * Keepalive timer does not keep event loop alive.
+ **/
+NAN_METHOD(MysqlConnection::SetKeepAliveSync) {
+    NanScope();
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    REQ_UINT_ARG(0, interval_ms);
+
+    conn->StopKeepAlive();
+
+    if (interval_ms > 0) {
+        conn->keepalive_interval = interval_ms;
+        conn->keepalive_timer = new uv_timer_t;
+        conn->keepalive_timer->data = conn;
+        uv_timer_init(uv_default_loop(), conn->keepalive_timer);
+        uv_timer_start(conn->keepalive_timer, EV_KeepAlive, interval_ms, interval_ms);
+        uv_unref((uv_handle_t *)conn->keepalive_timer);
+
+        if (!conn->last_activity) {
+            conn->last_activity = uv_hrtime();
+        }
+    }
+
+    NanReturnUndefined();
+}
+
 /**
  * MysqlConnection#setOptionSync(key, value) -> Boolean
  * - key (Integer): Option key
@@ -1520,6 +4862,13 @@ NAN_METHOD(MysqlConnection::SetOptionSync) {
                               static_cast<const char *>(
                                 static_cast<const void *>(
                                   &option_integer_value)));
+            if (!r) {
+                recorded_option option;
+                option.option = option_key;
+                option.kind = RECORDED_OPTION_INT;
+                option.int_value = option_integer_value;
+                conn->RecordOption(option);
+            }
             // MYSQL_OPT_RECONNECT option is modified by mysql_real_connect
             // due to bug in MySQL < 5.1.6
             // Save it state and repeat mysql_options after connect
@@ -1539,10 +4888,23 @@ NAN_METHOD(MysqlConnection::SetOptionSync) {
             {
             REQ_STR_ARG(1, option_string_value);
             r = mysql_options(conn->_conn, option_key, *option_string_value);
+            if (!r) {
+                recorded_option option;
+                option.option = option_key;
+                option.kind = RECORDED_OPTION_STRING;
+                option.string_value = *option_string_value;
+                conn->RecordOption(option);
+            }
             }
             break;
         case MYSQL_OPT_LOCAL_INFILE:
             r  = mysql_options(conn->_conn, option_key, NULL);
+            if (!r) {
+                recorded_option option;
+                option.option = option_key;
+                option.kind = RECORDED_OPTION_NULL;
+                conn->RecordOption(option);
+            }
             break;
         case MYSQL_OPT_NAMED_PIPE:
         case MYSQL_SHARED_MEMORY_BASE_NAME:
@@ -1604,6 +4966,13 @@ NAN_METHOD(MysqlConnection::SetSslSync) {
         cipher
     );
 
+    const char *ssl_values[5] = {key, cert, ca, capath, cipher};
+    conn->recorded_ssl.set = true;
+    for (int i = 0; i < 5; i++) {
+        conn->recorded_ssl.have[i] = (ssl_values[i] != NULL);
+        conn->recorded_ssl.values[i] = ssl_values[i] ? ssl_values[i] : "";
+    }
+
     NanReturnUndefined();
 }
 
@@ -1622,6 +4991,49 @@ NAN_METHOD(MysqlConnection::SqlStateSync) {
     NanReturnValue(V8STR(mysql_sqlstate(conn->_conn)));
 }
 
+/**
+ * MysqlConnection#sslSessionReusedSync() -> Boolean
+ *
+ * Returns whether TLS session was resumed from cache during connect
+ **/
+NAN_METHOD(MysqlConnection::SslSessionReusedSync) {
+    NanScope();
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+#ifdef MYSQLCONN_HAVE_SSL_SESSION_DATA
+    if (mysql_get_ssl_session_reused(conn->_conn)) {
+        NanReturnValue(True());
+    }
+#endif
+
+    NanReturnValue(False());
+}
+
+/**
+ * MysqlConnection#stat(callback)
+ * - callback (Function): Callback function, gets (error, status)
+ *
+ * Gets the current system status, asynchronous version of statSync()
+ **/
+NAN_METHOD(MysqlConnection::Stat) {
+    NanScope();
+
+    OPTIONAL_FUN_ARG(0, callback);
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    op_request *op_req = NewOpRequest(conn, CONN_OP_STAT, callback);
+
+    conn->QueueOp(op_req);
+
+    NanReturnUndefined();
+}
+
 /**
  * MysqlConnection#statSync() -> String
  *
@@ -1639,6 +5051,29 @@ NAN_METHOD(MysqlConnection::StatSync) {
     NanReturnValue(V8STR(stat ? stat : ""));
 }
 
+/**
+ * MysqlConnection#storeResult(callback)
+ * - callback (Function): Callback function, gets (error, result)
+ *
+ * Transfers a result set from the last query, result is true
+ * for queries without result set. Asynchronous version of storeResultSync()
+ **/
+NAN_METHOD(MysqlConnection::StoreResult) {
+    NanScope();
+
+    OPTIONAL_FUN_ARG(0, callback);
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    op_request *op_req = NewOpRequest(conn, CONN_OP_STORE_RESULT, callback);
+
+    conn->QueueOp(op_req);
+
+    NanReturnUndefined();
+}
+
 /**
  * MysqlConnection#storeResultSync() -> MysqlResult
  *
@@ -1721,6 +5156,7 @@ NAN_METHOD(MysqlConnection::UseResultSync) {
     }
 
     Local<Object> local_js_result = MysqlResult::NewInstance(conn->_conn, my_result, mysql_field_count(conn->_conn));
+    OBJUNWRAP<MysqlResult>(local_js_result)->SetConnection(conn, args.Holder());
     Persistent<Object> persistent_js_result;
     NanAssignPersistent(Object, persistent_js_result, local_js_result);
 
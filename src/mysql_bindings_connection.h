@@ -14,10 +14,21 @@
 #include <node.h>
 
 #include <unistd.h>
+#include <strings.h>
 #include <pthread.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <errno.h>
+#include <ctype.h>
+#include <time.h>
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
 
 #include "./mysql_bindings.h"
 
@@ -33,12 +44,71 @@
         conn->multi_query = true; \
     }
 
+// TLS session resumption is available since libmysqlclient 8.0.29
+#if MYSQL_VERSION_ID >= 80029
+#define MYSQLCONN_HAVE_SSL_SESSION_DATA 1
+#endif
+
+// COM_RESET_CONNECTION is available since libmysqlclient 5.7.3
+#if MYSQL_VERSION_ID >= 50703
+#define MYSQLCONN_HAVE_RESET_CONNECTION 1
+#endif
+
+class MysqlStatement;
+
+// Query types, returned by classifyQuerySync()
+enum MysqlQueryType {
+    QUERY_TYPE_READ = 0,
+    QUERY_TYPE_WRITE,
+    QUERY_TYPE_BEGIN,
+    QUERY_TYPE_END
+};
+
+// Connect timeout for side connection used to kill timed out queries, in seconds
+#define MYSQLCONN_KILL_CONNECT_TIMEOUT 5
+
+// Delay before starting next parallel connect attempt to hosts list, in milliseconds
+#define MYSQLCONN_CONNECT_STAGGER_MS 250
+
+// Connect timeout of each attempt to hosts list, in seconds,
+// bounds threads of blackholed hosts which lost the race
+#define MYSQLCONN_CONNECT_ATTEMPT_TIMEOUT 10
+
+// Priority classes of queries queue, see MysqlConnection#enqueue()
+enum MysqlQueuePriority {
+    QUEUE_PRIORITY_HIGH = 0,
+    QUEUE_PRIORITY_NORMAL,
+    QUEUE_PRIORITY_LOW,
+    QUEUE_PRIORITIES_COUNT
+};
+
+// Initial capacity of each queue priority ring
+#define MYSQLCONN_QUEUE_INITIAL_CAPACITY 16
+
+// Smoothing factor for queue wait time EWMA
+#define MYSQLCONN_QUEUE_WAIT_EWMA_ALPHA 0.2
+
+// Max keys in one loadByKey() batch, full batch is sent without waiting
+#define MYSQLCONN_LOAD_BATCH_MAX_KEYS 1000
+
+// Smoothing factor for queries time EWMA
+#define MYSQLCONN_QUERY_TIME_EWMA_ALPHA 0.2
+
+#define MYSQLCONN_MUSTNOT_BE_CLOSING \
+    if (conn->closing) { \
+        return NanThrowError("Connection is closing"); \
+    }
+
+// Also marks connection as active, so keepalive doesn't ping it while it is used synchronously
 #define MYSQLCONN_MUSTBE_CONNECTED \
+    MYSQLCONN_MUSTNOT_BE_CLOSING; \
     if (!conn->_conn || !conn->connected) { \
         return NanThrowError("Not connected"); \
-    }
+    } \
+    conn->last_activity = uv_hrtime();
 
 #define MYSQLCONN_MUSTBE_INITIALIZED \
+    MYSQLCONN_MUSTNOT_BE_CLOSING; \
     if (!conn->_conn) { \
         return NanThrowError("Not initialized"); \
     }
@@ -70,9 +140,103 @@ class MysqlConnection : public node::ObjectWrap {
                      const char* socket,
                      uint64_t flags);
 
-    void Close();
+    void Disconnect();
+
+    static MysqlQueryType ClassifyQuery(const char *query, size_t query_len);
+
+    void RegisterStatement(MysqlStatement *stmt);
+    void UnregisterStatement(MysqlStatement *stmt);
+
+    // Queries not started by query() or querySend() stop coalescing
+    // with running reads, unless they are reads too. NULL query always stops it
+    void StopCoalescing(const char *query, size_t query_len);
+
+    // Serializes threadpool fetches of unbuffered results with queries
+    void LockQuery();
+    void UnlockQuery();
+
+    // Statement executions are activity for keepalive
+    void MarkActive();
+
+    // Unbuffered results read from connection handle,
+    // keepalive doesn't replace it while they are alive
+    void AttachResult();
+    void DetachResult();
+
+    // Runs query and stores its result, for work queued by QueueWork()
+    bool QueryStoreResult(const std::string &query,
+                          MYSQL_RES **my_result,
+                          unsigned int *my_errno,
+                          std::string *my_error);
+
+    // Threadpool work of other classes, queued with connection queries.
+    // after() is called in main thread, with error if work was shed
+    typedef void (*queued_work_cb)(void *data);
+    typedef void (*queued_work_after_cb)(void *data, const char *error);
+    void QueueWork(void *data, queued_work_cb work, queued_work_after_cb after);
 
   private:
+    // Session setup recorded by setOptionSync(), setSslSync(),
+    // setCharset[Sync]() and selectDb[Sync](), replayed on keepalive reconnect
+    enum recorded_option_kind {
+        RECORDED_OPTION_INT = 0,
+        RECORDED_OPTION_STRING,
+        RECORDED_OPTION_NULL
+    };
+    struct recorded_option {
+        mysql_option option;
+        recorded_option_kind kind;
+        int int_value;
+        std::string string_value;
+    };
+    struct ssl_setup {
+        bool set;
+        bool have[5];
+        std::string values[5];
+    };
+    std::vector<recorded_option> recorded_options;
+    ssl_setup recorded_ssl;
+    std::string session_charset;
+
+    void RecordOption(const recorded_option &option);
+    // New MYSQL handle starts without recorded setup
+    void ForgetRecordedSetup();
+
+    // TLS sessions cache, shared by all connections in process
+    static std::map<std::string, std::string> ssl_sessions;
+    static pthread_mutex_t ssl_sessions_lock;
+
+    // Key includes TLS setup, so sessions are never resumed under other trust settings
+    static std::string SslSessionKey(const char* hostname,
+                                     const char* user,
+                                     uint32_t port,
+                                     const char* socket,
+                                     const ssl_setup &ssl,
+                                     const std::vector<recorded_option> &options);
+    static void ApplyCachedSslSession(MYSQL *my_conn, const std::string &key);
+    static void CacheSslSession(MYSQL *my_conn, const std::string &key);
+
+    // Last successful connect parameters,
+    // used to open side connections to the same server
+    struct connect_params {
+        std::string hostname;
+        std::string user;
+        std::string password;
+        std::string dbname;
+        std::string socket;
+        uint32_t port;
+        uint64_t flags;
+    };
+    connect_params last_connect;
+
+    void SaveConnectParams(const char* hostname,
+                           const char* user,
+                           const char* password,
+                           const char* dbname,
+                           uint32_t port,
+                           const char* socket,
+                           uint64_t flags);
+
     MYSQL *_conn;
     bool connected;
 
@@ -83,6 +247,253 @@ class MysqlConnection : public node::ObjectWrap {
 
     unsigned int connect_errno;
     const char *connect_error;
+    // Error of the last failed attempt to hosts list, connect_error points to it
+    std::string connect_error_buffer;
+
+    // Queries timeouts, KILL QUERY is sent using side connection
+    MYSQL *kill_conn;
+    pthread_mutex_t kill_conn_lock;
+    // Protects running_query_id, killed_query_id, pending_kills, kill_sending,
+    // close_kill_conn and query_request.timed_out, never held during network calls
+    pthread_mutex_t kill_lock;
+    pthread_cond_t kill_cond;
+    unsigned int pending_kills;
+    // KILL QUERY is being sent, next query waits for it in threadpool
+    bool kill_sending;
+    // Side connection is closed by the last running KILL QUERY thread
+    bool close_kill_conn;
+    uint64_t running_query_id;
+    // Last query KILL QUERY has been sent for while it was running
+    uint64_t killed_query_id;
+    uint64_t last_query_id;
+
+    struct kill_query_request {
+        MysqlConnection *conn;
+        connect_params params;
+        std::vector<recorded_option> options;
+        ssl_setup ssl;
+        uint64_t query_id;
+        unsigned long thread_id;
+    };
+    static MYSQL *ConnectKillConnection(const kill_query_request *kill_req);
+    static void ApplyRecordedSetup(MYSQL *my_conn,
+                                   const std::vector<recorded_option> &options,
+                                   const ssl_setup &ssl);
+
+    // Parallel connect to hosts list, the first successful handshake wins
+    struct connect_candidate {
+        std::string host;
+        uint32_t port;
+    };
+    struct connect_race {
+        pthread_mutex_t lock;
+        pthread_cond_t cond;
+        // Race is freed by the last of waiter and attempt threads
+        unsigned int refs;
+        unsigned int started;
+        unsigned int failed;
+        MYSQL *winner;
+        size_t winner_index;
+        unsigned int my_errno;
+        std::string my_error;
+    };
+    struct connect_attempt {
+        connect_race *race;
+        size_t index;
+        connect_candidate candidate;
+        connect_params params;
+    };
+    static bool ParseConnectCandidate(const std::string &entry,
+                                      uint32_t default_port,
+                                      connect_candidate *candidate);
+    static void ResolveConnectCandidates(const std::vector<connect_candidate> &hosts,
+                                         std::vector<connect_candidate> *candidates);
+    static void ReleaseConnectRace(connect_race *race);
+    static void *ConnectAttemptThread(void *data);
+    bool ConnectFirst(const std::vector<connect_candidate> &hosts,
+                      const char* user,
+                      const char* password,
+                      const char* dbname,
+                      const char* socket,
+                      uint64_t flags);
+    static void *KillQueryThread(void *data);
+    void KillRunningQuery(uint64_t query_id);
+
+    // Queries queue, ring buffer per priority class
+    enum queue_method {
+        QUEUE_METHOD_QUERY = 0,
+        QUEUE_METHOD_QUERY_SEND,
+        QUEUE_METHOD_MULTI_QUERY,
+        QUEUE_METHOD_WORK,
+        QUEUE_METHOD_OP
+    };
+    struct queue_entry {
+        queue_method method;
+        void *request;
+        uint32_t timeout_ms;
+        uint64_t enqueued_at;
+        uint64_t deadline;
+    };
+    struct queue_ring {
+        std::vector<queue_entry> entries;
+        size_t head;
+        size_t count;
+    };
+    queue_ring queue[QUEUE_PRIORITIES_COUNT];
+    // Queued request is in flight
+    bool queue_busy;
+    // ProcessQueue() is on the stack, guards from reentrance from callbacks
+    bool queue_processing;
+    // Async connect is in progress, queue waits for it
+    bool connecting;
+    // Async close is in progress, new work is rejected
+    bool closing;
+
+    // Queue metrics, times in nanoseconds
+    uint64_t queue_enqueued;
+    uint64_t queue_dispatched;
+    uint64_t queue_shed;
+    uint64_t queue_last_wait_time;
+    uint64_t queue_max_wait_time;
+    double queue_wait_time_ewma;
+
+    static void QueuePush(queue_ring *ring, const queue_entry &entry);
+    static queue_entry QueuePop(queue_ring *ring);
+    size_t QueueDepth();
+    void ProcessQueue();
+
+    struct work_request {
+        MysqlConnection *conn;
+        void *data;
+        queued_work_cb work;
+        queued_work_after_cb after;
+    };
+    void StartWork(work_request *work_req);
+    static void EIO_After_QueuedWork(uv_work_t *req);
+    static void EIO_QueuedWork(uv_work_t *req);
+    void ShedQueued(const queue_entry &entry, const char *error);
+
+    // Single-flight coalescing of identical read queries,
+    // followers are attached to in-flight query_request with the same SQL
+    struct query_request;
+    bool coalesce_reads;
+    uint64_t coalesced_count;
+    std::map<std::string, query_request *> inflight_reads;
+
+    bool JoinInflightRead(const char *query,
+                          size_t query_len,
+                          Handle<Value> callback,
+                          bool *is_read);
+    void RegisterInflightRead(query_request *query_req);
+    void ForgetInflightRead(query_request *query_req);
+
+    // Queries timings, in nanoseconds
+    uint64_t last_query_time;
+    double query_time_ewma;
+
+    void UpdateQueryTime(uint64_t query_time);
+
+
+    // Keepalive: idle connection is pinged in threadpool every
+    // keepalive_interval ms, dead one is reconnected and session is replayed
+    uv_timer_t *keepalive_timer;
+    uint32_t keepalive_interval;
+    bool keepalive_running;
+    // Time of last request, in nanoseconds
+    uint64_t last_activity;
+    // Number of alive unbuffered results, see AttachResult()
+    uint32_t attached_results;
+    // Number of querySend() results not read yet, they are read
+    // in main thread without query_lock held while waiting
+    uint32_t pending_query_sends;
+
+    struct keepalive_statement {
+        MysqlStatement *stmt;
+        std::string query;
+        MYSQL_STMT *new_stmt;
+    };
+    struct keepalive_request {
+        MysqlConnection *conn;
+
+        bool skipped;
+        bool failed;
+
+        // Connection opened in threadpool instead of dead one,
+        // it replaces connection handle in main thread
+        MYSQL *new_conn;
+
+        connect_params params;
+        std::vector<recorded_option> options;
+        ssl_setup ssl;
+        std::string charset;
+        std::vector<keepalive_statement> statements;
+    };
+    static MYSQL_BINDINGS_TIMER_CB(EV_KeepAlive);
+    static void EV_KeepAlive_OnTimerClose(uv_handle_t *handle);
+    static void EIO_After_KeepAlive(uv_work_t *req);
+    static void EIO_KeepAlive(uv_work_t *req);
+    static MYSQL *ReplayConnect(keepalive_request *keepalive_req);
+    bool CanReplaceHandle();
+    void ReplaceHandle(keepalive_request *keepalive_req);
+    void StopKeepAlive();
+
+    // Statements created by initStatementSync(), they are
+    // invalidated when server session is reset
+    std::set<MysqlStatement *> statements;
+    void InvalidateStatements();
+
+    // Async variants of *Sync connection methods share one request type
+    // and one threadpool worker, operation is selected by connection_op
+    enum connection_op {
+        CONN_OP_AUTO_COMMIT = 0,
+        CONN_OP_CHANGE_USER,
+        CONN_OP_COMMIT,
+        CONN_OP_GET_WARNINGS,
+        CONN_OP_PING,
+        CONN_OP_RESET_SESSION,
+        CONN_OP_ROLLBACK,
+        CONN_OP_SELECT_DB,
+        CONN_OP_SET_CHARSET,
+        CONN_OP_STAT,
+        CONN_OP_STORE_RESULT
+    };
+    struct op_warning {
+        unsigned int my_errno;
+        std::string reason;
+    };
+    struct op_request {
+        bool ok;
+        bool connection_closed;
+
+        NanCallback *nan_callback;
+        MysqlConnection *conn;
+
+        connection_op op;
+
+        // Arguments
+        bool flag;
+        std::string user;
+        std::string password;
+        std::string dbname;
+        bool have_password;
+        bool have_dbname;
+        std::string charset;
+
+        // Results
+        std::string stat;
+        std::vector<op_warning> warnings;
+        MYSQL_RES *my_result;
+        uint32_t field_count;
+
+        unsigned int my_errno;
+        std::string my_error;
+    };
+    static op_request *NewOpRequest(MysqlConnection *conn, connection_op op, Handle<Value> callback);
+    void QueueOp(op_request *op_req);
+    void StartOp(op_request *op_req);
+    static const char *OpName(connection_op op);
+    static void EIO_After_Op(uv_work_t *req);
+    static void EIO_Op(uv_work_t *req);
 
     MysqlConnection();
 
@@ -98,14 +509,25 @@ class MysqlConnection : public node::ObjectWrap {
 
     static NAN_GETTER(ConnectErrorGetter);
 
+    static NAN_GETTER(LastQueryTimeGetter);
+
+    static NAN_GETTER(QueryTimeEwmaGetter);
+
     // Methods
 
     static NAN_METHOD(AffectedRowsSync);
 
+    static NAN_METHOD(AutoCommit);
+
     static NAN_METHOD(AutoCommitSync);
 
+    static NAN_METHOD(ChangeUser);
+
     static NAN_METHOD(ChangeUserSync);
 
+
+    static NAN_METHOD(Commit);
+
     static NAN_METHOD(CommitSync);
 
     struct connect_request {
@@ -121,6 +543,9 @@ class MysqlConnection : public node::ObjectWrap {
         uint32_t port;
         String::Utf8Value *socket;
         uint64_t flags;
+
+        // Not empty if hostname or hosts list is given
+        std::vector<connect_candidate> hosts;
     };
     static void EIO_After_Connect(uv_work_t *req);
     static void EIO_Connect(uv_work_t *req);
@@ -130,12 +555,22 @@ class MysqlConnection : public node::ObjectWrap {
 
     static NAN_METHOD(ConnectedSync);
 
+    struct close_request {
+        MysqlConnection *conn;
+        NanCallback *nan_callback;
+    };
+    static void EIO_After_Close(uv_work_t *req);
+    static void EIO_Close(uv_work_t *req);
+    static NAN_METHOD(Close);
+
     static NAN_METHOD(CloseSync);
 
     static NAN_METHOD(DebugSync);
 
     static NAN_METHOD(DumpDebugInfoSync);
 
+    static NAN_METHOD(Enqueue);
+
     static NAN_METHOD(ErrnoSync);
 
     static NAN_METHOD(ErrorSync);
@@ -154,6 +589,8 @@ class MysqlConnection : public node::ObjectWrap {
 
     static NAN_METHOD(GetInfoStringSync);
 
+    static NAN_METHOD(GetWarnings);
+
     static NAN_METHOD(GetWarningsSync);
 
     static NAN_METHOD(InitSync);
@@ -162,12 +599,92 @@ class MysqlConnection : public node::ObjectWrap {
 
     static NAN_METHOD(LastInsertIdSync);
 
+    struct load_waiter {
+        size_t key_index;
+        NanCallback *nan_callback;
+    };
+    struct load_row {
+        MYSQL_ROW row;
+        std::vector<unsigned long> lengths;
+    };
+    struct load_batch_request {
+        bool ok;
+        bool connection_closed;
+
+        MysqlConnection *conn;
+        std::string batch_key;
+        std::string table;
+        std::string key_column;
+
+        // Unique keys and callbacks waiting for them
+        std::vector<std::string> keys;
+        std::map<std::string, size_t> key_indexes;
+        std::vector<load_waiter> waiters;
+
+        uv_timer_t *timer;
+
+        std::string query;
+
+        MYSQL_RES *my_result;
+        std::vector<std::vector<load_row> > rows_by_key;
+        // Rows server matched to some key, which text differs from all keys
+        size_t unmatched_rows;
+
+        unsigned int my_errno;
+        const char *my_error;
+    };
+    std::map<std::string, load_batch_request *> load_batches;
+    static MYSQL_BINDINGS_TIMER_CB(EV_LoadBatchTimeout);
+    static void EV_LoadBatchTimeout_OnTimerClose(uv_handle_t *handle);
+    void FlushLoadBatch(load_batch_request *batch);
+    // Batch query runs through connection queue, see QueueWork()
+    static void LoadByKeysDone(void *data, const char *error);
+    static void LoadByKeysWork(void *data);
+    static NAN_METHOD(LoadByKey);
+
     static NAN_METHOD(MultiMoreResultsSync);
 
     static NAN_METHOD(MultiNextResultSync);
 
     static NAN_METHOD(MultiRealQuerySync);
 
+    struct multi_query_result {
+        bool have_result_set;
+
+        MYSQL_RES *my_result;
+        uint32_t field_count;
+        my_ulonglong affected_rows;
+        my_ulonglong insert_id;
+    };
+    struct multi_query_request {
+        bool ok;
+        bool connection_closed;
+
+        NanCallback *nan_callback;
+        MysqlConnection *conn;
+
+        char *query;
+        unsigned int query_len;
+
+        std::vector<multi_query_result> results;
+
+        unsigned int my_errno;
+        // Copied, MYSQLCONN_DISABLE_MQ overwrites mysql_error() buffer
+        std::string my_error;
+
+        bool queued;
+    };
+    static multi_query_request *NewMultiQueryRequest(MysqlConnection *conn,
+                                                     const char *query,
+                                                     size_t query_len,
+                                                     Handle<Value> callback);
+    void StartMultiQuery(multi_query_request *mquery_req);
+    static void EIO_After_MultiQuery(uv_work_t *req);
+    static void EIO_MultiQuery(uv_work_t *req);
+    static NAN_METHOD(MultiQuery);
+
+    static NAN_METHOD(Ping);
+
     static NAN_METHOD(PingSync);
     struct local_infile_data {
       char * buffer;
@@ -194,8 +711,37 @@ class MysqlConnection : public node::ObjectWrap {
         unsigned int my_errno;
         const char *my_error;
 
+        uint64_t query_time;
+
+        uint64_t query_id;
+        bool timed_out;
+        // Query was killed or skipped due to timeout
+        bool interrupted;
+        uv_timer_t *timeout_timer;
+
+        bool queued;
+
+        // Coalesced requests with the same SQL
+        bool inflight_registered;
+        std::vector<NanCallback *> followers;
+
         local_infile_data * infile_data;
     };
+    struct query_options {
+        uint32_t timeout_ms;
+        uint32_t deadline_ms;
+        uint32_t priority;
+    };
+    static const char *GetQueryOptions(Local<Object> options, query_options *qo);
+    static query_request *NewQueryRequest(MysqlConnection *conn,
+                                          const char *query,
+                                          size_t query_len,
+                                          Handle<Value> local_infile_buffer,
+                                          Handle<Value> callback);
+    void StartQuery(query_request *query_req, uint32_t timeout_ms);
+    void StartQuerySend(query_request *query_req);
+    static MYSQL_BINDINGS_TIMER_CB(EV_QueryTimeout);
+    static void EV_QueryTimeout_OnTimerClose(uv_handle_t *handle);
     static int CustomLocalInfileInit(void ** ptr,
                                      const char * filename,
                                      void * userdata);
@@ -217,28 +763,50 @@ class MysqlConnection : public node::ObjectWrap {
 
     static void EV_After_QuerySend(uv_poll_t* handle, int status, int events);
     static void EV_After_QuerySend_OnWatchHandleClose(uv_handle_t* handle);
+    static MYSQL_BINDINGS_TIMER_CB(EV_QuerySend_OnRetryTimer);
+    static void EV_QuerySend_OnRetryTimerClose(uv_handle_t *handle);
     static NAN_METHOD(QuerySend);
 
     static NAN_METHOD(QuerySync);
 
+    static NAN_METHOD(QueueStatsSync);
+
     static NAN_METHOD(RealConnectSync);
 
     static NAN_METHOD(RealQuerySync);
 
+    static NAN_METHOD(ResetSession);
+
+    static NAN_METHOD(Rollback);
+
     static NAN_METHOD(RollbackSync);
 
+    static NAN_METHOD(SelectDb);
+
     static NAN_METHOD(SelectDbSync);
 
+    static NAN_METHOD(SetCharset);
+
     static NAN_METHOD(SetCharsetSync);
 
+    static NAN_METHOD(SetQueryCoalescingSync);
+
+    static NAN_METHOD(SetKeepAliveSync);
+
     static NAN_METHOD(SetOptionSync);
 
     static NAN_METHOD(SetSslSync);
 
     static NAN_METHOD(SqlStateSync);
 
+    static NAN_METHOD(SslSessionReusedSync);
+
+    static NAN_METHOD(Stat);
+
     static NAN_METHOD(StatSync);
 
+    static NAN_METHOD(StoreResult);
+
     static NAN_METHOD(StoreResultSync);
 
     static NAN_METHOD(ThreadIdSync);
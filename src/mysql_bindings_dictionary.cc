@@ -0,0 +1,104 @@
+/*!
+ * Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+ * See contributors list in README
+ *
+ * See license text in LICENSE file
+ */
+
+/*!
+ * Include headers
+ */
+#include <cstring>
+
+#include "./mysql_bindings_dictionary.h"
+#include "./mysql_bindings_result.h"
+
+MysqlDictionary::MysqlDictionary(MYSQL_FIELD *fields, uint32_t num_fields) {
+    columns.resize(num_fields);
+
+    for (uint32_t i = 0; i < num_fields; i++) {
+        columns[i].overflowed = false;
+
+        if (fields[i].type == MYSQL_TYPE_SET || (fields[i].flags & SET_FLAG)) {
+            columns[i].kind = DICTIONARY_SET;
+        } else if (fields[i].flags & BINARY_FLAG) {
+            // Buffers are mutable, they can't be shared between rows
+            columns[i].kind = DICTIONARY_NONE;
+        } else if (fields[i].type == MYSQL_TYPE_ENUM || (fields[i].flags & ENUM_FLAG)) {
+            columns[i].kind = DICTIONARY_ENUM;
+        } else if (fields[i].type == MYSQL_TYPE_STRING || fields[i].type == MYSQL_TYPE_VAR_STRING ||
+                   fields[i].type == MYSQL_TYPE_VARCHAR) {
+            columns[i].kind = DICTIONARY_STRING;
+        } else {
+            columns[i].kind = DICTIONARY_NONE;
+        }
+    }
+}
+
+MysqlDictionary::~MysqlDictionary() {
+    for (size_t i = 0; i < values.size(); i++) {
+        NanDispose(*values[i]);
+        delete values[i];
+    }
+}
+
+/*!
+ * Object.freeze(), shared SET arrays must not be changed through one row
+ */
+Local<Value> MysqlDictionary::Freeze(Local<Object> js_object) {
+    Local<Object> globalObj = Context::GetCurrent()->Global();
+    Local<Function> freeze = Local<Function>::Cast(globalObj->Get(V8STR("Object"))->ToObject()
+                                                            ->Get(V8STR("freeze")));
+
+    Local<Value> argv[1] = { js_object };
+
+    return freeze->Call(globalObj, 1, argv);
+}
+
+void MysqlDictionary::ResetOverflow() {
+    for (size_t i = 0; i < columns.size(); i++) {
+        columns[i].overflowed = false;
+    }
+}
+
+Local<Value> MysqlDictionary::Get(uint32_t column, const char *value, unsigned long length,
+                                  bool shared) {
+    struct column &col = columns[column];
+
+    // Shared SET arrays are frozen, so they are opt-in
+    if (col.kind == DICTIONARY_NONE || col.overflowed ||
+        ((col.kind == DICTIONARY_STRING || col.kind == DICTIONARY_SET) && !shared)) {
+        return Local<Value>();
+    }
+
+    std::string key(value, length);
+
+    std::map<std::string, size_t>::const_iterator it = col.index.find(key);
+    if (it != col.index.end()) {
+        return NanPersistentToLocal(*values[it->second]);
+    }
+
+    if (col.index.size() >= MYSQLDICT_MAX_VALUES ||
+        (col.kind == DICTIONARY_STRING && length > MYSQLDICT_MAX_VALUE_LENGTH)) {
+        col.overflowed = true;
+        return Local<Value>();
+    }
+
+    Local<Value> js_value;
+    if (col.kind == DICTIONARY_SET) {
+        js_value = Freeze(MysqlResult::GetSetValue(value, length));
+    } else if (memchr(value, '\0', length)) {
+        // Internalized string is created from zero terminated one
+        return Local<Value>();
+    } else {
+        js_value = NanSymbol(key.c_str());
+    }
+
+    Persistent<Value> *persistent = new Persistent<Value>();
+    NanAssignPersistent(Value, *persistent, js_value);
+
+    col.index[key] = values.size();
+    values.push_back(persistent);
+
+    return js_value;
+}
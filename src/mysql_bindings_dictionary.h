@@ -0,0 +1,70 @@
+/*!
+ * Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+ * See contributors list in README
+ *
+ * See license text in LICENSE file
+ */
+
+#ifndef SRC_MYSQL_BINDINGS_DICTIONARY_H_
+#define SRC_MYSQL_BINDINGS_DICTIONARY_H_
+
+#include <mysql.h>
+
+#include <v8.h>
+#include <node.h>
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "./mysql_bindings.h"
+
+// Column stops being dictionary encoded when it has more distinct values
+#define MYSQLDICT_MAX_VALUES 1024
+
+// Longer values of low-cardinality candidates are not cached
+#define MYSQLDICT_MAX_VALUE_LENGTH 64
+
+/*!
+ * Per-result dictionary of decoded column values.
+ *
+ * Each distinct ENUM value is materialized once as internalized string,
+ * then reused for every row. When requested, each distinct SET value
+ * is materialized as frozen array and text string columns are encoded
+ * the same way, while their distinct values count stays small
+ */
+class MysqlDictionary {
+  public:
+    MysqlDictionary(MYSQL_FIELD *fields, uint32_t num_fields);
+
+    ~MysqlDictionary();
+
+    // Returns empty handle when column value is not dictionary encoded,
+    // SET and string columns are encoded only with shared option
+    Local<Value> Get(uint32_t column, const char *value, unsigned long length, bool shared);
+
+    // Overflow is decided per fetch, cached values are kept
+    void ResetOverflow();
+
+  private:
+    enum column_kind {
+        DICTIONARY_NONE,
+        DICTIONARY_ENUM,
+        DICTIONARY_SET,
+        DICTIONARY_STRING
+    };
+    struct column {
+        column_kind kind;
+        bool overflowed;
+        // Index in values
+        std::map<std::string, size_t> index;
+    };
+    std::vector<column> columns;
+    std::vector<Persistent<Value> *> values;
+
+    static Local<Value> Freeze(Local<Object> js_object);
+};
+
+#endif  // SRC_MYSQL_BINDINGS_DICTIONARY_H_
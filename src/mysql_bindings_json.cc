@@ -0,0 +1,973 @@
+/*!
+ * Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+ * See contributors list in README
+ *
+ * See license text in LICENSE file
+ */
+
+/*!
+ * Include headers
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "./mysql_bindings_json.h"
+
+bool MysqlJsonTape::IsJsonField(const MYSQL_FIELD &field) {
+#ifdef MYSQL_BINDINGS_HAS_JSON_TYPE
+    return field.type == MYSQL_TYPE_JSON;
+#else
+    return false;
+#endif
+}
+
+/*!
+ * Parses whole document, returns false and sets error on invalid JSON
+ */
+bool MysqlJsonTape::Parse(const char *json, size_t length) {
+    nodes.clear();
+    strings.clear();
+    error.clear();
+
+    start = pos = json;
+    end = json + length;
+
+    SkipWhitespace();
+    if (!ParseValue(0)) {
+        return false;
+    }
+
+    SkipWhitespace();
+    if (pos != end) {
+        return Fail("Unexpected data after JSON value");
+    }
+
+    return true;
+}
+
+void MysqlJsonTape::SkipWhitespace() {
+    while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r')) {
+        pos++;
+    }
+}
+
+bool MysqlJsonTape::Fail(const char *message) {
+    char position[32];
+    snprintf(position, sizeof(position), " at position %lu", static_cast<unsigned long>(pos - start));
+
+    error = message;
+    error += position;
+
+    return false;
+}
+
+bool MysqlJsonTape::ParseValue(unsigned int depth) {
+    if (depth > MYSQLJSON_MAX_DEPTH) {
+        return Fail("JSON nesting is too deep");
+    }
+
+    if (pos == end) {
+        return Fail("Unexpected end of JSON");
+    }
+
+    node value = {JSON_NULL, 0, 0, 0, 0};
+    size_t index = nodes.size();
+
+    switch (*pos) {
+        case '{':
+        case '[': {
+            bool is_object = *pos == '{';
+            char close = is_object ? '}' : ']';
+
+            value.type = is_object ? JSON_OBJECT : JSON_ARRAY;
+            nodes.push_back(value);
+
+            pos++;
+            SkipWhitespace();
+
+            uint32_t count = 0;
+            if (pos < end && *pos == close) {
+                pos++;
+            } else {
+                for (;;) {
+                    if (is_object) {
+                        node key = {JSON_STRING, 0, 0, 0, 0};
+                        if (pos == end || *pos != '"') {
+                            return Fail("Expected object key");
+                        }
+                        if (!ParseString(&key.offset, &key.length)) {
+                            return false;
+                        }
+                        nodes.push_back(key);
+
+                        SkipWhitespace();
+                        if (pos == end || *pos != ':') {
+                            return Fail("Expected ':'");
+                        }
+                        pos++;
+                        SkipWhitespace();
+                    }
+
+                    if (!ParseValue(depth + 1)) {
+                        return false;
+                    }
+                    count++;
+
+                    SkipWhitespace();
+                    if (pos < end && *pos == ',') {
+                        pos++;
+                        SkipWhitespace();
+                    } else if (pos < end && *pos == close) {
+                        pos++;
+                        break;
+                    } else {
+                        return Fail(is_object ? "Expected ',' or '}'" : "Expected ',' or ']'");
+                    }
+                }
+            }
+
+            nodes[index].count = count;
+            return true;
+        }
+        case '"':
+            value.type = JSON_STRING;
+            if (!ParseString(&value.offset, &value.length)) {
+                return false;
+            }
+            break;
+        case 't':
+            value.type = JSON_TRUE;
+            if (!ParseLiteral("true", 4)) {
+                return false;
+            }
+            break;
+        case 'f':
+            value.type = JSON_FALSE;
+            if (!ParseLiteral("false", 5)) {
+                return false;
+            }
+            break;
+        case 'n':
+            value.type = JSON_NULL;
+            if (!ParseLiteral("null", 4)) {
+                return false;
+            }
+            break;
+        default:
+            value.type = JSON_NUMBER;
+            if (!ParseNumber(&value.number)) {
+                return false;
+            }
+    }
+
+    nodes.push_back(value);
+    return true;
+}
+
+bool MysqlJsonTape::ParseLiteral(const char *literal, size_t literal_length) {
+    if (static_cast<size_t>(end - pos) < literal_length || memcmp(pos, literal, literal_length) != 0) {
+        return Fail("Unexpected token");
+    }
+
+    pos += literal_length;
+    return true;
+}
+
+bool MysqlJsonTape::ParseHex4(uint32_t *code) {
+    if (end - pos < 4) {
+        return Fail("Invalid unicode escape");
+    }
+
+    *code = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = *pos++;
+        *code <<= 4;
+        if (c >= '0' && c <= '9') {
+            *code |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            *code |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            *code |= c - 'A' + 10;
+        } else {
+            return Fail("Invalid unicode escape");
+        }
+    }
+
+    return true;
+}
+
+/*!
+ * Unescapes string to strings buffer, pos is at opening quote
+ */
+bool MysqlJsonTape::ParseString(size_t *offset, size_t *length) {
+    pos++;
+    *offset = strings.size();
+
+    for (;;) {
+        // Copy unescaped runs at once
+        const char *run = pos;
+        while (pos < end && *pos != '"' && *pos != '\\' && static_cast<unsigned char>(*pos) >= 0x20) {
+            pos++;
+        }
+        strings.append(run, pos - run);
+
+        if (pos == end) {
+            return Fail("Unterminated string");
+        }
+
+        if (*pos == '"') {
+            pos++;
+            break;
+        }
+
+        if (*pos != '\\') {
+            return Fail("Control character in string");
+        }
+
+        pos++;
+        if (pos == end) {
+            return Fail("Unterminated string");
+        }
+
+        char escape = *pos++;
+        switch (escape) {
+            case '"':  strings += '"';  break;
+            case '\\': strings += '\\'; break;
+            case '/':  strings += '/';  break;
+            case 'b':  strings += '\b'; break;
+            case 'f':  strings += '\f'; break;
+            case 'n':  strings += '\n'; break;
+            case 'r':  strings += '\r'; break;
+            case 't':  strings += '\t'; break;
+            case 'u': {
+                uint32_t code;
+                if (!ParseHex4(&code)) {
+                    return false;
+                }
+
+                // Surrogate pair
+                if (code >= 0xD800 && code <= 0xDBFF) {
+                    uint32_t low;
+                    if (end - pos < 6 || pos[0] != '\\' || pos[1] != 'u') {
+                        return Fail("Invalid unicode surrogate pair");
+                    }
+                    pos += 2;
+                    if (!ParseHex4(&low)) {
+                        return false;
+                    }
+                    if (low < 0xDC00 || low > 0xDFFF) {
+                        return Fail("Invalid unicode surrogate pair");
+                    }
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                } else if (code >= 0xDC00 && code <= 0xDFFF) {
+                    return Fail("Invalid unicode surrogate pair");
+                }
+
+                // Encode to UTF-8
+                if (code < 0x80) {
+                    strings += static_cast<char>(code);
+                } else if (code < 0x800) {
+                    strings += static_cast<char>(0xC0 | (code >> 6));
+                    strings += static_cast<char>(0x80 | (code & 0x3F));
+                } else if (code < 0x10000) {
+                    strings += static_cast<char>(0xE0 | (code >> 12));
+                    strings += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                    strings += static_cast<char>(0x80 | (code & 0x3F));
+                } else {
+                    strings += static_cast<char>(0xF0 | (code >> 18));
+                    strings += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                    strings += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                    strings += static_cast<char>(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default:
+                return Fail("Invalid escape in string");
+        }
+    }
+
+    *length = strings.size() - *offset;
+    return true;
+}
+
+/*!
+ * Validates number grammar, then converts it with strtod()
+ */
+bool MysqlJsonTape::ParseNumber(double *number) {
+    const char *number_start = pos;
+
+    if (pos < end && *pos == '-') {
+        pos++;
+    }
+
+    if (pos < end && *pos == '0') {
+        pos++;
+    } else if (pos < end && *pos >= '1' && *pos <= '9') {
+        while (pos < end && *pos >= '0' && *pos <= '9') {
+            pos++;
+        }
+    } else {
+        return Fail("Unexpected token");
+    }
+
+    if (pos < end && *pos == '.') {
+        pos++;
+        if (pos == end || *pos < '0' || *pos > '9') {
+            return Fail("Invalid number");
+        }
+        while (pos < end && *pos >= '0' && *pos <= '9') {
+            pos++;
+        }
+    }
+
+    if (pos < end && (*pos == 'e' || *pos == 'E')) {
+        pos++;
+        if (pos < end && (*pos == '+' || *pos == '-')) {
+            pos++;
+        }
+        if (pos == end || *pos < '0' || *pos > '9') {
+            return Fail("Invalid number");
+        }
+        while (pos < end && *pos >= '0' && *pos <= '9') {
+            pos++;
+        }
+    }
+
+    // Value may be not zero terminated
+    std::string number_string(number_start, pos - number_start);
+    *number = strtod(number_string.c_str(), NULL);
+
+    return true;
+}
+
+/*!
+ * Builds JS value from the tape, main thread only
+ */
+Local<Value> MysqlJsonTape::ToValue() const {
+    NanScope();
+
+    size_t index = 0;
+
+    if (nodes.empty()) {
+        return scope.Close(NanNewLocal(Null()));
+    }
+
+    return scope.Close(NodeToValue(&index));
+}
+
+Local<Value> MysqlJsonTape::NodeToValue(size_t *index) const {
+    const node &value = nodes[(*index)++];
+    uint32_t i = 0;
+
+    switch (value.type) {
+        case JSON_NULL:
+            return NanNewLocal(Null());
+        case JSON_TRUE:
+            return NanNewLocal(True());
+        case JSON_FALSE:
+            return NanNewLocal(False());
+        case JSON_NUMBER:
+            return Number::New(value.number);
+        case JSON_STRING:
+            return V8STR2(strings.data() + value.offset, value.length);
+        case JSON_ARRAY: {
+            Local<Array> js_array = Array::New(value.count);
+            for (i = 0; i < value.count; i++) {
+                js_array->Set(Integer::NewFromUnsigned(i), NodeToValue(index));
+            }
+            return js_array;
+        }
+        case JSON_OBJECT: {
+            Local<Object> js_object = Object::New();
+            for (i = 0; i < value.count; i++) {
+                const node &key = nodes[(*index)++];
+                Local<String> js_key = V8STR2(strings.data() + key.offset, key.length);
+                // Own property as JSON.parse() defines, "__proto__" key doesn't change prototype
+                js_object->ForceSet(js_key, NodeToValue(index));
+            }
+            return js_object;
+        }
+    }
+
+    return NanNewLocal(Null());
+}
+
+MysqlJsonWriter::MysqlJsonWriter(MYSQL_FIELD *my_fields, uint32_t my_num_fields,
+                                 bool as_array, bool nest_tables, bool my_parse_json,
+                                 MysqlBindingsDecimalMode my_decimal):
+    fields(my_fields),
+    num_fields(my_num_fields),
+    parse_json(my_parse_json),
+    decimal(my_decimal),
+    row_count(0),
+    data(NULL),
+    length(0),
+    capacity(0) {
+    uint32_t i = 0, j = 0;
+
+    if (as_array) {
+        for (i = 0; i < num_fields; i++) {
+            order.push_back(i);
+            before.push_back(i == 0 ? "[" : ",");
+        }
+        row_end = num_fields ? "]" : "[]";
+    } else if (nest_tables) {
+        // Tables in order of first column
+        std::vector<std::string> tables;
+        for (i = 0; i < num_fields; i++) {
+            std::string table(fields[i].table ? fields[i].table : "");
+            for (j = 0; j < tables.size() && tables[j] != table; j++) {}
+            if (j == tables.size()) {
+                tables.push_back(table);
+            }
+        }
+
+        for (j = 0; j < tables.size(); j++) {
+            bool first_in_table = true;
+            for (i = 0; i < num_fields; i++) {
+                if (tables[j] != (fields[i].table ? fields[i].table : "")) {
+                    continue;
+                }
+
+                std::string text;
+                if (first_in_table) {
+                    text = j == 0 ? "{" : "},";
+                    text += QuoteString(tables[j].c_str()) + ":{";
+                    first_in_table = false;
+                } else {
+                    text = ",";
+                }
+                text += QuoteString(fields[i].name ? fields[i].name : "") + ":";
+
+                order.push_back(i);
+                before.push_back(text);
+            }
+        }
+        row_end = num_fields ? "}}" : "{}";
+    } else {
+        for (i = 0; i < num_fields; i++) {
+            order.push_back(i);
+            before.push_back((i == 0 ? "{" : ",") + QuoteString(fields[i].name ? fields[i].name : "") + ":");
+        }
+        row_end = num_fields ? "}" : "{}";
+    }
+
+    Append("[", 1);
+}
+
+MysqlJsonWriter::~MysqlJsonWriter() {
+    free(data);
+}
+
+void MysqlJsonWriter::FreeBuffer(char *data, void *hint) {
+    free(data);
+}
+
+char *MysqlJsonWriter::Release(size_t *released_length) {
+    Append("]", 1);
+
+    char *released = data;
+    *released_length = length;
+
+    data = NULL;
+    length = capacity = 0;
+
+    return released;
+}
+
+void MysqlJsonWriter::Reserve(size_t size) {
+    if (length + size <= capacity) {
+        return;
+    }
+
+    size_t new_capacity = capacity ? capacity * 2 : 4096;
+    while (new_capacity < length + size) {
+        new_capacity *= 2;
+    }
+
+    data = static_cast<char *>(realloc(data, new_capacity));
+    capacity = new_capacity;
+}
+
+void MysqlJsonWriter::Append(const char *text, size_t text_length) {
+    Reserve(text_length);
+    memcpy(data + length, text, text_length);
+    length += text_length;
+}
+
+void MysqlJsonWriter::AppendRow(char **values, unsigned long *lengths, bool binary_protocol) {
+    if (row_count++) {
+        Append(",", 1);
+    }
+
+    for (size_t i = 0; i < order.size(); i++) {
+        uint32_t column = order[i];
+
+        Append(before[i]);
+
+        if (!values[column]) {
+            Append("null", 4);
+        } else if (parse_json && MysqlJsonTape::IsJsonField(fields[column])) {
+            // Server sends valid JSON documents
+            Append(values[column], lengths[column]);
+        } else if (binary_protocol) {
+            AppendBinaryValue(fields[column], values[column], lengths[column]);
+        } else {
+            AppendTextValue(fields[column], values[column], lengths[column]);
+        }
+    }
+
+    Append(row_end);
+}
+
+/*!
+ * Length of value prefix without characters to escape,
+ * checks 8 bytes at once for '"', '\\', control and non-ASCII characters
+ */
+size_t MysqlJsonWriter::PlainRunLength(const char *value, size_t value_length) {
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highs = 0x8080808080808080ULL;
+    size_t i = 0;
+
+    for (; i + 8 <= value_length; i += 8) {
+        uint64_t word, quote, backslash;
+        memcpy(&word, value + i, 8);
+
+        quote = word ^ (ones * '"');
+        backslash = word ^ (ones * '\\');
+
+        if ((word & highs) |
+            ((word - ones * 0x20) & ~word & highs) |
+            ((quote - ones) & ~quote & highs) |
+            ((backslash - ones) & ~backslash & highs)) {
+            break;
+        }
+    }
+
+    for (; i < value_length; i++) {
+        unsigned char c = value[i];
+        if (c < 0x20 || c >= 0x80 || c == '"' || c == '\\') {
+            break;
+        }
+    }
+
+    return i;
+}
+
+size_t MysqlJsonWriter::EscapeChar(unsigned char c, char *escaped) {
+    escaped[0] = '\\';
+
+    switch (c) {
+        case '"':  escaped[1] = '"';  return 2;
+        case '\\': escaped[1] = '\\'; return 2;
+        case '\b': escaped[1] = 'b';  return 2;
+        case '\f': escaped[1] = 'f';  return 2;
+        case '\n': escaped[1] = 'n';  return 2;
+        case '\r': escaped[1] = 'r';  return 2;
+        case '\t': escaped[1] = 't';  return 2;
+        default:
+            snprintf(escaped + 1, 6, "u%04x", c);
+            return 6;
+    }
+}
+
+/*!
+ * Length of valid UTF-8 sequence at value start, 0 for invalid one
+ */
+size_t MysqlJsonWriter::Utf8SequenceLength(const char *value, size_t value_length) {
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(value);
+    unsigned char low = 0x80, high = 0xBF;
+    size_t sequence_length, i;
+
+    if (bytes[0] >= 0xC2 && bytes[0] <= 0xDF) {
+        sequence_length = 2;
+    } else if (bytes[0] >= 0xE0 && bytes[0] <= 0xEF) {
+        sequence_length = 3;
+        if (bytes[0] == 0xE0) {
+            low = 0xA0;
+        } else if (bytes[0] == 0xED) {
+            // Surrogates are not valid in UTF-8
+            high = 0x9F;
+        }
+    } else if (bytes[0] >= 0xF0 && bytes[0] <= 0xF4) {
+        sequence_length = 4;
+        if (bytes[0] == 0xF0) {
+            low = 0x90;
+        } else if (bytes[0] == 0xF4) {
+            high = 0x8F;
+        }
+    } else {
+        return 0;
+    }
+
+    if (sequence_length > value_length || bytes[1] < low || bytes[1] > high) {
+        return 0;
+    }
+    for (i = 2; i < sequence_length; i++) {
+        if (bytes[i] < 0x80 || bytes[i] > 0xBF) {
+            return 0;
+        }
+    }
+
+    return sequence_length;
+}
+
+/*!
+ * Writes the character at value start to escaped, returns its length in value.
+ * Valid UTF-8 sequences are copied, invalid bytes are replaced with U+FFFD
+ * as V8 does when it creates strings for fetchAll() rows
+ */
+size_t MysqlJsonWriter::EscapeNext(const char *value, size_t value_length,
+                                   char *escaped, size_t *escaped_length) {
+    unsigned char c = value[0];
+
+    if (c < 0x80) {
+        *escaped_length = EscapeChar(c, escaped);
+        return 1;
+    }
+
+    size_t sequence_length = Utf8SequenceLength(value, value_length);
+    if (!sequence_length) {
+        memcpy(escaped, "\\ufffd", 6);
+        *escaped_length = 6;
+        return 1;
+    }
+
+    memcpy(escaped, value, sequence_length);
+    *escaped_length = sequence_length;
+    return sequence_length;
+}
+
+std::string MysqlJsonWriter::QuoteString(const char *value) {
+    size_t value_length = strlen(value), i = 0, run = 0, escaped_length;
+    std::string quoted("\"");
+    char escaped[8];
+
+    while (i < value_length) {
+        run = PlainRunLength(value + i, value_length - i);
+        quoted.append(value + i, run);
+        i += run;
+
+        if (i < value_length) {
+            i += EscapeNext(value + i, value_length - i, escaped, &escaped_length);
+            quoted.append(escaped, escaped_length);
+        }
+    }
+
+    quoted += '"';
+    return quoted;
+}
+
+void MysqlJsonWriter::AppendString(const char *value, size_t value_length) {
+    size_t i = 0, run = 0, escaped_length;
+    char escaped[8];
+
+    // Plain text is the common case, so reserve for it
+    Reserve(value_length + 2);
+    Append("\"", 1);
+
+    while (i < value_length) {
+        run = PlainRunLength(value + i, value_length - i);
+        Append(value + i, run);
+        i += run;
+
+        if (i < value_length) {
+            i += EscapeNext(value + i, value_length - i, escaped, &escaped_length);
+            Append(escaped, escaped_length);
+        }
+    }
+
+    Append("\"", 1);
+}
+
+/*!
+ * Same as Buffer#toJSON() output
+ */
+void MysqlJsonWriter::AppendBuffer(const char *value, size_t value_length) {
+    char byte[8];
+
+    Append("{\"type\":\"Buffer\",\"data\":[", 25);
+    for (size_t i = 0; i < value_length; i++) {
+        int byte_length = snprintf(byte, sizeof(byte), i ? ",%u" : "%u",
+                                   static_cast<unsigned char>(value[i]));
+        Append(byte, byte_length);
+    }
+    Append("]}", 2);
+}
+
+/*!
+ * SET values are split by ',', empty values are skipped like MysqlResult::GetSetValue() does
+ */
+void MysqlJsonWriter::AppendSet(const char *value, size_t value_length) {
+    size_t start = 0, i = 0;
+    bool first = true;
+
+    Append("[", 1);
+    for (i = 0; i <= value_length; i++) {
+        if (i == value_length || value[i] == ',' || value[i] == '\0') {
+            if (i > start) {
+                if (!first) {
+                    Append(",", 1);
+                }
+                AppendString(value + start, i - start);
+                first = false;
+            }
+            start = i + 1;
+
+            if (i < value_length && value[i] == '\0') {
+                break;
+            }
+        }
+    }
+    Append("]", 1);
+}
+
+/*!
+ * Shortest representation which converts back to the same double
+ */
+void MysqlJsonWriter::AppendNumber(double number) {
+    char number_string[32];
+    int number_length = 0;
+
+    if (number != number || number - number != 0) {
+        // NaN and Infinity
+        Append("null", 4);
+        return;
+    }
+
+    for (int precision = 15; precision <= 17; precision++) {
+        number_length = snprintf(number_string, sizeof(number_string), "%.*g", precision, number);
+        if (strtod(number_string, NULL) == number) {
+            break;
+        }
+    }
+
+    Append(number_string, number_length);
+}
+
+static void CivilFromDays(int64_t days, int64_t *year, int *month, int *day) {
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t day_of_era = days - era * 146097;
+    int64_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    int64_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    int64_t month_part = (5 * day_of_year + 2) / 153;
+
+    *day = static_cast<int>(day_of_year - (153 * month_part + 2) / 5 + 1);
+    *month = static_cast<int>(month_part < 10 ? month_part + 3 : month_part - 9);
+    *year = year_of_era + era * 400 + (*month <= 2);
+}
+
+/*!
+ * Date#toJSON() output for UTC date, out of range parts overflow
+ * to the next ones like in Date.UTC(), zero dates are invalid
+ */
+void MysqlJsonWriter::AppendDate(int year, int month, int day, int hour, int minute, int second,
+                                 int millisecond) {
+    if (month < 1 || month > 12 || day < 1 || day > 31) {
+        Append("null", 4);
+        return;
+    }
+
+    int64_t ms = ((MysqlBindingsDaysFromCivil(year, month, 1) + day - 1) * 86400 +
+                  static_cast<int64_t>(hour) * 3600 + minute * 60 + second) * 1000 + millisecond;
+
+    int64_t days = (ms >= 0 ? ms : ms - 86399999) / 86400000;
+    int64_t ms_of_day = ms - days * 86400000;
+    int64_t civil_year;
+    int civil_month, civil_day;
+    CivilFromDays(days, &civil_year, &civil_month, &civil_day);
+
+    char date_string[40];
+    int date_length;
+    const char *year_format = civil_year >= 0 && civil_year <= 9999 ? "\"%04lld" :
+                              (civil_year < 0 ? "\"-%06lld" : "\"+%06lld");
+    date_length = snprintf(date_string, sizeof(date_string), year_format,
+                           static_cast<long long>(civil_year < 0 ? -civil_year : civil_year));
+    date_length += snprintf(date_string + date_length, sizeof(date_string) - date_length,
+                            "-%02d-%02dT%02d:%02d:%02d.%03dZ\"",
+                            civil_month, civil_day,
+                            static_cast<int>(ms_of_day / 3600000),
+                            static_cast<int>(ms_of_day / 60000 % 60),
+                            static_cast<int>(ms_of_day / 1000 % 60),
+                            static_cast<int>(ms_of_day % 1000));
+
+    Append(date_string, date_length);
+}
+
+/*!
+ * DECIMAL value, see MysqlResult::GetDecimalValue()
+ */
+void MysqlJsonWriter::AppendDecimal(const MYSQL_FIELD &field, const char *value,
+                                    unsigned long value_length) {
+    std::string number;
+
+    switch (decimal) {
+        case MYSQL_BINDINGS_DECIMAL_NUMBER:
+            number.assign(value, value_length);
+            AppendNumber(strtod(number.c_str(), NULL));
+            break;
+        case MYSQL_BINDINGS_DECIMAL_SCALED:
+            // Exact mantissa digits are JSON number as is
+            if (MysqlBindingsDecimalMantissa(value, value_length, field.decimals, &number)) {
+                Append(number);
+            } else {
+                AppendString(number.data(), number.size());
+            }
+            break;
+        default:
+            AppendString(value, value_length);
+    }
+}
+
+/*!
+ * Text protocol value, see MysqlResult::GetFieldValue()
+ */
+void MysqlJsonWriter::AppendTextValue(const MYSQL_FIELD &field, const char *value,
+                                      unsigned long value_length) {
+    if (field.flags & SET_FLAG) {
+        AppendSet(value, value_length);
+        return;
+    }
+
+    switch (field.type) {
+        case MYSQL_TYPE_NULL:
+            Append("null", 4);
+            break;
+        case MYSQL_TYPE_TINY:
+        case MYSQL_TYPE_SHORT:
+        case MYSQL_TYPE_LONG:
+        case MYSQL_TYPE_INT24:
+        case MYSQL_TYPE_YEAR:
+        case MYSQL_TYPE_FLOAT:
+        case MYSQL_TYPE_DOUBLE:
+            AppendNumber(strtod(value, NULL));
+            break;
+        case MYSQL_TYPE_TIME: {
+            int hours = 0, minutes = 0, seconds = 0;
+            sscanf(value, "%d:%d:%d", &hours, &minutes, &seconds);
+            AppendDate(1970, 1, 1, hours, minutes, seconds, 0);
+            break;
+        }
+        case MYSQL_TYPE_TIMESTAMP:
+        case MYSQL_TYPE_DATETIME:
+        case MYSQL_TYPE_DATE:
+        case MYSQL_TYPE_NEWDATE: {
+            int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+            char fraction[8] = "";
+            sscanf(value, "%d-%d-%d %d:%d:%d.%7[0-9]", &year, &month, &day, &hour, &minute, &second, fraction);
+
+            // Fraction is zero padded, sscanf() writes only its digits
+            int millisecond = 0;
+            for (int i = 0; i < 3; i++) {
+                millisecond = millisecond * 10 + (fraction[i] ? fraction[i] - '0' : 0);
+            }
+            AppendDate(year, month, day, hour, minute, second, millisecond);
+            break;
+        }
+        case MYSQL_TYPE_TINY_BLOB:
+        case MYSQL_TYPE_MEDIUM_BLOB:
+        case MYSQL_TYPE_LONG_BLOB:
+        case MYSQL_TYPE_BLOB:
+        case MYSQL_TYPE_STRING:
+        case MYSQL_TYPE_VAR_STRING:
+            if (field.flags & BINARY_FLAG) {
+                AppendBuffer(value, value_length);
+            } else {
+                AppendString(value, value_length);
+            }
+            break;
+        case MYSQL_TYPE_SET:
+            AppendSet(value, value_length);
+            break;
+        case MYSQL_TYPE_DECIMAL:
+        case MYSQL_TYPE_NEWDECIMAL:
+            AppendDecimal(field, value, strlen(value));
+            break;
+        default:
+            // BIGINT, ENUM and others are strings,
+            // zero terminated like V8STR() reads them
+            AppendString(value, strlen(value));
+    }
+}
+
+/*!
+ * Binary protocol value, see MysqlStatement::GetFieldValue()
+ */
+void MysqlJsonWriter::AppendBinaryValue(const MYSQL_FIELD &field, const char *value,
+                                        unsigned long value_length) {
+    switch (field.type) {
+        case MYSQL_TYPE_TINY:
+            if (value_length == 1) {
+                if (*reinterpret_cast<const signed char *>(value)) {
+                    Append("true", 4);
+                } else {
+                    Append("false", 5);
+                }
+            } else {
+                AppendNumber(*reinterpret_cast<const signed char *>(value));
+            }
+            break;
+        case MYSQL_TYPE_SHORT:
+            if (field.flags & UNSIGNED_FLAG) {
+                AppendNumber(*reinterpret_cast<const unsigned short int *>(value));
+            } else {
+                AppendNumber(*reinterpret_cast<const short int *>(value));
+            }
+            break;
+        case MYSQL_TYPE_INT24:
+        case MYSQL_TYPE_LONG:
+            if (field.flags & UNSIGNED_FLAG) {
+                AppendNumber(*reinterpret_cast<const unsigned int *>(value));
+            } else {
+                AppendNumber(*reinterpret_cast<const int *>(value));
+            }
+            break;
+        case MYSQL_TYPE_LONGLONG:
+            AppendNumber(static_cast<double>(*reinterpret_cast<const long long int *>(value)));
+            break;
+        case MYSQL_TYPE_FLOAT:
+            AppendNumber(*reinterpret_cast<const float *>(value));
+            break;
+        case MYSQL_TYPE_DOUBLE:
+            AppendNumber(*reinterpret_cast<const double *>(value));
+            break;
+        case MYSQL_TYPE_DECIMAL:
+        case MYSQL_TYPE_NEWDECIMAL:
+            if (decimal != MYSQL_BINDINGS_DECIMAL_STRING) {
+                AppendDecimal(field, value, value_length);
+                break;
+            }
+            // Strings by default, like other string buffers
+        case MYSQL_TYPE_STRING:
+        case MYSQL_TYPE_VAR_STRING:
+        case MYSQL_TYPE_TINY_BLOB:
+        case MYSQL_TYPE_BLOB:
+        case MYSQL_TYPE_MEDIUM_BLOB:
+        case MYSQL_TYPE_LONG_BLOB:
+        case MYSQL_TYPE_BIT:
+        case MYSQL_TYPE_ENUM:
+        case MYSQL_TYPE_GEOMETRY:
+            if (field.flags & BINARY_FLAG) {
+                AppendBuffer(value, value_length);
+            } else {
+                AppendString(value, value_length);
+            }
+            break;
+        case MYSQL_TYPE_TIME:
+        case MYSQL_TYPE_DATE:
+        case MYSQL_TYPE_NEWDATE:
+        case MYSQL_TYPE_DATETIME:
+        case MYSQL_TYPE_TIMESTAMP: {
+            const MYSQL_TIME *ts = reinterpret_cast<const MYSQL_TIME *>(value);
+            AppendDate(ts->year, ts->month, ts->day, ts->hour, ts->minute, ts->second, 0);
+            break;
+        }
+        case MYSQL_TYPE_SET:
+            AppendSet(value, value_length);
+            break;
+        default:
+            AppendString(value, value_length);
+    }
+}
@@ -0,0 +1,155 @@
+/*!
+ * Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+ * See contributors list in README
+ *
+ * See license text in LICENSE file
+ */
+
+#ifndef SRC_MYSQL_BINDINGS_JSON_H_
+#define SRC_MYSQL_BINDINGS_JSON_H_
+
+#include <mysql.h>
+
+#include <v8.h>
+#include <node.h>
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "./mysql_bindings.h"
+
+// MYSQL_TYPE_JSON exists since MySQL 5.7.8,
+// MariaDB sends JSON columns as LONGTEXT
+#if MYSQL_VERSION_ID >= 50708 && !defined(MARIADB_BASE_VERSION)
+#define MYSQL_BINDINGS_HAS_JSON_TYPE 1
+#endif
+
+// Nesting limit, parser is recursive
+#define MYSQLJSON_MAX_DEPTH 512
+
+/*!
+ * JSON document parsed to a flat tape.
+ *
+ * Parse() does not touch V8, so it may run in threadpool,
+ * ToValue() builds JS values from the tape in main thread
+ */
+class MysqlJsonTape {
+  public:
+    MysqlJsonTape(): start(NULL), pos(NULL), end(NULL) {}
+
+    static bool IsJsonField(const MYSQL_FIELD &field);
+
+    bool Parse(const char *json, size_t length);
+
+    const std::string &Error() const {
+        return error;
+    }
+
+    Local<Value> ToValue() const;
+
+  private:
+    enum node_type {
+        JSON_NULL,
+        JSON_TRUE,
+        JSON_FALSE,
+        JSON_NUMBER,
+        JSON_STRING,
+        JSON_ARRAY,
+        JSON_OBJECT
+    };
+    // Arrays and objects are followed by their members,
+    // object members are key string and value nodes
+    struct node {
+        node_type type;
+        uint32_t count;
+        double number;
+        size_t offset;
+        size_t length;
+    };
+    std::vector<node> nodes;
+    // Unescaped UTF-8 strings
+    std::string strings;
+    std::string error;
+
+    // Parser state
+    const char *start;
+    const char *pos;
+    const char *end;
+
+    void SkipWhitespace();
+    bool Fail(const char *message);
+    bool ParseValue(unsigned int depth);
+    bool ParseString(size_t *offset, size_t *length);
+    bool ParseHex4(uint32_t *code);
+    bool ParseNumber(double *number);
+    bool ParseLiteral(const char *literal, size_t literal_length);
+
+    Local<Value> NodeToValue(size_t *index) const;
+};
+
+/*!
+ * Serializes result rows to UTF-8 JSON text.
+ *
+ * Does not touch V8, so rows can be serialized in threadpool.
+ * Values are written the way JSON.stringify() prints values
+ * built by MysqlResult::GetFieldValue() for text protocol rows
+ * and MysqlStatement::GetFieldValue() for binary protocol rows
+ */
+class MysqlJsonWriter {
+  public:
+    MysqlJsonWriter(MYSQL_FIELD *my_fields, uint32_t my_num_fields,
+                    bool as_array, bool nest_tables, bool my_parse_json,
+                    MysqlBindingsDecimalMode my_decimal);
+
+    ~MysqlJsonWriter();
+
+    // Values are NULL for NULL cells
+    void AppendRow(char **values, unsigned long *lengths, bool binary_protocol);
+
+    // Closes rows array and passes memory ownership to caller, free it with FreeBuffer()
+    char *Release(size_t *length);
+
+    static void FreeBuffer(char *data, void *hint);
+
+  private:
+    MYSQL_FIELD *fields;
+    uint32_t num_fields;
+    bool parse_json;
+    MysqlBindingsDecimalMode decimal;
+
+    // Columns order and text written before each column value,
+    // nestTables option groups columns by table
+    std::vector<uint32_t> order;
+    std::vector<std::string> before;
+    std::string row_end;
+    size_t row_count;
+
+    char *data;
+    size_t length;
+    size_t capacity;
+
+    void Reserve(size_t size);
+    void Append(const char *text, size_t text_length);
+    void Append(const std::string &text) {
+        Append(text.data(), text.size());
+    }
+    void AppendString(const char *value, size_t value_length);
+    void AppendBuffer(const char *value, size_t value_length);
+    void AppendSet(const char *value, size_t value_length);
+    void AppendNumber(double number);
+    void AppendDate(int year, int month, int day, int hour, int minute, int second, int millisecond);
+    void AppendDecimal(const MYSQL_FIELD &field, const char *value, unsigned long value_length);
+    void AppendTextValue(const MYSQL_FIELD &field, const char *value, unsigned long value_length);
+    void AppendBinaryValue(const MYSQL_FIELD &field, const char *value, unsigned long value_length);
+
+    static size_t PlainRunLength(const char *value, size_t value_length);
+    static size_t EscapeChar(unsigned char c, char *escaped);
+    static size_t Utf8SequenceLength(const char *value, size_t value_length);
+    static size_t EscapeNext(const char *value, size_t value_length,
+                             char *escaped, size_t *escaped_length);
+    static std::string QuoteString(const char *value);
+};
+
+#endif  // SRC_MYSQL_BINDINGS_JSON_H_
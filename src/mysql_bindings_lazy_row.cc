@@ -0,0 +1,199 @@
+/*!
+ * Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+ * See contributors list in README
+ *
+ * See license text in LICENSE file
+ */
+
+/*!
+ * Include headers
+ */
+#include <cstring>
+
+#include "./mysql_bindings_json.h"
+#include "./mysql_bindings_lazy_row.h"
+#include "./mysql_bindings_result.h"
+
+MysqlLazyRows::MysqlLazyRows(MYSQL_FIELD *my_fields, uint32_t my_num_fields):
+    refs(0),
+    data(NULL),
+    num_fields(my_num_fields),
+    dictionary(NULL) {
+    fields.resize(num_fields);
+
+    for (uint32_t i = 0; i < num_fields; i++) {
+        // Only type info is used by GetFieldValue()
+        memset(&fields[i], 0, sizeof(MYSQL_FIELD));
+        fields[i].type = my_fields[i].type;
+        fields[i].flags = my_fields[i].flags;
+        fields[i].charsetnr = my_fields[i].charsetnr;
+        fields[i].decimals = my_fields[i].decimals;
+        fields[i].length = my_fields[i].length;
+
+        std::string name(my_fields[i].name ? my_fields[i].name : "");
+        if (columns.find(name) == columns.end()) {
+            names.push_back(name);
+        }
+        columns[name] = i;
+    }
+}
+
+MysqlLazyRows::~MysqlLazyRows() {
+    delete[] data;
+    delete dictionary;
+}
+
+/*!
+ * Init V8 structures for MysqlLazyRow class
+ */
+Persistent<FunctionTemplate> MysqlLazyRow::constructor_template;
+
+void MysqlLazyRow::Init(Handle<Object> target) {
+    NanScope();
+
+    // Constructor template, rows are created only by MysqlLazyRow::NewInstance()
+    Local<FunctionTemplate> tpl = FunctionTemplate::New();
+    NanAssignPersistent(FunctionTemplate, constructor_template, tpl);
+    tpl->SetClassName(NanSymbol("MysqlLazyRow"));
+
+    // Instance template
+    Local<ObjectTemplate> instance_template = tpl->InstanceTemplate();
+    instance_template->SetInternalFieldCount(1);
+
+    // Columns are decoded on first access
+    instance_template->SetNamedPropertyHandler(ColumnGetter, ColumnSetter, ColumnQuery,
+                                               0, ColumnEnumerator);
+}
+
+Local<Object> MysqlLazyRow::NewInstance(MysqlLazyRows *rows, size_t index) {
+    NanScope();
+
+    Local<FunctionTemplate> tpl = NanPersistentToLocal(constructor_template);
+
+    Local<Object> instance = tpl->InstanceTemplate()->NewInstance();
+
+    MysqlLazyRow *row = new MysqlLazyRow(rows, index);
+    row->Wrap(instance);
+    rows->refs++;
+
+    return scope.Close(instance);
+}
+
+MysqlLazyRow::~MysqlLazyRow() {
+    if (--rows->refs == 0) {
+        delete rows;
+    }
+}
+
+bool MysqlLazyRow::FindColumn(Local<String> property, uint32_t *column) {
+    String::Utf8Value name(property);
+
+    std::map<std::string, uint32_t>::const_iterator it = rows->columns.find(*name);
+    if (it == rows->columns.end()) {
+        return false;
+    }
+
+    *column = it->second;
+    return true;
+}
+
+Local<Value> MysqlLazyRow::DecodeColumn(uint32_t column) {
+    NanScope();
+
+    const uint32_t *cell = &rows->cells[(index * rows->num_fields + column) * 2];
+
+    if (cell[0] == 0xFFFFFFFF) {
+        return scope.Close(NanNewLocal(Null()));
+    }
+
+    if (rows->fo.results_parse_json && MysqlJsonTape::IsJsonField(rows->fields[column])) {
+        MysqlJsonTape tape;
+        // Invalid document is returned as string, like without parseJSON option
+        if (tape.Parse(rows->data + cell[0], cell[1])) {
+            return scope.Close(tape.ToValue());
+        }
+    }
+
+    if (!rows->dictionary) {
+        rows->dictionary = new MysqlDictionary(&rows->fields[0], rows->num_fields);
+    }
+
+    Local<Value> js_field = rows->dictionary->Get(column, rows->data + cell[0], cell[1],
+                                                  rows->fo.results_dictionary);
+    if (!js_field.IsEmpty()) {
+        return scope.Close(js_field);
+    }
+
+    return scope.Close(MysqlResult::GetFieldValue(rows->fields[column],
+                                                  rows->data + cell[0], cell[1], rows->fo.results_decimal));
+}
+
+/*!
+ * Returns cached or decoded column value, other properties are not intercepted
+ */
+NAN_PROPERTY_GETTER(MysqlLazyRow::ColumnGetter) {
+    NanScope();
+
+    MysqlLazyRow *row = OBJUNWRAP<MysqlLazyRow>(args.Holder());
+
+    uint32_t column;
+    if (!row->FindColumn(property, &column)) {
+        NanReturnValue(Handle<Value>());
+    }
+
+    Local<Value> js_field = args.Holder()->GetHiddenValue(property);
+    if (js_field.IsEmpty()) {
+        js_field = row->DecodeColumn(column);
+        args.Holder()->SetHiddenValue(property, js_field);
+    }
+
+    NanReturnValue(js_field);
+}
+
+/*!
+ * Assigned column value replaces decoded one
+ */
+NAN_PROPERTY_SETTER(MysqlLazyRow::ColumnSetter) {
+    NanScope();
+
+    MysqlLazyRow *row = OBJUNWRAP<MysqlLazyRow>(args.Holder());
+
+    uint32_t column;
+    if (!row->FindColumn(property, &column)) {
+        NanReturnValue(Handle<Value>());
+    }
+
+    args.Holder()->SetHiddenValue(property, value);
+
+    NanReturnValue(value);
+}
+
+NAN_PROPERTY_QUERY(MysqlLazyRow::ColumnQuery) {
+    NanScope();
+
+    MysqlLazyRow *row = OBJUNWRAP<MysqlLazyRow>(args.Holder());
+
+    uint32_t column;
+    if (!row->FindColumn(property, &column)) {
+        NanReturnValue(Handle<Integer>());
+    }
+
+    NanReturnValue(Integer::New(None));
+}
+
+/*!
+ * Columns are enumerable, so Object.keys() and JSON.stringify() see them
+ */
+NAN_PROPERTY_ENUMERATOR(MysqlLazyRow::ColumnEnumerator) {
+    NanScope();
+
+    MysqlLazyRow *row = OBJUNWRAP<MysqlLazyRow>(args.Holder());
+
+    Local<Array> js_names = Array::New(row->rows->names.size());
+
+    for (uint32_t i = 0; i < row->rows->names.size(); i++) {
+        js_names->Set(Integer::NewFromUnsigned(i), V8STR(row->rows->names[i].c_str()));
+    }
+
+    NanReturnValue(js_names);
+}
@@ -0,0 +1,94 @@
+/*!
+ * Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+ * See contributors list in README
+ *
+ * See license text in LICENSE file
+ */
+
+#ifndef SRC_MYSQL_BINDINGS_LAZY_ROW_H_
+#define SRC_MYSQL_BINDINGS_LAZY_ROW_H_
+
+#include <mysql.h>
+
+#include <v8.h>
+#include <node.h>
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "./mysql_bindings.h"
+#include "./mysql_bindings_result.h"
+
+/*!
+ * Packed rows shared by all MysqlLazyRow objects of one fetchAll() call,
+ * freed when the last row object is garbage collected
+ */
+struct MysqlLazyRows {
+    unsigned int refs;
+
+    // Zero terminated values and (offset, length) pairs per cell,
+    // see MysqlResult::PackRows()
+    char *data;
+    std::vector<uint32_t> cells;
+    uint32_t num_fields;
+
+    // Copies of fields type info, result may be freed before rows
+    std::vector<MYSQL_FIELD> fields;
+
+    // Options of fetchAll() call, values are decoded like in eager rows
+    MysqlResult::fetch_options fo;
+    // Created on first decoded value, see MysqlResult::GetColumnValue()
+    MysqlDictionary *dictionary;
+
+    // Column index by name, last column wins like in eager rows
+    std::map<std::string, uint32_t> columns;
+    // Unique names in fields order, for enumeration
+    std::vector<std::string> names;
+
+    MysqlLazyRows(MYSQL_FIELD *my_fields, uint32_t my_num_fields);
+    ~MysqlLazyRows();
+};
+
+/** internal, section: Classes
+ * class MysqlLazyRow
+ *
+ * Row of fetchAll({lazy: true}), decodes column value on first access
+ **/
+class MysqlLazyRow : public node::ObjectWrap {
+  public:
+    static Persistent<FunctionTemplate> constructor_template;
+
+    static void Init(Handle<Object> target);
+
+    static Local<Object> NewInstance(MysqlLazyRows *rows, size_t index);
+
+  private:
+    MysqlLazyRows *rows;
+    size_t index;
+
+    MysqlLazyRow(MysqlLazyRows *my_rows, size_t my_index):
+        ObjectWrap(),
+        rows(my_rows),
+        index(my_index) {}
+
+    ~MysqlLazyRow();
+
+    bool FindColumn(Local<String> property, uint32_t *column);
+
+    Local<Value> DecodeColumn(uint32_t column);
+
+    // Interceptors
+
+    static NAN_PROPERTY_GETTER(ColumnGetter);
+
+    static NAN_PROPERTY_SETTER(ColumnSetter);
+
+    static NAN_PROPERTY_QUERY(ColumnQuery);
+
+    static NAN_PROPERTY_ENUMERATOR(ColumnEnumerator);
+};
+
+#endif  // SRC_MYSQL_BINDINGS_LAZY_ROW_H_
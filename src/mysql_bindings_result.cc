@@ -9,6 +9,7 @@
  * Include headers
  */
 #include "./mysql_bindings_connection.h"
+#include "./mysql_bindings_lazy_row.h"
 #include "./mysql_bindings_result.h"
 
 /*!
@@ -33,8 +34,11 @@ void MysqlResult::Init(Handle<Object> target) {
 
     // Prototype methods
     NODE_SET_PROTOTYPE_METHOD(tpl, "dataSeekSync",         DataSeekSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "exportTo",             ExportTo);
     NODE_SET_PROTOTYPE_METHOD(tpl, "fetchAll",             FetchAll);
     NODE_SET_PROTOTYPE_METHOD(tpl, "fetchAllSync",         FetchAllSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "fetchAllJSON",         FetchAllJSON);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "fetchArrow",           FetchArrow);
     NODE_SET_PROTOTYPE_METHOD(tpl, "fetchFieldSync",       FetchFieldSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "fetchFieldDirectSync", FetchFieldDirectSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "fetchFieldsSync",      FetchFieldsSync);
@@ -49,23 +53,28 @@ void MysqlResult::Init(Handle<Object> target) {
     target->Set(NanSymbol("MysqlResult"), tpl->GetFunction());
 }
 
-Local<Object> MysqlResult::NewInstance(MYSQL *my_conn, MYSQL_RES *my_result, uint32_t field_count) {
+Local<Object> MysqlResult::NewInstance(MYSQL *my_conn, MYSQL_RES *my_result, uint32_t field_count,
+                                       MysqlSharedResult *shared) {
     NanScope();
 
     Local<FunctionTemplate> tpl = NanPersistentToLocal(constructor_template);
 
-    const int argc = 3;
-    Local<Value> argv[argc];
+    int argc = 3;
+    Local<Value> argv[4];
     argv[0] = External::New(my_conn);
     argv[1] = External::New(my_result);
     argv[2] = Integer::NewFromUnsigned(field_count);
+    if (shared) {
+        argv[3] = External::New(shared);
+        argc = 4;
+    }
 
     Local<Object> instance = tpl->GetFunction()->NewInstance(argc, argv);
 
     return scope.Close(instance);
 }
 
-MysqlResult::MysqlResult(): ObjectWrap() {}
+MysqlResult::MysqlResult(): ObjectWrap(), connection(NULL), shared(NULL), dictionary(NULL), fetching(false) {}
 
 MysqlResult::~MysqlResult() {
     this->Free();
@@ -97,11 +106,18 @@ void MysqlResult::AddFieldProperties(Local<Object> &js_field_obj, MYSQL_FIELD *f
                       Integer::NewFromUnsigned(field->decimals));
 }
 
-Local<Value> MysqlResult::GetFieldValue(MYSQL_FIELD field, char* field_value, unsigned long field_length) {
+Local<Value> MysqlResult::GetFieldValue(MYSQL_FIELD field, char* field_value, unsigned long field_length,
+                                        MysqlBindingsDecimalMode decimal) {
     NanScope();
 
     Local<Value> js_field = NanNewLocal(Null());
 
+    // Proper MYSQL_TYPE_SET type handle, thanks for Mark Hechim
+    // http://www.mirrorservice.org/sites/ftp.mysql.com/doc/refman/5.1/en/c-api-datatypes.html#c10485
+    if (field_value && (field.type == MYSQL_TYPE_SET || (field.flags & SET_FLAG))) {
+        return scope.Close(GetSetValue(field_value, field_length));
+    }
+
     switch (field.type) {
         case MYSQL_TYPE_NULL:   // NULL-type field
             // Already null
@@ -130,9 +146,9 @@ Local<Value> MysqlResult::GetFieldValue(MYSQL_FIELD field, char* field_value, un
             break;
         case MYSQL_TYPE_DECIMAL:     // DECIMAL or NUMERIC field
         case MYSQL_TYPE_NEWDECIMAL:  // Precision math DECIMAL or NUMERIC field
-            // Return DECIMAL/NUMERIC as string, see #110
+            // Return DECIMAL/NUMERIC as string by default, see #110
             if (field_value) {
-              js_field = V8STR(field_value);
+              js_field = GetDecimalValue(field, field_value, field_length, decimal);
             }
             break;
         case MYSQL_TYPE_TIME:  // TIME field
@@ -191,23 +207,6 @@ Local<Value> MysqlResult::GetFieldValue(MYSQL_FIELD field, char* field_value, un
                 }
             }
             break;
-        case MYSQL_TYPE_SET:  // SET field
-            // TODO(Sannis): Maybe memory leaks here
-            if (field_value) {
-                char *pch, *last;
-                int i = 0;
-                Local<Array> js_field_array = Array::New();
-
-                pch = strtok_r(field_value, ",", &last);
-                while (pch != NULL) {
-                    js_field_array->Set(Integer::New(i), V8STR(pch));
-                    pch = strtok_r(NULL, ",", &last);
-                    i++;
-                }
-
-                js_field = js_field_array;
-            }
-            break;
         case MYSQL_TYPE_ENUM:  // ENUM field
             if (field_value) {
                 js_field = V8STR(field_value);
@@ -226,47 +225,245 @@ Local<Value> MysqlResult::GetFieldValue(MYSQL_FIELD field, char* field_value, un
             }
     }
 
-    // Proper MYSQL_TYPE_SET type handle, thanks for Mark Hechim
-    // http://www.mirrorservice.org/sites/ftp.mysql.com/doc/refman/5.1/en/c-api-datatypes.html#c10485
-    if (field_value && (field.flags & SET_FLAG)) {
-        char *pch, *last;
-        int i = 0;
-        Local<Array> js_field_array = Array::New();
-
-        pch = strtok_r(field_value, ",", &last);
-        while (pch != NULL) {
-            js_field_array->Set(Integer::New(i), V8STR(pch));
-            pch = strtok_r(NULL, ",", &last);
-            i++;
-        }
+    return scope.Close(js_field);
+}
+
+/*!
+ * SET value as array of its members, value buffer is not modified
+ */
+Local<Array> MysqlResult::GetSetValue(const char *field_value, unsigned long field_length) {
+    NanScope();
 
-        js_field = js_field_array;
+    Local<Array> js_field_array = Array::New();
+    unsigned long start = 0, end;
+    uint32_t i = 0;
+
+    while (start < field_length) {
+        const char *comma = static_cast<const char *>(memchr(field_value + start, ',', field_length - start));
+        end = comma ? comma - field_value : field_length;
+
+        if (end > start) {
+            js_field_array->Set(Integer::NewFromUnsigned(i++), V8STR2(field_value + start, end - start));
+        }
+        start = end + 1;
     }
 
-    return scope.Close(js_field);
+    return scope.Close(js_field_array);
 }
 
-MysqlResult::fetch_options MysqlResult::GetFetchOptions(Local<Object> options) {
-    fetch_options fo = {false, false};
+/*!
+ * DECIMAL/NEWDECIMAL value for text and binary protocol, value may be not zero terminated.
+ * Scaled value is integer mantissa of field.decimals scale, or its digits string
+ * when it is out of exact JS numbers range
+ */
+Local<Value> MysqlResult::GetDecimalValue(const MYSQL_FIELD &field, const char *field_value,
+                                          unsigned long field_length, MysqlBindingsDecimalMode decimal) {
+    NanScope();
+
+    std::string number;
+
+    switch (decimal) {
+        case MYSQL_BINDINGS_DECIMAL_NUMBER:
+            number.assign(field_value, field_length);
+            return scope.Close(Number::New(strtod(number.c_str(), NULL)));
+        case MYSQL_BINDINGS_DECIMAL_SCALED:
+            if (MysqlBindingsDecimalMantissa(field_value, field_length, field.decimals, &number)) {
+                return scope.Close(Number::New(strtod(number.c_str(), NULL)));
+            }
+            return scope.Close(V8STR2(number.data(), number.size()));
+        default:
+            return scope.Close(V8STR2(field_value, field_length));
+    }
+}
 
+/*!
+ * Reads fetch options from JS object, returns false for unknown decimal mode
+ */
+bool MysqlResult::GetFetchOptions(Local<Object> options, fetch_options *fo) {
     // Inherit from options object
     if (options->Has(V8STR("asArray"))) {
         DEBUG_PRINTF("+asArray");
-        fo.results_as_array = options->Get(V8STR("asArray"))->BooleanValue();
+        fo->results_as_array = options->Get(V8STR("asArray"))->BooleanValue();
     }
     if (options->Has(V8STR("nestTables"))) {
         DEBUG_PRINTF("+nestTables");
-        fo.results_nest_tables = options->ToObject()->Get(V8STR("nestTables"))->BooleanValue();
+        fo->results_nest_tables = options->ToObject()->Get(V8STR("nestTables"))->BooleanValue();
+    }
+    if (options->Has(V8STR("raw"))) {
+        DEBUG_PRINTF("+raw");
+        fo->results_raw = options->Get(V8STR("raw"))->BooleanValue();
+    }
+    if (options->Has(V8STR("lazy"))) {
+        DEBUG_PRINTF("+lazy");
+        fo->results_lazy = options->Get(V8STR("lazy"))->BooleanValue();
     }
+    if (options->Has(V8STR("parseJSON"))) {
+        DEBUG_PRINTF("+parseJSON");
+        fo->results_parse_json = options->Get(V8STR("parseJSON"))->BooleanValue();
+    }
+    if (options->Has(V8STR("decimal"))) {
+        DEBUG_PRINTF("+decimal");
+        String::Utf8Value decimal(options->Get(V8STR("decimal")));
+        if (strcmp(*decimal, "string") == 0) {
+            fo->results_decimal = MYSQL_BINDINGS_DECIMAL_STRING;
+        } else if (strcmp(*decimal, "number") == 0) {
+            fo->results_decimal = MYSQL_BINDINGS_DECIMAL_NUMBER;
+        } else if (strcmp(*decimal, "scaled") == 0) {
+            fo->results_decimal = MYSQL_BINDINGS_DECIMAL_SCALED;
+        } else {
+            return false;
+        }
+    }
+    if (options->Has(V8STR("dictionary"))) {
+        DEBUG_PRINTF("+dictionary");
+        fo->results_dictionary = options->Get(V8STR("dictionary"))->BooleanValue();
+    }
+
+    return true;
+}
+
+Local<Array> MysqlResult::GetFieldsArray(MYSQL_FIELD *fields, uint32_t num_fields) {
+    NanScope();
+
+    Local<Array> js_fields = Array::New(num_fields);
+    Local<Object> js_field_obj;
+    uint32_t i = 0;
+
+    for (i = 0; i < num_fields; i++) {
+        js_field_obj = Object::New();
+        AddFieldProperties(js_field_obj, &fields[i]);
+
+        js_fields->Set(Integer::NewFromUnsigned(i), js_field_obj);
+    }
+
+    return scope.Close(js_fields);
+}
+
+Local<Object> MysqlResult::NewRow(const fetch_options &fo) {
+    if (fo.results_as_array) {
+        return Array::New();
+    }
+
+    return Object::New();
+}
 
-    return fo;
+/*!
+ * Sets column value of row created by NewRow(), nestTables rows
+ * get nested object per table
+ */
+void MysqlResult::SetRowColumn(Local<Object> js_row, MYSQL_FIELD *fields, uint32_t column,
+                               Local<Value> js_field, const fetch_options &fo) {
+    if (fo.results_as_array) {
+        js_row->Set(Integer::NewFromUnsigned(column), js_field);
+    } else if (fo.results_nest_tables) {
+        if (!js_row->Has(V8STR(fields[column].table))) {
+            js_row->Set(V8STR(fields[column].table), Object::New());
+        }
+        js_row->Get(V8STR(fields[column].table))->ToObject()
+              ->Set(V8STR(fields[column].name), js_field);
+    } else {
+        js_row->Set(V8STR(fields[column].name), js_field);
+    }
+}
+
+void MysqlResult::SetConnection(MysqlConnection *my_connection, Local<Object> my_js_connection) {
+    connection = my_connection;
+    connection->AttachResult();
+    NanAssignPersistent(Object, js_connection, my_js_connection);
+}
+
+void MysqlResult::SetFetching(bool value) {
+    if (shared) {
+        shared->fetching = value;
+    } else {
+        fetching = value;
+    }
 }
 
 void MysqlResult::Free() {
     if (_res) {
-        mysql_free_result(_res);
+        if (shared) {
+            if (shared->cursor_owner == this) {
+                shared->cursor_owner = NULL;
+            }
+            if (--shared->refs == 0) {
+                mysql_free_result(_res);
+                delete shared;
+            }
+            shared = NULL;
+        } else {
+            mysql_free_result(_res);
+        }
         _res = NULL;
     }
+
+    if (connection) {
+        connection->DetachResult();
+        connection = NULL;
+        NanDispose(js_connection);
+    }
+
+    delete dictionary;
+    dictionary = NULL;
+}
+
+/*!
+ * Called by each fetch, dictionary options may differ between them
+ */
+void MysqlResult::ResetDictionary() {
+    if (dictionary) {
+        dictionary->ResetOverflow();
+    }
+}
+
+/*!
+ * Column value from result dictionary, or decoded by GetFieldValue()
+ * for columns and values which are not dictionary encoded
+ */
+Local<Value> MysqlResult::GetColumnValue(MYSQL_FIELD *fields, uint32_t column, char *field_value,
+                                         unsigned long field_length, const fetch_options &fo) {
+    if (field_value) {
+        if (!dictionary) {
+            dictionary = new MysqlDictionary(fields, mysql_num_fields(_res));
+        }
+
+        Local<Value> js_field = dictionary->Get(column, field_value, field_length, fo.results_dictionary);
+        if (!js_field.IsEmpty()) {
+            return js_field;
+        }
+    }
+
+    return GetFieldValue(fields[column], field_value, field_length, fo.results_decimal);
+}
+
+/*!
+ * Moves shared result set cursors to the position of this object,
+ * saving cursors of previous user. Current row is restored by fetching it again,
+ * so mysql_fetch_lengths() works as expected.
+ * Main thread only, cursors are not locked: while any of results walks
+ * the shared set in threadpool it is marked as fetching, and
+ * MYSQLRES_RESTORE_CURSOR throws instead of moving cursors
+ */
+void MysqlResult::RestoreCursor() {
+    if (!shared || shared->cursor_owner == this) {
+        return;
+    }
+
+    MysqlResult *owner = shared->cursor_owner;
+    if (owner) {
+        owner->row_cursor = mysql_row_tell(_res);
+        owner->field_cursor = mysql_field_tell(_res);
+    }
+
+    if (current_row_offset) {
+        mysql_row_seek(_res, current_row_offset);
+        mysql_fetch_row(_res);
+    } else {
+        mysql_row_seek(_res, row_cursor);
+    }
+    mysql_field_seek(_res, field_cursor);
+
+    shared->cursor_owner = this;
 }
 
 /** internal
@@ -284,55 +481,548 @@ NAN_METHOD(MysqlResult::New) {
     MYSQL *connection = static_cast<MYSQL*>(js_connection->Value());
     MYSQL_RES *result = static_cast<MYSQL_RES*>(js_result->Value());
 
-    MysqlResult *my_res = new MysqlResult(connection, result, field_count);
-    my_res->Wrap(args.Holder());
+    MysqlSharedResult *shared = NULL;
+    if (args.Length() > 3 && args[3]->IsExternal()) {
+        shared = static_cast<MysqlSharedResult*>(Local<External>::Cast(args[3])->Value());
+    }
+
+    MysqlResult *my_res = new MysqlResult(connection, result, field_count, shared);
+    my_res->Wrap(args.Holder());
+
+    NanReturnValue(args.Holder());
+}
+
+/** read-only
+ * MysqlResult#fieldCount -> Integer|Undefined
+ *
+ * Get the number of fields in a result
+ **/
+NAN_GETTER(MysqlResult::FieldCountGetter) {
+    NanScope();
+
+    MysqlResult *res = OBJUNWRAP<MysqlResult>(args.Holder());
+
+    MYSQLRES_MUSTBE_VALID;
+
+    if (res->field_count > 0) {
+        NanReturnValue(Integer::NewFromUnsigned(res->field_count));
+    } else {
+        NanReturnUndefined();
+    }
+}
+
+/**
+ * MysqlResult#dataSeekSync(offset)
+ * - offset (Integer): The field offset
+ *
+ * Adjusts the result pointer to an arbitrary row in the result
+ **/
+NAN_METHOD(MysqlResult::DataSeekSync) {
+    NanScope();
+
+    MysqlResult *res = OBJUNWRAP<MysqlResult>(args.Holder());
+
+    MYSQLRES_MUSTBE_VALID;
+
+    MYSQLRES_RESTORE_CURSOR;
+
+    REQ_UINT_ARG(0, offset)
+
+    if (mysql_result_is_unbuffered(res->_res)) {
+        return NanThrowError("Function cannot be used with MYSQL_USE_RESULT");
+    }
+
+    if (offset >= mysql_num_rows(res->_res)) {
+        return NanThrowError("Invalid row offset");
+    }
+
+    mysql_data_seek(res->_res, offset);
+    res->current_row_offset = NULL;
+
+    NanReturnUndefined();
+}
+
+/*!
+ * Frees Buffer memory allocated in FetchRaw()
+ */
+void MysqlResult::FreeRawBuffer(char *data, void *hint) {
+    delete[] data;
+}
+
+/*!
+ * Packs rows left in buffered result to one memory block. Moves result cursor,
+ * so in threadpool result must be marked as fetching.
+ * Stored rows are spread over libmysqlclient memory blocks,
+ * so each cell is copied once. Cells are (offset, length) pairs,
+ * offset is 0xFFFFFFFF for NULL values. Returns error message or NULL
+ */
+const char *MysqlResult::PackRows(bool zero_terminated, char **data, uint64_t *data_length,
+                                  std::vector<uint32_t> *cells, size_t *row_count) {
+    MYSQL_ROW result_row;
+    unsigned long *field_lengths;
+    uint32_t num_fields = mysql_num_fields(_res);
+    uint32_t j = 0;
+    uint64_t total_length = 0;
+    size_t i = 0;
+
+    std::vector<MYSQL_ROW> rows;
+
+    rows.reserve(mysql_num_rows(_res));
+    cells->reserve(mysql_num_rows(_res) * num_fields * 2);
+
+    // Stored rows stay in place, so offsets are computed before copying
+    while ((result_row = mysql_fetch_row(_res))) {
+        field_lengths = mysql_fetch_lengths(_res);
+
+        for (j = 0; j < num_fields; j++) {
+            if (result_row[j]) {
+                cells->push_back(static_cast<uint32_t>(total_length));
+                cells->push_back(static_cast<uint32_t>(field_lengths[j]));
+                total_length += field_lengths[j] + (zero_terminated ? 1 : 0);
+            } else {
+                cells->push_back(0xFFFFFFFF);
+                cells->push_back(0);
+            }
+        }
+
+        rows.push_back(result_row);
+    }
+
+    if (rows.size() != mysql_num_rows(_res)) {
+        return mysql_error(_conn);
+    }
+
+    if (total_length >= 0xFFFFFFFF) {
+        return "Result is too large to pack";
+    }
+
+    *data = new char[total_length ? total_length : 1];
+    for (i = 0; i < rows.size(); i++) {
+        for (j = 0; j < num_fields; j++) {
+            const uint32_t *cell = &(*cells)[(i * num_fields + j) * 2];
+            if (rows[i][j]) {
+                memcpy(*data + cell[0], rows[i][j], cell[1]);
+                if (zero_terminated) {
+                    (*data)[cell[0] + cell[1]] = '\0';
+                }
+            }
+        }
+    }
+
+    *data_length = total_length;
+    *row_count = rows.size();
+
+    return NULL;
+}
+
+/*!
+ * Packs rows to one Buffer, GetFieldValue() is never called.
+ * Sets js_raw to {buffer, cells, fields}, cells is Uint32Array
+ * of (offset, length) pairs, see PackRows().
+ * Returns error message or NULL
+ */
+const char *MysqlResult::FetchRaw(Local<Object> *js_raw) {
+    char *data;
+    uint64_t total_length;
+    size_t row_count;
+    std::vector<uint32_t> cells;
+
+    const char *error = PackRows(false, &data, &total_length, &cells, &row_count);
+    if (error) {
+        return error;
+    }
+
+    *js_raw = RawToObject(data, total_length, cells);
+
+    return NULL;
+}
+
+/*!
+ * Wraps rows packed by PackRows() to {buffer, cells, fields} object,
+ * Buffer takes ownership of data
+ */
+Local<Object> MysqlResult::RawToObject(char *data, uint64_t data_length, const std::vector<uint32_t> &cells) {
+    NanScope();
+
+    uint32_t num_fields = mysql_num_fields(_res);
+
+    // Buffer owns packed data, it is freed with FreeRawBuffer()
+    Local<Object> js_buffer = NanNewBufferHandle(data, data_length, FreeRawBuffer, NULL);
+
+    Local<Value> js_cells_length = Integer::NewFromUnsigned(cells.size());
+    Local<Function> js_uint32array = Local<Function>::Cast(
+        Context::GetCurrent()->Global()->Get(V8STR("Uint32Array")));
+    Local<Object> js_cells = js_uint32array->NewInstance(1, &js_cells_length);
+    if (cells.size()) {
+        memcpy(js_cells->GetIndexedPropertiesExternalArrayData(),
+               &cells[0], cells.size() * sizeof(uint32_t));
+    }
+
+    Local<Object> js_raw = Object::New();
+    js_raw->Set(V8STR("buffer"), js_buffer);
+    js_raw->Set(V8STR("cells"), js_cells);
+    js_raw->Set(V8STR("fields"), GetFieldsArray(mysql_fetch_fields(_res), num_fields));
+
+    return scope.Close(js_raw);
+}
+
+/*!
+ * Builds JSON column value from tape parsed in threadpool,
+ * values of unbuffered results are parsed here.
+ * Returns error message or NULL
+ */
+const char *MysqlResult::GetJsonFieldValue(parsed_json *parsed, const char *field_value,
+                                           unsigned long field_length, Local<Value> *js_field) {
+    std::map<const char *, size_t>::const_iterator it = parsed->cells.find(field_value);
+
+    if (it != parsed->cells.end()) {
+        *js_field = parsed->tapes[it->second].ToValue();
+        return NULL;
+    }
+
+    // Unbuffered rows reuse memory, so these values are not cached
+    if (!parsed->scratch.Parse(field_value, field_length)) {
+        parsed->error = "Invalid JSON value: " + parsed->scratch.Error();
+        return parsed->error.c_str();
+    }
+
+    *js_field = parsed->scratch.ToValue();
+
+    return NULL;
+}
+
+/*!
+ * Packs rows for MysqlLazyRow objects, values are decoded on first access.
+ * Returns error message or NULL
+ */
+const char *MysqlResult::FetchLazy(const fetch_options &fo, Local<Array> *js_rows) {
+    char *data;
+    uint64_t total_length;
+    size_t row_count;
+    std::vector<uint32_t> cells;
+
+    const char *error = PackRows(true, &data, &total_length, &cells, &row_count);
+    if (error) {
+        return error;
+    }
+
+    *js_rows = LazyToArray(fo, data, &cells, row_count);
+
+    return NULL;
+}
+
+/*!
+ * Creates MysqlLazyRow objects for rows packed by PackRows(),
+ * rows set takes ownership of data and cells
+ */
+Local<Array> MysqlResult::LazyToArray(const fetch_options &fo, char *data, std::vector<uint32_t> *cells,
+                                      size_t row_count) {
+    NanScope();
+
+    MysqlLazyRows *rows = new MysqlLazyRows(mysql_fetch_fields(_res), mysql_num_fields(_res));
+    rows->fo = fo;
+    rows->data = data;
+    rows->cells.swap(*cells);
+    size_t i = 0;
+
+    Local<Array> js_rows = Array::New(row_count);
+    for (i = 0; i < row_count; i++) {
+        js_rows->Set(Integer::NewFromUnsigned(i), MysqlLazyRow::NewInstance(rows, i));
+    }
+
+    // Nobody holds an empty result
+    if (row_count == 0) {
+        delete rows;
+    }
+
+    return scope.Close(js_rows);
+}
+
+/*!
+ * strerror_r() is XSI or GNU one depending on platform
+ */
+static inline const char *ErrnoMessage(int result, const char *buffer) {
+    return result == 0 ? buffer : "Unknown error";
+}
+
+static inline const char *ErrnoMessage(const char *result, const char *) {
+    return result;
+}
+
+static std::string ErrnoString(int my_errno) {
+    char buffer[256];
+    return ErrnoMessage(strerror_r(my_errno, buffer, sizeof(buffer)), buffer);
+}
+
+/*!
+ * Writes buffered data to export file, runs in threadpool.
+ * Partial writes are continued, non-blocking fd is waited for
+ */
+bool MysqlResult::ExportFlush(exportTo_request *export_req) {
+    size_t written = 0;
+
+    while (written < export_req->buffer.size()) {
+        ssize_t bytes = write(export_req->fd, &export_req->buffer[written],
+                              export_req->buffer.size() - written);
+        if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                struct pollfd writable = {export_req->fd, POLLOUT, 0};
+                if (poll(&writable, 1, -1) >= 0 || errno == EINTR) {
+                    continue;
+                }
+            }
+
+            export_req->my_error = "Export write error: " + ErrnoString(errno);
+            return false;
+        }
+        written += bytes;
+    }
+
+    export_req->buffer.clear();
+    return true;
+}
+
+void MysqlResult::ExportAppend(exportTo_request *export_req, const char *data, size_t length) {
+    export_req->buffer.insert(export_req->buffer.end(), data, data + length);
+}
+
+/*!
+ * CSV fields are quoted as in RFC 4180 when needed, empty string is "" and NULL is empty.
+ * TSV fields are escaped as in SELECT ... INTO OUTFILE, NULL is \N
+ */
+void MysqlResult::ExportAppendField(exportTo_request *export_req, const char *value, size_t length) {
+    std::vector<char> &buffer = export_req->buffer;
+    size_t i = 0;
+
+    if (export_req->tsv) {
+        if (!value) {
+            ExportAppend(export_req, "\\N", 2);
+            return;
+        }
+
+        for (i = 0; i < length; i++) {
+            switch (value[i]) {
+                case '\t':  ExportAppend(export_req, "\\t", 2);  break;
+                case '\n':  ExportAppend(export_req, "\\n", 2);  break;
+                case '\r':  ExportAppend(export_req, "\\r", 2);  break;
+                case '\\': ExportAppend(export_req, "\\\\", 2); break;
+                case '\0':  ExportAppend(export_req, "\\0", 2);  break;
+                default:    buffer.push_back(value[i]);
+            }
+        }
+        return;
+    }
+
+    if (!value) {
+        return;
+    }
+
+    bool quote = length == 0;
+    for (i = 0; i < length && !quote; i++) {
+        quote = value[i] == ',' || value[i] == '"' || value[i] == '\n' || value[i] == '\r';
+    }
+
+    if (!quote) {
+        ExportAppend(export_req, value, length);
+        return;
+    }
+
+    buffer.push_back('"');
+    for (i = 0; i < length; i++) {
+        if (value[i] == '"') {
+            buffer.push_back('"');
+        }
+        buffer.push_back(value[i]);
+    }
+    buffer.push_back('"');
+}
+
+/*!
+ * EIO wrapper functions for MysqlResult::ExportTo
+ */
+void MysqlResult::EIO_After_ExportTo(uv_work_t *req) {
+    NanScope();
+
+    struct exportTo_request *export_req = (struct exportTo_request *)(req->data);
+
+    int argc = 1;
+    Local<Value> argv[2];
+
+    if (!export_req->ok) {
+        argv[0] = V8EXC(export_req->my_error.c_str());
+    } else {
+        argv[1] = Number::New(static_cast<double>(export_req->row_count));
+        argv[0] = NanNewLocal(Null());
+        argc = 2;
+    }
+
+    export_req->res->SetFetching(false);
+
+    export_req->nan_callback->Call(argc, argv);
+    delete export_req->nan_callback;
+
+    export_req->res->Unref();
+
+    delete export_req;
+    delete req;
+}
+
+void MysqlResult::EIO_ExportTo(uv_work_t *req) {
+    struct exportTo_request *export_req = (struct exportTo_request *)(req->data);
+    MysqlResult *res = export_req->res;
+
+    MYSQL_ROW result_row;
+    unsigned long *field_lengths;
+    MYSQL_FIELD *fields = mysql_fetch_fields(res->_res);
+    uint32_t num_fields = mysql_num_fields(res->_res), j = 0;
+    bool unbuffered = mysql_result_is_unbuffered(res->_res);
+    const char separator = export_req->tsv ? '\t' : ',';
+
+    export_req->ok = false;
+    export_req->row_count = 0;
+
+    if (!export_req->path.empty()) {
+        export_req->fd = open(export_req->path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if (export_req->fd < 0) {
+            export_req->my_error = "Can't open export file: " + ErrnoString(errno);
+            return;
+        }
+    }
+
+    export_req->buffer.reserve(MYSQLRES_EXPORT_BUFFER_SIZE);
+
+    if (export_req->header) {
+        for (j = 0; j < num_fields; j++) {
+            if (j) {
+                export_req->buffer.push_back(separator);
+            }
+            ExportAppendField(export_req, fields[j].name, strlen(fields[j].name));
+        }
+        export_req->buffer.push_back('\n');
+    }
+
+    // Unbuffered rows are streamed from server to file
+    if (unbuffered && res->connection) {
+        res->connection->LockQuery();
+    }
+
+    while ((result_row = mysql_fetch_row(res->_res))) {
+        field_lengths = mysql_fetch_lengths(res->_res);
+
+        for (j = 0; j < num_fields; j++) {
+            if (j) {
+                export_req->buffer.push_back(separator);
+            }
+            ExportAppendField(export_req, result_row[j], field_lengths[j]);
+        }
+        export_req->buffer.push_back('\n');
+        export_req->row_count++;
+
+        if (export_req->buffer.size() >= MYSQLRES_EXPORT_BUFFER_SIZE && !ExportFlush(export_req)) {
+            break;
+        }
+    }
+
+    if (export_req->my_error.empty()) {
+        if (unbuffered && mysql_errno(res->_conn)) {
+            char error_string[32];
+            snprintf(error_string, sizeof(error_string), "Fetch error #%d: ", mysql_errno(res->_conn));
+            export_req->my_error = std::string(error_string) + mysql_error(res->_conn);
+        } else if (ExportFlush(export_req)) {
+            export_req->ok = true;
+        }
+    }
+
+    if (unbuffered && res->connection) {
+        res->connection->UnlockQuery();
+    }
 
-    NanReturnValue(args.Holder());
+    if (!export_req->path.empty() && close(export_req->fd) != 0 && export_req->ok) {
+        export_req->ok = false;
+        export_req->my_error = "Export write error: " + ErrnoString(errno);
+    }
 }
 
-/** read-only
- * MysqlResult#fieldCount -> Integer|Undefined
+/**
+ * MysqlResult#exportTo(fd, [options, ]callback)
+ * MysqlResult#exportTo(path, [options, ]callback)
+ * - fd (Integer): File descriptor to write to, it is not closed
+ * - path (String): File to create or truncate
+ * - options (Object): {format: 'csv'|'tsv', header: Boolean} (optional)
+ * - callback (Function): Callback function, gets (error, rowCount)
  *
- * Get the number of fields in a result
+ * Writes all result rows as CSV (default) or TSV in threadpool.
+ * Rows of unbuffered results are streamed from the server.
+ * Values are written as server sends them. CSV is quoted as in RFC 4180,
+ * NULL is an empty field. TSV is escaped as SELECT ... INTO OUTFILE does,
+ * NULL is \N. Other methods of the result throw until callback is called
  **/
-NAN_GETTER(MysqlResult::FieldCountGetter) {
+NAN_METHOD(MysqlResult::ExportTo) {
     NanScope();
 
-    MysqlResult *res = OBJUNWRAP<MysqlResult>(args.Holder());
+    if (args.Length() < 1 || !(args[0]->IsString() || args[0]->IsInt32())) {
+        return NanThrowTypeError("Argument 0 must be a file descriptor or a path");
+    }
 
-    MYSQLRES_MUSTBE_VALID;
+    int arg_pos = 1;
+    bool tsv = false, header = false;
 
-    if (res->field_count > 0) {
-        NanReturnValue(Integer::NewFromUnsigned(res->field_count));
-    } else {
-        NanReturnUndefined();
+    if (args.Length() > 2) {
+        if (!args[1]->IsObject() || args[1]->IsFunction()) {
+            return NanThrowError("exportTo can handle only (target, options, callback) or (target, callback) arguments");
+        }
+
+        Local<Object> options = args[1]->ToObject();
+        if (options->Has(V8STR("format"))) {
+            String::Utf8Value format(options->Get(V8STR("format")));
+            if (strcmp(*format, "tsv") == 0) {
+                tsv = true;
+            } else if (strcmp(*format, "csv") != 0) {
+                return NanThrowError("Export format must be 'csv' or 'tsv'");
+            }
+        }
+        if (options->Has(V8STR("header"))) {
+            header = options->Get(V8STR("header"))->BooleanValue();
+        }
+        arg_pos++;
     }
-}
 
-/**
- * MysqlResult#dataSeekSync(offset)
- * - offset (Integer): The field offset
- *
- * Adjusts the result pointer to an arbitrary row in the result
- **/
-NAN_METHOD(MysqlResult::DataSeekSync) {
-    NanScope();
+    REQ_FUN_ARG(arg_pos, callback)
 
-    MysqlResult *res = OBJUNWRAP<MysqlResult>(args.Holder());
+    MysqlResult *res = OBJUNWRAP<MysqlResult>(args.Holder()); // NOLINT
 
     MYSQLRES_MUSTBE_VALID;
 
-    REQ_UINT_ARG(0, offset)
+    // Rows are fetched in threadpool from this cursor
+    MYSQLRES_RESTORE_CURSOR;
+    res->current_row_offset = NULL;
 
-    if (mysql_result_is_unbuffered(res->_res)) {
-        return NanThrowError("Function cannot be used with MYSQL_USE_RESULT");
-    }
+    exportTo_request *export_req = new exportTo_request;
 
-    if (offset >= mysql_num_rows(res->_res)) {
-        return NanThrowError("Invalid row offset");
+    export_req->nan_callback = new NanCallback(callback.As<Function>());
+
+    export_req->res = res;
+    res->Ref();
+
+    if (args[0]->IsString()) {
+        String::Utf8Value path(args[0]);
+        export_req->fd = -1;
+        export_req->path = *path;
+    } else {
+        export_req->fd = args[0]->Int32Value();
     }
+    export_req->tsv = tsv;
+    export_req->header = header;
 
-    mysql_data_seek(res->_res, offset);
+    res->SetFetching(true);
+
+    uv_work_t *_req = new uv_work_t;
+    _req->data = export_req;
+    uv_queue_work(uv_default_loop(), _req, EIO_ExportTo, (uv_after_work_cb)EIO_After_ExportTo);
 
     NanReturnUndefined();
 }
@@ -345,49 +1035,69 @@ void MysqlResult::EIO_After_FetchAll(uv_work_t *req) {
 
     struct fetchAll_request *fetchAll_req = (struct fetchAll_request *)(req->data);
 
+    if (fetchAll_req->walked) {
+        fetchAll_req->res->SetFetching(false);
+    }
+
     // We can't use const int argc here because argv is used
     // for both MysqlResult creation and callback call
     int argc = 1; // node.js convention, there is always at least one argument for callback
     Local<Value> argv[3];
 
     if (!fetchAll_req->ok) {
-        argv[0] = V8EXC("Error on fetching fields");
+        argv[0] = V8EXC(fetchAll_req->my_error.empty() ? "Error on fetching fields"
+                                                       : fetchAll_req->my_error.c_str());
+    } else if (fetchAll_req->fo.results_raw) {
+        Local<Object> js_raw = fetchAll_req->res->RawToObject(fetchAll_req->packed_data,
+                                                               fetchAll_req->packed_length,
+                                                               fetchAll_req->packed_cells);
+        argv[1] = js_raw;
+        argv[2] = js_raw->Get(V8STR("fields"));
+        argv[0] = NanNewLocal(Null());
+        argc = 3;
+    } else if (fetchAll_req->fo.results_lazy) {
+        argv[1] = fetchAll_req->res->LazyToArray(fetchAll_req->fo, fetchAll_req->packed_data,
+                                                 &fetchAll_req->packed_cells, fetchAll_req->packed_rows);
+        argv[2] = GetFieldsArray(fetchAll_req->fields, fetchAll_req->num_fields);
+        argv[0] = NanNewLocal(Null());
+        argc = 3;
     } else {
         MYSQL_FIELD *fields = fetchAll_req->fields;
         uint32_t num_fields = fetchAll_req->num_fields;
         MYSQL_ROW result_row;
         unsigned long *field_lengths;
         uint32_t i = 0, j = 0;
+        const char *json_error = NULL;
 
         // Get rows
         Local<Array> js_result = Array::New();
         Local<Object> js_result_row;
         Local<Value> js_field;
 
+        fetchAll_req->res->RestoreCursor();
+        fetchAll_req->res->current_row_offset = NULL;
+        fetchAll_req->res->ResetDictionary();
+
         i = 0;
-        while ((result_row = mysql_fetch_row(fetchAll_req->res->_res))) {
+        while (!json_error && (result_row = mysql_fetch_row(fetchAll_req->res->_res))) {
             field_lengths = mysql_fetch_lengths(fetchAll_req->res->_res);
 
-            if (fetchAll_req->fo.results_as_array) {
-              js_result_row = Array::New();
-            } else {
-              js_result_row = Object::New();
-            }
+            js_result_row = NewRow(fetchAll_req->fo);
 
             for (j = 0; j < num_fields; j++) {
-                js_field = GetFieldValue(fields[j], result_row[j], field_lengths[j]);
-
-                if (fetchAll_req->fo.results_as_array) {
-                    js_result_row->Set(Integer::NewFromUnsigned(j), js_field);
-                } else if (fetchAll_req->fo.results_nest_tables) {
-                    if (!js_result_row->Has(V8STR(fields[j].table))) {
-                        js_result_row->Set(V8STR(fields[j].table), Object::New());
+                if (fetchAll_req->fo.results_parse_json && result_row[j]
+                 && MysqlJsonTape::IsJsonField(fields[j])) {
+                    json_error = GetJsonFieldValue(&fetchAll_req->json, result_row[j],
+                                                   field_lengths[j], &js_field);
+                    if (json_error) {
+                        break;
                     }
-                    js_result_row->Get(V8STR(fields[j].table))->ToObject()
-                                 ->Set(V8STR(fields[j].name), js_field);
                 } else {
-                    js_result_row->Set(V8STR(fields[j].name), js_field);
+                    js_field = fetchAll_req->res->GetColumnValue(fields, j, result_row[j], field_lengths[j],
+                                                                 fetchAll_req->fo);
                 }
+
+                SetRowColumn(js_result_row, fields, j, js_field, fetchAll_req->fo);
             }
 
             js_result->Set(Integer::NewFromUnsigned(i), js_result_row);
@@ -395,7 +1105,9 @@ void MysqlResult::EIO_After_FetchAll(uv_work_t *req) {
             i++;
         }
 
-        if (i != mysql_num_rows(fetchAll_req->res->_res)) {
+        if (json_error) {
+            argv[0] = V8EXC(json_error);
+        } else if (i != mysql_num_rows(fetchAll_req->res->_res)) {
             unsigned int my_errno = mysql_errno(fetchAll_req->res->_conn);
             const char *my_error = mysql_error(fetchAll_req->res->_conn);
             unsigned long error_string_length = strlen(my_error) + 20;
@@ -409,18 +1121,8 @@ void MysqlResult::EIO_After_FetchAll(uv_work_t *req) {
             argv[0] = V8EXC(error_string);
             delete[] error_string;
         } else {
-            // Get fields info
-            Local<Array> js_fields = Array::New();
-
-            for (i = 0; i < num_fields; i++) {
-                js_result_row = Object::New();
-                AddFieldProperties(js_result_row, &fields[i]);
-
-                js_fields->Set(Integer::NewFromUnsigned(i), js_result_row);
-            }
-
             argv[1] = js_result;
-            argv[2] = js_fields;
+            argv[2] = GetFieldsArray(fields, num_fields);
             argv[0] = NanNewLocal(Null());
             argc = 3;
         }
@@ -453,27 +1155,93 @@ void MysqlResult::EIO_FetchAll(uv_work_t *req) {
     fetchAll_req->num_fields = mysql_num_fields(res->_res);
 
     fetchAll_req->ok = true;
+
+    if (!fetchAll_req->walked) {
+        return;
+    }
+
+    // Cursor is moved to this result in main thread, siblings are blocked by fetching flag
+    if (fetchAll_req->fo.results_raw || fetchAll_req->fo.results_lazy) {
+        // Lazy rows decode values from zero terminated strings
+        const char *pack_error = res->PackRows(fetchAll_req->fo.results_lazy, &fetchAll_req->packed_data,
+                                               &fetchAll_req->packed_length, &fetchAll_req->packed_cells,
+                                               &fetchAll_req->packed_rows);
+        if (pack_error) {
+            fetchAll_req->ok = false;
+            fetchAll_req->my_error = pack_error;
+        }
+        return;
+    }
+
+    // Parse JSON columns of stored rows here, main thread only builds values.
+    // Rows list is walked directly, so cursors used in main thread are not moved
+    std::vector<uint32_t> json_columns;
+    uint32_t j = 0;
+    for (j = 0; j < fetchAll_req->num_fields; j++) {
+        if (MysqlJsonTape::IsJsonField(fetchAll_req->fields[j])) {
+            json_columns.push_back(j);
+        }
+    }
+    if (json_columns.empty()) {
+        return;
+    }
+
+    parsed_json *parsed = &fetchAll_req->json;
+    parsed->tapes.reserve(mysql_num_rows(res->_res) * json_columns.size());
+
+    for (MYSQL_ROWS *row = res->_res->data->data; row; row = row->next) {
+        for (j = 0; j < json_columns.size(); j++) {
+            const char *field_value = row->data[json_columns[j]];
+            if (!field_value) {
+                continue;
+            }
+
+            // JSON text has no zero bytes
+            parsed->tapes.push_back(MysqlJsonTape());
+            if (!parsed->tapes.back().Parse(field_value, strlen(field_value))) {
+                fetchAll_req->ok = false;
+                fetchAll_req->my_error = "Invalid JSON value: " + parsed->tapes.back().Error();
+                return;
+            }
+            parsed->cells[field_value] = parsed->tapes.size() - 1;
+        }
+    }
 }
 
 /**
  * MysqlResult#fetchAll(callback)
  * MysqlResult#fetchAll(options, callback)
  * - options (Boolean|Object): Fetch style options (optional)
- * - callback (Function): Callback function, gets (error, rows)
+ * - callback (Function): Callback function, gets (error, rows, fields)
  *
- * Fetches all result rows as an array
+ * Fetches all result rows as an array.
+ * With {raw: true} option rows are {buffer, cells, fields} object:
+ * all values packed in one Buffer and Uint32Array of (offset, length) pairs
+ * per cell, offset is 0xFFFFFFFF for NULL values.
+ * With {lazy: true} option rows decode column values on first access,
+ * useful for wide tables when only a few columns are read.
+ * With {parseJSON: true} option JSON columns are parsed in threadpool
+ * and returned as objects instead of strings, other methods of the result
+ * throw until callback is called.
+ * DECIMAL columns are strings, {decimal: 'number'} option returns numbers,
+ * {decimal: 'scaled'} returns integer mantissas, scale is field `decimals`,
+ * mantissas out of exact numbers range are returned as digits strings,
+ * other modes than 'string', 'number' and 'scaled' throw TypeError.
+ * ENUM values are decoded once per result and shared between rows.
+ * With {dictionary: true} option SET arrays are shared too and frozen,
+ * and short text columns are shared while they have few distinct values
  **/
 NAN_METHOD(MysqlResult::FetchAll) {
     NanScope();
 
     int arg_pos = 0;
-    fetch_options fo = {false, false};
+    fetch_options fo;
     bool throw_wrong_arguments_exception = false;
 
     if (args.Length() > 0) {
         if (args[0]->IsObject()) { // Simple Object or Function
             if (!args[0]->IsFunction()) { // Simple Object - options hash
-                fo = MysqlResult::GetFetchOptions(args[0]->ToObject());
+                MYSQLRES_GET_FETCH_OPTIONS(args[0]->ToObject(), fo);
                 arg_pos++;
             }
         } else { // Not an options Object or a Function
@@ -500,10 +1268,24 @@ NAN_METHOD(MysqlResult::FetchAll) {
         return NanThrowError("You can't mix 'asArray' and 'nestTables' options");
     }
 
+    if ((fo.results_raw || fo.results_lazy) && (fo.results_as_array || fo.results_nest_tables)) {
+        return NanThrowError("You can't mix 'raw' or 'lazy' with 'asArray' or 'nestTables' options");
+    }
+
+    if (fo.results_raw && fo.results_lazy) {
+        return NanThrowError("You can't mix 'raw' and 'lazy' options");
+    }
+
     MysqlResult *res = OBJUNWRAP<MysqlResult>(args.Holder()); // NOLINT
 
     MYSQLRES_MUSTBE_VALID;
 
+    MYSQLRES_MUSTNOT_BE_FETCHING;
+
+    if ((fo.results_raw || fo.results_lazy) && mysql_result_is_unbuffered(res->_res)) {
+        return NanThrowError("Function cannot be used with MYSQL_USE_RESULT");
+    }
+
     fetchAll_request *fetchAll_req = new fetchAll_request;
 
     fetchAll_req->nan_callback = new NanCallback(callback.As<Function>());
@@ -512,6 +1294,20 @@ NAN_METHOD(MysqlResult::FetchAll) {
     res->Ref();
     
     fetchAll_req->fo = fo;
+    fetchAll_req->packed_data = NULL;
+    fetchAll_req->packed_length = 0;
+    fetchAll_req->packed_rows = 0;
+
+    // Stored rows are packed in threadpool for raw and lazy options,
+    // rows list is walked in threadpool for parseJSON option
+    fetchAll_req->walked = fo.results_raw || fo.results_lazy || (fo.results_parse_json && res->_res->data);
+    if (fetchAll_req->walked) {
+        if (fo.results_raw || fo.results_lazy) {
+            res->RestoreCursor();
+            res->current_row_offset = NULL;
+        }
+        res->SetFetching(true);
+    }
 
     uv_work_t *_req = new uv_work_t;
     _req->data = fetchAll_req;
@@ -521,10 +1317,10 @@ NAN_METHOD(MysqlResult::FetchAll) {
 }
 
 /**
- * MysqlResult#fetchAllSync([options]) -> Array
+ * MysqlResult#fetchAllSync([options]) -> Array|Object
  * - options (Object): Fetch style options (optional)
  *
- * Fetches all result rows as an array
+ * Fetches all result rows as an array, see MysqlResult#fetchAll() for raw and lazy options
  **/
 NAN_METHOD(MysqlResult::FetchAllSync) {
     NanScope();
@@ -533,53 +1329,93 @@ NAN_METHOD(MysqlResult::FetchAllSync) {
 
     MYSQLRES_MUSTBE_VALID;
 
-    fetch_options fo = {false, false};
+    MYSQLRES_RESTORE_CURSOR;
+
+    fetch_options fo;
 
     if (args.Length() > 0) {
         if (!args[0]->IsObject()) {
             return NanThrowError("fetchAllSync can handle only (options) or none arguments");
         }
-        fo = MysqlResult::GetFetchOptions(args[0]->ToObject());
+        MYSQLRES_GET_FETCH_OPTIONS(args[0]->ToObject(), fo);
     }
 
     if (fo.results_as_array && fo.results_nest_tables) {
         return NanThrowError("You can't mix 'asArray' and 'nestTables' options");
     }
 
+    if (fo.results_raw || fo.results_lazy) {
+        if (fo.results_as_array || fo.results_nest_tables) {
+            return NanThrowError("You can't mix 'raw' or 'lazy' with 'asArray' or 'nestTables' options");
+        }
+        if (fo.results_raw && fo.results_lazy) {
+            return NanThrowError("You can't mix 'raw' and 'lazy' options");
+        }
+        if (mysql_result_is_unbuffered(res->_res)) {
+            return NanThrowError("Function cannot be used with MYSQL_USE_RESULT");
+        }
+    }
+
+    if (fo.results_lazy) {
+        Local<Array> js_rows;
+        const char *lazy_error;
+
+        res->current_row_offset = NULL;
+
+        lazy_error = res->FetchLazy(fo, &js_rows);
+        if (lazy_error) {
+            return NanThrowError(lazy_error);
+        }
+
+        NanReturnValue(js_rows);
+    }
+
+    if (fo.results_raw) {
+        Local<Object> js_raw;
+        const char *raw_error;
+
+        res->current_row_offset = NULL;
+
+        raw_error = res->FetchRaw(&js_raw);
+        if (raw_error) {
+            return NanThrowError(raw_error);
+        }
+
+        NanReturnValue(js_raw);
+    }
+
     MYSQL_FIELD *fields = mysql_fetch_fields(res->_res);
     uint32_t num_fields = mysql_num_fields(res->_res);
     MYSQL_ROW result_row;
     unsigned long *field_lengths;
     uint32_t i = 0, j = 0;
+    parsed_json json;
+    const char *json_error = NULL;
 
     Local<Array> js_result = Array::New();
     Local<Object> js_result_row;
     Local<Value> js_field;
 
+    res->current_row_offset = NULL;
+    res->ResetDictionary();
+
     i = 0;
     while ( (result_row = mysql_fetch_row(res->_res)) ) {
         field_lengths = mysql_fetch_lengths(res->_res);
 
-        if (fo.results_as_array) {
-            js_result_row = Array::New();
-        } else {
-            js_result_row = Object::New();
-        }
+        js_result_row = NewRow(fo);
 
         for (j = 0; j < num_fields; j++) {
-            js_field = GetFieldValue(fields[j], result_row[j], field_lengths[j]);
-
-            if (fo.results_as_array) {
-                js_result_row->Set(Integer::NewFromUnsigned(j), js_field);
-            } else if (fo.results_nest_tables) {
-                if (!js_result_row->Has(V8STR(fields[j].table))) {
-                    js_result_row->Set(V8STR(fields[j].table), Object::New());
+            if (fo.results_parse_json && result_row[j] && MysqlJsonTape::IsJsonField(fields[j])) {
+                json_error = GetJsonFieldValue(&json, result_row[j], field_lengths[j], &js_field);
+                if (json_error) {
+                    return NanThrowError(json_error);
                 }
-                js_result_row->Get(V8STR(fields[j].table))->ToObject()
-                             ->Set(V8STR(fields[j].name), js_field);
             } else {
-                js_result_row->Set(V8STR(fields[j].name), js_field);
+                js_field = res->GetColumnValue(fields, j, result_row[j], field_lengths[j], fo);
             }
+
+            SetRowColumn(js_result_row, fields, j, js_field, fo);
         }
 
         js_result->Set(Integer::NewFromUnsigned(i), js_result_row);
@@ -590,6 +1426,296 @@ NAN_METHOD(MysqlResult::FetchAllSync) {
     NanReturnValue(js_result);
 }
 
+/*!
+ * EIO wrapper functions for MysqlResult::FetchAllJSON
+ */
+void MysqlResult::EIO_After_FetchAllJSON(uv_work_t *req) {
+    NanScope();
+
+    struct fetchAllJSON_request *json_req = (struct fetchAllJSON_request *)(req->data);
+
+    int argc = 1;
+    Local<Value> argv[2];
+
+    if (!json_req->ok) {
+        MysqlJsonWriter::FreeBuffer(json_req->data, NULL);
+        argv[0] = V8EXC(json_req->my_error.c_str());
+    } else {
+        // Buffer owns serialized rows
+        argv[1] = NanNewBufferHandle(json_req->data, json_req->length, MysqlJsonWriter::FreeBuffer, NULL);
+        argv[0] = NanNewLocal(Null());
+        argc = 2;
+    }
+
+    json_req->res->SetFetching(false);
+
+    json_req->nan_callback->Call(argc, argv);
+    delete json_req->nan_callback;
+
+    json_req->res->Unref();
+
+    delete json_req;
+    delete req;
+}
+
+void MysqlResult::EIO_FetchAllJSON(uv_work_t *req) {
+    struct fetchAllJSON_request *json_req = (struct fetchAllJSON_request *)(req->data);
+    MysqlResult *res = json_req->res;
+
+    MYSQL_ROW result_row;
+    bool unbuffered = mysql_result_is_unbuffered(res->_res);
+
+    MysqlJsonWriter writer(mysql_fetch_fields(res->_res), mysql_num_fields(res->_res),
+                           json_req->fo.results_as_array, json_req->fo.results_nest_tables,
+                           json_req->fo.results_parse_json, json_req->fo.results_decimal);
+
+    // Unbuffered rows are read from connection socket
+    if (unbuffered && res->connection) {
+        res->connection->LockQuery();
+    }
+
+    while ((result_row = mysql_fetch_row(res->_res))) {
+        writer.AppendRow(result_row, mysql_fetch_lengths(res->_res), false);
+    }
+
+    json_req->data = writer.Release(&json_req->length);
+
+    json_req->ok = !(unbuffered && mysql_errno(res->_conn));
+    if (!json_req->ok) {
+        char error_string[32];
+        snprintf(error_string, sizeof(error_string), "Fetch error #%d: ", mysql_errno(res->_conn));
+        json_req->my_error = std::string(error_string) + mysql_error(res->_conn);
+    }
+
+    if (unbuffered && res->connection) {
+        res->connection->UnlockQuery();
+    }
+}
+
+/**
+ * MysqlResult#fetchAllJSON(callback)
+ * MysqlResult#fetchAllJSON(options, callback)
+ * - options (Object): Fetch style options (optional)
+ * - callback (Function): Callback function, gets (error, buffer)
+ *
+ * Serializes all result rows to UTF-8 JSON array in threadpool,
+ * values are the same as JSON.stringify(rows) gives for fetchAll() rows,
+ * invalid UTF-8 bytes are replaced with U+FFFD.
+ * Supports asArray, nestTables, parseJSON and decimal options.
+ * Other methods of the result throw until callback is called
+ **/
+NAN_METHOD(MysqlResult::FetchAllJSON) {
+    NanScope();
+
+    int arg_pos = 0;
+    fetch_options fo;
+
+    if (args.Length() > 1) {
+        if (!args[0]->IsObject() || args[0]->IsFunction()) {
+            return NanThrowError("fetchAllJSON can handle only (options, callback) or (callback) arguments");
+        }
+        MYSQLRES_GET_FETCH_OPTIONS(args[0]->ToObject(), fo);
+        arg_pos++;
+    }
+
+    REQ_FUN_ARG(arg_pos, callback)
+
+    if (fo.results_as_array && fo.results_nest_tables) {
+        return NanThrowError("You can't mix 'asArray' and 'nestTables' options");
+    }
+
+    if (fo.results_raw || fo.results_lazy) {
+        return NanThrowError("Options 'raw' and 'lazy' are not supported by fetchAllJSON()");
+    }
+
+    MysqlResult *res = OBJUNWRAP<MysqlResult>(args.Holder()); // NOLINT
+
+    MYSQLRES_MUSTBE_VALID;
+
+    // Rows are fetched in threadpool from this cursor
+    MYSQLRES_RESTORE_CURSOR;
+    res->current_row_offset = NULL;
+
+    fetchAllJSON_request *json_req = new fetchAllJSON_request;
+
+    json_req->nan_callback = new NanCallback(callback.As<Function>());
+
+    json_req->res = res;
+    res->Ref();
+
+    json_req->fo = fo;
+    json_req->data = NULL;
+    json_req->length = 0;
+
+    res->SetFetching(true);
+
+    uv_work_t *_req = new uv_work_t;
+    _req->data = json_req;
+    uv_queue_work(uv_default_loop(), _req, EIO_FetchAllJSON, (uv_after_work_cb)EIO_After_FetchAllJSON);
+
+    NanReturnUndefined();
+}
+
+/*!
+ * EIO wrapper functions for MysqlResult::FetchArrow
+ */
+void MysqlResult::EIO_After_FetchArrow(uv_work_t *req) {
+    NanScope();
+
+    struct fetchArrow_request *arrow_req = (struct fetchArrow_request *)(req->data);
+
+    int argc = 1;
+    Local<Value> argv[2];
+    size_t i;
+
+    if (!arrow_req->ok) {
+        for (i = 0; i < arrow_req->messages.size(); i++) {
+            MysqlArrowWriter::FreeBuffer(arrow_req->messages[i].first, NULL);
+        }
+        argv[0] = V8EXC(arrow_req->my_error.c_str());
+    } else {
+        Local<Array> js_buffers = Array::New(arrow_req->messages.size());
+
+        // Buffers own messages memory
+        for (i = 0; i < arrow_req->messages.size(); i++) {
+            js_buffers->Set(Integer::NewFromUnsigned(i),
+                            NanNewBufferHandle(arrow_req->messages[i].first, arrow_req->messages[i].second,
+                                               MysqlArrowWriter::FreeBuffer, NULL));
+        }
+
+        argv[1] = js_buffers;
+        argv[0] = NanNewLocal(Null());
+        argc = 2;
+    }
+
+    arrow_req->res->SetFetching(false);
+
+    arrow_req->nan_callback->Call(argc, argv);
+    delete arrow_req->nan_callback;
+
+    arrow_req->res->Unref();
+
+    delete arrow_req;
+    delete req;
+}
+
+void MysqlResult::EIO_FetchArrow(uv_work_t *req) {
+    struct fetchArrow_request *arrow_req = (struct fetchArrow_request *)(req->data);
+    MysqlResult *res = arrow_req->res;
+
+    MYSQL_ROW result_row;
+    bool unbuffered = mysql_result_is_unbuffered(res->_res);
+    char *data;
+    size_t length;
+
+    MysqlArrowWriter writer(mysql_fetch_fields(res->_res), mysql_num_fields(res->_res),
+                            arrow_req->fo.results_decimal);
+
+    data = writer.SchemaMessage(&length);
+    arrow_req->messages.push_back(std::make_pair(data, length));
+
+    // Unbuffered rows are read from connection socket
+    if (unbuffered && res->connection) {
+        res->connection->LockQuery();
+    }
+
+    while ((result_row = mysql_fetch_row(res->_res))) {
+        writer.AppendRow(result_row, mysql_fetch_lengths(res->_res));
+
+        if (writer.BatchFull()) {
+            data = writer.BatchMessage(&length);
+            arrow_req->messages.push_back(std::make_pair(data, length));
+        }
+    }
+
+    if ((data = writer.BatchMessage(&length))) {
+        arrow_req->messages.push_back(std::make_pair(data, length));
+    }
+
+    data = MysqlArrowWriter::EndOfStream(&length);
+    arrow_req->messages.push_back(std::make_pair(data, length));
+
+    arrow_req->ok = !(unbuffered && mysql_errno(res->_conn));
+    if (!arrow_req->ok) {
+        char error_string[32];
+        snprintf(error_string, sizeof(error_string), "Fetch error #%d: ", mysql_errno(res->_conn));
+        arrow_req->my_error = std::string(error_string) + mysql_error(res->_conn);
+    }
+
+    if (unbuffered && res->connection) {
+        res->connection->UnlockQuery();
+    }
+
+    if (!arrow_req->ok) {
+        return;
+    }
+
+    for (size_t i = 0; i < arrow_req->messages.size(); i++) {
+        if (!arrow_req->messages[i].first) {
+            arrow_req->ok = false;
+            arrow_req->my_error = "Not enough memory for Arrow record batch";
+            return;
+        }
+    }
+
+    arrow_req->ok = true;
+}
+
+/**
+ * MysqlResult#fetchArrow(callback)
+ * MysqlResult#fetchArrow(options, callback)
+ * - options (Object): Fetch options, only `decimal` is used (optional)
+ * - callback (Function): Callback function, gets (error, buffers)
+ *
+ * Converts all result rows to Arrow IPC stream format in threadpool.
+ * Buffers are schema message, record batches and end-of-stream marker,
+ * Buffer.concat(buffers) is a complete stream.
+ * DECIMAL columns are Utf8, float64 with {decimal: 'number'} option
+ * and Decimal128 with {decimal: 'scaled'} option.
+ * Other methods of the result throw until callback is called
+ **/
+NAN_METHOD(MysqlResult::FetchArrow) {
+    NanScope();
+
+    int arg_pos = 0;
+    fetch_options fo;
+
+    if (args.Length() > 1) {
+        if (!args[0]->IsObject() || args[0]->IsFunction()) {
+            return NanThrowError("fetchArrow can handle only (options, callback) or (callback) arguments");
+        }
+        MYSQLRES_GET_FETCH_OPTIONS(args[0]->ToObject(), fo);
+        arg_pos++;
+    }
+
+    REQ_FUN_ARG(arg_pos, callback)
+
+    MysqlResult *res = OBJUNWRAP<MysqlResult>(args.Holder()); // NOLINT
+
+    MYSQLRES_MUSTBE_VALID;
+
+    // Rows are fetched in threadpool from this cursor
+    MYSQLRES_RESTORE_CURSOR;
+    res->current_row_offset = NULL;
+
+    fetchArrow_request *arrow_req = new fetchArrow_request;
+
+    arrow_req->nan_callback = new NanCallback(callback.As<Function>());
+
+    arrow_req->res = res;
+    res->Ref();
+
+    arrow_req->fo = fo;
+
+    res->SetFetching(true);
+
+    uv_work_t *_req = new uv_work_t;
+    _req->data = arrow_req;
+    uv_queue_work(uv_default_loop(), _req, EIO_FetchArrow, (uv_after_work_cb)EIO_After_FetchArrow);
+
+    NanReturnUndefined();
+}
+
 /**
  * MysqlResult#fetchFieldSync() -> Object
  *
@@ -602,6 +1728,8 @@ NAN_METHOD(MysqlResult::FetchFieldSync) {
 
     MYSQLRES_MUSTBE_VALID;
 
+    MYSQLRES_RESTORE_CURSOR;
+
     MYSQL_FIELD *field;
 
     Local<Object> js_result;
@@ -692,6 +1820,8 @@ NAN_METHOD(MysqlResult::FetchLengthsSync) {
 
     MYSQLRES_MUSTBE_VALID;
 
+    MYSQLRES_RESTORE_CURSOR;
+
     uint32_t num_fields = mysql_num_fields(res->_res);
     unsigned long int *lengths = mysql_fetch_lengths(res->_res); // NOLINT
     uint32_t i = 0;
@@ -723,13 +1853,15 @@ NAN_METHOD(MysqlResult::FetchRowSync) {
 
     MYSQLRES_MUSTBE_VALID;
 
-    fetch_options fo = {false, false};
+    MYSQLRES_RESTORE_CURSOR;
+
+    fetch_options fo;
 
     if (args.Length() > 0) {
         if (!args[0]->IsObject()) {
             return NanThrowError("fetchRowSync can handle only (options) or none arguments");
         }
-        fo = MysqlResult::GetFetchOptions(args[0]->ToObject());
+        MYSQLRES_GET_FETCH_OPTIONS(args[0]->ToObject(), fo);
     }
 
     if (fo.results_as_array && fo.results_nest_tables) {
@@ -743,7 +1875,10 @@ NAN_METHOD(MysqlResult::FetchRowSync) {
     Local<Object> js_result_row;
     Local<Value> js_field;
 
+    MYSQL_ROW_OFFSET row_offset = res->shared ? mysql_row_tell(res->_res) : NULL;
     MYSQL_ROW result_row = mysql_fetch_row(res->_res);
+    res->current_row_offset = result_row ? row_offset : NULL;
+    res->ResetDictionary();
 
     if (!result_row) {
         NanReturnValue(False());
@@ -751,26 +1886,12 @@ NAN_METHOD(MysqlResult::FetchRowSync) {
 
     unsigned long *field_lengths = mysql_fetch_lengths(res->_res);
 
-    if (fo.results_as_array) {
-        js_result_row = Array::New();
-    } else {
-        js_result_row = Object::New();
-    }
+    js_result_row = NewRow(fo);
 
     for (j = 0; j < num_fields; j++) {
-        js_field = GetFieldValue(fields[j], result_row[j], field_lengths[j]);
+        js_field = res->GetColumnValue(fields, j, result_row[j], field_lengths[j], fo);
 
-        if (fo.results_as_array) {
-            js_result_row->Set(Integer::NewFromUnsigned(j), js_field);
-        } else if (fo.results_nest_tables) {
-            if (!js_result_row->Has(V8STR(fields[j].table))) {
-                js_result_row->Set(V8STR(fields[j].table), Object::New());
-            }
-            js_result_row->Get(V8STR(fields[j].table))->ToObject()
-                         ->Set(V8STR(fields[j].name), js_field);
-        } else {
-            js_result_row->Set(V8STR(fields[j].name), js_field);
-        }
+        SetRowColumn(js_result_row, fields, j, js_field, fo);
     }
 
     NanReturnValue(js_result_row);
@@ -789,6 +1910,8 @@ NAN_METHOD(MysqlResult::FieldSeekSync) {
 
     MYSQLRES_MUSTBE_VALID;
 
+    MYSQLRES_RESTORE_CURSOR;
+
     REQ_UINT_ARG(0, field_num)
 
     if (field_num >= res->field_count) {
@@ -812,6 +1935,8 @@ NAN_METHOD(MysqlResult::FieldTellSync) {
 
     MYSQLRES_MUSTBE_VALID;
 
+    MYSQLRES_RESTORE_CURSOR;
+
     NanReturnValue(Integer::NewFromUnsigned(mysql_field_tell(res->_res)));
 }
 
@@ -827,6 +1952,8 @@ NAN_METHOD(MysqlResult::FreeSync) {
 
     MYSQLRES_MUSTBE_VALID;
 
+    MYSQLRES_MUSTNOT_BE_FETCHING;
+
     res->Free();
 
     NanReturnUndefined();
@@ -15,9 +15,21 @@
 #include <node_version.h>
 #include <node_buffer.h>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
 #include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "./mysql_bindings.h"
+#include "./mysql_bindings_arrow.h"
+#include "./mysql_bindings_dictionary.h"
+#include "./mysql_bindings_json.h"
 
 #define mysql_result_is_unbuffered(r) \
 ((r)->handle && (r)->handle->status == MYSQL_STATUS_USE_RESULT)
@@ -27,6 +39,42 @@
         return NanThrowError("Result has been freed."); \
     }
 
+// Rows are walked in threadpool by fetchAll(), fetchAllJSON(), fetchArrow() or exportTo()
+#define MYSQLRES_MUSTNOT_BE_FETCHING \
+    if (res->Fetching()) { \
+        return NanThrowError("Result is being fetched in threadpool"); \
+    }
+
+// Shared cursors must not be moved while rows are walked in threadpool
+#define MYSQLRES_RESTORE_CURSOR \
+    MYSQLRES_MUSTNOT_BE_FETCHING; \
+    res->RestoreCursor();
+
+// Fetch options from JS object, unknown decimal mode is an error
+#define MYSQLRES_GET_FETCH_OPTIONS(options, fo) \
+    if (!MysqlResult::GetFetchOptions(options, &fo)) { \
+        return NanThrowTypeError("Option 'decimal' must be 'string', 'number' or 'scaled'"); \
+    }
+
+// Buffered writer size for exportTo()
+#define MYSQLRES_EXPORT_BUFFER_SIZE (1024 * 1024)
+
+class MysqlConnection;
+class MysqlResult;
+
+/*!
+ * Result set shared by several MysqlResult objects,
+ * used for coalesced queries. Each MysqlResult keeps its own
+ * row and field cursors, see MysqlResult::RestoreCursor()
+ */
+struct MysqlSharedResult {
+    MYSQL_RES *res;
+    unsigned int refs;
+    MysqlResult *cursor_owner;
+    // One of results walks rows in threadpool
+    bool fetching;
+};
+
 /** section: Classes
  * class MysqlResult
  *
@@ -38,17 +86,58 @@ class MysqlResult : public node::ObjectWrap {
 
     static void Init(Handle<Object> target);
 
-    static Local<Object> NewInstance(MYSQL *my_conn, MYSQL_RES *my_result, uint32_t field_count);
+    static Local<Object> NewInstance(MYSQL *my_conn, MYSQL_RES *my_result, uint32_t field_count,
+                                     MysqlSharedResult *shared = NULL);
 
     static void AddFieldProperties(Local<Object> &js_field_obj, MYSQL_FIELD *field);
 
-    static Local<Value> GetFieldValue(MYSQL_FIELD field, char* field_value, unsigned long field_length);
+    static Local<Value> GetFieldValue(MYSQL_FIELD field, char* field_value, unsigned long field_length,
+                                      MysqlBindingsDecimalMode decimal = MYSQL_BINDINGS_DECIMAL_STRING);
+
+    static Local<Array> GetSetValue(const char *field_value, unsigned long field_length);
+
+    static Local<Value> GetDecimalValue(const MYSQL_FIELD &field, const char *field_value,
+                                        unsigned long field_length, MysqlBindingsDecimalMode decimal);
 
     struct fetch_options {
+        // Defaults of fetch methods called without options
+        fetch_options()
+            : results_as_array(false), results_nest_tables(false), results_raw(false),
+              results_lazy(false), results_parse_json(false),
+              results_decimal(MYSQL_BINDINGS_DECIMAL_STRING), results_dictionary(false) {}
+
         bool results_as_array;
         bool results_nest_tables;
+        bool results_raw;
+        bool results_lazy;
+        bool results_parse_json;
+        MysqlBindingsDecimalMode results_decimal;
+        bool results_dictionary;
     };
-    static fetch_options GetFetchOptions(Local<Object> options);
+    static bool GetFetchOptions(Local<Object> options, fetch_options *fo);
+
+    static Local<Array> GetFieldsArray(MYSQL_FIELD *fields, uint32_t num_fields);
+
+    // Rows of asArray, nestTables or default style, shared by fetch methods
+    static Local<Object> NewRow(const fetch_options &fo);
+    static void SetRowColumn(Local<Object> js_row, MYSQL_FIELD *fields, uint32_t column,
+                             Local<Value> js_field, const fetch_options &fo);
+
+    // JSON columns values parsed with MysqlJsonTape, keyed by value pointer
+    struct parsed_json {
+        std::map<const char *, size_t> cells;
+        std::vector<MysqlJsonTape> tapes;
+
+        // Values not parsed in threadpool
+        MysqlJsonTape scratch;
+        std::string error;
+    };
+    static const char *GetJsonFieldValue(parsed_json *parsed, const char *field_value,
+                                         unsigned long field_length, Local<Value> *js_field);
+
+    // Unbuffered results read rows from connection socket,
+    // so connection is kept alive and locked while rows are fetched in threadpool
+    void SetConnection(MysqlConnection *connection, Local<Object> js_connection);
 
     void Free();
 
@@ -56,15 +145,50 @@ class MysqlResult : public node::ObjectWrap {
     MYSQL *_conn;
     MYSQL_RES *_res;
 
+    MysqlConnection *connection;
+    Persistent<Object> js_connection;
+
     uint32_t field_count;
 
+    // Shared result set and own cursors in it
+    MysqlSharedResult *shared;
+    MYSQL_ROW_OFFSET row_cursor;
+    MYSQL_ROW_OFFSET current_row_offset;
+    MYSQL_FIELD_OFFSET field_cursor;
+
+    // Decoded ENUM, SET and low-cardinality values, created on first fetch
+    MysqlDictionary *dictionary;
+
+    // Rows are walked in threadpool, main thread must not touch them,
+    // flag of shared result set is used for coalesced results
+    bool fetching;
+    bool Fetching() const {
+        return shared ? shared->fetching : fetching;
+    }
+    void SetFetching(bool value);
+
+    void RestoreCursor();
+
+    void ResetDictionary();
+
+    Local<Value> GetColumnValue(MYSQL_FIELD *fields, uint32_t column, char *field_value,
+                                unsigned long field_length, const fetch_options &fo);
+
     MysqlResult();
 
-    explicit MysqlResult(MYSQL *my_connection, MYSQL_RES *my_result, uint32_t my_field_count):
+    explicit MysqlResult(MYSQL *my_connection, MYSQL_RES *my_result, uint32_t my_field_count,
+                         MysqlSharedResult *my_shared):
         ObjectWrap(),
         _conn(my_connection),
         _res(my_result),
-        field_count(my_field_count) {}
+        connection(NULL),
+        field_count(my_field_count),
+        shared(my_shared),
+        row_cursor(my_shared ? mysql_row_tell(my_result) : NULL),
+        current_row_offset(NULL),
+        field_cursor(0),
+        dictionary(NULL),
+        fetching(false) {}
 
     ~MysqlResult();
 
@@ -80,6 +204,16 @@ class MysqlResult : public node::ObjectWrap {
 
     static NAN_METHOD(DataSeekSync);
 
+    // Rows packed to one memory block for fetchAll({raw: true}) and fetchAll({lazy: true})
+    const char *PackRows(bool zero_terminated, char **data, uint64_t *data_length,
+                         std::vector<uint32_t> *cells, size_t *row_count);
+    static void FreeRawBuffer(char *data, void *hint);
+    const char *FetchRaw(Local<Object> *js_raw);
+    Local<Object> RawToObject(char *data, uint64_t data_length, const std::vector<uint32_t> &cells);
+    const char *FetchLazy(const fetch_options &fo, Local<Array> *js_rows);
+    Local<Array> LazyToArray(const fetch_options &fo, char *data, std::vector<uint32_t> *cells,
+                             size_t row_count);
+
     struct fetchAll_request {
         bool ok;
         
@@ -90,6 +224,18 @@ class MysqlResult : public node::ObjectWrap {
         uint32_t num_fields;
 
         fetch_options fo;
+        // Stored rows are walked in threadpool
+        bool walked;
+
+        // Packed in threadpool for {raw: true} and {lazy: true}, see PackRows()
+        char *packed_data;
+        uint64_t packed_length;
+        std::vector<uint32_t> packed_cells;
+        size_t packed_rows;
+
+        // Parsed in threadpool for {parseJSON: true}
+        parsed_json json;
+        std::string my_error;
     };
     static void EIO_After_FetchAll(uv_work_t *req);
     static void EIO_FetchAll(uv_work_t *req);
@@ -97,6 +243,61 @@ class MysqlResult : public node::ObjectWrap {
 
     static NAN_METHOD(FetchAllSync);
 
+    struct fetchAllJSON_request {
+        bool ok;
+
+        NanCallback *nan_callback;
+        MysqlResult *res;
+
+        fetch_options fo;
+
+        char *data;
+        size_t length;
+        std::string my_error;
+    };
+    static void EIO_After_FetchAllJSON(uv_work_t *req);
+    static void EIO_FetchAllJSON(uv_work_t *req);
+    static NAN_METHOD(FetchAllJSON);
+
+    struct fetchArrow_request {
+        bool ok;
+
+        NanCallback *nan_callback;
+        MysqlResult *res;
+
+        fetch_options fo;
+
+        // Encapsulated IPC messages, see MysqlArrowWriter
+        std::vector<std::pair<char *, size_t> > messages;
+        std::string my_error;
+    };
+    static void EIO_After_FetchArrow(uv_work_t *req);
+    static void EIO_FetchArrow(uv_work_t *req);
+    static NAN_METHOD(FetchArrow);
+
+    struct exportTo_request {
+        bool ok;
+
+        NanCallback *nan_callback;
+        MysqlResult *res;
+
+        // Path is opened in threadpool, fd is not closed
+        int fd;
+        std::string path;
+        bool tsv;
+        bool header;
+
+        std::vector<char> buffer;
+        uint64_t row_count;
+        std::string my_error;
+    };
+    static bool ExportFlush(exportTo_request *export_req);
+    static void ExportAppend(exportTo_request *export_req, const char *data, size_t length);
+    static void ExportAppendField(exportTo_request *export_req, const char *value, size_t length);
+    static void EIO_After_ExportTo(uv_work_t *req);
+    static void EIO_ExportTo(uv_work_t *req);
+    static NAN_METHOD(ExportTo);
+
     static NAN_METHOD(FetchFieldSync);
 
     static NAN_METHOD(FetchFieldDirectSync);
@@ -0,0 +1,633 @@
+/*!
+ * Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+ * See contributors list in README
+ *
+ * See license text in LICENSE file
+ */
+
+/*!
+ * Include headers
+ */
+#include <strings.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "./mysql_bindings_connection.h"
+#include "./mysql_bindings_result.h"
+#include "./mysql_bindings_shard_router.h"
+
+/*!
+ * Init V8 structures for MysqlShardRouter class
+ */
+Persistent<FunctionTemplate> MysqlShardRouter::constructor_template;
+
+void MysqlShardRouter::Init(Handle<Object> target) {
+    NanScope();
+
+    // Constructor template
+    Local<FunctionTemplate> tpl = FunctionTemplate::New(New);
+    NanAssignPersistent(FunctionTemplate, constructor_template, tpl);
+    tpl->SetClassName(NanSymbol("MysqlShardRouter"));
+
+    // Instance template
+    Local<ObjectTemplate> instance_template = tpl->InstanceTemplate();
+    instance_template->SetInternalFieldCount(1);
+
+    // Prototype methods
+    NODE_SET_PROTOTYPE_METHOD(tpl, "addShardSync",    AddShardSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "getShardSync",    GetShardSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "removeShardSync", RemoveShardSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "scatter",         Scatter);
+
+    // Make it visible in JavaScript land
+    target->Set(NanSymbol("MysqlShardRouter"), tpl->GetFunction());
+}
+
+/*!
+ * FNV-1a with murmur3 finalizer, so similar keys
+ * such as virtual nodes names spread over the whole ring
+ */
+uint32_t MysqlShardRouter::Hash(const char *key, size_t key_len) {
+    uint32_t hash = 2166136261U;
+
+    for (size_t i = 0; i < key_len; i++) {
+        hash ^= static_cast<unsigned char>(key[i]);
+        hash *= 16777619U;
+    }
+
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bU;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35U;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
+/*!
+ * Places virtual nodes "<shard>#<n>" of every shard on the ring
+ */
+void MysqlShardRouter::RebuildRing() {
+    this->ring.clear();
+    this->ring.reserve(this->shards.size() * this->virtual_nodes);
+
+    for (uint32_t shard = 0; shard < this->shards.size(); shard++) {
+        for (uint32_t i = 0; i < this->virtual_nodes; i++) {
+            char suffix[16];
+            snprintf(suffix, sizeof(suffix), "#%u", i);
+
+            std::string node_key = this->shards[shard] + suffix;
+
+            ring_point point;
+            point.hash = Hash(node_key.c_str(), node_key.length());
+            point.shard = shard;
+
+            this->ring.push_back(point);
+        }
+    }
+
+    ring_order order;
+    order.shards = &this->shards;
+    std::sort(this->ring.begin(), this->ring.end(), order);
+}
+
+/**
+ * new MysqlShardRouter([virtualNodes])
+ * - virtualNodes (Integer): Points on the hash ring per shard, 160 by default
+ *
+ * Creates new MysqlShardRouter object
+ **/
+NAN_METHOD(MysqlShardRouter::New) {
+    NanScope();
+
+    uint32_t virtual_nodes = MYSQLSHARD_DEFAULT_VIRTUAL_NODES;
+    if (args.Length() > 0 && !args[0]->IsUndefined()) {
+        if (!args[0]->IsUint32() || args[0]->Uint32Value() == 0) {
+            return NanThrowTypeError("Virtual nodes count must be a positive integer");
+        }
+        virtual_nodes = args[0]->Uint32Value();
+    }
+
+    MysqlShardRouter *router = new MysqlShardRouter(virtual_nodes);
+    router->Wrap(args.Holder());
+
+    NanReturnValue(args.Holder());
+}
+
+/**
+ * MysqlShardRouter#addShardSync(name) -> Integer
+ * - name (String): Shard name
+ *
+ * Adds shard to the hash ring, returns shards count.
+ * Keys move only to the new shard, others keep their shards
+ **/
+NAN_METHOD(MysqlShardRouter::AddShardSync) {
+    NanScope();
+
+    REQ_STR_ARG(0, name);
+
+    MysqlShardRouter *router = OBJUNWRAP<MysqlShardRouter>(args.Holder());
+
+    std::string shard_name(*name, name.length());
+
+    if (std::find(router->shards.begin(), router->shards.end(), shard_name) != router->shards.end()) {
+        return NanThrowError("Shard already exists");
+    }
+
+    router->shards.push_back(shard_name);
+    router->RebuildRing();
+
+    NanReturnValue(Integer::NewFromUnsigned(router->shards.size()));
+}
+
+/**
+ * MysqlShardRouter#getShardSync(key) -> String
+ * - key (String|Number): Sharding key
+ *
+ * Gets name of the shard the key belongs to
+ **/
+NAN_METHOD(MysqlShardRouter::GetShardSync) {
+    NanScope();
+
+    if (args.Length() < 1 || !(args[0]->IsString() || args[0]->IsNumber())) {
+        return NanThrowTypeError("Argument 0 must be a string or a number");
+    }
+
+    MysqlShardRouter *router = OBJUNWRAP<MysqlShardRouter>(args.Holder());
+
+    if (router->ring.empty()) {
+        return NanThrowError("There are no shards");
+    }
+
+    String::Utf8Value key(args[0]->ToString());
+
+    // First point clockwise from the key hash
+    ring_point point;
+    point.hash = Hash(*key, key.length());
+    point.shard = 0;
+
+    std::vector<ring_point>::const_iterator it =
+        std::lower_bound(router->ring.begin(), router->ring.end(), point);
+    if (it == router->ring.end()) {
+        it = router->ring.begin();
+    }
+
+    const std::string &shard_name = router->shards[it->shard];
+
+    NanReturnValue(V8STR2(shard_name.c_str(), shard_name.length()));
+}
+
+/**
+ * MysqlShardRouter#removeShardSync(name) -> Boolean
+ * - name (String): Shard name
+ *
+ * Removes shard from the hash ring, its keys move to the remaining shards
+ **/
+NAN_METHOD(MysqlShardRouter::RemoveShardSync) {
+    NanScope();
+
+    REQ_STR_ARG(0, name);
+
+    MysqlShardRouter *router = OBJUNWRAP<MysqlShardRouter>(args.Holder());
+
+    std::vector<std::string>::iterator it =
+        std::find(router->shards.begin(), router->shards.end(), std::string(*name, name.length()));
+    if (it == router->shards.end()) {
+        NanReturnValue(False());
+    }
+
+    router->shards.erase(it);
+    router->RebuildRing();
+
+    NanReturnValue(True());
+}
+
+/*!
+ * Compares rows by orderBy columns like MySQL does:
+ * NULL is the smallest value, numbers are compared as numbers,
+ * other values are compared bytewise
+ */
+int MysqlShardRouter::CompareRows(const scatter_request *scatter_req,
+                                  const merged_row &a,
+                                  const merged_row &b) {
+    for (size_t i = 0; i < scatter_req->order_by.size(); i++) {
+        const order_column &column = scatter_req->order_by[i];
+        const MYSQL_FIELD &field = scatter_req->fields[column.index];
+        const char *value_a = a.row[column.index];
+        const char *value_b = b.row[column.index];
+        int cmp = 0;
+
+        if (!value_a || !value_b) {
+            cmp = (value_a ? 1 : 0) - (value_b ? 1 : 0);
+        } else {
+            switch (field.type) {
+                case MYSQL_TYPE_TINY:
+                case MYSQL_TYPE_SHORT:
+                case MYSQL_TYPE_LONG:
+                case MYSQL_TYPE_INT24:
+                case MYSQL_TYPE_LONGLONG:
+                case MYSQL_TYPE_YEAR:
+                    if (field.flags & UNSIGNED_FLAG) {
+                        unsigned long long x = strtoull(value_a, NULL, 10);  // NOLINT
+                        unsigned long long y = strtoull(value_b, NULL, 10);  // NOLINT
+                        cmp = x < y ? -1 : (x > y ? 1 : 0);
+                    } else {
+                        long long x = strtoll(value_a, NULL, 10);  // NOLINT
+                        long long y = strtoll(value_b, NULL, 10);  // NOLINT
+                        cmp = x < y ? -1 : (x > y ? 1 : 0);
+                    }
+                    break;
+                case MYSQL_TYPE_FLOAT:
+                case MYSQL_TYPE_DOUBLE:
+                case MYSQL_TYPE_DECIMAL:
+                case MYSQL_TYPE_NEWDECIMAL:
+                    {
+                        double x = strtod(value_a, NULL);
+                        double y = strtod(value_b, NULL);
+                        cmp = x < y ? -1 : (x > y ? 1 : 0);
+                    }
+                    break;
+                default:
+                    {
+                        unsigned long length_a = a.lengths[column.index];
+                        unsigned long length_b = b.lengths[column.index];
+
+                        cmp = memcmp(value_a, value_b, std::min(length_a, length_b));
+                        if (cmp == 0) {
+                            cmp = length_a < length_b ? -1 : (length_a > length_b ? 1 : 0);
+                        }
+                    }
+                    break;
+            }
+        }
+
+        if (column.desc) {
+            cmp = -cmp;
+        }
+        if (cmp != 0) {
+            return cmp;
+        }
+    }
+
+    return 0;
+}
+
+/*!
+ * Shard query callbacks for MysqlShardRouter::Scatter, error is set when
+ * connection shed the query without running it
+ */
+void MysqlShardRouter::ScatterPartDone(void *data, const char *error) {
+    NanScope();
+
+    struct scatter_part_request *part_req = static_cast<scatter_part_request *>(data);
+    scatter_request *scatter_req = part_req->scatter_req;
+
+    if (error) {
+        scatter_part &part = scatter_req->parts[part_req->index];
+        part.ok = false;
+        part.my_errno = 0;
+        part.my_error = error;
+    }
+
+    delete part_req;
+
+    // Merge after the last shard is done
+    if (--scatter_req->pending == 0) {
+        uv_work_t *_req = new uv_work_t;
+        _req->data = scatter_req;
+        uv_queue_work(uv_default_loop(), _req, EIO_ScatterMerge, (uv_after_work_cb)EIO_After_ScatterMerge);
+    }
+}
+
+void MysqlShardRouter::ScatterPartWork(void *data) {
+    struct scatter_part_request *part_req = static_cast<scatter_part_request *>(data);
+    scatter_part &part = part_req->scatter_req->parts[part_req->index];
+
+    part.ok = part.conn->QueryStoreResult(part_req->scatter_req->query,
+                                          &part.my_result,
+                                          &part.my_errno,
+                                          &part.my_error);
+    part.has_result = part.my_result != NULL;
+
+    if (!part.has_result) {
+        return;
+    }
+
+    uint32_t num_fields = mysql_num_fields(part.my_result);
+    MYSQL_ROW row;
+
+    part.rows.reserve(mysql_num_rows(part.my_result));
+    while ((row = mysql_fetch_row(part.my_result))) {
+        unsigned long *lengths = mysql_fetch_lengths(part.my_result);
+
+        part.rows.push_back(merged_row());
+        part.rows.back().row = row;
+        part.rows.back().lengths.assign(lengths, lengths + num_fields);
+    }
+}
+
+void MysqlShardRouter::EIO_After_ScatterMerge(uv_work_t *req) {
+    NanScope();
+
+    struct scatter_request *scatter_req = (struct scatter_request *)(req->data);
+
+    int argc = 1;
+    Local<Value> argv[3];
+
+    if (!scatter_req->ok) {
+        argv[0] = V8EXC(scatter_req->my_error.c_str());
+    } else {
+        MYSQL_FIELD *fields = scatter_req->fields;
+        uint32_t num_fields = scatter_req->num_fields;
+        uint32_t i = 0, j = 0;
+
+        Local<Array> js_result = Array::New();
+        Local<Object> js_result_row;
+        Local<Value> js_field;
+
+        for (i = 0; i < scatter_req->rows.size(); i++) {
+            const merged_row &result_row = scatter_req->rows[i];
+
+            js_result_row = MysqlResult::NewRow(scatter_req->fo);
+
+            for (j = 0; j < num_fields; j++) {
+                js_field = MysqlResult::GetFieldValue(fields[j], result_row.row[j], result_row.lengths[j],
+                                                      scatter_req->fo.results_decimal);
+
+                MysqlResult::SetRowColumn(js_result_row, fields, j, js_field, scatter_req->fo);
+            }
+
+            js_result->Set(Integer::NewFromUnsigned(i), js_result_row);
+        }
+
+        argv[0] = NanNewLocal(Null());
+        argv[1] = js_result;
+        argv[2] = MysqlResult::GetFieldsArray(fields, num_fields);
+        argc = 3;
+    }
+
+    // Rows point into results, so free them after JS values are built
+    for (size_t k = 0; k < scatter_req->parts.size(); k++) {
+        if (scatter_req->parts[k].my_result) {
+            mysql_free_result(scatter_req->parts[k].my_result);
+        }
+    }
+    NanDispose(scatter_req->js_connections);
+
+    scatter_req->nan_callback->Call(argc, argv);
+    delete scatter_req->nan_callback;
+
+    delete scatter_req;
+
+    delete req;
+}
+
+void MysqlShardRouter::EIO_ScatterMerge(uv_work_t *req) {
+    struct scatter_request *scatter_req = (struct scatter_request *)(req->data);
+    std::vector<scatter_part> &parts = scatter_req->parts;
+
+    scatter_req->ok = false;
+    scatter_req->fields = NULL;
+    scatter_req->num_fields = 0;
+
+    size_t i = 0, j = 0;
+
+    // Fail on the first shard error
+    for (i = 0; i < parts.size(); i++) {
+        if (parts[i].ok) {
+            continue;
+        }
+
+        if (parts[i].my_errno) {
+            char error_string[32];
+            snprintf(error_string, sizeof(error_string), "Query error #%u: ", parts[i].my_errno);
+            scatter_req->my_error = error_string + parts[i].my_error;
+        } else {
+            scatter_req->my_error = parts[i].my_error;
+        }
+        return;
+    }
+
+    // All shards must return result sets of the same shape
+    for (i = 0; i < parts.size(); i++) {
+        bool same = parts[i].has_result == parts[0].has_result;
+
+        if (same && parts[i].has_result) {
+            uint32_t num_fields = mysql_num_fields(parts[0].my_result);
+            MYSQL_FIELD *fields = mysql_fetch_fields(parts[0].my_result);
+            MYSQL_FIELD *part_fields = mysql_fetch_fields(parts[i].my_result);
+
+            same = mysql_num_fields(parts[i].my_result) == num_fields;
+            for (j = 0; same && j < num_fields; j++) {
+                same = part_fields[j].name_length == fields[j].name_length &&
+                       memcmp(part_fields[j].name, fields[j].name, fields[j].name_length) == 0;
+            }
+        }
+
+        if (!same) {
+            scatter_req->my_error = "Shards returned different result sets";
+            return;
+        }
+    }
+
+    if (!parts[0].has_result) {
+        scatter_req->ok = true;
+        return;
+    }
+
+    scatter_req->fields = mysql_fetch_fields(parts[0].my_result);
+    scatter_req->num_fields = mysql_num_fields(parts[0].my_result);
+
+    for (i = 0; i < scatter_req->order_by.size(); i++) {
+        order_column &column = scatter_req->order_by[i];
+
+        for (j = 0; j < scatter_req->num_fields; j++) {
+            if (column.name == scatter_req->fields[j].name) {
+                break;
+            }
+        }
+        if (j == scatter_req->num_fields) {
+            scatter_req->my_error = "Unknown column '" + column.name + "' in orderBy";
+            return;
+        }
+        column.index = j;
+    }
+
+    uint64_t limit = scatter_req->has_limit ? scatter_req->limit : static_cast<uint64_t>(-1);
+
+    if (scatter_req->order_by.empty()) {
+        // Concatenate in shards order
+        for (i = 0; i < parts.size(); i++) {
+            for (j = 0; j < parts[i].rows.size() && scatter_req->rows.size() < limit; j++) {
+                scatter_req->rows.push_back(parts[i].rows[j]);
+            }
+        }
+    } else {
+        // k-way merge, every shard result is already sorted by query ORDER BY
+        std::vector<size_t> heads(parts.size(), 0);
+
+        while (scatter_req->rows.size() < limit) {
+            size_t best = parts.size();
+
+            for (i = 0; i < parts.size(); i++) {
+                if (heads[i] == parts[i].rows.size()) {
+                    continue;
+                }
+                if (best == parts.size() ||
+                    CompareRows(scatter_req, parts[i].rows[heads[i]], parts[best].rows[heads[best]]) < 0) {
+                    best = i;
+                }
+            }
+
+            if (best == parts.size()) {
+                break;
+            }
+
+            scatter_req->rows.push_back(parts[best].rows[heads[best]]);
+            heads[best]++;
+        }
+    }
+
+    scatter_req->ok = true;
+}
+
+/**
+ * MysqlShardRouter#scatter(connections, query[, options], callback)
+ * - connections (Array): One MysqlConnection per shard
+ * - query (String): Query
+ * - options (Object): Merge and fetch options
+ * - callback (Function): Callback function, gets (error, rows, fields)
+ *
+ * Runs query on all connections in parallel and merges results in threadpool.
+ * Shard queries wait in connections queues like MysqlConnection#enqueue() ones.
+ * Options are `orderBy` (column name or array of names,
+ * each can end with " ASC" or " DESC"), `limit` and fetch options
+ * `asArray` and `nestTables` like in MysqlResult#fetchAll().
+ * For `orderBy` every shard must return rows sorted in the same order,
+ * strings are compared bytewise
+ **/
+NAN_METHOD(MysqlShardRouter::Scatter) {
+    NanScope();
+
+    REQ_ARRAY_ARG(0, js_connections);
+    REQ_STR_ARG(1, query);
+    REQ_FUN_ARG(args.Length() - 1, callback);
+
+    if (js_connections->Length() == 0) {
+        return NanThrowError("Connections list is empty");
+    }
+
+    Local<FunctionTemplate> conn_tpl = NanPersistentToLocal(MysqlConnection::constructor_template);
+    std::vector<MysqlConnection *> conns;
+
+    for (uint32_t i = 0; i < js_connections->Length(); i++) {
+        Local<Value> js_conn = js_connections->Get(i);
+
+        if (!js_conn->IsObject() || !conn_tpl->HasInstance(js_conn)) {
+            return NanThrowTypeError("Connections list must contain MysqlConnection objects");
+        }
+        conns.push_back(OBJUNWRAP<MysqlConnection>(js_conn->ToObject()));
+    }
+
+    MysqlResult::fetch_options fo;
+    std::vector<order_column> order_by;
+    bool has_limit = false;
+    uint64_t limit = 0;
+
+    if (args.Length() > 3) {
+        if (!args[2]->IsObject()) {
+            return NanThrowTypeError("Argument 2 must be an object");
+        }
+        Local<Object> options = args[2]->ToObject();
+
+        MYSQLRES_GET_FETCH_OPTIONS(options, fo);
+        if (fo.results_as_array && fo.results_nest_tables) {
+            return NanThrowError("You can't mix 'asArray' and 'nestTables' options");
+        }
+
+        if (options->Has(V8STR("orderBy"))) {
+            Local<Value> js_order_by = options->Get(V8STR("orderBy"));
+            Local<Array> columns;
+
+            if (js_order_by->IsArray()) {
+                columns = Local<Array>::Cast(js_order_by);
+            } else {
+                columns = Array::New();
+                columns->Set(0, js_order_by);
+            }
+
+            for (uint32_t i = 0; i < columns->Length(); i++) {
+                if (!columns->Get(i)->IsString()) {
+                    return NanThrowTypeError("orderBy must contain column names");
+                }
+                String::Utf8Value column_string(columns->Get(i)->ToString());
+
+                order_column column;
+                column.name.assign(*column_string, column_string.length());
+                column.desc = false;
+                column.index = 0;
+
+                size_t space = column.name.rfind(' ');
+                if (space != std::string::npos) {
+                    const char *direction = column.name.c_str() + space + 1;
+
+                    if (!strcasecmp(direction, "DESC")) {
+                        column.desc = true;
+                        column.name.erase(space);
+                    } else if (!strcasecmp(direction, "ASC")) {
+                        column.name.erase(space);
+                    }
+                }
+
+                order_by.push_back(column);
+            }
+        }
+
+        if (options->Has(V8STR("limit"))) {
+            Local<Value> js_limit = options->Get(V8STR("limit"));
+            if (!js_limit->IsNumber() || js_limit->NumberValue() < 0) {
+                return NanThrowTypeError("limit must be a non-negative number");
+            }
+            has_limit = true;
+            limit = static_cast<uint64_t>(js_limit->NumberValue());
+        }
+    }
+
+    scatter_request *scatter_req = new scatter_request;
+
+    scatter_req->nan_callback = new NanCallback(callback.As<Function>());
+
+    // Keep connections alive until merge is done
+    NanAssignPersistent(Object, scatter_req->js_connections, js_connections);
+
+    scatter_req->query.assign(*query, query.length());
+    scatter_req->pending = conns.size();
+    scatter_req->order_by = order_by;
+    scatter_req->has_limit = has_limit;
+    scatter_req->limit = limit;
+    scatter_req->fo = fo;
+
+    scatter_req->parts.resize(conns.size());
+    for (size_t i = 0; i < conns.size(); i++) {
+        scatter_part &part = scatter_req->parts[i];
+
+        part.conn = conns[i];
+        part.ok = false;
+        part.has_result = false;
+        part.my_result = NULL;
+        part.my_errno = 0;
+    }
+
+    // Queued work holds its connection until it is done
+    for (size_t i = 0; i < conns.size(); i++) {
+        scatter_part_request *part_req = new scatter_part_request;
+        part_req->scatter_req = scatter_req;
+        part_req->index = i;
+
+        conns[i]->QueueWork(part_req, ScatterPartWork, ScatterPartDone);
+    }
+
+    NanReturnUndefined();
+}
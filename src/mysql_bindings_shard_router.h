@@ -0,0 +1,147 @@
+/*!
+ * Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+ * See contributors list in README
+ *
+ * See license text in LICENSE file
+ */
+
+#ifndef SRC_MYSQL_BINDINGS_SHARD_ROUTER_H_
+#define SRC_MYSQL_BINDINGS_SHARD_ROUTER_H_
+
+#include <mysql.h>
+
+#include <v8.h>
+#include <node.h>
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "./mysql_bindings.h"
+#include "./mysql_bindings_result.h"
+
+// Points on the hash ring per shard
+#define MYSQLSHARD_DEFAULT_VIRTUAL_NODES 160
+
+class MysqlConnection;
+
+/** section: Classes
+ * class MysqlShardRouter
+ *
+ * Maps keys to shards with consistent hashing
+ * and runs scatter-gather queries over shards connections
+ **/
+class MysqlShardRouter : public node::ObjectWrap {
+  public:
+    static Persistent<FunctionTemplate> constructor_template;
+
+    static void Init(Handle<Object> target);
+
+    static uint32_t Hash(const char *key, size_t key_len);
+
+  private:
+    uint32_t virtual_nodes;
+
+    std::vector<std::string> shards;
+
+    struct ring_point {
+        uint32_t hash;
+        uint32_t shard;
+
+        bool operator<(const ring_point &other) const {
+            return hash < other.hash;
+        }
+    };
+    // Points with colliding hashes are ordered by shard name,
+    // so ring doesn't depend on shards adding order
+    struct ring_order {
+        const std::vector<std::string> *shards;
+
+        bool operator()(const ring_point &a, const ring_point &b) const {
+            if (a.hash != b.hash) {
+                return a.hash < b.hash;
+            }
+            return (*shards)[a.shard] < (*shards)[b.shard];
+        }
+    };
+    // Sorted by hash
+    std::vector<ring_point> ring;
+
+    void RebuildRing();
+
+    explicit MysqlShardRouter(uint32_t my_virtual_nodes):
+        ObjectWrap(),
+        virtual_nodes(my_virtual_nodes) {}
+
+    // Constructor
+
+    static NAN_METHOD(New);
+
+    // Methods
+
+    static NAN_METHOD(AddShardSync);
+
+    static NAN_METHOD(GetShardSync);
+
+    static NAN_METHOD(RemoveShardSync);
+
+    // Scatter-gather query
+    struct merged_row {
+        MYSQL_ROW row;
+        std::vector<unsigned long> lengths;
+    };
+    struct scatter_part {
+        MysqlConnection *conn;
+
+        bool ok;
+        bool has_result;
+        MYSQL_RES *my_result;
+        std::vector<merged_row> rows;
+
+        unsigned int my_errno;
+        std::string my_error;
+    };
+    struct order_column {
+        std::string name;
+        bool desc;
+        uint32_t index;
+    };
+    struct scatter_request {
+        bool ok;
+
+        NanCallback *nan_callback;
+        Persistent<Object> js_connections;
+
+        std::string query;
+        std::vector<scatter_part> parts;
+        unsigned int pending;
+
+        std::vector<order_column> order_by;
+        bool has_limit;
+        uint64_t limit;
+
+        MysqlResult::fetch_options fo;
+
+        // Merge results
+        MYSQL_FIELD *fields;
+        uint32_t num_fields;
+        std::vector<merged_row> rows;
+        std::string my_error;
+    };
+    struct scatter_part_request {
+        scatter_request *scatter_req;
+        size_t index;
+    };
+    static int CompareRows(const scatter_request *scatter_req,
+                           const merged_row &a,
+                           const merged_row &b);
+    // Shard queries run through connections queues, see MysqlConnection::QueueWork()
+    static void ScatterPartDone(void *data, const char *error);
+    static void ScatterPartWork(void *data);
+    static void EIO_After_ScatterMerge(uv_work_t *req);
+    static void EIO_ScatterMerge(uv_work_t *req);
+    static NAN_METHOD(Scatter);
+};
+
+#endif  // SRC_MYSQL_BINDINGS_SHARD_ROUTER_H_
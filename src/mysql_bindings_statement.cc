@@ -46,6 +46,7 @@ void MysqlStatement::Init(Handle<Object> target) {
     NODE_SET_PROTOTYPE_METHOD(tpl, "executeSync",        ExecuteSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "fetchAll",           FetchAll);
     NODE_SET_PROTOTYPE_METHOD(tpl, "fetchAllSync",       FetchAllSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "fetchAllJSON",       FetchAllJSON);
     NODE_SET_PROTOTYPE_METHOD(tpl, "fetchSync",          FetchSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "fetch",              Fetch);
     NODE_SET_PROTOTYPE_METHOD(tpl, "fieldCountSync",     FieldCountSync);
@@ -56,6 +57,7 @@ void MysqlStatement::Init(Handle<Object> target) {
     NODE_SET_PROTOTYPE_METHOD(tpl, "prepareSync",        PrepareSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "resetSync",          ResetSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "resultMetadataSync", ResultMetadataSync);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "run",                Run);
     NODE_SET_PROTOTYPE_METHOD(tpl, "sendLongDataSync",   SendLongDataSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "storeResultSync",    StoreResultSync);
     NODE_SET_PROTOTYPE_METHOD(tpl, "storeResult",        StoreResult);
@@ -82,12 +84,17 @@ Local<Object> MysqlStatement::NewInstance(MYSQL_STMT *my_statement) {
 
 MysqlStatement::MysqlStatement(MYSQL_STMT *my_stmt): ObjectWrap() {
     this->_stmt = my_stmt;
+    this->conn = NULL;
+    this->pending_requests = 0;
     this->binds = NULL;
     this->param_count = 0;
     this->state = STMT_INITIALIZED;
 }
 
 MysqlStatement::~MysqlStatement() {
+    if (this->conn) {
+        this->conn->UnregisterStatement(this);
+    }
     if (this->_stmt) {
         if (this->state >= STMT_PREPARED) {
             FreeMysqlBinds(this->binds, this->param_count, true);
@@ -97,6 +104,84 @@ MysqlStatement::~MysqlStatement() {
     }
 }
 
+/*!
+ * Statement writes stop coalescing of connection reads, see MysqlConnection::StopCoalescing()
+ */
+void MysqlStatement::StopCoalescing() {
+    if (this->conn) {
+        this->conn->StopCoalescing(this->prepared_query.data(), this->prepared_query.size());
+    }
+}
+
+void MysqlStatement::MarkActive() {
+    if (this->conn) {
+        this->conn->MarkActive();
+    }
+}
+
+void MysqlStatement::SetConnection(MysqlConnection *connection) {
+    this->conn = connection;
+}
+
+/*!
+ * Marks statement as closed after server session reset,
+ * libmysqlclient has already detached MYSQL_STMT from connection
+ */
+void MysqlStatement::Invalidate() {
+    if (this->state >= STMT_PREPARED) {
+        // Frees binds array too
+        FreeMysqlBinds(this->binds, this->param_count, true);
+        this->binds = NULL;
+        this->param_count = 0;
+    }
+
+    this->state = STMT_CLOSED;
+}
+
+/*!
+ * Gets query of prepared statement, empty if it is not prepared
+ */
+std::string MysqlStatement::PreparedQuery() {
+    if (this->state < STMT_PREPARED) {
+        return std::string();
+    }
+
+    return this->prepared_query;
+}
+
+/*!
+ * Replaces statement handle with the one prepared on new connection,
+ * bound parameters are kept, result set and bound results are lost.
+ * NULL handle marks statement as closed
+ */
+void MysqlStatement::Reprepare(MYSQL_STMT *my_stmt) {
+    if (this->_stmt) {
+        mysql_stmt_close(this->_stmt);
+        this->_stmt = NULL;
+    }
+
+    if (!my_stmt) {
+        this->Invalidate();
+        return;
+    }
+
+    this->_stmt = my_stmt;
+
+    if (this->state >= STMT_BINDED_PARAMS && this->param_count > 0) {
+        mysql_stmt_bind_param(this->_stmt, this->binds);
+        this->state = STMT_BINDED_PARAMS;
+    } else {
+        this->state = STMT_PREPARED;
+    }
+}
+
+/*!
+ * Checks whether statement has requests running in threadpool
+ */
+bool MysqlStatement::Busy() {
+    return this->pending_requests > 0;
+}
+
 /**
  * new MysqlStatement()
  *
@@ -233,27 +318,32 @@ NAN_METHOD(MysqlStatement::AttrSetSync) {
     NanReturnValue(True());
 }
 
-/**
- * MysqlStatement#bindParamsSync(params) -> Boolean
- * - params(Array)
- *
- * Binds variables to a prepared statement as parameters
- **/
-NAN_METHOD(MysqlStatement::BindParamsSync) {
-    NanScope();
-
-    MysqlStatement *stmt = OBJUNWRAP<MysqlStatement>(args.Holder());
-
-    MYSQLSTMT_MUSTBE_INITIALIZED;
-    MYSQLSTMT_MUSTBE_PREPARED;
-
-    REQ_ARRAY_ARG(0, js_params);
-
+/*!
+ * Copies parameters values to native binds, used by bindParamsSync() and run().
+ * On error previous binding and statement state are left untouched
+ */
+bool MysqlStatement::SetParams(Local<Array> js_params, const char **error) {
     uint32_t i = 0;
     Local<Value> js_param;
 
-    if (js_params->Length() != stmt->param_count) {
-        return NanThrowError("Array length doesn't match number of parameters in prepared statement"); // NOLINT
+    if (js_params->Length() != this->param_count) {
+        *error = "Array length doesn't match number of parameters in prepared statement";
+        return false;
+    }
+
+    for (i = 0; i < js_params->Length(); i++) {
+        if (js_params->Get(i)->IsUndefined()) {
+            *error = "All arguments must be defined";
+            return false;
+        }
+    }
+
+    // Values are converted to new binds, previous binding stays
+    // in effect until all of them are converted
+    MYSQL_BIND *new_binds = NULL;
+    if (this->param_count > 0) {
+        new_binds = new MYSQL_BIND[this->param_count];
+        memset(new_binds, 0, this->param_count*sizeof(MYSQL_BIND));
     }
 
     int *int_data;
@@ -268,56 +358,56 @@ NAN_METHOD(MysqlStatement::BindParamsSync) {
     for (i = 0; i < js_params->Length(); i++) {
         js_param = js_params->Get(i);
 
-        if (js_param->IsUndefined()) {
-            return NanThrowError("All arguments must be defined");
-        }
-
         if (js_param->IsNull()) {
             int_data = new int;
             *int_data = 0;
 
-            stmt->binds[i].buffer_type = MYSQL_TYPE_NULL;
-            stmt->binds[i].buffer = int_data;
+            new_binds[i].buffer_type = MYSQL_TYPE_NULL;
+            new_binds[i].buffer = int_data;
             // TODO(Sannis): Fix this error
-            stmt->binds[i].is_null = 0;
+            new_binds[i].is_null = 0;
         } else if (js_param->IsInt32()) {
             int_data = new int;
             *int_data = js_param->Int32Value();
 
-            stmt->binds[i].buffer_type = MYSQL_TYPE_LONG;
-            stmt->binds[i].buffer = int_data;
-            stmt->binds[i].is_null = 0;
-            stmt->binds[i].is_unsigned = false;
+            new_binds[i].buffer_type = MYSQL_TYPE_LONG;
+            new_binds[i].buffer = int_data;
+            new_binds[i].is_null = 0;
+            new_binds[i].is_unsigned = false;
         } else if (js_param->IsBoolean()) {
             // I assume, booleans are usually stored as TINYINT(1)
             int_data = new int;
             *int_data = js_param->Int32Value();
 
-            stmt->binds[i].buffer_type = MYSQL_TYPE_TINY;
-            stmt->binds[i].buffer = int_data;
-            stmt->binds[i].is_null = 0;
-            stmt->binds[i].is_unsigned = false;
+            new_binds[i].buffer_type = MYSQL_TYPE_TINY;
+            new_binds[i].buffer = int_data;
+            new_binds[i].is_null = 0;
+            new_binds[i].is_unsigned = false;
         } else if (js_param->IsUint32()) {
             uint_data = new unsigned int;
             *uint_data = js_param->Uint32Value();
 
-            stmt->binds[i].buffer_type = MYSQL_TYPE_LONG;
-            stmt->binds[i].buffer = uint_data;
-            stmt->binds[i].is_null = 0;
-            stmt->binds[i].is_unsigned = true;
+            new_binds[i].buffer_type = MYSQL_TYPE_LONG;
+            new_binds[i].buffer = uint_data;
+            new_binds[i].is_null = 0;
+            new_binds[i].is_unsigned = true;
         } else if (js_param->IsNumber()) {
             double_data = new double;
             *double_data = js_param->NumberValue();
 
-            stmt->binds[i].buffer_type = MYSQL_TYPE_DOUBLE;
-            stmt->binds[i].buffer = double_data;
-            stmt->binds[i].is_null = 0;
+            new_binds[i].buffer_type = MYSQL_TYPE_DOUBLE;
+            new_binds[i].buffer = double_data;
+            new_binds[i].is_null = 0;
         } else if (js_param->IsDate()) {
-            date_data = new MYSQL_TIME;
             date_timet = static_cast<time_t>(js_param->NumberValue()/1000);
             if (!gmtime_r(&date_timet, &date_timeinfo)) {
-                return NanThrowError("Error occured in gmtime_r()");
+                // Frees new_binds array too
+                FreeMysqlBinds(new_binds, i, true);
+                *error = "Error occured in gmtime_r()";
+                return false;
             }
+            date_data = new MYSQL_TIME;
+            memset(date_data, 0, sizeof(MYSQL_TIME));
             date_data->year = date_timeinfo.tm_year + 1900;
             date_data->month = date_timeinfo.tm_mon + 1;
             date_data->day = date_timeinfo.tm_mday;
@@ -325,28 +415,66 @@ NAN_METHOD(MysqlStatement::BindParamsSync) {
             date_data->minute = date_timeinfo.tm_min;
             date_data->second = date_timeinfo.tm_sec;
 
-            stmt->binds[i].buffer_type = MYSQL_TYPE_DATETIME;
-            stmt->binds[i].buffer = date_data;
-            stmt->binds[i].is_null = 0;
+            new_binds[i].buffer_type = MYSQL_TYPE_DATETIME;
+            new_binds[i].buffer = date_data;
+            new_binds[i].is_null = 0;
         } else {  // js_param->IsString() and other
-            // TODO(Sannis): Simplify this if possible
-            str_data = strdup(**(new String::Utf8Value(js_param->ToString())));
+            String::Utf8Value str_value(js_param->ToString());
+
+            str_data = new char[str_value.length() + 1];
+            memcpy(str_data, *str_value, str_value.length() + 1);
             str_length = new unsigned long; // NOLINT
-            *str_length = js_param->ToString()->Length();
+            *str_length = str_value.length();
 
-            stmt->binds[i].buffer_type = MYSQL_TYPE_STRING;
-            stmt->binds[i].buffer =  str_data;
-            stmt->binds[i].is_null = 0;
-            stmt->binds[i].length = str_length;
+            new_binds[i].buffer_type = MYSQL_TYPE_STRING;
+            new_binds[i].buffer =  str_data;
+            new_binds[i].is_null = 0;
+            new_binds[i].length = str_length;
         }
     }
 
+    // Free values of previous binding
+    if (this->param_count > 0) {
+        if (this->state >= STMT_BINDED_PARAMS) {
+            FreeMysqlBinds(this->binds, this->param_count, true);
+        } else {
+            delete[] this->binds;
+        }
+        this->binds = new_binds;
+    }
+
+    // Values are owned by binds from now on
+    this->state = STMT_BINDED_PARAMS;
+
+    return true;
+}
+
+/**
+ * MysqlStatement#bindParamsSync(params) -> Boolean
+ * - params(Array)
+ *
+ * Binds variables to a prepared statement as parameters
+ **/
+NAN_METHOD(MysqlStatement::BindParamsSync) {
+    NanScope();
+
+    MysqlStatement *stmt = OBJUNWRAP<MysqlStatement>(args.Holder());
+
+    MYSQLSTMT_MUSTBE_INITIALIZED;
+    MYSQLSTMT_MUSTBE_PREPARED;
+    MYSQLSTMT_MUSTNOT_BE_BUSY;
+
+    REQ_ARRAY_ARG(0, js_params);
+
+    const char *error = NULL;
+    if (!stmt->SetParams(js_params, &error)) {
+        return NanThrowError(error);
+    }
+
     if (mysql_stmt_bind_param(stmt->_stmt, stmt->binds)) {
       NanReturnValue(False());
     }
 
-    stmt->state = STMT_BINDED_PARAMS;
-
     NanReturnValue(True());
 }
 
@@ -564,6 +692,7 @@ void MysqlStatement::EIO_After_Execute(uv_work_t *req) {
     execute_req->nan_callback->Call(argc, argv);
     delete execute_req->nan_callback;
 
+    execute_req->stmt->pending_requests--;
     execute_req->stmt->Unref();
 
     delete execute_req;
@@ -593,12 +722,16 @@ NAN_METHOD(MysqlStatement::Execute) {
 
     MYSQLSTMT_MUSTBE_PREPARED;
 
+    stmt->StopCoalescing();
+    stmt->MarkActive();
+
     execute_request* execute_req = new execute_request;
 
     execute_req->nan_callback = new NanCallback(callback.As<Function>());
 
     execute_req->stmt = stmt;
     stmt->Ref();
+    stmt->pending_requests++;
 
     uv_work_t *_req = new uv_work_t;
     _req->data = execute_req;
@@ -619,6 +752,9 @@ NAN_METHOD(MysqlStatement::ExecuteSync) {
 
     MYSQLSTMT_MUSTBE_PREPARED;
 
+    stmt->StopCoalescing();
+    stmt->MarkActive();
+
     if (mysql_stmt_execute(stmt->_stmt)) {
         NanReturnValue(False());
     }
@@ -631,77 +767,31 @@ void MysqlStatement::EIO_After_FetchAll(uv_work_t* req) {
     NanScope();
 
     struct fetch_request* fetchAll_req = (struct fetch_request *) (req->data);
-    MysqlStatement* stmt = fetchAll_req->stmt;
 
-    MYSQL_FIELD* fields;
-    int argc = 1, error = 0;
-    uint32_t i = 0, j = 0;
-    void *ptr = 0;
-    my_ulonglong row_count = 0;
-    Local<Array> js_result;
+    int argc = 1;
     Local<Value> argv[2];
-    Local<Object> js_result_row;
 
     if (!fetchAll_req->ok) {
-        argv[0] = V8EXC(mysql_stmt_error(stmt->_stmt));
+        argv[0] = V8EXC(fetchAll_req->my_error.c_str());
     } else if (fetchAll_req->empty_resultset) {
         argc = 2;
         argv[0] = argv[1] = NanNewLocal(Null());
     } else {
-        fields = fetchAll_req->meta->fields;
-
-        row_count = mysql_stmt_num_rows(stmt->_stmt);
-        js_result = Array::New(row_count);
-
-        while (row_count && !error) {
-            error = mysql_stmt_fetch(stmt->_stmt);
-            // TODO(estliberitas): handle following case properly
-            if (error == MYSQL_DATA_TRUNCATED) {
-                error = 0;
-            } else if (error == MYSQL_NO_DATA) {
-                FreeMysqlBinds(stmt->result_binds, fetchAll_req->field_count, false);
-                break;
-            } else if (error) {
-                break;
-            }
-
-            js_result_row = Object::New();
-
-            while (j < fetchAll_req->field_count) {
-                ptr = stmt->result_binds[j].buffer;
-
-                Local<Value> js_field;
-                if (*(stmt->result_binds[j].is_null)) {
-                    js_field = NanNewLocal(Null());
-                } else {
-                    js_field = GetFieldValue(ptr, *(stmt->result_binds[j].length), fields[j]);
-                }
-
-                js_result_row->Set(V8STR(fields[j].name), js_field);
-                j++;
-            }
-            j = 0;
-
-            js_result->Set(Integer::NewFromUnsigned(i), js_result_row);
-            i++;
-        }
+        MysqlResult::fetch_options fo;
 
-        if (error && error != MYSQL_NO_DATA) {
-            argv[0] = V8EXC(mysql_stmt_error(stmt->_stmt));
-        } else {
-            argc = 2;
-            argv[0] = NanNewLocal(Null());
-            argv[1] = js_result;
-        }
+        argc = 2;
+        argv[0] = NanNewLocal(Null());
+        argv[1] = PackedRowsToArray(&fetchAll_req->rows, fetchAll_req->meta->fields, fo);
     }
 
-    if (fetchAll_req->meta != NULL && mysql_stmt_num_rows(stmt->_stmt)) {
+    if (fetchAll_req->meta != NULL) {
         mysql_free_result(fetchAll_req->meta);
     }
 
     fetchAll_req->nan_callback->Call(argc, argv);
     delete fetchAll_req->nan_callback;
 
+    fetchAll_req->stmt->pending_requests--;
     fetchAll_req->stmt->Unref();
 
     delete fetchAll_req;
@@ -725,6 +815,14 @@ void MysqlStatement::EIO_FetchAll(uv_work_t *req) {
         fetchAll_req->empty_resultset = false;
         fetchAll_req->field_count = field_count;
         fetchAll_req->meta = meta;
+
+        // Whole fetch loop runs here, main thread only builds JS values
+        if (FetchPacked(stmt->_stmt, stmt->result_binds, field_count, &fetchAll_req->rows)) {
+            fetchAll_req->ok = false;
+            fetchAll_req->my_error = mysql_stmt_error(stmt->_stmt);
+        } else {
+            FreeMysqlBinds(stmt->result_binds, field_count, false);
+        }
     }
 }
 
@@ -746,6 +844,7 @@ NAN_METHOD(MysqlStatement::FetchAll) {
     fetchAll_req->stmt = stmt;
     fetchAll_req->meta = NULL;
     stmt->Ref();
+    stmt->pending_requests++;
 
     uv_work_t *_req = new uv_work_t;
     _req->data = fetchAll_req;
@@ -769,12 +868,9 @@ NAN_METHOD(MysqlStatement::FetchAllSync) {
     }
 
     MYSQL_RES* meta;
-    MYSQL_FIELD* fields;
-    int error = 0;
-    uint32_t i = 0, j = 0;
-    void *ptr = 0;
     unsigned int field_count;
-    my_ulonglong row_count;
+    packed_rows rows;
+    MysqlResult::fetch_options fo;
 
     // Get fields count for binding buffers
     field_count = mysql_stmt_field_count(stmt->_stmt);
@@ -785,54 +881,155 @@ NAN_METHOD(MysqlStatement::FetchAllSync) {
         NanReturnValue(Null());
     }
 
-    fields = meta->fields;
-    row_count = mysql_stmt_num_rows(stmt->_stmt);
+    if (FetchPacked(stmt->_stmt, stmt->result_binds, field_count, &rows)) {
+        mysql_free_result(meta);
+        return NanThrowError(mysql_stmt_error(stmt->_stmt));
+    }
+    FreeMysqlBinds(stmt->result_binds, field_count, false);
 
-    Local<Array> js_result = Array::New(row_count);
-    Local<Object> js_result_row;
+    Local<Array> js_result = PackedRowsToArray(&rows, meta->fields, fo);
 
-    while (row_count && !error) {
-        error = mysql_stmt_fetch(stmt->_stmt);
-        // TODO: handle following case properly
-        if (error == MYSQL_DATA_TRUNCATED) {
-            error = 0;
-        } else if (error == MYSQL_NO_DATA) {
-            FreeMysqlBinds(stmt->result_binds, field_count, false);
-            break;
-        } else if (error) {
-            break;
-        }
+    mysql_free_result(meta);
 
-        js_result_row = Object::New();
+    NanReturnValue(js_result);
+}
 
-        while (j < field_count) {
-            ptr = stmt->result_binds[j].buffer;
+void MysqlStatement::EIO_After_FetchAllJSON(uv_work_t* req) {
+    NanScope();
 
-            Local<Value> js_field;
-            if (*(stmt->result_binds[j].is_null)) {
-                js_field = NanNewLocal(Null());
-            } else {
-                js_field = GetFieldValue(ptr, *(stmt->result_binds[j].length), fields[j]);
+    struct fetchAllJSON_request* json_req = (struct fetchAllJSON_request *) (req->data);
+
+    int argc = 1;
+    Local<Value> argv[2];
+
+    if (!json_req->ok) {
+        MysqlJsonWriter::FreeBuffer(json_req->data, NULL);
+        argv[0] = V8EXC(json_req->my_error.c_str());
+    } else if (json_req->empty_resultset) {
+        argc = 2;
+        argv[0] = argv[1] = NanNewLocal(Null());
+    } else {
+        // Buffer owns serialized rows
+        argc = 2;
+        argv[0] = NanNewLocal(Null());
+        argv[1] = NanNewBufferHandle(json_req->data, json_req->length, MysqlJsonWriter::FreeBuffer, NULL);
+    }
+
+    json_req->nan_callback->Call(argc, argv);
+    delete json_req->nan_callback;
+
+    json_req->stmt->pending_requests--;
+    json_req->stmt->Unref();
+
+    delete json_req;
+    delete req;
+}
+
+void MysqlStatement::EIO_FetchAllJSON(uv_work_t* req) {
+    struct fetchAllJSON_request* json_req = (struct fetchAllJSON_request *) (req->data);
+    MysqlStatement* stmt = json_req->stmt;
+    MYSQL_BIND *binds = stmt->result_binds;
+
+    json_req->ok = true;
+
+    MYSQL_RES* meta = mysql_stmt_result_metadata(stmt->_stmt);
+    if (meta == NULL) {
+        json_req->empty_resultset = true;
+        return;
+    }
+    json_req->empty_resultset = false;
+
+    uint32_t field_count = mysql_stmt_field_count(stmt->_stmt), j = 0;
+    std::vector<char *> values(field_count + 1);
+    std::vector<unsigned long> lengths(field_count + 1);
+    int error = 0;
+
+    MysqlJsonWriter writer(meta->fields, field_count,
+                           json_req->fo.results_as_array, json_req->fo.results_nest_tables,
+                           json_req->fo.results_parse_json, json_req->fo.results_decimal);
+
+    // Values are serialized straight from bound buffers, see FetchPacked()
+    while ((error = mysql_stmt_fetch(stmt->_stmt)) == 0 || error == MYSQL_DATA_TRUNCATED) {
+        for (j = 0; j < field_count; j++) {
+            if (*(binds[j].is_null)) {
+                values[j] = NULL;
+                continue;
             }
 
-            js_result_row->Set(V8STR(fields[j].name), js_field);
-            j++;
+            values[j] = static_cast<char *>(binds[j].buffer);
+            lengths[j] = *(binds[j].length);
+            if (!IsFixedLengthType(binds[j].buffer_type) && lengths[j] > binds[j].buffer_length) {
+                // Value is truncated to buffer size
+                lengths[j] = binds[j].buffer_length;
+            }
         }
-        j = 0;
 
-        js_result->Set(Integer::NewFromUnsigned(i), js_result_row);
-        i++;
+        writer.AppendRow(&values[0], &lengths[0], true);
     }
 
-    if (meta != NULL) {
-        mysql_free_result(meta);
-    }
+    json_req->data = writer.Release(&json_req->length);
 
-    if (error && error != MYSQL_NO_DATA) {
-        return NanThrowError(mysql_stmt_error(stmt->_stmt));
+    if (error != MYSQL_NO_DATA) {
+        json_req->ok = false;
+        json_req->my_error = mysql_stmt_error(stmt->_stmt);
     } else {
-        NanReturnValue(js_result);
+        FreeMysqlBinds(stmt->result_binds, field_count, false);
     }
+
+    mysql_free_result(meta);
+}
+
+/**
+ * MysqlStatement#fetchAllJSON(callback)
+ * MysqlStatement#fetchAllJSON(options, callback)
+ * - options (Object): Fetch style options (optional)
+ * - callback (Function): Callback function, gets (error, buffer)
+ *
+ * Serializes all rows to UTF-8 JSON array in threadpool,
+ * see MysqlResult#fetchAllJSON()
+ **/
+NAN_METHOD(MysqlStatement::FetchAllJSON) {
+    NanScope();
+
+    int arg_pos = 0;
+    MysqlResult::fetch_options fo;
+
+    if (args.Length() > 1) {
+        if (!args[0]->IsObject() || args[0]->IsFunction()) {
+            return NanThrowError("fetchAllJSON can handle only (options, callback) or (callback) arguments");
+        }
+        MYSQLRES_GET_FETCH_OPTIONS(args[0]->ToObject(), fo);
+        arg_pos++;
+    }
+
+    REQ_FUN_ARG(arg_pos, callback);
+
+    if (fo.results_as_array && fo.results_nest_tables) {
+        return NanThrowError("You can't mix 'asArray' and 'nestTables' options");
+    }
+
+    MysqlStatement *stmt = OBJUNWRAP<MysqlStatement>(args.This());
+
+    if (stmt->state < STMT_BINDED_RESULT) {
+        return NanThrowError("Resultset buffers not binded");
+    }
+
+    fetchAllJSON_request *json_req = new fetchAllJSON_request;
+
+    json_req->nan_callback = new NanCallback(callback.As<Function>());
+
+    json_req->stmt = stmt;
+    json_req->fo = fo;
+    json_req->data = NULL;
+    json_req->length = 0;
+    stmt->Ref();
+    stmt->pending_requests++;
+
+    uv_work_t *_req = new uv_work_t;
+    _req->data = json_req;
+    uv_queue_work(uv_default_loop(), _req, EIO_FetchAllJSON, (uv_after_work_cb)EIO_After_FetchAllJSON);
+
+    NanReturnUndefined();
 }
 
 void MysqlStatement::EIO_After_Fetch(uv_work_t* req) {
@@ -882,6 +1079,7 @@ void MysqlStatement::EIO_After_Fetch(uv_work_t* req) {
     fetch_req->nan_callback->Call(argc, argv);
     delete fetch_req->nan_callback;
 
+    fetch_req->stmt->pending_requests--;
     fetch_req->stmt->Unref();
 
     delete fetch_req;
@@ -944,6 +1142,7 @@ NAN_METHOD(MysqlStatement::Fetch) {
     fetch_req->stmt = stmt;
     fetch_req->meta = NULL;
     stmt->Ref();
+    stmt->pending_requests++;
 
     uv_work_t *_req = new uv_work_t;
     _req->data = fetch_req;
@@ -1137,9 +1336,14 @@ void MysqlStatement::FreeMysqlBinds(MYSQL_BIND *binds, unsigned long size, bool
 /*! todo: finish
  * Helper for FetchAll(), FetchAllSync() methods. Converts raw data to JS type.
  */
-Local<Value> MysqlStatement::GetFieldValue(void* ptr, unsigned long& length, MYSQL_FIELD& field) {
+Local<Value> MysqlStatement::GetFieldValue(void* ptr, unsigned long& length, MYSQL_FIELD& field,
+                                           MysqlBindingsDecimalMode decimal) {
     unsigned int type = field.type;
-    if (type == MYSQL_TYPE_TINY) {             // TINYINT
+    if (decimal != MYSQL_BINDINGS_DECIMAL_STRING &&
+        (type == MYSQL_TYPE_DECIMAL || type == MYSQL_TYPE_NEWDECIMAL)) {
+        // Bound as string buffer
+        return MysqlResult::GetDecimalValue(field, (char *) ptr, length, decimal);
+    } else if (type == MYSQL_TYPE_TINY) {             // TINYINT
         int32_t val = *((signed char *) ptr);
         // handle as boolean
         if (length == 1) {
@@ -1229,24 +1433,191 @@ Local<Value> MysqlStatement::GetFieldValue(void* ptr, unsigned long& length, MYS
         // Now we have our constructor, and our constructor args. Let's create the Date:
         return dateConstructor->NewInstance(argc, argv);
     } else if (type == MYSQL_TYPE_SET) {       // SET
-        // TODO(Sannis): Maybe memory leaks here
-        char *pch, *last, *field_value = (char *) ptr;
-        int k = 0;
-        Local<Array> js_field_array = Array::New();
-
-        pch = strtok_r(field_value, ",", &last);
-        while (pch != NULL) {
-            js_field_array->Set(Integer::New(k), V8STR(pch));
-            pch = strtok_r(NULL, ",", &last);
-            k++;
-        }
-
-        return js_field_array;
+        return MysqlResult::GetSetValue((char *) ptr, length);
     } else {
         return V8STR2((char *) ptr, length);
     }
 }
 
+/*!
+ * Whether bound buffer of this type has fixed size
+ */
+bool MysqlStatement::IsFixedLengthType(enum_field_types type) {
+    switch (type) {
+        case MYSQL_TYPE_TINY:
+        case MYSQL_TYPE_NULL:
+        case MYSQL_TYPE_SHORT:
+        case MYSQL_TYPE_INT24:
+        case MYSQL_TYPE_LONG:
+        case MYSQL_TYPE_LONGLONG:
+        case MYSQL_TYPE_FLOAT:
+        case MYSQL_TYPE_DOUBLE:
+        case MYSQL_TYPE_TIME:
+        case MYSQL_TYPE_DATE:
+        case MYSQL_TYPE_NEWDATE:
+        case MYSQL_TYPE_DATETIME:
+        case MYSQL_TYPE_TIMESTAMP:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*!
+ * Fetches all rows with bound buffers and copies values to one packed buffer,
+ * runs in threadpool. Returns mysql_stmt_fetch() error or 0
+ */
+int MysqlStatement::FetchPacked(MYSQL_STMT *my_stmt, MYSQL_BIND *binds,
+                                uint32_t field_count, packed_rows *rows) {
+    int error = 0;
+    uint32_t j = 0;
+
+    rows->field_count = field_count;
+    rows->row_count = 0;
+    rows->cells.reserve(mysql_stmt_num_rows(my_stmt) * field_count);
+
+    while ((error = mysql_stmt_fetch(my_stmt)) == 0 || error == MYSQL_DATA_TRUNCATED) {
+        for (j = 0; j < field_count; j++) {
+            packed_cell cell;
+            cell.is_null = *(binds[j].is_null) != 0;
+            cell.length = *(binds[j].length);
+            // Keep values aligned for casts in GetFieldValue()
+            cell.offset = (rows->data.size() + 7) & ~static_cast<size_t>(7);
+
+            if (!cell.is_null) {
+                size_t size = binds[j].buffer_length;
+                if (!IsFixedLengthType(binds[j].buffer_type)) {
+                    // Value may be truncated to buffer size
+                    if (cell.length < size) {
+                        size = cell.length;
+                    }
+                    cell.length = size;
+                }
+
+                // Zero terminated like bound string buffers
+                rows->data.resize(cell.offset + size + 1);
+                memcpy(&rows->data[cell.offset], binds[j].buffer, size);
+                rows->data[cell.offset + size] = '\0';
+            }
+
+            rows->cells.push_back(cell);
+        }
+
+        rows->row_count++;
+    }
+
+    return error == MYSQL_NO_DATA ? 0 : error;
+}
+
+/*!
+ * Converts packed rows to JS array, must be called in main thread
+ */
+Local<Array> MysqlStatement::PackedRowsToArray(packed_rows *rows, MYSQL_FIELD *fields,
+                                               const MysqlResult::fetch_options &fo) {
+    Local<Array> js_result = Array::New(rows->row_count);
+    Local<Object> js_result_row;
+    Local<Value> js_field;
+    size_t i = 0, cell_index = 0;
+    uint32_t j = 0;
+
+    for (i = 0; i < rows->row_count; i++) {
+        js_result_row = MysqlResult::NewRow(fo);
+
+        for (j = 0; j < rows->field_count; j++) {
+            packed_cell &cell = rows->cells[cell_index++];
+
+            if (cell.is_null) {
+                js_field = NanNewLocal(Null());
+            } else {
+                js_field = GetFieldValue(&rows->data[cell.offset], cell.length, fields[j], fo.results_decimal);
+            }
+
+            MysqlResult::SetRowColumn(js_result_row, fields, j, js_field, fo);
+        }
+
+        js_result->Set(Integer::NewFromUnsigned(i), js_result_row);
+    }
+
+    return js_result;
+}
+
+/*!
+ * Allocates result buffers for stored result, string values
+ * get buffers of max_length, so they are never truncated.
+ * Needs STMT_ATTR_UPDATE_MAX_LENGTH set for mysql_stmt_store_result()
+ */
+void MysqlStatement::AllocResultBuffers(MYSQL_FIELD *fields, uint32_t field_count,
+                                        result_buffers *buffers) {
+    buffers->binds.assign(field_count, MYSQL_BIND());
+    buffers->buffers.resize(field_count);
+    buffers->states.assign(field_count, result_cell_state());
+
+    for (uint32_t i = 0; i < field_count; i++) {
+        enum_field_types buffer_type = fields[i].type;
+        size_t size = 0;
+
+        switch (fields[i].type) {
+            case MYSQL_TYPE_TINY:
+            case MYSQL_TYPE_NULL:
+                size = sizeof(signed char);
+                break;
+            case MYSQL_TYPE_SHORT:
+                size = sizeof(short int);  // NOLINT
+                break;
+            case MYSQL_TYPE_INT24:
+            case MYSQL_TYPE_LONG:
+                size = sizeof(int);
+                break;
+            case MYSQL_TYPE_LONGLONG:
+                size = sizeof(long long);  // NOLINT
+                break;
+            case MYSQL_TYPE_FLOAT:
+                size = sizeof(float);
+                break;
+            case MYSQL_TYPE_DOUBLE:
+                size = sizeof(double);
+                break;
+            case MYSQL_TYPE_TIME:
+            case MYSQL_TYPE_DATE:
+            case MYSQL_TYPE_NEWDATE:
+            case MYSQL_TYPE_DATETIME:
+            case MYSQL_TYPE_TIMESTAMP:
+                size = sizeof(MYSQL_TIME);
+                break;
+            case MYSQL_TYPE_DECIMAL:
+            case MYSQL_TYPE_NEWDECIMAL:
+            case MYSQL_TYPE_STRING:
+            case MYSQL_TYPE_VAR_STRING:
+            case MYSQL_TYPE_TINY_BLOB:
+            case MYSQL_TYPE_BLOB:
+            case MYSQL_TYPE_MEDIUM_BLOB:
+            case MYSQL_TYPE_LONG_BLOB:
+            case MYSQL_TYPE_BIT:
+            case MYSQL_TYPE_SET:
+            case MYSQL_TYPE_ENUM:
+            case MYSQL_TYPE_GEOMETRY:
+                size = fields[i].max_length + 1;
+                break;
+            default:
+                // YEAR, JSON and others are fetched as strings
+                buffer_type = MYSQL_TYPE_STRING;
+                size = fields[i].max_length + 1;
+                break;
+        }
+
+        buffers->buffers[i].resize(size);
+
+        MYSQL_BIND &bind = buffers->binds[i];
+        bind.buffer_type = buffer_type;
+        bind.buffer = &buffers->buffers[i][0];
+        bind.buffer_length = size;
+        bind.is_unsigned = (fields[i].flags & UNSIGNED_FLAG) != 0;
+        bind.is_null = &buffers->states[i].is_null;
+        bind.length = &buffers->states[i].length;
+        bind.error = &buffers->states[i].error;
+    }
+}
+
 /*! todo: finish
  * Get the ID generated from the previous INSERT operation
  *
@@ -1329,6 +1700,7 @@ NAN_METHOD(MysqlStatement::PrepareSync) {
     }
 
     stmt->state = STMT_PREPARED;
+    stmt->prepared_query.assign(*query, query_len);
 
     NanReturnValue(True());
 }
@@ -1376,6 +1748,225 @@ NAN_METHOD(MysqlStatement::ResultMetadataSync) {
     NanReturnValue(local_js_result);
 }
 
+/*!
+ * EIO wrapper functions for MysqlStatement::Run,
+ * used when statement has no connection to queue on
+ */
+void MysqlStatement::EIO_After_Run(uv_work_t *req) {
+    RunDone(req->data, NULL);
+
+    delete req;
+}
+
+void MysqlStatement::EIO_Run(uv_work_t *req) {
+    RunWork(req->data);
+}
+
+/*!
+ * Completes run() request in main thread, error is set
+ * when request is shed from connection queue
+ */
+void MysqlStatement::RunDone(void *data, const char *error) {
+    NanScope();
+
+    struct run_request *run_req = static_cast<run_request *>(data);
+    MysqlStatement *stmt = run_req->stmt;
+
+    int argc = 1;
+    Local<Value> argv[2];
+
+    if (error) {
+        argv[0] = V8EXC(error);
+    } else if (!run_req->ok) {
+        argv[0] = V8EXC(run_req->my_error.c_str());
+    } else {
+        // Result is already fetched and freed in threadpool,
+        // statement is ready for the next run()
+        stmt->state = stmt->param_count > 0 ? STMT_BINDED_PARAMS : STMT_PREPARED;
+
+        if (run_req->meta) {
+            argv[1] = PackedRowsToArray(&run_req->rows, mysql_fetch_fields(run_req->meta), run_req->fo);
+        } else {
+            Local<Object> js_info = Object::New();
+            js_info->Set(V8STR("affectedRows"), Number::New(run_req->affected_rows));
+            js_info->Set(V8STR("insertId"), Number::New(run_req->insert_id));
+            argv[1] = js_info;
+        }
+
+        argv[0] = NanNewLocal(Null());
+        argc = 2;
+    }
+
+    if (run_req->meta) {
+        mysql_free_result(run_req->meta);
+    }
+
+    run_req->nan_callback->Call(argc, argv);
+    delete run_req->nan_callback;
+
+    stmt->pending_requests--;
+    stmt->Unref();
+
+    delete run_req;
+}
+
+void MysqlStatement::RunWork(void *data) {
+    struct run_request *run_req = static_cast<run_request *>(data);
+
+    // Statement shares MYSQL handle with connection queries
+    if (run_req->conn) {
+        run_req->conn->LockQuery();
+    }
+
+    RunLocked(run_req);
+
+    if (run_req->conn) {
+        run_req->conn->UnlockQuery();
+    }
+}
+
+/*!
+ * Binds, executes and fetches statement for RunWork(), under connection query_lock
+ */
+void MysqlStatement::RunLocked(run_request *run_req) {
+    MYSQL_STMT *my_stmt = run_req->stmt->_stmt;
+
+    run_req->ok = false;
+    run_req->meta = NULL;
+    run_req->affected_rows = 0;
+    run_req->insert_id = 0;
+
+    if (run_req->stmt->param_count > 0 &&
+        mysql_stmt_bind_param(my_stmt, run_req->stmt->binds)) {
+        run_req->my_error = mysql_stmt_error(my_stmt);
+        return;
+    }
+
+    if (mysql_stmt_execute(my_stmt)) {
+        run_req->my_error = mysql_stmt_error(my_stmt);
+        return;
+    }
+
+    run_req->affected_rows = mysql_stmt_affected_rows(my_stmt);
+    run_req->insert_id = mysql_stmt_insert_id(my_stmt);
+
+    uint32_t field_count = mysql_stmt_field_count(my_stmt);
+    if (field_count == 0) {
+        run_req->ok = true;
+        return;
+    }
+
+    // Let mysql_stmt_store_result() compute max_length for buffers
+    my_bool saved_update_max_length = 0, update_max_length = 1;
+    mysql_stmt_attr_get(my_stmt, STMT_ATTR_UPDATE_MAX_LENGTH, &saved_update_max_length);
+    mysql_stmt_attr_set(my_stmt, STMT_ATTR_UPDATE_MAX_LENGTH, &update_max_length);
+
+    int r = mysql_stmt_store_result(my_stmt);
+
+    mysql_stmt_attr_set(my_stmt, STMT_ATTR_UPDATE_MAX_LENGTH, &saved_update_max_length);
+
+    if (r) {
+        run_req->my_error = mysql_stmt_error(my_stmt);
+        return;
+    }
+
+    MYSQL_RES *meta = mysql_stmt_result_metadata(my_stmt);
+    if (!meta) {
+        run_req->my_error = mysql_stmt_error(my_stmt);
+        mysql_stmt_free_result(my_stmt);
+        return;
+    }
+
+    result_buffers buffers;
+    AllocResultBuffers(mysql_fetch_fields(meta), field_count, &buffers);
+
+    if (mysql_stmt_bind_result(my_stmt, &buffers.binds[0]) ||
+        FetchPacked(my_stmt, &buffers.binds[0], field_count, &run_req->rows)) {
+        run_req->my_error = mysql_stmt_error(my_stmt);
+        mysql_stmt_free_result(my_stmt);
+        mysql_free_result(meta);
+        return;
+    }
+
+    mysql_stmt_free_result(my_stmt);
+
+    run_req->meta = meta;
+    run_req->ok = true;
+}
+
+/**
+ * MysqlStatement#run([params][, options], callback)
+ * - params (Array): Parameters values
+ * - options (Object): Fetch style options, `asArray` and `nestTables`
+ * - callback (Function): Callback function, gets (error, rows) for queries with result set
+ *   and (error, info) with `affectedRows` and `insertId` for others
+ *
+ * Binds parameters, executes statement, stores result
+ * and fetches all rows in one threadpool job. Job runs through connection queue
+ * after already queued queries and is serialized with other connection queries.
+ * Throws while previous request of this statement is running
+ **/
+NAN_METHOD(MysqlStatement::Run) {
+    NanScope();
+
+    REQ_FUN_ARG(args.Length() - 1, callback);
+
+    MysqlStatement *stmt = OBJUNWRAP<MysqlStatement>(args.This());
+
+    MYSQLSTMT_MUSTBE_PREPARED;
+    MYSQLSTMT_MUSTNOT_BE_BUSY;
+
+    int arg_pos = 0;
+    MysqlResult::fetch_options fo;
+
+    if (args.Length() > arg_pos + 1 && args[arg_pos]->IsArray()) {
+        const char *error = NULL;
+        if (!stmt->SetParams(Local<Array>::Cast(args[arg_pos]), &error)) {
+            return NanThrowError(error);
+        }
+        arg_pos++;
+    }
+
+    if (args.Length() > arg_pos + 1) {
+        if (!args[arg_pos]->IsObject()) {
+            return NanThrowTypeError("run() can handle only ([params][, options], callback) arguments");
+        }
+        MYSQLRES_GET_FETCH_OPTIONS(args[arg_pos]->ToObject(), fo);
+    }
+
+    if (fo.results_as_array && fo.results_nest_tables) {
+        return NanThrowError("You can't mix 'asArray' and 'nestTables' options");
+    }
+
+    stmt->StopCoalescing();
+    stmt->MarkActive();
+
+    run_request *run_req = new run_request;
+
+    run_req->nan_callback = new NanCallback(callback.As<Function>());
+
+    run_req->stmt = stmt;
+    run_req->conn = stmt->conn;
+    run_req->fo = fo;
+    run_req->ok = false;
+    run_req->meta = NULL;
+    stmt->Ref();
+    stmt->pending_requests++;
+
+    // Connection queue holds connection until request is done
+    // and orders it with queued queries
+    if (stmt->conn) {
+        stmt->conn->QueueWork(run_req, RunWork, RunDone);
+        NanReturnUndefined();
+    }
+
+    uv_work_t *_req = new uv_work_t;
+    _req->data = run_req;
+    uv_queue_work(uv_default_loop(), _req, EIO_Run, (uv_after_work_cb)EIO_After_Run);
+
+    NanReturnUndefined();
+}
+
 /*! todo: finish
  * Send parameter data to the server in blocks (or "chunks")
  *
@@ -1436,6 +2027,7 @@ void MysqlStatement::EIO_After_StoreResult(uv_work_t *req) {
     store_req->nan_callback->Call(argc, argv);
     delete store_req->nan_callback;
 
+    store_req->stmt->pending_requests--;
     store_req->stmt->Unref();
 
     delete store_req;
@@ -1467,6 +2059,7 @@ NAN_METHOD(MysqlStatement::StoreResult) {
 
     store_req->stmt = stmt;
     stmt->Ref();
+    stmt->pending_requests++;
 
     uv_work_t *_req = new uv_work_t;
     _req->data = store_req;
@@ -14,7 +14,13 @@
 #include <node.h>
 #include <node_object_wrap.h>
 
+#include <string>
+#include <vector>
+
 #include "./mysql_bindings.h"
+#include "./mysql_bindings_result.h"
+
+class MysqlConnection;
 
 #define MYSQLSTMT_MUSTBE_INITIALIZED \
     if (stmt->state < STMT_INITIALIZED) { \
@@ -36,6 +42,11 @@
         return NanThrowError("Statement result not stored"); \
     }
 
+#define MYSQLSTMT_MUSTNOT_BE_BUSY \
+    if (stmt->Busy()) { \
+        return NanThrowError("Statement is busy in threadpool"); \
+    }
+
 /** section: Classes
  * class MysqlStatement
  *
@@ -49,9 +60,33 @@ class MysqlStatement : public node::ObjectWrap {
 
     static Local<Object> NewInstance(MYSQL_STMT *my_statement);
 
+    void SetConnection(MysqlConnection *connection);
+
+    void Invalidate();
+
+    std::string PreparedQuery();
+
+    void Reprepare(MYSQL_STMT *my_stmt);
+
+    bool Busy();
+
   private:
     MYSQL_STMT *_stmt;
 
+    // Connection statement is registered with
+    MysqlConnection *conn;
+
+    // Query of the last successful prepare, for re-prepare on reconnect
+    std::string prepared_query;
+
+    void StopCoalescing();
+
+    // Executions keep connection from keepalive ping, see MysqlConnection::MarkActive()
+    void MarkActive();
+
+    // Number of requests running in threadpool, they use binds and handle
+    uint32_t pending_requests;
+
     MYSQL_BIND *binds;
     MYSQL_BIND *result_binds;
     unsigned long param_count;
@@ -87,6 +122,8 @@ class MysqlStatement : public node::ObjectWrap {
 
     static NAN_METHOD(AttrSetSync);
 
+    bool SetParams(Local<Array> js_params, const char **error);
+
     static NAN_METHOD(BindParamsSync);
 
     static NAN_METHOD(BindResultSync);
@@ -114,6 +151,19 @@ class MysqlStatement : public node::ObjectWrap {
 
     static NAN_METHOD(ExecuteSync);
 
+    // Result rows copied from bound buffers in threadpool,
+    // main thread only converts them to JS values
+    struct packed_cell {
+        bool is_null;
+        size_t offset;
+        unsigned long length;
+    };
+    struct packed_rows {
+        std::vector<char> data;
+        std::vector<packed_cell> cells;
+        uint32_t field_count;
+        size_t row_count;
+    };
     struct fetch_request {
         bool ok;
         bool empty_resultset;
@@ -123,6 +173,10 @@ class MysqlStatement : public node::ObjectWrap {
 
         MYSQL_RES* meta;
         unsigned long field_count;
+
+        // fetchAll() rows, fetched in threadpool
+        packed_rows rows;
+        std::string my_error;
     };
     static void EIO_After_FetchAll(uv_work_t* req);
     static void EIO_FetchAll(uv_work_t* req);
@@ -130,6 +184,23 @@ class MysqlStatement : public node::ObjectWrap {
 
     static NAN_METHOD(FetchAllSync);
 
+    struct fetchAllJSON_request {
+        bool ok;
+        bool empty_resultset;
+
+        NanCallback *nan_callback;
+        MysqlStatement* stmt;
+
+        MysqlResult::fetch_options fo;
+
+        char *data;
+        size_t length;
+        std::string my_error;
+    };
+    static void EIO_After_FetchAllJSON(uv_work_t* req);
+    static void EIO_FetchAllJSON(uv_work_t* req);
+    static NAN_METHOD(FetchAllJSON);
+
     static void EIO_After_Fetch(uv_work_t* req);
     static void EIO_Fetch(uv_work_t* req);
     static NAN_METHOD(Fetch);
@@ -142,7 +213,26 @@ class MysqlStatement : public node::ObjectWrap {
 
     static void FreeMysqlBinds(MYSQL_BIND *binds, unsigned long size, bool params);
 
-    static Local<Value> GetFieldValue(void* ptr, unsigned long& length, MYSQL_FIELD& field);
+    static Local<Value> GetFieldValue(void* ptr, unsigned long& length, MYSQL_FIELD& field,
+                                      MysqlBindingsDecimalMode decimal = MYSQL_BINDINGS_DECIMAL_STRING);
+
+    static bool IsFixedLengthType(enum_field_types type);
+    static int FetchPacked(MYSQL_STMT *my_stmt, MYSQL_BIND *binds, uint32_t field_count, packed_rows *rows);
+    static Local<Array> PackedRowsToArray(packed_rows *rows, MYSQL_FIELD *fields,
+                                          const MysqlResult::fetch_options &fo);
+
+    // Own result buffers sized by max_length of stored result
+    struct result_cell_state {
+        unsigned long length;
+        my_bool is_null;
+        my_bool error;
+    };
+    struct result_buffers {
+        std::vector<MYSQL_BIND> binds;
+        std::vector<std::vector<char> > buffers;
+        std::vector<result_cell_state> states;
+    };
+    static void AllocResultBuffers(MYSQL_FIELD *fields, uint32_t field_count, result_buffers *buffers);
 
     static NAN_METHOD(LastInsertIdSync);
 
@@ -156,6 +246,30 @@ class MysqlStatement : public node::ObjectWrap {
 
     static NAN_METHOD(ResultMetadataSync);
 
+    struct run_request {
+        bool ok;
+
+        NanCallback *nan_callback;
+        MysqlStatement* stmt;
+        MysqlConnection *conn;
+
+        MysqlResult::fetch_options fo;
+
+        MYSQL_RES *meta;
+        packed_rows rows;
+        my_ulonglong affected_rows;
+        my_ulonglong insert_id;
+
+        std::string my_error;
+    };
+    static void EIO_After_Run(uv_work_t* req);
+    static void EIO_Run(uv_work_t* req);
+    // Runs through connection queue, see MysqlConnection::QueueWork()
+    static void RunDone(void *data, const char *error);
+    static void RunWork(void *data);
+    static void RunLocked(run_request *run_req);
+    static NAN_METHOD(Run);
+
     static NAN_METHOD(SendLongDataSync);
 
     static NAN_METHOD(StoreResultSync);
@@ -352,3 +352,36 @@ exports.CallStoredProcedureSelectNested = function (test) {
     });
   });
 };
+
+exports.CallStoredProcedureMultiQuery = function (test) {
+  test.expect(7);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(),
+    res,
+    num = 1234;
+
+  conn.connectSync(cfg.host, cfg.user, cfg.password, cfg.database, null, null, cfg.mysql_libmysqlclient.CLIENT_MULTI_RESULTS);
+
+  res = conn.querySync("DROP PROCEDURE IF EXISTS test_procedure;");
+  test.strictEqual(res, true);
+
+  res = conn.querySync("CREATE PROCEDURE test_procedure() BEGIN SELECT " + num + " AS num; SELECT " + (num + 1) + " AS num; END");
+  test.strictEqual(res, true);
+
+  conn.multiQuery("CALL test_procedure();", function (err, results) {
+    test.ok(err === null, "Error object is not present");
+    // Two result sets and the execution status
+    test.equals(results.length, 3, "All results from procedure");
+
+    test.equals(results[0].fetchAllSync()[0].num, num, "First result set");
+    test.equals(results[1].fetchAllSync()[0].num, num + 1, "Second result set");
+    test.ok(typeof results[2].affectedRows === 'number', "Execution status");
+
+    results[0].freeSync();
+    results[1].freeSync();
+
+    conn.closeSync();
+    test.done();
+  });
+};
@@ -317,3 +317,32 @@ exports.setOptionSyncQueryFetchAll = function (test) {
   });
 };
 
+exports.FetchAll_dictionary = function (test) {
+  test.expect(7);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    query = "SELECT t1.size, t1.colors FROM " + cfg.test_table + " AS t1, " + cfg.test_table + " AS t2 " +
+            "WHERE t1.size='small' AND t2.size='large';",
+    res,
+    rows;
+
+  rows = conn.querySync(query).fetchAllSync();
+  test.same(rows, [{size: 'small', colors: ['red']}, {size: 'small', colors: ['red']}], "SET and ENUM values");
+  test.ok(rows[0].colors !== rows[1].colors, "SET arrays are not shared by default");
+  test.ok(!Object.isFrozen(rows[0].colors), "SET array is mutable by default");
+
+  rows = conn.querySync(query).fetchAllSync({dictionary: true});
+  test.ok(rows[0].colors === rows[1].colors, "Same SET value is one array with dictionary option");
+  test.ok(Object.isFrozen(rows[0].colors), "Shared SET array is frozen");
+
+  res = conn.querySync("SELECT colors FROM " + cfg.test_table2 + " ORDER BY colors;");
+  res.fetchAll({dictionary: true}, function (err, rows) {
+    test.ok(err === null, "Error object is not present");
+    test.same(rows, [{colors: 'black'}, {colors: 'deep purple'}, {colors: 'orange'}, {colors: 'red'}],
+              "conn.querySync('SELECT ...').fetchAll({dictionary: true})");
+
+    conn.closeSync();
+    test.done();
+  });
+};
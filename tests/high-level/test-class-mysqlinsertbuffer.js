@@ -0,0 +1,177 @@
+/*
+Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+See contributors list in README
+
+See license text in LICENSE file
+*/
+
+// Load configuration
+var cfg = require('../config');
+
+exports.Setup = function (test) {
+  test.expect(0);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  conn.querySync("DROP TABLE IF EXISTS " + cfg.test_table + ";");
+  conn.querySync("CREATE TABLE " + cfg.test_table +
+    " (id INT(8) NOT NULL AUTO_INCREMENT, title VARCHAR(32), PRIMARY KEY (id)) ENGINE=MEMORY;");
+
+  conn.closeSync();
+
+  test.done();
+};
+
+exports.New = function (test) {
+  test.expect(2);
+
+  test.throws(function () {
+    (new cfg.mysql_libmysqlclient.MysqlInsertBuffer());
+  });
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  test.throws(function () {
+    cfg.mysql_libmysqlclient.createInsertBuffer(conn, {loadData: true});
+  }, Error, "loadData requires MysqlConnectionQueued");
+
+  conn.closeSync();
+  test.done();
+};
+
+function testBufferedInsert(test, options) {
+  test.expect(4);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionQueuedSync(),
+    buffer = cfg.mysql_libmysqlclient.createInsertBuffer(conn, options),
+    ids = [],
+    titles = ["first", "second\twith tab", null];
+
+  conn.initSync();
+  conn.setOptionSync(cfg.mysql_libmysqlclient.MYSQL_OPT_LOCAL_INFILE);
+  conn.realConnectSync(cfg.host, cfg.user, cfg.password, cfg.database);
+  conn.querySync("DELETE FROM " + cfg.test_table + ";");
+
+  titles.forEach(function (title, i) {
+    buffer.bufferedInsert(cfg.test_table, {title: title}, function (err, info) {
+      test.ok(err === null, "Row is inserted");
+      ids[i] = info.insertId;
+
+      if (ids.length === titles.length) {
+        var rows = conn.querySync("SELECT id, title FROM " + cfg.test_table + " ORDER BY id;").fetchAllSync();
+
+        test.same(rows, titles.map(function (title, i) {
+          return {id: ids[i], title: title};
+        }), "Rows are written in one batch with mapped insertIds");
+
+        conn.closeSync();
+        test.done();
+      }
+    });
+  });
+}
+
+exports.BufferedInsert = function (test) {
+  testBufferedInsert(test, {windowMs: 5});
+};
+
+exports.BufferedInsertLoadData = function (test) {
+  testBufferedInsert(test, {windowMs: 5, loadData: true});
+};
+
+function testBufferedInsertValues(test, options) {
+  test.expect(3);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionQueuedSync(),
+    buffer = cfg.mysql_libmysqlclient.createInsertBuffer(conn, options),
+    done = 0;
+
+  conn.initSync();
+  conn.setOptionSync(cfg.mysql_libmysqlclient.MYSQL_OPT_LOCAL_INFILE);
+  conn.realConnectSync(cfg.host, cfg.user, cfg.password, cfg.database);
+  conn.querySync("DELETE FROM " + cfg.test_table + ";");
+
+  [new Date(Date.UTC(2020, 0, 2, 3, 4, 5, 60)), new Buffer([0x61, 0x09, 0x00, 0x62])].forEach(function (title) {
+    buffer.bufferedInsert(cfg.test_table, {title: title}, function (err) {
+      test.ok(err === null, "Row is inserted");
+
+      done += 1;
+      if (done === 2) {
+        var rows = conn.querySync("SELECT title FROM " + cfg.test_table + " ORDER BY id;").fetchAllSync();
+
+        test.same(rows, [{title: "2020-01-02 03:04:05.060000"}, {title: "a\t\u0000b"}],
+                  "Dates are written as DATETIME text, Buffers as bytes");
+
+        conn.closeSync();
+        test.done();
+      }
+    });
+  });
+}
+
+exports.BufferedInsertValues = function (test) {
+  testBufferedInsertValues(test, {windowMs: 5});
+};
+
+exports.BufferedInsertLoadDataValues = function (test) {
+  testBufferedInsertValues(test, {windowMs: 5, loadData: true});
+};
+
+exports.BufferedInsertLoadDataWarnings = function (test) {
+  test.expect(2);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionQueuedSync(),
+    buffer;
+
+  conn.initSync();
+  conn.setOptionSync(cfg.mysql_libmysqlclient.MYSQL_OPT_LOCAL_INFILE);
+  conn.realConnectSync(cfg.host, cfg.user, cfg.password, cfg.database);
+  buffer = cfg.mysql_libmysqlclient.createInsertBuffer(conn, {windowMs: 5, loadData: true});
+
+  // Value is longer than VARCHAR(32), LOAD DATA truncates it with warning
+  buffer.bufferedInsert(cfg.test_table, {title: new Array(40).join("x")}, function (err) {
+    test.ok(err instanceof Error, "Batch with warnings fails");
+    test.ok(err.warnings.length > 0, "Error has warnings");
+
+    conn.closeSync();
+    test.done();
+  });
+};
+
+exports.BufferedInsertExplicitId = function (test) {
+  test.expect(2);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    buffer = cfg.mysql_libmysqlclient.createInsertBuffer(conn, {windowMs: 5});
+
+  conn.querySync("DELETE FROM " + cfg.test_table + ";");
+
+  buffer.bufferedInsert(cfg.test_table, {id: 100, title: "explicit"}, function (err, info) {
+    test.ok(err === null, "Row is inserted");
+    test.ok(!info.hasOwnProperty("insertId"), "Row setting auto increment column gets no insertId");
+
+    conn.closeSync();
+    test.done();
+  });
+};
+
+exports.BufferedInsertMaxRows = function (test) {
+  test.expect(1);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    buffer = cfg.mysql_libmysqlclient.createInsertBuffer(conn, {windowMs: 10000, maxRows: 2}),
+    started = Date.now();
+
+  buffer.bufferedInsert(cfg.test_table, {title: "a"});
+  buffer.bufferedInsert(cfg.test_table, {title: "b"}, function () {
+    test.ok(Date.now() - started < 10000, "Full batch is written without waiting for window");
+
+    conn.closeSync();
+    test.done();
+  });
+};
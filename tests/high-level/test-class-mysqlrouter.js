@@ -0,0 +1,180 @@
+/*
+Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+See contributors list in README
+
+See license text in LICENSE file
+*/
+
+// Load configuration
+var cfg = require('../config');
+
+function createRouter(options) {
+  var
+    primary = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    replicas = [
+      cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+      cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database)
+    ];
+
+  return cfg.mysql_libmysqlclient.createRouter(primary, replicas, options);
+}
+
+function closeRouter(router) {
+  router._primary.closeSync();
+  router._replicas.forEach(function (replica) {
+    replica.closeSync();
+  });
+}
+
+exports.Setup = function (test) {
+  test.expect(0);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  conn.querySync("DROP TABLE IF EXISTS " + cfg.test_table + ";");
+  conn.querySync("CREATE TABLE " + cfg.test_table + " (number INT(8) NOT NULL) ENGINE=MEMORY;");
+
+  conn.closeSync();
+
+  test.done();
+};
+
+exports.ClassifyQuerySync = function (test) {
+  test.expect(12);
+
+  var mysql = cfg.mysql_libmysqlclient;
+
+  test.equals(mysql.classifyQuerySync("SELECT 1;"), mysql.QUERY_TYPE_READ);
+  test.equals(mysql.classifyQuerySync(" /* comment */ (select * from t) UNION (SELECT 2)"), mysql.QUERY_TYPE_READ);
+  test.equals(mysql.classifyQuerySync("SHOW TABLES;"), mysql.QUERY_TYPE_READ);
+  test.equals(mysql.classifyQuerySync("SELECT 'into' FROM t;"), mysql.QUERY_TYPE_READ);
+  test.equals(mysql.classifyQuerySync("SELECT * FROM t FOR UPDATE;"), mysql.QUERY_TYPE_WRITE);
+  test.equals(mysql.classifyQuerySync("SELECT * FROM t LOCK IN SHARE MODE;"), mysql.QUERY_TYPE_WRITE);
+  test.equals(mysql.classifyQuerySync("SELECT LAST_INSERT_ID();"), mysql.QUERY_TYPE_WRITE);
+  test.equals(mysql.classifyQuerySync("INSERT INTO t VALUES (1);"), mysql.QUERY_TYPE_WRITE);
+  test.equals(mysql.classifyQuerySync("START TRANSACTION;"), mysql.QUERY_TYPE_BEGIN);
+  test.equals(mysql.classifyQuerySync("COMMIT;"), mysql.QUERY_TYPE_END);
+  test.equals(mysql.classifyQuerySync("ROLLBACK;"), mysql.QUERY_TYPE_END);
+  test.equals(mysql.classifyQuerySync("ROLLBACK TO SAVEPOINT a;"), mysql.QUERY_TYPE_WRITE);
+
+  test.done();
+};
+
+exports.New = function (test) {
+  test.expect(2);
+
+  test.doesNotThrow(function () {
+    closeRouter(createRouter());
+  });
+
+  test.throws(function () {
+    (new cfg.mysql_libmysqlclient.MysqlRouter());
+  });
+
+  test.done();
+};
+
+exports.ReadsGoToReplicas = function (test) {
+  test.expect(2);
+
+  var router = createRouter();
+
+  test.ok(router._replicas.indexOf(router.getConnectionSync("SELECT 1;")) !== -1, "Read is routed to replica");
+  test.strictEqual(router.getConnectionSync("INSERT INTO " + cfg.test_table + " VALUES (1);"),
+                   router._primary, "Write is routed to primary");
+
+  closeRouter(router);
+  test.done();
+};
+
+exports.ReadsGoToFastestReplica = function (test) {
+  test.expect(1);
+
+  var router = createRouter();
+
+  router._replicas[0].query("SELECT SLEEP(0.05);", function () {
+    router._replicas[1].query("SELECT 1;", function () {
+      test.strictEqual(router.getConnectionSync("SELECT 1;"), router._replicas[1], "Read is routed to fastest replica");
+
+      closeRouter(router);
+      test.done();
+    });
+  });
+};
+
+exports.ReadsArePinnedAfterWrite = function (test) {
+  test.expect(2);
+
+  var router = createRouter({readAfterWriteMs: 100});
+
+  router.query("INSERT INTO " + cfg.test_table + " VALUES (1);", function (err) {
+    if (err) {
+      throw err;
+    }
+
+    test.strictEqual(router.getConnectionSync("SELECT 1;"), router._primary, "Read is pinned to primary after write");
+
+    setTimeout(function () {
+      test.notStrictEqual(router.getConnectionSync("SELECT 1;"), router._primary, "Read goes to replica after window");
+
+      closeRouter(router);
+      test.done();
+    }, 150);
+  });
+};
+
+exports.ReadsArePinnedInTransaction = function (test) {
+  test.expect(2);
+
+  var router = createRouter({readAfterWriteMs: 0});
+
+  router.query("START TRANSACTION;", function (err) {
+    if (err) {
+      throw err;
+    }
+
+    test.strictEqual(router.getConnectionSync("SELECT 1;"), router._primary, "Read is pinned to primary in transaction");
+
+    router.query("COMMIT;", function (err) {
+      if (err) {
+        throw err;
+      }
+
+      test.notStrictEqual(router.getConnectionSync("SELECT 1;"), router._primary, "Read goes to replica after commit");
+
+      closeRouter(router);
+      test.done();
+    });
+  });
+};
+
+exports.FailedBeginDoesNotPinReads = function (test) {
+  test.expect(2);
+
+  var router = createRouter({readAfterWriteMs: 0});
+
+  router.query("START TRANSACTION WITH NOTHING;", function (err) {
+    test.ok(err instanceof Error, "BEGIN error is passed to callback");
+    test.notStrictEqual(router.getConnectionSync("SELECT 1;"), router._primary, "Read goes to replica after failed BEGIN");
+
+    closeRouter(router);
+    test.done();
+  });
+};
+
+exports.QueryResult = function (test) {
+  test.expect(1);
+
+  var router = createRouter();
+
+  router.query("SELECT 1 AS one;", function (err, res) {
+    if (err) {
+      throw err;
+    }
+
+    test.same(res.fetchAllSync(), [{one: 1}], "Read result");
+
+    closeRouter(router);
+    test.done();
+  });
+};
@@ -0,0 +1,191 @@
+/*
+Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+See contributors list in README
+
+See license text in LICENSE file
+*/
+
+// Load configuration
+var cfg = require('../config');
+
+// Both shards are connections to the test server
+function createShardRouter(options) {
+  var shards = {};
+
+  ["shard_a", "shard_b"].forEach(function (name) {
+    shards[name] = [
+      cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database)
+    ];
+  });
+
+  return cfg.mysql_libmysqlclient.createShardRouter(shards, options);
+}
+
+function closeShardRouter(router) {
+  Object.keys(router._shards).forEach(function (name) {
+    router._shards[name].connections.forEach(function (connection) {
+      connection.closeSync();
+    });
+  });
+}
+
+exports.Setup = function (test) {
+  test.expect(0);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  conn.querySync("DROP TABLE IF EXISTS " + cfg.test_table + ";");
+  conn.querySync("CREATE TABLE " + cfg.test_table + " (id INT(8) NOT NULL, title VARCHAR(32)) ENGINE=MEMORY;");
+  conn.querySync("INSERT INTO " + cfg.test_table + " VALUES (1, 'a'), (3, NULL), (5, 'c');");
+
+  conn.closeSync();
+
+  test.done();
+};
+
+exports.New = function (test) {
+  test.expect(3);
+
+  test.doesNotThrow(function () {
+    closeShardRouter(createShardRouter());
+  });
+
+  test.throws(function () {
+    cfg.mysql_libmysqlclient.createShardRouter({}, {virtualNodes: 0});
+  });
+
+  test.throws(function () {
+    cfg.mysql_libmysqlclient.createShardRouter({shard_a: []});
+  });
+
+  test.done();
+};
+
+exports.GetShardSync = function (test) {
+  test.expect(4);
+
+  var router = cfg.mysql_libmysqlclient.createShardRouter(), keys = [], moved = 0, i;
+
+  test.throws(function () {
+    router.getShardSync(1);
+  }, "No shards");
+
+  // Connections are not used for keys mapping
+  router.addShardSync("shard_a", {});
+  router.addShardSync("shard_b", {});
+
+  for (i = 0; i < 1000; i += 1) {
+    keys.push(router.getShardSync(i));
+  }
+
+  test.strictEqual(router.getShardSync(42), keys[42], "Key always maps to the same shard");
+  test.ok(keys.indexOf("shard_a") !== -1 && keys.indexOf("shard_b") !== -1, "Keys are spread over shards");
+
+  router.addShardSync("shard_c", {});
+  for (i = 0; i < 1000; i += 1) {
+    if (router.getShardSync(i) !== keys[i] && router.getShardSync(i) !== "shard_c") {
+      moved += 1;
+    }
+  }
+  test.strictEqual(moved, 0, "Keys move only to the added shard");
+
+  test.done();
+};
+
+exports.QueryRoutedByKey = function (test) {
+  test.expect(1);
+
+  var router = createShardRouter(), key = "tenant-1";
+
+  router.query(key, "SELECT CONNECTION_ID() AS id;", function (err, res) {
+    if (err) {
+      throw err;
+    }
+
+    var expected = router._shards[router.getShardSync(key)].connections[0].threadIdSync();
+    test.equals(res.fetchAllSync()[0].id, expected, "Query is sent to the key shard");
+
+    closeShardRouter(router);
+    test.done();
+  });
+};
+
+exports.Execute = function (test) {
+  test.expect(1);
+
+  var router = createShardRouter();
+
+  router.execute("tenant-1", "SELECT ? + 1 AS result;", [41], function (err, rows) {
+    if (err) {
+      throw err;
+    }
+
+    test.same(rows, [{result: 42}], "Statement result");
+
+    closeShardRouter(router);
+    test.done();
+  });
+};
+
+exports.ScatterWithOrderByAndLimit = function (test) {
+  test.expect(2);
+
+  var router = createShardRouter();
+
+  router.scatter("SELECT id, title FROM " + cfg.test_table + " WHERE 0;", function (err, rows) {
+    if (err) {
+      throw err;
+    }
+
+    test.same(rows, [], "Empty merged result");
+
+    // Both shards return the same rows, so every row is doubled
+    router.scatter("SELECT id, title FROM " + cfg.test_table + " ORDER BY title DESC, id;",
+                   {orderBy: ["title DESC", "id"], limit: 5}, function (err, rows) {
+      if (err) {
+        throw err;
+      }
+
+      test.same(rows, [
+        {id: 5, title: 'c'},
+        {id: 5, title: 'c'},
+        {id: 1, title: 'a'},
+        {id: 1, title: 'a'},
+        {id: 3, title: null}
+      ], "Rows are merged by orderBy and cut by limit");
+
+      closeShardRouter(router);
+      test.done();
+    });
+  });
+};
+
+exports.ScatterWithDifferentColumns = function (test) {
+  test.expect(1);
+
+  var router = createShardRouter(), names = Object.keys(router._shards);
+
+  // Temporary tables are per connection, so shards return columns with different names
+  router._shards[names[0]].connections[0].querySync("CREATE TEMPORARY TABLE shard_columns (a INT);");
+  router._shards[names[1]].connections[0].querySync("CREATE TEMPORARY TABLE shard_columns (b INT);");
+
+  router.scatter("SELECT * FROM shard_columns;", function (err) {
+    test.ok(err instanceof Error, "Shards with different column names are not merged");
+
+    closeShardRouter(router);
+    test.done();
+  });
+};
+
+exports.ScatterWithError = function (test) {
+  test.expect(1);
+
+  var router = createShardRouter();
+
+  router.scatter("SELECT * FROM " + cfg.test_table_notexists + ";", function (err) {
+    test.ok(err instanceof Error, "Shard error is passed to callback");
+
+    closeShardRouter(router);
+    test.done();
+  });
+};
@@ -8,6 +8,93 @@ See license text in LICENSE file
 // Load configuration
 var cfg = require('../config.js');
 
+exports.AutoCommitCommitAndRollback = function (test) {
+  test.expect(4);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  conn.autoCommit(false, function (err) {
+    test.ok(err === null, "conn.autoCommit(false)");
+
+    conn.commit(function (err) {
+      test.ok(err === null, "conn.commit()");
+
+      conn.rollback(function (err) {
+        test.ok(err === null, "conn.rollback()");
+
+        conn.autoCommit(true, function (err) {
+          test.ok(err === null, "conn.autoCommit(true)");
+
+          conn.closeSync();
+          test.done();
+        });
+      });
+    });
+  });
+};
+
+exports.ChangeUser = function (test) {
+  test.expect(3);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  conn.changeUser(cfg.user, cfg.password, cfg.database_denied, function (err) {
+    test.ok(err instanceof Error, "conn.changeUser() with denied database selection");
+
+    conn.changeUser(cfg.user, cfg.password, cfg.database, function (err) {
+      test.ok(err === null, "conn.changeUser() with database selection");
+
+      test.throws(function () {
+        conn.changeUser(cfg.user, 2, function () {});
+      }, TypeError, "conn.changeUser() with not string password argument");
+
+      conn.closeSync();
+      test.done();
+    });
+  });
+};
+
+exports.Close = function (test) {
+  test.expect(5);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database), queryDone = false;
+
+  // Result sets of queries completed after connection is closed are not usable
+  conn.query("DO SLEEP(0.1);", function (err, res) {
+    test.ok(err === null, "In-flight query is completed by conn.close()");
+    queryDone = true;
+  });
+
+  conn.close(function (err) {
+    test.ok(err === null, "conn.close()");
+    test.ok(queryDone, "Connection is closed after in-flight query");
+    test.ok(!conn.connectedSync(), "Connection is closed");
+
+    test.done();
+  });
+
+  test.throws(function () {
+    conn.query("SELECT 1;", function () {});
+  }, /Connection is closing/);
+};
+
+exports.CloseWithKillQuery = function (test) {
+  test.expect(1);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    started = Date.now();
+
+  conn.query("SELECT SLEEP(10) AS s;", function () {});
+
+  setTimeout(function () {
+    conn.close({killQuery: true}, function () {
+      test.ok(Date.now() - started < 5000, "Running query is killed by conn.close({killQuery: true})");
+
+      test.done();
+    });
+  }, 100);
+};
+
 exports.Connect = function (test) {
   test.expect(2);
   
@@ -49,6 +136,46 @@ exports.ConnectWithError = function (test) {
   });
 };
 
+exports.ConnectToHostsList = function (test) {
+  test.expect(4);
+
+  var conn = new cfg.mysql_bindings.MysqlConnection();
+
+  test.throws(function () {
+    conn.connect(["[::1"], cfg.user, cfg.password, cfg.database, function () {});
+  }, "conn.connect() with invalid host in hosts list");
+
+  // Nothing listens on port 1, so the first attempt fails and the next one wins
+  conn.connect(["127.0.0.1:1", cfg.host], cfg.user, cfg.password, cfg.database, function (err) {
+    test.ok(err === null, "conn.connect() to hosts list with dead host");
+    test.ok(conn.connectedSync(), "conn.connectedSync() after conn.connect() to hosts list");
+
+    conn.closeSync();
+
+    conn.connect(["127.0.0.1:1", "[::1]:1"], cfg.user, cfg.password, cfg.database, function (err) {
+      test.ok(err instanceof Error, "conn.connect() to hosts list with dead hosts only");
+
+      test.done();
+    });
+  });
+};
+
+exports.ConnectToHostsListWithBlackholedHost = function (test) {
+  test.expect(2);
+
+  var conn = new cfg.mysql_bindings.MysqlConnection();
+
+  // TEST-NET-1 address doesn't answer, the next host wins after stagger delay
+  conn.connect(["192.0.2.1", cfg.host], cfg.user, cfg.password, cfg.database, function (err) {
+    test.ok(err === null, "conn.connect() to hosts list with blackholed host");
+    test.ok(conn.connectedSync(), "conn.connectedSync() after conn.connect() to hosts list");
+
+    conn.closeSync();
+
+    test.done();
+  });
+};
+
 exports.Connect2Times = function (test) {
   test.expect(5);
 
@@ -88,6 +215,243 @@ exports.ConnectAfterConnectSync2 = function (test) {
   });
 };
 
+exports.Enqueue = function (test) {
+  test.expect(3);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    mysql = cfg.mysql_libmysqlclient,
+    order = [];
+
+  function onResult(name) {
+    return function (err, res) {
+      order.push(err ? name + ": " + err.message : name);
+
+      if (order.length === 4) {
+        test.same(order, [
+          "sleep",
+          "high",
+          "expired: Query deadline exceeded in queue",
+          "low"
+        ], "Queued queries are sent in priority order, expired are shed");
+
+        var stats = conn.queueStatsSync();
+        test.equals(stats.dispatched, 3, "Dispatched queries count");
+        test.equals(stats.shed, 1, "Shed queries count");
+
+        conn.closeSync();
+        test.done();
+      }
+    };
+  }
+
+  conn.enqueue("query", "SELECT SLEEP(0.2);", onResult("sleep"));
+  conn.enqueue("query", "SELECT 'low';", {priority: mysql.QUEUE_PRIORITY_LOW}, onResult("low"));
+  conn.enqueue("query", "SELECT 'expired';", {deadlineMs: 50}, onResult("expired"));
+  conn.enqueue("querySend", "SELECT 'high';", {priority: mysql.QUEUE_PRIORITY_HIGH}, onResult("high"));
+};
+
+exports.EnqueueThenCommit = function (test) {
+  test.expect(3);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database), order = [];
+
+  conn.enqueue("query", "SELECT SLEEP(0.2);", function (err) {
+    test.ok(err === null, "conn.enqueue('query')");
+    order.push("query");
+  });
+  conn.commit(function (err) {
+    test.ok(err === null, "conn.commit()");
+    order.push("commit");
+
+    test.same(order, ["query", "commit"], "conn.commit() waits for queued query");
+
+    conn.closeSync();
+    test.done();
+  });
+};
+
+exports.EnqueueWithWrongArguments = function (test) {
+  test.expect(2);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  test.throws(function () {
+    conn.enqueue("fetchAll", "SELECT 1;", function () {});
+  });
+
+  test.throws(function () {
+    conn.enqueue("query", "SELECT 1;", {priority: 100}, function () {});
+  });
+
+  conn.closeSync();
+  test.done();
+};
+
+exports.GetWarnings = function (test) {
+  test.expect(2);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  conn.querySync("DROP TABLE IF EXISTS " + cfg.test_table_notexists + ";");
+
+  conn.getWarnings(function (err, warnings) {
+    test.ok(err === null, "conn.getWarnings()");
+    test.same(warnings,
+              [{errno: 1051, reason: "Unknown table '" + cfg.test_table_notexists + "'" }],
+              "conn.getWarnings() after DROP TABLE IF EXISTS test_table_notexists");
+
+    conn.closeSync();
+    test.done();
+  });
+};
+
+exports.KeepAliveReconnect = function (test) {
+  test.expect(4);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    killer = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    threadId = conn.threadIdSync(),
+    stmt = conn.initStatementSync();
+
+  conn.setCharsetSync(cfg.charset);
+  stmt.prepareSync("SELECT 1;");
+
+  conn.setKeepAliveSync(50);
+  killer.querySync("KILL " + threadId + ";");
+  killer.closeSync();
+
+  setTimeout(function () {
+    test.notEqual(conn.threadIdSync(), threadId, "Dead connection is reconnected");
+    test.equals(conn.getCharsetNameSync(), cfg.charset, "Charset is replayed");
+    test.same(conn.querySync("SELECT 1 AS one;").fetchAllSync(), [{one: 1}], "Query works after reconnect");
+    test.ok(stmt.executeSync(), "Prepared statement is prepared again");
+
+    conn.closeSync();
+    test.done();
+  }, 500);
+};
+
+exports.LoadByKey = function (test) {
+  test.expect(7);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database), res, loaded = 0;
+
+  res = conn.querySync("DELETE FROM " + cfg.test_table + ";");
+  test.ok(res, "conn.querySync('DELETE FROM cfg.test_table')");
+
+  res = conn.querySync("INSERT INTO " + cfg.test_table + " (random_number, random_boolean) VALUES ('1', '0'), ('2', '0'), ('2', '1');");
+  test.ok(res, "conn.querySync('INSERT INTO cfg.test_table ...')");
+
+  function done() {
+    loaded += 1;
+    if (loaded === 3) {
+      conn.closeSync();
+      test.done();
+    }
+  }
+
+  conn.loadByKey(cfg.test_table, "random_number", 1, function (err, rows) {
+    test.ok(err === null, "conn.loadByKey() for key 1");
+    test.equals(rows.length, 1, "One row for key 1");
+    done();
+  });
+
+  conn.loadByKey(cfg.test_table, "random_number", "2", function (err, rows) {
+    test.equals(rows.length, 2, "Two rows for key 2");
+    done();
+  });
+
+  conn.loadByKey(cfg.test_table, "random_number", "3", function (err, rows) {
+    test.ok(err === null, "conn.loadByKey() for missing key");
+    test.same(rows, [], "No rows for key 3");
+    done();
+  });
+};
+
+exports.LoadByKeyNotExactKeys = function (test) {
+  test.expect(4);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database), loaded = 0;
+
+  conn.querySync("CREATE TEMPORARY TABLE load_by_key_decimal (d DECIMAL(10,2), s VARCHAR(10)) DEFAULT CHARSET=utf8 COLLATE=utf8_general_ci;");
+  conn.querySync("INSERT INTO load_by_key_decimal (d, s) VALUES (1, 'ABC');");
+
+  function done() {
+    loaded += 1;
+    if (loaded === 2) {
+      conn.closeSync();
+      test.done();
+    }
+  }
+
+  conn.loadByKey("load_by_key_decimal", "d", 1, function (err, rows) {
+    test.ok(err === null, "conn.loadByKey() for DECIMAL key");
+    test.equals(rows.length, 1, "Row with '1.00' is matched to key 1");
+    done();
+  });
+
+  conn.loadByKey("load_by_key_decimal", "s", "abc", function (err, rows) {
+    test.ok(err instanceof Error, "conn.loadByKey() for key matched by collation returns error");
+    test.ok(rows === undefined, "No rows for key matched by collation");
+    done();
+  });
+};
+
+exports.MultiQuery = function (test) {
+  test.expect(7);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  conn.multiQuery("SELECT 1 AS one; DELETE FROM " + cfg.test_table + "; SELECT 2 AS two;", function (err, results) {
+    test.ok(err === null, "Error object is not present");
+    test.ok(Array.isArray(results), "Results is an array");
+    test.equals(results.length, 3, "Every result set and OK packet is returned");
+
+    test.ok(results[0] instanceof cfg.mysql_bindings.MysqlResult, "results[0] instanceof MysqlResult");
+    test.same(results[0].fetchAllSync(), [{one: 1}], "First result set");
+    test.ok(typeof results[1].affectedRows === 'number', "results[1] is an OK packet");
+    test.same(results[2].fetchAllSync(), [{two: 2}], "Third result set");
+
+    results[0].freeSync();
+    results[2].freeSync();
+
+    conn.closeSync();
+    test.done();
+  });
+};
+
+exports.MultiQueryWithError = function (test) {
+  test.expect(3);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  conn.multiQuery("SELECT 1; SHOW TABLESaagh;", function (err, results) {
+    test.ok(err instanceof Error, "Error object is present");
+    test.ok(!results, "Results are not defined");
+    test.equals(err.message, "Query error #" + conn.errnoSync() + ": " + conn.errorSync(), "Callback exception in conn.multiQuery()");
+
+    conn.closeSync();
+    test.done();
+  });
+};
+
+exports.Ping = function (test) {
+  test.expect(1);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  conn.ping(function (err) {
+    test.ok(err === null, "conn.ping()");
+
+    conn.closeSync();
+    test.done();
+  });
+};
+
 exports.Query = function (test) {
   test.expect(3);
   
@@ -178,6 +542,112 @@ exports.QueryWithError = function (test) {
   });
 };
 
+exports.QueryWithTimeout = function (test) {
+  test.expect(4);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    start = Date.now();
+
+  conn.query("SELECT SLEEP(10);", {timeoutMs: 100}, function (err, res) {
+    test.ok(err, "conn.query() with timeoutMs returns error");
+    test.equals(err && err.message, "Query timeout", "Error message");
+    test.ok(Date.now() - start < 5000, "Query is killed before it completes");
+
+    // Connection is still usable after KILL QUERY
+    conn.query("SELECT 1;", function (err, res) {
+      test.ok(!err && res, "Next query succeeds");
+
+      conn.closeSync();
+      test.done();
+    });
+  });
+};
+
+exports.QueryWithTimeoutNotExpired = function (test) {
+  test.expect(2);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  test.throws(function () {
+    conn.query("SELECT 1;", {timeoutMs: -1}, function () {});
+  });
+
+  conn.query("SELECT 1;", {timeoutMs: 5000}, function (err, res) {
+    test.ok(!err && res, "conn.query() with timeoutMs returns result");
+
+    conn.closeSync();
+    test.done();
+  });
+};
+
+exports.QueryCoalescing = function (test) {
+  test.expect(5);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    query = "SELECT SLEEP(0.1) AS s UNION ALL SELECT 1;",
+    results = [];
+
+  conn.setQueryCoalescingSync(true);
+
+  function onResult(err, res) {
+    if (err) {
+      throw err;
+    }
+
+    results.push(res);
+
+    if (results.length === 3) {
+      test.equals(conn.queueStatsSync().coalesced, 2, "Two queries are coalesced");
+
+      // Each result has own cursor over shared result set
+      test.same(results[0].fetchRowSync(), {s: 0}, "First result, first row");
+      test.same(results[1].fetchRowSync(), {s: 0}, "Second result, first row");
+      test.same(results[0].fetchRowSync(), {s: 1}, "First result, second row");
+
+      results[0].freeSync();
+      test.same(results[2].fetchAllSync(), [{s: 0}, {s: 1}], "Third result is usable after first is freed");
+
+      conn.closeSync();
+      test.done();
+    }
+  }
+
+  conn.query(query, onResult);
+  conn.query(query, onResult);
+  conn.querySend(query, onResult);
+};
+
+exports.QueryCoalescingStoppedBySyncWrite = function (test) {
+  test.expect(1);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    query = "SELECT SLEEP(0.1) AS s;",
+    results = 0;
+
+  conn.setQueryCoalescingSync(true);
+
+  function onResult(err, res) {
+    if (err) {
+      throw err;
+    }
+
+    results += 1;
+    if (results === 2) {
+      test.equals(conn.queueStatsSync().coalesced, 0, "Read after querySync() write is not coalesced");
+
+      conn.closeSync();
+      test.done();
+    }
+  }
+
+  conn.query(query, onResult);
+  conn.querySync("SET @coalescing_test = 1;");
+  conn.query(query, onResult);
+};
+
 exports.QueryWithoutCallback = function (test) {
   test.expect(5);
   
@@ -287,3 +757,113 @@ exports.QuerySendWithError = function (test) {
     test.done();
   });
 };
+
+exports.ResetSession = function (test) {
+  test.expect(3);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    stmt = conn.initStatementSync();
+
+  stmt.prepareSync("SELECT 1;");
+  conn.querySync("SET @reset_session_test = 1;");
+
+  conn.resetSession(function (err) {
+    test.ok(err === null, "conn.resetSession()");
+
+    test.same(conn.querySync("SELECT @reset_session_test AS v;").fetchAllSync(), [{v: null}],
+              "User variables are dropped");
+
+    test.throws(function () {
+      stmt.executeSync();
+    }, /Statement not/, "Prepared statement is closed by conn.resetSession()");
+
+    conn.closeSync();
+    test.done();
+  });
+};
+
+exports.ResetSessionWithBoundParams = function (test) {
+  test.expect(2);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    stmt = conn.initStatementSync();
+
+  stmt.prepareSync("SELECT ? AS a, ? AS b;");
+  stmt.bindParamsSync([1, "text"]);
+
+  conn.resetSession(function (err) {
+    test.ok(err === null, "conn.resetSession() with bound statement parameters");
+
+    test.throws(function () {
+      stmt.bindParamsSync([2, "other"]);
+    }, /Statement not/, "Statement with freed parameters is closed");
+
+    conn.closeSync();
+    test.done();
+  });
+};
+
+exports.SelectDb = function (test) {
+  test.expect(3);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  conn.selectDb(cfg.database_denied, function (err) {
+    test.ok(err instanceof Error, "conn.selectDb() for denied database");
+    test.ok(err.message.match(/^selectDb\(\) error #1044: /), "Error message contains method name and errno");
+
+    conn.selectDb(cfg.database, function (err) {
+      test.ok(err === null, "conn.selectDb() for allowed database");
+
+      conn.closeSync();
+      test.done();
+    });
+  });
+};
+
+exports.SetCharset = function (test) {
+  test.expect(2);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  conn.setCharset(cfg.charset, function (err) {
+    test.ok(err === null, "conn.setCharset()");
+    test.equals(conn.getCharsetNameSync(), cfg.charset, "Charset is changed");
+
+    conn.closeSync();
+    test.done();
+  });
+};
+
+exports.Stat = function (test) {
+  test.expect(2);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  conn.stat(function (err, stat) {
+    test.ok(err === null, "conn.stat()");
+    test.ok(/Uptime: \d+/.test(stat), "conn.stat() result contains uptime");
+
+    conn.closeSync();
+    test.done();
+  });
+};
+
+exports.StoreResult = function (test) {
+  test.expect(2);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  conn.realQuerySync("SELECT 1 AS one;");
+
+  conn.storeResult(function (err, res) {
+    test.ok(err === null, "conn.storeResult()");
+    test.same(res.fetchAllSync(), [{one: 1}], "Stored result");
+
+    res.freeSync();
+    conn.closeSync();
+    test.done();
+  });
+};
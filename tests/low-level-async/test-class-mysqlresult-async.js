@@ -8,6 +8,79 @@ See license text in LICENSE file
 // Load configuration
 var cfg = require('../config.js');
 
+var fs = require('fs'), os = require('os'), path = require('path');
+
+/*
+ * Minimal Arrow IPC stream reader for fetchArrow() test: Int32, Utf8 and Null columns only
+ */
+function readArrowStream(stream) {
+  var pos = 0, schema = [], batches = [];
+
+  // FlatBuffers table field position, 0 for absent field
+  function field(table, id) {
+    var vtable = table - stream.readInt32LE(table), offset = 4 + 2 * id;
+    return offset < stream.readUInt16LE(vtable) && stream.readUInt16LE(vtable + offset) ?
+           table + stream.readUInt16LE(vtable + offset) : 0;
+  }
+  function deref(position) {
+    return position + stream.readUInt32LE(position);
+  }
+  function int64(position) {
+    return stream.readUInt32LE(position) + stream.readInt32LE(position + 4) * 0x100000000;
+  }
+
+  while (stream.readUInt32LE(pos) === 0xFFFFFFFF && stream.readUInt32LE(pos + 4) > 0) {
+    var meta = pos + 8, body = meta + stream.readUInt32LE(pos + 4),
+      message = deref(meta),
+      header = deref(field(message, 2)),
+      bodyLength = field(message, 3) ? int64(field(message, 3)) : 0,
+      i, vector;
+
+    if (stream.readUInt8(field(message, 1)) === 1) {
+      vector = deref(field(header, 1));
+      for (i = 0; i < stream.readUInt32LE(vector); i++) {
+        var f = deref(vector + 4 + 4 * i), name = deref(field(f, 0));
+        schema.push({name: stream.toString('utf8', name + 4, name + 4 + stream.readUInt32LE(name)),
+                     type: stream.readUInt8(field(f, 2))});
+      }
+    } else {
+      var length = int64(field(header, 0)),
+        nodes = deref(field(header, 1)) + 4,
+        buffers = deref(field(header, 2)) + 4,
+        columns = [];
+
+      schema.forEach(function (column, c) {
+        var values = [], nullCount = int64(nodes + 16 * c + 8), j, b;
+        function buffer() {
+          b = buffers; buffers += 16;
+          return [body + int64(b), int64(b + 8)];
+        }
+        if (column.type === 1) {
+          for (j = 0; j < length; j++) { values.push(null); }
+        } else {
+          var validity = buffer(), offsets = column.type === 5 ? buffer() : null, data = buffer();
+          for (j = 0; j < length; j++) {
+            if (validity[1] && !(stream[validity[0] + (j >> 3)] & (1 << (j & 7)))) {
+              values.push(null);
+            } else if (offsets) {
+              values.push(stream.toString('utf8', data[0] + stream.readInt32LE(offsets[0] + 4 * j),
+                                          data[0] + stream.readInt32LE(offsets[0] + 4 * j + 4)));
+            } else {
+              values.push(stream.readInt32LE(data[0] + 4 * j));
+            }
+          }
+        }
+        columns.push({nullCount: nullCount, values: values});
+      });
+      batches.push({length: length, columns: columns});
+    }
+
+    pos = body + bodyLength;
+  }
+
+  return {schema: schema, batches: batches};
+}
+
 exports.setupTestTable = function (test) {
   test.expect(1);
 
@@ -76,3 +149,311 @@ exports.ResultObjectManipulationsAfterFetchAll = function (test) {
     test.done();
   });
 };
+
+exports.FetchAllRaw = function (test) {
+  test.expect(5);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    res;
+
+  res = conn.querySync(
+    "SELECT random_number, NULL AS nothing FROM " + cfg.test_table + " WHERE random_boolean='1';"
+  );
+
+  res.fetchAll({raw: true}, function (err, raw, fields) {
+    test.ok(err === null, "res.fetchAll({raw: true}) err===null");
+
+    test.equals(raw.buffer.toString(), "12", "All values are packed in one Buffer");
+    test.same(Array.prototype.slice.call(raw.cells), [0, 1, 0xFFFFFFFF, 0, 1, 1, 0xFFFFFFFF, 0],
+              "Cells are (offset, length) pairs, NULL offset is 0xFFFFFFFF");
+    test.same(fields, raw.fields, "Callback fields argument == raw.fields");
+    test.equals(fields.length, 2, "Fields metadata");
+
+    res.freeSync();
+    conn.closeSync();
+
+    test.done();
+  });
+};
+
+exports.FetchAllLazy = function (test) {
+  test.expect(6);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    res;
+
+  res = conn.querySync(
+    "SELECT random_number, NULL AS nothing FROM " + cfg.test_table + " WHERE random_boolean='1';"
+  );
+
+  res.fetchAll({lazy: true}, function (err, rows, fields) {
+    test.ok(err === null, "res.fetchAll({lazy: true}) err===null");
+    test.equals(fields.length, 2, "Fields metadata");
+
+    // Rows outlive the result
+    res.freeSync();
+
+    test.strictEqual(rows[0].random_number, 1, "Column is decoded on access");
+    test.strictEqual(rows[0].nothing, null, "NULL column");
+    test.same(Object.keys(rows[1]), ["random_number", "nothing"], "Columns are enumerable");
+    test.equals(JSON.stringify(rows), '[{"random_number":1,"nothing":null},{"random_number":2,"nothing":null}]',
+                "JSON.stringify() works with lazy rows");
+
+    conn.closeSync();
+
+    test.done();
+  });
+};
+
+exports.FetchAllLazyDecimal = function (test) {
+  test.expect(3);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    query = "SELECT CAST(random_number / -4 AS DECIMAL(10,2)) AS amount FROM " + cfg.test_table +
+            " WHERE random_boolean='1' ORDER BY random_number;";
+
+  conn.querySync(query).fetchAll({lazy: true, decimal: 'number'}, function (err, rows) {
+    test.ok(err === null, "res.fetchAll({lazy: true, decimal: 'number'}) err===null");
+    test.strictEqual(rows[0].amount, -0.25, "Lazy row decodes DECIMAL with decimal option");
+    test.strictEqual(rows[1].amount, -0.5, "Lazy row decodes DECIMAL with decimal option");
+
+    conn.closeSync();
+
+    test.done();
+  });
+};
+
+exports.FetchAllParseJSON = function (test) {
+  test.expect(2);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    res;
+
+  res = conn.querySync("SELECT JSON_OBJECT('a', JSON_ARRAY(1, 'x'), 'b', NULL) AS doc;");
+
+  res.fetchAll({parseJSON: true}, function (err, rows, fields) {
+    test.ok(err === null, "res.fetchAll({parseJSON: true}) err===null");
+
+    // MariaDB sends JSON columns as LONGTEXT, they stay strings
+    var doc = fields[0].type === 245 ? rows[0].doc : JSON.parse(rows[0].doc);
+    test.same(doc, {a: [1, "x"], b: null}, "JSON column is parsed");
+
+    res.freeSync();
+    conn.closeSync();
+
+    test.done();
+  });
+};
+
+exports.FetchAllParseJSONProtoKey = function (test) {
+  test.expect(3);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    res;
+
+  res = conn.querySync("SELECT CAST('{\"__proto__\": {\"polluted\": 1}}' AS JSON) AS doc;");
+  if (!res) {
+    // Server without JSON type
+    conn.closeSync();
+    test.expect(0);
+    test.done();
+    return;
+  }
+
+  res.fetchAll({parseJSON: true}, function (err, rows) {
+    test.ok(err === null, "res.fetchAll({parseJSON: true}) err===null");
+    test.ok(Object.getPrototypeOf(rows[0].doc) === Object.prototype, "Prototype is not changed");
+    test.same(rows[0].doc, JSON.parse('{"__proto__": {"polluted": 1}}'), "Key is own property");
+
+    res.freeSync();
+    conn.closeSync();
+
+    test.done();
+  });
+};
+
+exports.FetchAllDecimal = function (test) {
+  test.expect(6);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    query = "SELECT CAST(random_number / -4 AS DECIMAL(10,2)) AS amount FROM " + cfg.test_table +
+            " WHERE random_boolean='1' ORDER BY random_number;";
+
+  test.same(conn.querySync(query).fetchAllSync(), [{amount: "-0.25"}, {amount: "-0.50"}], "DECIMAL is string by default");
+  test.same(conn.querySync(query).fetchAllSync({decimal: 'number'}), [{amount: -0.25}, {amount: -0.5}],
+            "res.fetchAllSync({decimal: 'number'})");
+  test.throws(function () {
+    conn.querySync(query).fetchAllSync({decimal: 'float'});
+  }, TypeError, "Unknown decimal mode throws");
+
+  conn.querySync(query).fetchAll({decimal: 'scaled', asArray: true}, function (err, rows, fields) {
+    test.ok(err === null, "res.fetchAll({decimal: 'scaled'}) err===null");
+    test.same(rows, [[-25], [-50]], "Scaled DECIMAL values are integer mantissas");
+    test.equals(fields[0].decimals, 2, "Scale is field decimals");
+
+    conn.closeSync();
+
+    test.done();
+  });
+};
+
+exports.FetchAllJSON = function (test) {
+  test.expect(3);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    query = "SELECT random_number, CONCAT('\"q\"\\n', random_number) AS title, NULL AS nothing FROM " +
+            cfg.test_table + " WHERE random_boolean='1';",
+    res = conn.querySync(query);
+
+  res.fetchAllJSON(function (err, buffer) {
+    test.ok(err === null, "res.fetchAllJSON() err===null");
+    test.equals(buffer.toString(), JSON.stringify(conn.querySync(query).fetchAllSync()),
+                "Same JSON as JSON.stringify(rows)");
+
+    res = conn.querySync(query);
+    res.fetchAllJSON({asArray: true}, function (err, buffer) {
+      test.same(JSON.parse(buffer.toString()), [[1, "\"q\"\n1", null], [2, "\"q\"\n2", null]],
+                "res.fetchAllJSON() with asArray option");
+
+      conn.closeSync();
+
+      test.done();
+    });
+  });
+};
+
+exports.FetchAllJSONInvalidUtf8 = function (test) {
+  test.expect(2);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    query = "SELECT CAST(X'61FF62' AS CHAR) AS title;",
+    res = conn.querySync(query);
+
+  res.fetchAllJSON(function (err, buffer) {
+    test.ok(err === null, "res.fetchAllJSON() err===null");
+    test.same(JSON.parse(buffer.toString()), conn.querySync(query).fetchAllSync(),
+              "Invalid UTF-8 is replaced as in fetchAllSync() rows");
+
+    conn.closeSync();
+
+    test.done();
+  });
+};
+
+exports.FetchAllJSONResultIsBusy = function (test) {
+  test.expect(4);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    res = conn.querySync("SELECT random_number FROM " + cfg.test_table + " WHERE random_boolean='1' ORDER BY random_number;");
+
+  res.fetchAllJSON(function (err, buffer) {
+    test.ok(err === null, "res.fetchAllJSON() err===null");
+    res.dataSeekSync(0);
+    test.same(res.fetchRowSync(), {random_number: 1}, "res.fetchRowSync() works after callback");
+
+    res.freeSync();
+    conn.closeSync();
+
+    test.done();
+  });
+
+  test.throws(function () {
+    res.fetchRowSync();
+  }, "res.fetchRowSync() throws while rows are fetched in threadpool");
+  test.throws(function () {
+    res.freeSync();
+  }, "res.freeSync() throws while rows are fetched in threadpool");
+};
+
+exports.ExportTo = function (test) {
+  test.expect(5);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    query = "SELECT random_number, IF(random_number = 1, 'a,\"b\"', '') AS title, NULL AS nothing FROM " +
+            cfg.test_table + " WHERE random_boolean='1' ORDER BY random_number;",
+    file = path.join(os.tmpdir(), "mysql-libmysqlclient-export-" + process.pid),
+    res = conn.querySync(query);
+
+  res.exportTo(file, {format: 'csv', header: true}, function (err, rowCount) {
+    test.ok(err === null, "res.exportTo() err===null");
+    test.equals(rowCount, 2, "res.exportTo() row count");
+    test.equals(fs.readFileSync(file, 'utf8'),
+                'random_number,title,nothing\n1,"a,""b""",\n2,"",\n', "CSV output");
+
+    var fd = fs.openSync(file, 'w');
+    res = conn.querySync(query);
+    res.exportTo(fd, {format: 'tsv'}, function (err) {
+      test.ok(err === null, "res.exportTo() to fd err===null");
+
+      fs.closeSync(fd);
+      test.equals(fs.readFileSync(file, 'utf8'), '1\ta,"b"\t\\N\n2\t\t\\N\n', "TSV output");
+
+      fs.unlinkSync(file);
+      conn.closeSync();
+
+      test.done();
+    });
+  });
+};
+
+exports.ExportToResultIsBusy = function (test) {
+  test.expect(2);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    file = path.join(os.tmpdir(), "mysql-libmysqlclient-export-busy-" + process.pid),
+    res = conn.querySync("SELECT random_number FROM " + cfg.test_table + ";");
+
+  res.exportTo(file, function (err) {
+    test.ok(err === null, "res.exportTo() err===null");
+
+    fs.unlinkSync(file);
+    res.freeSync();
+    conn.closeSync();
+
+    test.done();
+  });
+
+  test.throws(function () {
+    res.dataSeekSync(0);
+  }, "res.dataSeekSync() throws while rows are exported in threadpool");
+};
+
+exports.FetchArrow = function (test) {
+  test.expect(5);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    res = conn.querySync("SELECT random_number, IF(random_number = 1, CONCAT('n', random_number), NULL) AS title, " +
+                         "NULL AS nothing FROM " + cfg.test_table + " WHERE random_boolean='1' ORDER BY random_number;");
+
+  res.fetchArrow(function (err, buffers) {
+    test.ok(err === null, "res.fetchArrow() err===null");
+    test.equals(buffers.length, 3, "Schema, record batch and end-of-stream marker");
+
+    var stream = readArrowStream(Buffer.concat(buffers));
+
+    test.same(stream.schema, [{name: "random_number", type: 2}, {name: "title", type: 5}, {name: "nothing", type: 1}],
+              "Schema fields names and types");
+    test.equals(stream.batches[0].length, 2, "Record batch length");
+    test.same(stream.batches[0].columns, [
+      {nullCount: 0, values: [1, 2]},
+      {nullCount: 1, values: ["n1", null]},
+      {nullCount: 2, values: [null, null]}
+    ], "Record batch columns");
+
+    conn.closeSync();
+
+    test.done();
+  });
+};
@@ -0,0 +1,176 @@
+/*
+Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+See contributors list in README
+
+See license text in LICENSE file
+*/
+
+// Load configuration
+var cfg = require('../config.js');
+
+exports.setupTestTable = function (test) {
+  test.expect(1);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database), res;
+
+  res = conn.querySync("DELETE FROM " + cfg.test_table + ";");
+  res = conn.querySync("INSERT INTO " + cfg.test_table +
+                       " (random_number, random_boolean) VALUES (1, 1), (2, 1), (3, 0);") && res;
+  test.ok(res, "INSERT");
+
+  conn.closeSync();
+
+  test.done();
+};
+
+exports.Run = function (test) {
+  test.expect(4);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    stmt = conn.initStatementSync();
+
+  test.ok(stmt.prepareSync("SELECT random_number, CONCAT('n', random_number) AS title FROM " + cfg.test_table +
+                           " WHERE random_boolean = ? ORDER BY random_number;"), "stmt.prepareSync()");
+
+  stmt.run([1], function (err, rows) {
+    test.ok(err === null, "stmt.run() err === null");
+    test.same(rows, [{random_number: 1, title: "n1"}, {random_number: 2, title: "n2"}], "stmt.run() rows");
+
+    // Statement can be run again with other parameters
+    stmt.run([0], {asArray: true}, function (err, rows) {
+      test.same(rows, [[3, "n3"]], "stmt.run() with asArray option");
+
+      stmt.closeSync();
+      conn.closeSync();
+
+      test.done();
+    });
+  });
+};
+
+exports.RunWithoutResultSet = function (test) {
+  test.expect(2);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    stmt = conn.initStatementSync();
+
+  stmt.prepareSync("INSERT INTO " + cfg.test_table + " (random_number, random_boolean) VALUES (?, ?);");
+
+  stmt.run([4, 0], function (err, info) {
+    test.ok(err === null, "stmt.run() err === null");
+    test.equals(info.affectedRows, 1, "stmt.run() affectedRows");
+
+    stmt.closeSync();
+    conn.closeSync();
+
+    test.done();
+  });
+};
+
+exports.RunWithError = function (test) {
+  test.expect(3);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    stmt = conn.initStatementSync();
+
+  stmt.prepareSync("INSERT INTO " + cfg.test_table + " (id, random_number, random_boolean) VALUES (?, 5, 0);");
+
+  test.throws(function () {
+    stmt.run([1, 2], function () {});
+  }, "stmt.run() with wrong parameters count");
+
+  stmt.run([1000], function (err) {
+    test.ok(err === null, "stmt.run() err === null");
+
+    // Duplicate primary key
+    stmt.run([1000], function (err) {
+      test.ok(err instanceof Error, "stmt.run() error is passed to callback");
+
+      stmt.closeSync();
+      conn.closeSync();
+
+      test.done();
+    });
+  });
+};
+
+exports.RunIsBusy = function (test) {
+  test.expect(4);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    stmt = conn.initStatementSync();
+
+  stmt.prepareSync("SELECT ? AS value;");
+
+  stmt.run([1], function (err, rows) {
+    test.same(rows, [{value: 1}], "stmt.run() rows");
+
+    // Parameters can be bound again after run() is finished
+    test.ok(stmt.bindParamsSync([3]), "stmt.bindParamsSync() after stmt.run()");
+
+    stmt.closeSync();
+    conn.closeSync();
+
+    test.done();
+  });
+
+  test.throws(function () {
+    stmt.run([2], function () {});
+  }, "stmt.run() while previous run() is in threadpool");
+  test.throws(function () {
+    stmt.bindParamsSync([2]);
+  }, "stmt.bindParamsSync() while run() is in threadpool");
+};
+
+exports.FetchAll = function (test) {
+  test.expect(3);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    stmt = conn.initStatementSync();
+
+  stmt.prepareSync("SELECT random_number, CONCAT('n', random_number) AS title FROM " + cfg.test_table +
+                   " WHERE random_number < 3 ORDER BY random_number;");
+  stmt.executeSync();
+  stmt.storeResultSync();
+  test.ok(stmt.bindResultSync(), "stmt.bindResultSync()");
+
+  stmt.fetchAll(function (err, rows) {
+    test.ok(err === null, "stmt.fetchAll() err === null");
+    test.same(rows, [{random_number: 1, title: "n1"}, {random_number: 2, title: "n2"}], "stmt.fetchAll() rows");
+
+    stmt.closeSync();
+    conn.closeSync();
+
+    test.done();
+  });
+};
+
+exports.FetchAllJSON = function (test) {
+  test.expect(2);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    stmt = conn.initStatementSync();
+
+  stmt.prepareSync("SELECT random_number, CONCAT('n', random_number) AS title FROM " + cfg.test_table +
+                   " WHERE random_number < 3 ORDER BY random_number;");
+  stmt.executeSync();
+  stmt.storeResultSync();
+  stmt.bindResultSync();
+
+  stmt.fetchAllJSON(function (err, buffer) {
+    test.ok(err === null, "stmt.fetchAllJSON() err === null");
+    test.same(JSON.parse(buffer.toString()), [{random_number: 1, title: "n1"}, {random_number: 2, title: "n2"}],
+              "stmt.fetchAllJSON() rows");
+
+    stmt.closeSync();
+    conn.closeSync();
+
+    test.done();
+  });
+};
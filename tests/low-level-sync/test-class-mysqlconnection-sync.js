@@ -195,6 +195,38 @@ exports.ConnectErrorGetter = function (test) {
   test.done();
 };
 
+exports.LastQueryTimeGetter = function (test) {
+  test.expect(2);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+  test.strictEqual(conn.lastQueryTime, 0, "conn.lastQueryTime before queries");
+
+  conn.query("SELECT SLEEP(0.01);", function (err, res) {
+    test.ok(conn.lastQueryTime >= 10, "conn.lastQueryTime after query");
+
+    conn.closeSync();
+    test.done();
+  });
+};
+
+exports.QueryTimeEwmaGetter = function (test) {
+  test.expect(3);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+  test.strictEqual(conn.queryTimeEwma, 0, "conn.queryTimeEwma before queries");
+
+  conn.query("SELECT SLEEP(0.01);", function (err, res) {
+    test.equals(conn.queryTimeEwma, conn.lastQueryTime, "First sample initializes conn.queryTimeEwma");
+
+    conn.query("SELECT 1;", function (err, res) {
+      test.ok(conn.queryTimeEwma < 10 && conn.queryTimeEwma > conn.lastQueryTime, "conn.queryTimeEwma is smoothed");
+
+      conn.closeSync();
+      test.done();
+    });
+  });
+};
+
 exports.AffectedRowsSync = function (test) {
   test.expect(5);
 
@@ -609,6 +641,22 @@ exports.QuerySync = function (test) {
   test.done();
 };
 
+exports.QueueStatsSync = function (test) {
+  test.expect(4);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    stats = conn.queueStatsSync();
+
+  test.equals(stats.depth, 0, "Queue is empty");
+  test.same(stats.depthByPriority, [0, 0, 0], "Queue depth by priority");
+  test.equals(stats.busy, false, "Queue is not busy");
+  test.equals(stats.enqueued, 0, "No queries were enqueued");
+
+  conn.closeSync();
+  test.done();
+};
+
 exports.RealConnectSync = function (test) {
   initAndRealConnectSync(test);
 };
@@ -642,6 +690,48 @@ exports.SetCharsetSync = function (test) {
   test.done();
 };
 
+exports.SetQueryCoalescingSync = function (test) {
+  test.expect(2);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  test.doesNotThrow(function () {
+    conn.setQueryCoalescingSync(true);
+    conn.setQueryCoalescingSync(false);
+  });
+
+  test.throws(function () {
+    conn.setQueryCoalescingSync("yes");
+  });
+
+  conn.closeSync();
+  test.done();
+};
+
+exports.SetKeepAliveSync = function (test) {
+  test.expect(3);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  test.doesNotThrow(function () {
+    conn.setKeepAliveSync(1000);
+    conn.setKeepAliveSync(0);
+  }, "conn.setKeepAliveSync() enables and disables keepalive");
+
+  test.throws(function () {
+    conn.setKeepAliveSync(-1);
+  }, TypeError, "conn.setKeepAliveSync() with negative interval");
+
+  conn.setKeepAliveSync(1000);
+  conn.closeSync();
+
+  test.throws(function () {
+    conn.setKeepAliveSync(1000);
+  }, /Not connected/, "conn.setKeepAliveSync() on closed connection");
+
+  test.done();
+};
+
 exports.SetOptionSync = function (test) {
   test.expect(2);
   
@@ -727,6 +817,56 @@ exports.SqlStateSync = function (test) {
   test.done();
 };
 
+exports.SslSessionReusedSync = function (test) {
+  test.expect(5);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(),
+    key = path.resolve(__dirname, '../ssl-fixtures/client-key.pem'),
+    cert = path.resolve(__dirname, '../ssl-fixtures/client-cert.pem'),
+    ca = path.resolve(__dirname, '../ssl-fixtures/ca-cert.pem'),
+    status;
+
+  conn.initSync();
+  conn.setSslSync(key, cert, ca, "", "HIGH");
+  conn.realConnectSync(cfg.host, cfg.user, cfg.password, cfg.database);
+  if (!conn.connectedSync() && (conn.connectErrno == 2026)) {
+    // Server has no SSL support
+    test.expect(0);
+    test.done();
+    return;
+  }
+
+  test.equals(typeof conn.sslSessionReusedSync(), "boolean", "conn.sslSessionReusedSync() returns boolean");
+  status = conn.querySync("SHOW SESSION STATUS LIKE 'Ssl_session_reused';").fetchAllSync();
+  conn.closeSync();
+  if (status.length === 0) {
+    // Server does not support TLS session resumption
+    test.expect(1);
+    test.done();
+    return;
+  }
+
+  // Second connection with the same TLS setup resumes cached session
+  conn.initSync();
+  conn.setSslSync(key, cert, ca, "", "HIGH");
+  conn.realConnectSync(cfg.host, cfg.user, cfg.password, cfg.database);
+  test.ok(conn.sslSessionReusedSync(), "conn.sslSessionReusedSync() after connect with the same TLS setup");
+  status = conn.querySync("SHOW SESSION STATUS LIKE 'Ssl_session_reused';").fetchAllSync();
+  test.equals(status[0].Value, "ON", "Server reports resumed TLS session");
+  conn.closeSync();
+
+  // Session is not offered under other trust settings
+  conn.initSync();
+  conn.setSslSync(null, null, ca, "", "HIGH");
+  conn.realConnectSync(cfg.host, cfg.user, cfg.password, cfg.database);
+  test.ok(conn.connectedSync(), "Connect with other TLS setup");
+  test.ok(!conn.sslSessionReusedSync(), "TLS session of other setup is not resumed");
+  conn.closeSync();
+
+  test.done();
+};
+
 exports.StatSync = function (test) {
   test.expect(2);
   
@@ -0,0 +1,67 @@
+#!/usr/bin/env node
+/*
+Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+See contributors list in README
+
+See license text in LICENSE file
+*/
+
+/**
+ * TLS reconnect storm benchmark
+ *
+ * Opens and closes TLS connections to local server in a tight loop
+ * using certificates from tests/ssl-fixtures and prints connects per second
+ * and how many of them resumed cached TLS session.
+ *
+ * Usage: ./tools/benchmark-ssl-reconnect.js [connectsCount]
+ **/
+
+var
+// Require modules
+  path = require("path"),
+  mysql = require("../"),
+// Load configuration
+  cfg = require("../tests/config"),
+// Parameters
+  connectsCount = parseInt(process.argv[2], 10) || cfg.slow_connects_inloop * 10,
+  fixturesDir = path.resolve(__dirname, "../tests/ssl-fixtures"),
+  key = path.join(fixturesDir, "client-key.pem"),
+  cert = path.join(fixturesDir, "client-cert.pem"),
+  ca = path.join(fixturesDir, "ca-cert.pem");
+
+function sslConnect() {
+  var conn = new mysql.bindings.MysqlConnection();
+
+  conn.initSync();
+  conn.setSslSync(key, cert, ca, "", "ALL");
+  conn.realConnectSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  if (!conn.connectedSync()) {
+    throw new Error("Connection error #" + conn.connectErrno + ": " + conn.connectError);
+  }
+
+  return conn;
+}
+
+var
+  startTime = Date.now(),
+  reused = 0,
+  conn,
+  i,
+  elapsed;
+
+for (i = 0; i < connectsCount; i += 1) {
+  conn = sslConnect();
+
+  if (conn.sslSessionReusedSync()) {
+    reused += 1;
+  }
+
+  conn.closeSync();
+}
+
+elapsed = (Date.now() - startTime) / 1000;
+
+console.log(connectsCount + " TLS connects in " + elapsed.toFixed(2) + " sec: " +
+            Math.round(connectsCount / elapsed) + " connects/sec, " +
+            reused + " resumed sessions");